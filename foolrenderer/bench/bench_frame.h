@@ -0,0 +1,46 @@
+#pragma once
+
+// A procedural frame like the ones the renderer writes, shared by the
+// benchmarks of the image writers: the clear color of the renderer with a
+// shaded disk in the middle. Only included by the programs in this directory.
+
+#include <cmath>
+#include <memory>
+
+#include "graphics/color.h"
+#include "graphics/texture.h"
+
+#define BENCH_FRAME_SIZE 1024
+
+inline std::unique_ptr<Texture> make_procedural_frame()
+{
+    auto texture = std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_FRAME_SIZE,
+                                             BENCH_FRAME_SIZE);
+    uint8_t *pixel = texture->get_pixels();
+    for (uint32_t y = 0; y < BENCH_FRAME_SIZE; y++)
+    {
+        for (uint32_t x = 0; x < BENCH_FRAME_SIZE; x++)
+        {
+            float dx = (x - BENCH_FRAME_SIZE * 0.5f) / (BENCH_FRAME_SIZE * 0.3f);
+            float dy = (y - BENCH_FRAME_SIZE * 0.5f) / (BENCH_FRAME_SIZE * 0.3f);
+            float distance = dx * dx + dy * dy;
+            if (distance < 1.0f)
+            {
+                float shade = sqrtf(1.0f - distance);
+                pixel[0] = float_to_uint8(shade);
+                pixel[1] = float_to_uint8(shade * 0.6f);
+                pixel[2] = float_to_uint8(shade * 0.3f + 0.1f * sinf(x * 0.2f));
+            }
+            else
+            {
+                // FrameBuffer::set_clear_color(0.49f, 0.33f, 0.41f, 1.0f) of the renderer.
+                pixel[0] = 125;
+                pixel[1] = 84;
+                pixel[2] = 105;
+            }
+            pixel[3] = 0xFF;
+            pixel += 4;
+        }
+    }
+    return texture;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+// The cut_fish scene of the renderer, shared by the benchmarks that render
+// frames. Other models can be loaded into the same scene, with the same
+// camera and light. Only included by the programs in this directory.
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "graphics/framebuffer.h"
+#include "graphics/rasterizer.h"
+#include "graphics/texture.h"
+#include "graphics/tone_mapping.h"
+#include "rmath/rmatrix.h"
+#include "shaders/shadow_casting.h"
+#include "shaders/standard.h"
+#include "utility/image.h"
+#include "utility/mesh.h"
+
+#define BENCH_SHADOW_MAP_SIZE 1024
+#define BENCH_IMAGE_SIZE 1024
+#define BENCH_CAMERA_TARGET (vec3{0.0f, 0.4f, 0.0f})
+
+struct BenchScene
+{
+    std::unique_ptr<Mesh> mesh;
+    std::unique_ptr<MaterialTexture> material_map;
+    FrameBuffer shadow_framebuffer;
+    FrameBuffer framebuffer;
+    standard_uniform uniform;
+};
+
+// Loads the assets and renders the shadow map. The maps of the material are
+// loaded from material_path, which ends with a '/', a model without maps
+// gets the default material of MaterialTexture::pack() if it is empty.
+// Returns false if the assets can not be loaded, the programs must be run from
+// the repository root.
+inline bool initialize_bench_scene(BenchScene &scene, const std::string &model_path = "./assets/cut_fish/cut_fish.obj",
+                                   const std::string &material_path = "./assets/cut_fish/",
+                                   uint32_t width = BENCH_IMAGE_SIZE, uint32_t height = BENCH_IMAGE_SIZE)
+{
+    scene.mesh = std::make_unique<Mesh>(model_path);
+    if (material_path.empty())
+    {
+        scene.material_map = MaterialTexture::pack(nullptr, nullptr, nullptr, nullptr);
+    }
+    else
+    {
+        scene.material_map = load_material(material_path + "base_color.tga", material_path + "normal.tga",
+                                           material_path + "metallic.tga", material_path + "roughness.tga");
+    }
+    if (scene.mesh->triangle_count == 0 || !scene.material_map)
+    {
+        return false;
+    }
+    scene.shadow_framebuffer.attach_texture(attachment_type::DEPTH_ATTACHMENT,
+                                            std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_DEPTH16,
+                                                                      BENCH_SHADOW_MAP_SIZE, BENCH_SHADOW_MAP_SIZE));
+    scene.framebuffer.attach_texture(attachment_type::COLOR_ATTACHMENT,
+                                     std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_RGBA_FLOAT, width,
+                                                               height));
+    scene.framebuffer.attach_texture(attachment_type::DEPTH_ATTACHMENT,
+                                     std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_DEPTH_FLOAT, width,
+                                                               height));
+
+    // The same light and shadow map as the renderer.
+    vec3 light_direction{1.0f, 4.0f, -1.0f};
+    matrix4x4 world2view = matrix_t::look_at(light_direction.normalize() * 5.0f, VEC3_ZERO, vec3{0.0f, 1.0f, 0.0f});
+    matrix4x4 light_world2clip = matrix_t::orthographic(1.5f, 1.5f, 0.1f, 6.0f) * world2view;
+    set_viewport(0, 0, BENCH_SHADOW_MAP_SIZE, BENCH_SHADOW_MAP_SIZE);
+    set_vertex_shader(shadow_casting_vertex_shader);
+    set_fragment_shader(shadow_casting_fragment_shader);
+    scene.shadow_framebuffer.clear();
+    shadow_casting_uniform shadow_uniform;
+    shadow_uniform.local2clip = light_world2clip;
+    transformed_vertices vertices;
+    const Mesh &mesh = *scene.mesh;
+    transform_vertices(light_world2clip, mesh.positions_x.get(), mesh.positions_y.get(), mesh.positions_z.get(),
+                       mesh.vertex_count, vertices);
+    for (uint32_t t = 0; t < mesh.triangle_count; t++)
+    {
+        draw_transformed_triangle(&scene.shadow_framebuffer, &shadow_uniform, vertices, mesh.indices.get() + t * 3,
+                                  nullptr);
+    }
+    scene.shadow_framebuffer.resolve(attachment_type::DEPTH_ATTACHMENT);
+
+    standard_uniform &uniform = scene.uniform;
+    uniform.local2world = MATRIX4x4_IDENTITY;
+    uniform.local2world_direction = uniform.local2world.to_3x3();
+    uniform.local2world_normal = uniform.local2world_direction;
+    uniform.light_direction = light_direction.normalize();
+    uniform.illuminance = vec3{4.0f, 4.0f, 4.0f};
+    matrix4x4 scale_bias = {{0.5f, 0.0f, 0.0f, 0.5f},
+                            {0.0f, 0.5f, 0.0f, 0.5f},
+                            {0.0f, 0.0f, 0.5f, 0.5f},
+                            {0.0f, 0.0f, 0.0f, 1.0f},
+                            false};
+    uniform.world2light = scale_bias * light_world2clip;
+    uniform.shadow_map = scene.shadow_framebuffer.depth_buffer.get();
+    uniform.ambient_luminance = vec3{1.0f, 0.5f, 0.8f};
+    uniform.base_color = VEC3_ONE;
+    uniform.metallic = 1.0f;
+    uniform.roughness = 1.0f;
+    uniform.reflectance = 0.5f;
+    uniform.material_map = scene.material_map.get();
+    uniform.normal_map = nullptr;
+    uniform.base_color_map = nullptr;
+    uniform.metallic_map = nullptr;
+    uniform.roughness_map = nullptr;
+    return true;
+}
+
+// Sets up the viewport, the vertex shader and the camera of a view into the
+// framebuffer, and clears it. The camera looks at BENCH_CAMERA_TARGET from the
+// camera position. Returns the world2view matrix.
+inline matrix4x4 begin_bench_view(BenchScene &scene, FrameBuffer &framebuffer, vec3 camera_position)
+{
+    set_viewport(0, 0, framebuffer.m_width, framebuffer.m_height);
+    set_vertex_shader(standard_vertex_shader);
+    FrameBuffer::set_clear_color(0.49f, 0.33f, 0.41f, 1.0f);
+    scene.uniform.camera_position = camera_position;
+    matrix4x4 world2view = matrix_t::look_at(camera_position, BENCH_CAMERA_TARGET, vec3{0.0f, 1.0f, 0.0f});
+    // Wider framebuffers see more of the scene, not a stretched one.
+    float aspect = (float)framebuffer.m_width / framebuffer.m_height;
+    scene.uniform.world2clip = matrix_t::orthographic(2.0f * aspect, 2.0f, 0.1f, 10.0f) * world2view;
+    framebuffer.clear();
+    return world2view;
+}
+
+// Draws the scene from the camera position into a framebuffer with an HDR
+// color buffer, of any size, with the fragment shader or packet fragment
+// shader that is set. The framebuffer is cleared first and not resolved.
+inline void draw_bench_view(BenchScene &scene, FrameBuffer &framebuffer, vec3 camera_position)
+{
+    begin_bench_view(scene, framebuffer, camera_position);
+    const Mesh &mesh = *scene.mesh;
+    for (uint32_t t = 0; t < mesh.triangle_count; t++)
+    {
+        standard_vertex_attribute attributes[3];
+        const void *attribute_ptrs[3];
+        for (uint32_t v = 0; v < 3; v++)
+        {
+            attributes[v].position = mesh.get_mesh_position(t, v);
+            attributes[v].normal = mesh.get_mesh_normal(t, v);
+            attributes[v].tangent = mesh.get_mesh_tangent(t, v);
+            attributes[v].texcoord = mesh.get_mesh_texcoord(t, v);
+            attribute_ptrs[v] = attributes + v;
+        }
+        draw_triangle(&framebuffer, &scene.uniform, attribute_ptrs);
+    }
+}
+
+// Renders the scene from the camera position into output, an SRGB8_A8 texture,
+// with the fragment shader or packet fragment shader that is set. Returns the
+// milliseconds the pass took.
+inline double render_bench_view(BenchScene &scene, vec3 camera_position, Texture &output)
+{
+    auto start = std::chrono::steady_clock::now();
+    draw_bench_view(scene, scene.framebuffer, camera_position);
+    tone_mapping_settings tone_mapping;
+    tone_mapping.exposure = 1.0f;
+    tone_mapping.tone_operator = tone_mapping_operator::TONE_MAPPING_NONE;
+    resolve_hdr(scene.framebuffer, output, tone_mapping);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
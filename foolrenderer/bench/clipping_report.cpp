@@ -0,0 +1,87 @@
+// Moves a perspective camera towards the cut_fish model until it is inside of
+// it, and reports for each view how many triangles took each path through
+// clipping and the time of the frame. Close views have many triangles beyond
+// the edges of the viewport, which are rasterized in the guard band, and the
+// last ones cross the near plane, which is the only case that is clipped.
+//
+// Usage: clipping_report [views] [frame directory]
+// If a directory is given, the frame of each view is written there. Run from
+// the repository root so that the assets can be found.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "bench_scene.h"
+
+#define FIELD_OF_VIEW 1.0f
+#define NEAR_PLANE 0.1f
+#define FAR_PLANE 10.0f
+// The distances of the first and the last camera position to the target.
+#define FIRST_DISTANCE 4.0f
+#define LAST_DISTANCE 0.3f
+
+int main(int argc, char *argv[])
+{
+    int view_count = argc > 1 ? std::max(atoi(argv[1]), 2) : 8;
+    const char *frame_directory = argc > 2 ? argv[2] : nullptr;
+
+    BenchScene scene;
+    if (!initialize_bench_scene(scene))
+    {
+        printf("Can not load the cut_fish assets, run from the repository root.\n");
+        return 1;
+    }
+    set_packet_fragment_shader(standard_packet_fragment_shader);
+    Texture frame(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    tone_mapping_settings tone_mapping;
+    tone_mapping.exposure = 1.0f;
+    tone_mapping.tone_operator = tone_mapping_operator::TONE_MAPPING_NONE;
+    vec3 direction = vec3{-2.0f, 4.5f, 4.0f}.normalize();
+
+    printf("%d views of %dx%d, %u triangles:\n", view_count, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE,
+           scene.mesh->triangle_count);
+    printf("distance  ms/frame    inside  guard band   clipped    culled\n");
+    for (int view = 0; view < view_count; view++)
+    {
+        float distance = FIRST_DISTANCE + (LAST_DISTANCE - FIRST_DISTANCE) * view / (view_count - 1);
+        vec3 camera_position = BENCH_CAMERA_TARGET + direction * distance;
+        auto start = std::chrono::steady_clock::now();
+        matrix4x4 world2view = begin_bench_view(scene, scene.framebuffer, camera_position);
+        scene.uniform.world2clip = matrix_t::perspective(FIELD_OF_VIEW, 1.0f, NEAR_PLANE, FAR_PLANE) * world2view;
+        end_frame_statistics();
+        const Mesh &mesh = *scene.mesh;
+        for (uint32_t t = 0; t < mesh.triangle_count; t++)
+        {
+            standard_vertex_attribute attributes[3];
+            const void *attribute_ptrs[3];
+            for (uint32_t v = 0; v < 3; v++)
+            {
+                attributes[v].position = mesh.get_mesh_position(t, v);
+                attributes[v].normal = mesh.get_mesh_normal(t, v);
+                attributes[v].tangent = mesh.get_mesh_tangent(t, v);
+                attributes[v].texcoord = mesh.get_mesh_texcoord(t, v);
+                attribute_ptrs[v] = attributes + v;
+            }
+            draw_triangle(&scene.framebuffer, &scene.uniform, attribute_ptrs);
+        }
+        resolve_hdr(scene.framebuffer, frame, tone_mapping);
+        auto end = std::chrono::steady_clock::now();
+
+        pipeline_statistics statistics = end_frame_statistics();
+        printf("%8.2f  %8.1f  %8llu  %10llu  %8llu  %8llu\n", distance,
+               std::chrono::duration<double, std::milli>(end - start).count(),
+               (unsigned long long)statistics.inside_triangles, (unsigned long long)statistics.guard_band_triangles,
+               (unsigned long long)statistics.clipped_triangles, (unsigned long long)statistics.culled_triangles);
+        if (frame_directory)
+        {
+            std::string path = std::string(frame_directory) + "/clipping_" + std::to_string(view + 1) + ".tga";
+            if (!save_image(frame, path, false, true))
+            {
+                printf("Can not write %s\n", path.c_str());
+            }
+        }
+    }
+    return 0;
+}
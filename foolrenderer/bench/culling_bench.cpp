@@ -0,0 +1,110 @@
+// Draws a grid of copies of the cut_fish model, of which the camera sees only
+// a few, with and without culling the copies against the view frustum. Without
+// culling the vertices of every copy are fetched and shaded, and its triangles
+// are rejected one at a time. Reports the time per frame, the copies drawn and
+// whether the frames are the same, for the views of the cut_fish sweep.
+//
+// Usage: culling_bench [views] [grid size]
+// Run from the repository root so that the assets can be found.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bench_scene.h"
+#include "utility/culling.h"
+
+// The distance between the copies in the grid, on the x-z plane.
+#define GRID_SPACING 2.5f
+
+using bench_clock = std::chrono::steady_clock;
+
+// Draws the copies of the grid, returns the number of copies drawn.
+static uint32_t draw_grid(BenchScene &scene, uint32_t grid_size, bool use_culling)
+{
+    const Mesh &mesh = *scene.mesh;
+    standard_uniform uniform = scene.uniform;
+    uint32_t drawn_count = 0;
+    for (uint32_t row = 0; row < grid_size; row++)
+    {
+        for (uint32_t column = 0; column < grid_size; column++)
+        {
+            // The copy at the origin is the one of the other benchmarks.
+            float half = (float)(grid_size / 2);
+            vec3 offset{(column - half) * GRID_SPACING, 0.0f, (row - half) * GRID_SPACING};
+            uniform.local2world = matrix_t::translate(offset);
+            if (use_culling && !is_mesh_visible(extract_frustum(uniform.world2clip * uniform.local2world), mesh))
+            {
+                continue;
+            }
+            drawn_count++;
+            for (uint32_t t = 0; t < mesh.triangle_count; t++)
+            {
+                standard_vertex_attribute attributes[3];
+                const void *attribute_ptrs[3];
+                for (uint32_t v = 0; v < 3; v++)
+                {
+                    attributes[v].position = mesh.get_mesh_position(t, v);
+                    attributes[v].normal = mesh.get_mesh_normal(t, v);
+                    attributes[v].tangent = mesh.get_mesh_tangent(t, v);
+                    attributes[v].texcoord = mesh.get_mesh_texcoord(t, v);
+                    attribute_ptrs[v] = attributes + v;
+                }
+                draw_triangle(&scene.framebuffer, &uniform, attribute_ptrs);
+            }
+        }
+    }
+    return drawn_count;
+}
+
+int main(int argc, char *argv[])
+{
+    int view_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 6;
+    uint32_t grid_size = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 1) : 10;
+
+    BenchScene scene;
+    if (!initialize_bench_scene(scene))
+    {
+        printf("Can not load the cut_fish assets, run from the repository root.\n");
+        return 1;
+    }
+    set_packet_fragment_shader(standard_packet_fragment_shader);
+    Texture frames[2] = {Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE),
+                         Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE)};
+    tone_mapping_settings tone_mapping;
+    tone_mapping.exposure = 1.0f;
+    tone_mapping.tone_operator = tone_mapping_operator::TONE_MAPPING_NONE;
+    double milliseconds[2] = {0.0, 0.0};
+    uint64_t drawn_counts[2] = {0, 0};
+    bool same = true;
+
+    for (int view = 0; view < view_count; view++)
+    {
+        // Spread the views over the z sweep of the renderer.
+        vec3 camera_position{-2.0f, 4.5f, 2.0f + 4.0f * (view + 1) / view_count};
+        for (int mode = 0; mode < 2; mode++)
+        {
+            auto start = bench_clock::now();
+            begin_bench_view(scene, scene.framebuffer, camera_position);
+            drawn_counts[mode] += draw_grid(scene, grid_size, mode == 1);
+            resolve_hdr(scene.framebuffer, frames[mode], tone_mapping);
+            auto end = bench_clock::now();
+            milliseconds[mode] += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        same = same && memcmp(frames[0].get_pixels(), frames[1].get_pixels(),
+                              (size_t)BENCH_IMAGE_SIZE * BENCH_IMAGE_SIZE * 4) == 0;
+    }
+
+    printf("%d views of %dx%d, %ux%u copies of %u triangles:\n", view_count, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE,
+           grid_size, grid_size, scene.mesh->triangle_count);
+    const char *names[2] = {"no culling", "frustum culling"};
+    printf("mode             ms/frame  copies drawn/frame\n");
+    for (int mode = 0; mode < 2; mode++)
+    {
+        printf("%-15s  %8.1f  %18.1f\n", names[mode], milliseconds[mode] / view_count,
+               (double)drawn_counts[mode] / view_count);
+    }
+    printf("culling is %.2fx faster, frames %s\n", milliseconds[0] / milliseconds[1], same ? "identical" : "differ");
+    return 0;
+}
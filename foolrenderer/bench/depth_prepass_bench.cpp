@@ -0,0 +1,218 @@
+// Compares the draw orders and the depth prepass on a scene with overdraw:
+// copies of the cut_fish model one behind the other along the view direction,
+// submitted farthest first. Reports the time per frame, the fragment shader
+// invocations and the image difference of each mode to the frame drawn in
+// submission order, for the views of the cut_fish sweep.
+//
+// Usage: depth_prepass_bench [views] [copies]
+// Run from the repository root so that the assets can be found. The copies are
+// not in the shadow map, only the model at the origin casts shadows.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "bench_scene.h"
+#include "utility/draw_order.h"
+#include "utility/image_diff.h"
+
+#define MODE_COUNT 5
+#define MESHLET_TRIANGLE_COUNT 64
+// The distance between the copies along the view direction, and sideways, so
+// that each copy is partly visible.
+#define COPY_DEPTH_SPACING 0.5f
+#define COPY_SIDE_SPACING 0.2f
+
+using bench_clock = std::chrono::steady_clock;
+
+static uint64_t fragment_count = 0;
+
+// The standard packet fragment shader, counting the fragments it shades.
+static void counting_fragment_shader(const ShaderPacket *input, const void *uniform, packet_vec4 *output)
+{
+    fragment_count += __builtin_popcount(input->coverage_mask);
+    standard_packet_fragment_shader(input, uniform, output);
+}
+
+struct BenchCopy
+{
+    standard_uniform uniform;
+    transformed_vertices vertices;
+};
+
+// A run of triangles of one copy, the unit of the draw order.
+struct DrawRange
+{
+    uint32_t copy;
+    uint32_t first_triangle;
+    uint32_t triangle_count;
+};
+
+static void draw_range(const Mesh &mesh, BenchCopy &copy, FrameBuffer &framebuffer, const DrawRange &range,
+                       bool use_transformed_vertices, bool with_attributes)
+{
+    for (uint32_t t = range.first_triangle; t < range.first_triangle + range.triangle_count; t++)
+    {
+        standard_vertex_attribute attributes[3];
+        const void *attribute_ptrs[3];
+        for (uint32_t v = 0; v < 3 && with_attributes; v++)
+        {
+            attributes[v].position = mesh.get_mesh_position(t, v);
+            attributes[v].normal = mesh.get_mesh_normal(t, v);
+            attributes[v].tangent = mesh.get_mesh_tangent(t, v);
+            attributes[v].texcoord = mesh.get_mesh_texcoord(t, v);
+            attribute_ptrs[v] = attributes + v;
+        }
+        if (use_transformed_vertices)
+        {
+            draw_transformed_triangle(&framebuffer, &copy.uniform, copy.vertices, mesh.indices.get() + t * 3,
+                                      with_attributes ? attribute_ptrs : nullptr);
+        }
+        else
+        {
+            draw_triangle(&framebuffer, &copy.uniform, attribute_ptrs);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int view_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 6;
+    uint32_t copy_count = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 1) : 4;
+
+    BenchScene scene;
+    if (!initialize_bench_scene(scene))
+    {
+        printf("Can not load the cut_fish assets, run from the repository root.\n");
+        return 1;
+    }
+    const Mesh &mesh = *scene.mesh;
+    std::vector<Meshlet> meshlets = build_meshlets(mesh, MESHLET_TRIANGLE_COUNT);
+    bounding_sphere mesh_bounds = build_meshlets(mesh, mesh.triangle_count)[0].bounds;
+    std::vector<BenchCopy> copies(copy_count);
+    std::vector<bounding_sphere> copy_bounds(copy_count);
+    std::vector<bounding_sphere> meshlet_bounds(copy_count * meshlets.size());
+    std::vector<DrawRange> copy_ranges(copy_count);
+    std::vector<DrawRange> meshlet_ranges(copy_count * meshlets.size());
+    std::vector<uint32_t> order;
+    std::vector<DrawRange> ranges;
+
+    Texture frames[MODE_COUNT] = {
+        Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE),
+        Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE),
+        Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE),
+        Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE),
+        Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE)};
+    const char *names[MODE_COUNT] = {"submission order", "objects sorted", "meshlets sorted", "depth prepass",
+                                     "prepass + sorted"};
+    // Which modes sort the meshlets instead of the copies, and which draw a
+    // depth prepass.
+    const bool sorts_copies[MODE_COUNT] = {false, true, false, false, false};
+    const bool sorts_meshlets[MODE_COUNT] = {false, false, true, false, true};
+    const bool has_prepass[MODE_COUNT] = {false, false, false, true, true};
+    double milliseconds[MODE_COUNT] = {0.0, 0.0, 0.0, 0.0, 0.0};
+    uint64_t fragments[MODE_COUNT] = {0, 0, 0, 0, 0};
+    uint32_t max_errors[MODE_COUNT] = {0, 0, 0, 0, 0};
+    tone_mapping_settings tone_mapping;
+    tone_mapping.exposure = 1.0f;
+    tone_mapping.tone_operator = tone_mapping_operator::TONE_MAPPING_NONE;
+
+    for (int view = 0; view < view_count; view++)
+    {
+        // Spread the views over the z sweep of the renderer.
+        vec3 camera_position{-2.0f, 4.5f, 2.0f + 4.0f * (view + 1) / view_count};
+        vec3 forward = (BENCH_CAMERA_TARGET - camera_position).normalize();
+        vec3 side = forward.cross(vec3{0.0f, 1.0f, 0.0f}).normalize();
+        // The farthest copy is submitted first.
+        for (uint32_t c = 0; c < copy_count; c++)
+        {
+            uint32_t distance = copy_count - 1 - c;
+            vec3 offset = forward * (COPY_DEPTH_SPACING * distance) + side * (COPY_SIDE_SPACING * distance);
+            copies[c].uniform = scene.uniform;
+            copies[c].uniform.local2world = matrix_t::translate(offset);
+            copy_bounds[c] = bounding_sphere{mesh_bounds.center + offset, mesh_bounds.radius};
+            copy_ranges[c] = DrawRange{c, 0, mesh.triangle_count};
+            for (size_t m = 0; m < meshlets.size(); m++)
+            {
+                const Meshlet &meshlet = meshlets[m];
+                size_t index = c * meshlets.size() + m;
+                meshlet_bounds[index] = bounding_sphere{meshlet.bounds.center + offset, meshlet.bounds.radius};
+                meshlet_ranges[index] = DrawRange{c, meshlet.first_triangle, meshlet.triangle_count};
+            }
+        }
+
+        for (int mode = 0; mode < MODE_COUNT; mode++)
+        {
+            fragment_count = 0;
+            auto start = bench_clock::now();
+            matrix4x4 world2view = begin_bench_view(scene, scene.framebuffer, camera_position);
+            for (BenchCopy &copy : copies)
+            {
+                copy.uniform.camera_position = scene.uniform.camera_position;
+                copy.uniform.world2clip = scene.uniform.world2clip;
+            }
+            if (sorts_copies[mode] || sorts_meshlets[mode])
+            {
+                const std::vector<bounding_sphere> &bounds = sorts_copies[mode] ? copy_bounds : meshlet_bounds;
+                const std::vector<DrawRange> &unsorted = sorts_copies[mode] ? copy_ranges : meshlet_ranges;
+                sort_front_to_back(bounds.data(), bounds.size(), world2view, order);
+                ranges.clear();
+                for (uint32_t i : order)
+                {
+                    ranges.push_back(unsorted[i]);
+                }
+            }
+            else
+            {
+                ranges = copy_ranges;
+            }
+
+            if (has_prepass[mode])
+            {
+                for (BenchCopy &copy : copies)
+                {
+                    transform_vertices(copy.uniform.world2clip * copy.uniform.local2world, mesh.positions_x.get(),
+                                       mesh.positions_y.get(), mesh.positions_z.get(), mesh.vertex_count,
+                                       copy.vertices);
+                }
+                set_fragment_shader(nullptr);
+                for (const DrawRange &range : ranges)
+                {
+                    draw_range(mesh, copies[range.copy], scene.framebuffer, range, true, false);
+                }
+                set_depth_function(depth_function::DEPTH_FUNCTION_EQUAL);
+            }
+            set_packet_fragment_shader(counting_fragment_shader);
+            for (const DrawRange &range : ranges)
+            {
+                draw_range(mesh, copies[range.copy], scene.framebuffer, range, has_prepass[mode], true);
+            }
+            set_depth_function(depth_function::DEPTH_FUNCTION_LESS_EQUAL);
+            resolve_hdr(scene.framebuffer, frames[mode], tone_mapping);
+            auto end = bench_clock::now();
+            milliseconds[mode] += std::chrono::duration<double, std::milli>(end - start).count();
+            fragments[mode] += fragment_count;
+        }
+
+        for (int mode = 1; mode < MODE_COUNT; mode++)
+        {
+            image_difference difference;
+            compare_images(frames[0], frames[mode], difference);
+            max_errors[mode] = std::max(max_errors[mode], difference.max_error);
+        }
+    }
+
+    printf("%d views of %dx%d, %u copies of %u triangles in %zu meshlets each, differences to submission order:\n",
+           view_count, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE, copy_count, mesh.triangle_count, meshlets.size());
+    printf("mode              ms/frame  fragments/frame  shaded/pixel  max error\n");
+    double pixel_count = (double)BENCH_IMAGE_SIZE * BENCH_IMAGE_SIZE;
+    for (int mode = 0; mode < MODE_COUNT; mode++)
+    {
+        double frame_fragments = (double)fragments[mode] / view_count;
+        printf("%-16s  %8.1f  %15.0f  %12.3f  %9u\n", names[mode], milliseconds[mode] / view_count, frame_fragments,
+               frame_fragments / pixel_count, max_errors[mode]);
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Measures the throughput of each frame sink format on a sequence of frames,
+// writing into a temporary directory. TGA is the reference, it is what the
+// renderer wrote before frame sinks existed.
+//
+// Usage: frame_sink_bench [frame.tga] [frames]
+// If the frame can not be loaded, a procedural frame is used instead. Each
+// frame is shifted by a few pixels so the encoders do not see identical
+// frames.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "bench_frame.h"
+#include "graphics/texture.h"
+#include "utility/frame_sink.h"
+#include "utility/image.h"
+
+using bench_clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+// Returns the total size of the regular files in the directory.
+static uintmax_t get_directory_size(const fs::path &directory)
+{
+    uintmax_t size = 0;
+    for (const auto &entry : fs::directory_iterator(directory))
+    {
+        if (entry.is_regular_file())
+        {
+            size += entry.file_size();
+        }
+    }
+    return size;
+}
+
+static void run(const char *name, frame_sink_format format, const Texture *frames, int frame_variant_count,
+                int frame_count, const fs::path &directory)
+{
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    bool is_stream = format == frame_sink_format::FRAME_SINK_Y4M || format == frame_sink_format::FRAME_SINK_PPM;
+    std::string path = is_stream ? (directory / "stream").string() : (directory / "").string();
+
+    auto start = bench_clock::now();
+    {
+        FrameSink sink(format, path, BENCH_FRAME_SIZE, BENCH_FRAME_SIZE);
+        for (int i = 0; i < frame_count; i++)
+        {
+            if (!sink.write_frame(frames[i % frame_variant_count]))
+            {
+                printf("%-4s write failed\n", name);
+                return;
+            }
+        }
+        sink.finish();
+    }
+    auto end = bench_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    uintmax_t size = get_directory_size(directory);
+    double input_mb = (double)BENCH_FRAME_SIZE * BENCH_FRAME_SIZE * 3 * frame_count / (1024.0 * 1024.0);
+    printf("%-4s %7.2f ms/frame  %7.1f MB/s of RGB input  %9.0f bytes/frame\n", name, ms / frame_count,
+           input_mb / (ms / 1000.0), (double)size / frame_count);
+    fs::remove_all(directory);
+}
+
+int main(int argc, char *argv[])
+{
+    int frame_count = argc > 2 ? atoi(argv[2]) : 30;
+    std::unique_ptr<Texture> frame = argc > 1 ? load_image(argv[1], true) : nullptr;
+    if (!frame || frame->m_width != BENCH_FRAME_SIZE || frame->m_height != BENCH_FRAME_SIZE)
+    {
+        printf("Using procedural frame.\n");
+        frame = make_procedural_frame();
+    }
+
+    // A few shifted copies of the frame, so consecutive frames differ.
+    const int frame_variant_count = 4;
+    int pixel_size = frame->m_format == texture_format::TEXTURE_FORMAT_RGB8 ||
+                             frame->m_format == texture_format::TEXTURE_FORMAT_SRGB8
+                         ? 3
+                         : 4;
+    Texture frames[frame_variant_count] = {*frame, *frame, *frame, *frame};
+    for (int v = 1; v < frame_variant_count; v++)
+    {
+        size_t shift = (size_t)v * 3 * pixel_size;
+        size_t size = (size_t)BENCH_FRAME_SIZE * BENCH_FRAME_SIZE * pixel_size;
+        memmove(frames[v].get_pixels() + shift, frames[v].get_pixels(), size - shift);
+    }
+
+    fs::path directory = fs::temp_directory_path() / "frame_sink_bench";
+    printf("%d frames of %dx%d.\n", frame_count, BENCH_FRAME_SIZE, BENCH_FRAME_SIZE);
+    run("TGA", frame_sink_format::FRAME_SINK_TGA, frames, frame_variant_count, frame_count, directory);
+    run("QOI", frame_sink_format::FRAME_SINK_QOI, frames, frame_variant_count, frame_count, directory);
+    run("Y4M", frame_sink_format::FRAME_SINK_Y4M, frames, frame_variant_count, frame_count, directory);
+    run("PPM", frame_sink_format::FRAME_SINK_PPM, frames, frame_variant_count, frame_count, directory);
+    return 0;
+}
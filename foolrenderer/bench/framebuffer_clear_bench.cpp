@@ -0,0 +1,89 @@
+// Measures the per-frame cost of clearing a framebuffer. The scalar clear is
+// the per-pixel loop FrameBuffer::clear() used before clears were deferred.
+// The eager clear is clear() followed by resolving every attachment, which
+// writes every pixel with row fills. The lazy clear only
+// marks the tiles; the cost of filling them then moves to the first access of
+// each tile, and the depth of tiles no triangle touches is never written.
+//
+// Usage: framebuffer_clear_bench [size] [frames]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include "graphics/framebuffer.h"
+#include "graphics/texture.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+// The clear loop FrameBuffer::clear() used before tiles were introduced.
+static void scalar_clear(FrameBuffer &framebuffer, const uint8_t clear_color[4])
+{
+    size_t pixel_cnt = framebuffer.m_width * framebuffer.m_height;
+    uint8_t *color_pixels = framebuffer.color_buffer->get_pixels();
+    for (size_t i = 0; i < pixel_cnt; i++)
+    {
+        uint8_t *pixel = color_pixels + i * 4;
+        pixel[0] = clear_color[0];
+        pixel[1] = clear_color[1];
+        pixel[2] = clear_color[2];
+        pixel[3] = clear_color[3];
+    }
+    float *depth_pixels = (float *)framebuffer.depth_buffer->get_pixels();
+    for (size_t i = 0; i < pixel_cnt; i++)
+    {
+        depth_pixels[i] = 1.0f;
+    }
+}
+
+// Returns the microseconds per frame.
+template <typename Function>
+static double time_frames(int frame_count, Function function)
+{
+    auto start = bench_clock::now();
+    for (int i = 0; i < frame_count; i++)
+    {
+        function();
+    }
+    auto end = bench_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / frame_count;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t size = argc > 1 ? (uint32_t)atoi(argv[1]) : 1024;
+    int frame_count = argc > 2 ? atoi(argv[2]) : 200;
+
+    FrameBuffer framebuffer;
+    framebuffer.attach_texture(attachment_type::COLOR_ATTACHMENT,
+                               std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_SRGB8_A8, size, size));
+    framebuffer.attach_texture(attachment_type::DEPTH_ATTACHMENT,
+                               std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_DEPTH_FLOAT, size, size));
+    FrameBuffer::set_clear_color(0.49f, 0.33f, 0.41f, 1.0f);
+
+    // Touch every page once so the first measurement does not pay for them.
+    scalar_clear(framebuffer, framebuffer.m_clear_color);
+
+    double scalar = time_frames(frame_count, [&]() { scalar_clear(framebuffer, framebuffer.m_clear_color); });
+    double eager = time_frames(frame_count, [&]() {
+        framebuffer.clear();
+        framebuffer.resolve(attachment_type::COLOR_ATTACHMENT);
+        framebuffer.resolve(attachment_type::DEPTH_ATTACHMENT);
+    });
+    double lazy = time_frames(frame_count, [&]() { framebuffer.clear(); });
+    // A frame in which a model covers the center quarter of the screen and
+    // only the color buffer is read back, like the frames rendered by main.
+    double partial = time_frames(frame_count, [&]() {
+        framebuffer.clear();
+        framebuffer.prepare_region(size / 4, size / 4, size * 3 / 4 - 1, size * 3 / 4 - 1);
+        framebuffer.resolve(attachment_type::COLOR_ATTACHMENT);
+    });
+
+    printf("%ux%u color + depth, %d frames\n", size, size, frame_count);
+    printf("scalar clear (previous clear())   %8.1f us/frame\n", scalar);
+    printf("eager clear (all pixels)          %8.1f us/frame\n", eager);
+    printf("lazy clear (mark tiles only)      %8.1f us/frame\n", lazy);
+    printf("lazy clear + quarter + color read %8.1f us/frame\n", partial);
+    return 0;
+}
@@ -0,0 +1,68 @@
+// Measures resolve_hdr() on a 1024x1024 RGBA_FLOAT color buffer for each
+// tone mapping operator and a range of thread counts.
+//
+// Usage: hdr_resolve_bench [frames]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include "graphics/framebuffer.h"
+#include "graphics/texture.h"
+#include "graphics/tone_mapping.h"
+
+#define IMAGE_SIZE 1024
+
+using bench_clock = std::chrono::steady_clock;
+
+int main(int argc, char *argv[])
+{
+    int frame_count = argc > 1 ? atoi(argv[1]) : 50;
+
+    FrameBuffer framebuffer;
+    framebuffer.attach_texture(attachment_type::COLOR_ATTACHMENT,
+                               std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_RGBA_FLOAT, IMAGE_SIZE, IMAGE_SIZE));
+    Texture target(texture_format::TEXTURE_FORMAT_SRGB8_A8, IMAGE_SIZE, IMAGE_SIZE);
+
+    // HDR values with a few highlights above 1.
+    std::mt19937 generator(42);
+    std::exponential_distribution<float> distribution(2.0f);
+    float *pixels = (float *)framebuffer.color_buffer->get_pixels();
+    for (size_t i = 0; i < (size_t)IMAGE_SIZE * IMAGE_SIZE; i++)
+    {
+        pixels[i * 4 + 0] = distribution(generator);
+        pixels[i * 4 + 1] = distribution(generator);
+        pixels[i * 4 + 2] = distribution(generator);
+        pixels[i * 4 + 3] = 1.0f;
+    }
+
+    const char *operator_names[] = {"none", "reinhard", "aces"};
+    tone_mapping_operator operators[] = {tone_mapping_operator::TONE_MAPPING_NONE,
+                                         tone_mapping_operator::TONE_MAPPING_REINHARD,
+                                         tone_mapping_operator::TONE_MAPPING_ACES};
+    uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    printf("%dx%d RGBA_FLOAT -> SRGB8_A8, %d frames\n", IMAGE_SIZE, IMAGE_SIZE, frame_count);
+    for (int o = 0; o < 3; o++)
+    {
+        for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+        {
+            tone_mapping_settings settings;
+            settings.exposure = 1.5f;
+            settings.tone_operator = operators[o];
+            settings.thread_count = threads;
+            resolve_hdr(framebuffer, target, settings);
+            auto start = bench_clock::now();
+            for (int i = 0; i < frame_count; i++)
+            {
+                resolve_hdr(framebuffer, target, settings);
+            }
+            auto end = bench_clock::now();
+            printf("%-9s %2u threads %8.1f us/frame\n", operator_names[o], threads,
+                   std::chrono::duration<double, std::micro>(end - start).count() / frame_count);
+        }
+    }
+    return 0;
+}
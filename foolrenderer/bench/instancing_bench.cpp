@@ -0,0 +1,150 @@
+// Draws a grid of small copies of the cut_fish model, each with its own color,
+// once with the per triangle loop and a rebuilt uniform per copy, and once
+// with draw_standard_instances(). The copies are small, so the time goes to
+// the vertices rather than to the fragments. Reports the time per frame and
+// the image difference of the two frames, for the views of the cut_fish sweep.
+//
+// Usage: instancing_bench [views] [grid size]
+// Run from the repository root so that the assets can be found.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "bench_scene.h"
+#include "utility/culling.h"
+#include "utility/image_diff.h"
+#include "utility/instancing.h"
+
+// The copies cover about the view of the other benchmarks.
+#define GRID_EXTENT 2.4f
+#define INSTANCE_SCALE 0.6f
+
+using bench_clock = std::chrono::steady_clock;
+
+static std::vector<standard_instance> make_grid(uint32_t grid_size)
+{
+    std::vector<standard_instance> instances;
+    float spacing = GRID_EXTENT / grid_size;
+    float scale = spacing * INSTANCE_SCALE;
+    for (uint32_t row = 0; row < grid_size; row++)
+    {
+        for (uint32_t column = 0; column < grid_size; column++)
+        {
+            vec3 offset{(column + 0.5f) * spacing - GRID_EXTENT * 0.5f, 0.0f,
+                        (row + 0.5f) * spacing - GRID_EXTENT * 0.5f};
+            standard_instance instance;
+            instance.local2world = matrix_t::translate(offset) * matrix_t::scale(vec3{scale, scale, scale});
+            instance.base_color = vec3{0.4f + 0.6f * column / grid_size, 0.6f, 0.4f + 0.6f * row / grid_size};
+            instance.metallic = (row + column) % 2 == 0 ? 1.0f : 0.0f;
+            instance.roughness = 0.3f + 0.7f * row / grid_size;
+            instances.push_back(instance);
+        }
+    }
+    return instances;
+}
+
+// The loop that draw_standard_instances() replaces: a uniform per copy and the
+// attributes gathered per triangle, for every copy.
+static uint32_t draw_per_triangle(BenchScene &scene, const std::vector<standard_instance> &instances)
+{
+    const Mesh &mesh = *scene.mesh;
+    uint32_t drawn_count = 0;
+    for (const standard_instance &instance : instances)
+    {
+        standard_uniform uniform = scene.uniform;
+        uniform.local2world = instance.local2world;
+        uniform.local2world_direction = instance.local2world.to_3x3();
+        uniform.local2world_normal = instance.local2world.inverse().transpose().to_3x3();
+        uniform.base_color = instance.base_color;
+        uniform.metallic = instance.metallic;
+        uniform.roughness = instance.roughness;
+        if (!is_mesh_visible(extract_frustum(uniform.world2clip * uniform.local2world), mesh))
+        {
+            continue;
+        }
+        drawn_count++;
+        for (uint32_t t = 0; t < mesh.triangle_count; t++)
+        {
+            standard_vertex_attribute attributes[3];
+            const void *attribute_ptrs[3];
+            for (uint32_t v = 0; v < 3; v++)
+            {
+                attributes[v].position = mesh.get_mesh_position(t, v);
+                attributes[v].normal = mesh.get_mesh_normal(t, v);
+                attributes[v].tangent = mesh.get_mesh_tangent(t, v);
+                attributes[v].texcoord = mesh.get_mesh_texcoord(t, v);
+                attribute_ptrs[v] = attributes + v;
+            }
+            draw_triangle(&scene.framebuffer, &uniform, attribute_ptrs);
+        }
+    }
+    return drawn_count;
+}
+
+int main(int argc, char *argv[])
+{
+    int view_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 6;
+    uint32_t grid_size = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 1) : 8;
+
+    BenchScene scene;
+    if (!initialize_bench_scene(scene))
+    {
+        printf("Can not load the cut_fish assets, run from the repository root.\n");
+        return 1;
+    }
+    set_packet_fragment_shader(standard_packet_fragment_shader);
+    std::vector<standard_instance> instances = make_grid(grid_size);
+    Texture frames[2] = {Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE),
+                         Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE)};
+    tone_mapping_settings tone_mapping;
+    tone_mapping.exposure = 1.0f;
+    tone_mapping.tone_operator = tone_mapping_operator::TONE_MAPPING_NONE;
+    double milliseconds[2] = {0.0, 0.0};
+    uint64_t drawn_counts[2] = {0, 0};
+    uint32_t max_error = 0;
+    double mean_error = 0.0;
+    standard_instance_scratch scratch;
+
+    for (int view = 0; view < view_count; view++)
+    {
+        // Spread the views over the z sweep of the renderer.
+        vec3 camera_position{-2.0f, 4.5f, 2.0f + 4.0f * (view + 1) / view_count};
+        for (int mode = 0; mode < 2; mode++)
+        {
+            auto start = bench_clock::now();
+            begin_bench_view(scene, scene.framebuffer, camera_position);
+            if (mode == 0)
+            {
+                drawn_counts[mode] += draw_per_triangle(scene, instances);
+            }
+            else
+            {
+                drawn_counts[mode] += draw_standard_instances(&scene.framebuffer, *scene.mesh, scene.uniform,
+                                                              instances.data(), instances.size(), scratch);
+            }
+            resolve_hdr(scene.framebuffer, frames[mode], tone_mapping);
+            auto end = bench_clock::now();
+            milliseconds[mode] += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        image_difference difference;
+        compare_images(frames[0], frames[1], difference);
+        max_error = std::max(max_error, difference.max_error);
+        mean_error += difference.mean_error;
+    }
+
+    printf("%d views of %dx%d, %zu copies of %u triangles:\n", view_count, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE,
+           instances.size(), scene.mesh->triangle_count);
+    const char *names[2] = {"per triangle", "instanced"};
+    printf("mode          ms/frame  copies drawn/frame\n");
+    for (int mode = 0; mode < 2; mode++)
+    {
+        printf("%-12s  %8.1f  %18.1f\n", names[mode], milliseconds[mode] / view_count,
+               (double)drawn_counts[mode] / view_count);
+    }
+    printf("instanced is %.2fx faster, max error %u, mean error %.4f\n", milliseconds[0] / milliseconds[1],
+           max_error, mean_error / view_count);
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Compares 4x MSAA with the supersampling it replaces: rendering at twice the
+// width and height and averaging each 2x2 block. Both sample each pixel at
+// four positions; MSAA runs the fragment shader once per covered pixel
+// instead of once per sample. Reports the time per frame, the fragment shader
+// invocations and the image difference of each mode to the supersampled
+// frame, for the views of the cut_fish sweep.
+//
+// Usage: msaa_bench [views] [difference directory]
+// If a directory is given, an amplified difference image of the MSAA frame
+// to the supersampled frame of each view is written there. Run from the
+// repository root so that the assets can be found.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "bench_scene.h"
+#include "utility/image_diff.h"
+
+#define MODE_COUNT 3
+
+using bench_clock = std::chrono::steady_clock;
+
+static uint64_t fragment_count = 0;
+
+// The standard packet fragment shader, counting the fragments it shades.
+static void counting_fragment_shader(const ShaderPacket *input, const void *uniform, packet_vec4 *output)
+{
+    fragment_count += __builtin_popcount(input->coverage_mask);
+    standard_packet_fragment_shader(input, uniform, output);
+}
+
+// Averages each 2x2 block of the supersampled color buffer into the color
+// buffer of the target, both in TEXTURE_FORMAT_RGBA_FLOAT.
+static void downsample(FrameBuffer &supersampled, FrameBuffer &target)
+{
+    supersampled.resolve(attachment_type::COLOR_ATTACHMENT);
+    const vec4 *src = (const vec4 *)supersampled.color_buffer->get_pixels();
+    vec4 *dst = (vec4 *)target.color_buffer->get_pixels();
+    uint32_t width = target.m_width, src_width = supersampled.m_width;
+    for (uint32_t y = 0; y < target.m_height; y++)
+    {
+        const vec4 *row0 = src + (size_t)y * 2 * src_width;
+        const vec4 *row1 = row0 + src_width;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            dst[(size_t)y * width + x] = ((row0[x * 2] + row0[x * 2 + 1]) + (row1[x * 2] + row1[x * 2 + 1])) * 0.25f;
+        }
+    }
+}
+
+static void attach_hdr_buffers(FrameBuffer &framebuffer, uint32_t size)
+{
+    framebuffer.attach_texture(attachment_type::COLOR_ATTACHMENT,
+                               std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_RGBA_FLOAT, size, size));
+    framebuffer.attach_texture(attachment_type::DEPTH_ATTACHMENT,
+                               std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_DEPTH_FLOAT, size, size));
+}
+
+int main(int argc, char *argv[])
+{
+    int view_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 6;
+    const char *difference_directory = argc > 2 ? argv[2] : nullptr;
+
+    BenchScene scene;
+    if (!initialize_bench_scene(scene))
+    {
+        printf("Can not load the cut_fish assets, run from the repository root.\n");
+        return 1;
+    }
+    set_packet_fragment_shader(counting_fragment_shader);
+    FrameBuffer multisampled, supersampled, downsampled;
+    attach_hdr_buffers(multisampled, BENCH_IMAGE_SIZE);
+    multisampled.set_sample_count(MSAA_SAMPLE_COUNT);
+    attach_hdr_buffers(supersampled, BENCH_IMAGE_SIZE * 2);
+    downsampled.attach_texture(attachment_type::COLOR_ATTACHMENT,
+                               std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_RGBA_FLOAT,
+                                                         BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE));
+    tone_mapping_settings tone_mapping;
+    tone_mapping.exposure = 1.0f;
+    tone_mapping.tone_operator = tone_mapping_operator::TONE_MAPPING_NONE;
+
+    Texture frames[MODE_COUNT] = {
+        Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE),
+        Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE),
+        Texture(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE)};
+    const char *names[MODE_COUNT] = {"1x", "4x MSAA", "2x2 SSAA"};
+    double milliseconds[MODE_COUNT] = {0.0, 0.0, 0.0};
+    uint64_t fragments[MODE_COUNT] = {0, 0, 0};
+    double mean_errors[MODE_COUNT] = {0.0, 0.0, 0.0};
+    double worst_psnr[MODE_COUNT] = {INFINITY, INFINITY, INFINITY};
+
+    for (int view = 0; view < view_count; view++)
+    {
+        // Spread the views over the z sweep of the renderer.
+        vec3 camera_position{-2.0f, 4.5f, 2.0f + 4.0f * (view + 1) / view_count};
+        for (int mode = 0; mode < MODE_COUNT; mode++)
+        {
+            fragment_count = 0;
+            auto start = bench_clock::now();
+            if (mode == 2)
+            {
+                draw_bench_view(scene, supersampled, camera_position);
+                downsample(supersampled, downsampled);
+                resolve_hdr(downsampled, frames[mode], tone_mapping);
+            }
+            else
+            {
+                FrameBuffer &framebuffer = mode == 1 ? multisampled : scene.framebuffer;
+                draw_bench_view(scene, framebuffer, camera_position);
+                resolve_hdr(framebuffer, frames[mode], tone_mapping);
+            }
+            auto end = bench_clock::now();
+            milliseconds[mode] += std::chrono::duration<double, std::milli>(end - start).count();
+            fragments[mode] += fragment_count;
+        }
+
+        for (int mode = 0; mode < MODE_COUNT - 1; mode++)
+        {
+            image_difference difference;
+            compare_images(frames[MODE_COUNT - 1], frames[mode], difference);
+            mean_errors[mode] += difference.mean_error;
+            worst_psnr[mode] = std::min(worst_psnr[mode], difference.psnr);
+        }
+        if (difference_directory)
+        {
+            std::string path = std::string(difference_directory) + "/msaa_" + std::to_string(view + 1) + ".tga";
+            std::unique_ptr<Texture> image = make_difference_image(frames[MODE_COUNT - 1], frames[1]);
+            if (!save_image(*image, path, false, true))
+            {
+                printf("Can not write %s\n", path.c_str());
+            }
+        }
+    }
+
+    printf("%d views of %dx%d, differences to 2x2 SSAA:\n", view_count, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    printf("mode      ms/frame  fragments/frame  mean error  worst PSNR dB\n");
+    for (int mode = 0; mode < MODE_COUNT; mode++)
+    {
+        printf("%-8s  %8.1f  %15.0f  %10.3f  %13.2f\n", names[mode], milliseconds[mode] / view_count,
+               (double)fragments[mode] / view_count, mean_errors[mode] / view_count, worst_psnr[mode]);
+    }
+    printf("4x MSAA is %.2fx faster than 2x2 SSAA, %.2fx the time of 1x\n", milliseconds[2] / milliseconds[1],
+           milliseconds[1] / milliseconds[0]);
+    return 0;
+}
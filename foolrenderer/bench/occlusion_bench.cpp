@@ -0,0 +1,206 @@
+// Draws the cut_fish model with layers of small copies behind it, many of them
+// hidden by it, with and without occlusion culling. The occlusion buffer is
+// filled either with the model itself as the occluder, or with the depth of
+// the frame without culling, which stands in for the previous frame of a
+// still camera. The copies are tested whole, and then per meshlet. Reports
+// the time, the tested, culled and drawn counts of each frame, and whether the
+// frames are the same as without culling.
+//
+// Usage: occlusion_bench [views] [occlusion buffer width]
+// Run from the repository root so that the assets can be found.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "bench_scene.h"
+#include "utility/culling.h"
+#include "utility/draw_order.h"
+#include "utility/occlusion.h"
+
+#define MODE_COUNT 4
+#define MESHLET_TRIANGLE_COUNT 64
+// The copies are in layers behind the model, along the view direction.
+#define LAYER_COUNT 2
+#define COPY_COLUMNS 7
+#define COPY_ROWS 5
+#define COPY_SPACING 0.3f
+#define COPY_SCALE 0.25f
+#define FIRST_LAYER_DISTANCE 1.5f
+#define LAYER_SPACING 0.5f
+
+using bench_clock = std::chrono::steady_clock;
+
+struct mode_result
+{
+    double milliseconds = 0.0;
+    uint64_t tested = 0;
+    uint64_t culled = 0;
+    uint64_t drawn_triangles = 0;
+    bool same = true;
+};
+
+static uint32_t draw_triangles(BenchScene &scene, const standard_uniform &uniform, uint32_t first_triangle,
+                               uint32_t triangle_count)
+{
+    const Mesh &mesh = *scene.mesh;
+    for (uint32_t t = first_triangle; t < first_triangle + triangle_count; t++)
+    {
+        standard_vertex_attribute attributes[3];
+        const void *attribute_ptrs[3];
+        for (uint32_t v = 0; v < 3; v++)
+        {
+            attributes[v].position = mesh.get_mesh_position(t, v);
+            attributes[v].normal = mesh.get_mesh_normal(t, v);
+            attributes[v].tangent = mesh.get_mesh_tangent(t, v);
+            attributes[v].texcoord = mesh.get_mesh_texcoord(t, v);
+            attribute_ptrs[v] = attributes + v;
+        }
+        draw_triangle(&scene.framebuffer, &uniform, attribute_ptrs);
+    }
+    return triangle_count;
+}
+
+int main(int argc, char *argv[])
+{
+    int view_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 6;
+    uint32_t buffer_width = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 4) : 256;
+    buffer_width &= ~(uint32_t)(OCCLUSION_BUFFER_ALIGNMENT - 1);
+
+    BenchScene scene;
+    if (!initialize_bench_scene(scene))
+    {
+        printf("Can not load the cut_fish assets, run from the repository root.\n");
+        return 1;
+    }
+    OcclusionBuffer occlusion;
+    if (!occlusion.initialize(buffer_width, buffer_width))
+    {
+        printf("Can not allocate a %ux%u occlusion buffer.\n", buffer_width, buffer_width);
+        return 1;
+    }
+    set_packet_fragment_shader(standard_packet_fragment_shader);
+    const Mesh &mesh = *scene.mesh;
+    std::vector<Meshlet> meshlets = build_meshlets(mesh, MESHLET_TRIANGLE_COUNT);
+    std::vector<standard_uniform> copies(LAYER_COUNT * COPY_COLUMNS * COPY_ROWS, scene.uniform);
+    size_t pixel_size = (size_t)BENCH_IMAGE_SIZE * BENCH_IMAGE_SIZE * 4;
+    Texture reference(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    Texture frame(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    tone_mapping_settings tone_mapping;
+    tone_mapping.exposure = 1.0f;
+    tone_mapping.tone_operator = tone_mapping_operator::TONE_MAPPING_NONE;
+    const char *names[MODE_COUNT] = {"no occlusion", "occluder", "occluder+meshlet", "previous depth"};
+    mode_result results[MODE_COUNT];
+
+    printf("%d views of %dx%d, the model and %zu copies, %ux%u occlusion buffer\n", view_count, BENCH_IMAGE_SIZE,
+           BENCH_IMAGE_SIZE, copies.size(), buffer_width, buffer_width);
+    printf("view  mode              ms/frame  tested  culled  drawn triangles\n");
+    for (int view = 0; view < view_count; view++)
+    {
+        // Spread the views over the z sweep of the renderer.
+        vec3 camera_position{-2.0f, 4.5f, 2.0f + 4.0f * (view + 1) / view_count};
+        vec3 forward = (BENCH_CAMERA_TARGET - camera_position).normalize();
+        vec3 side = forward.cross(vec3{0.0f, 1.0f, 0.0f}).normalize();
+        vec3 up = side.cross(forward);
+        for (uint32_t layer = 0; layer < LAYER_COUNT; layer++)
+        {
+            for (uint32_t row = 0; row < COPY_ROWS; row++)
+            {
+                for (uint32_t column = 0; column < COPY_COLUMNS; column++)
+                {
+                    vec3 offset = BENCH_CAMERA_TARGET + forward * (FIRST_LAYER_DISTANCE + LAYER_SPACING * layer) +
+                                  side * ((column - (COPY_COLUMNS - 1) * 0.5f) * COPY_SPACING) +
+                                  up * ((row - (COPY_ROWS - 1) * 0.5f) * COPY_SPACING);
+                    standard_uniform &copy = copies[(layer * COPY_ROWS + row) * COPY_COLUMNS + column];
+                    copy.local2world =
+                        matrix_t::translate(offset) * matrix_t::scale(vec3{COPY_SCALE, COPY_SCALE, COPY_SCALE});
+                    copy.local2world_direction = copy.local2world.to_3x3();
+                    copy.local2world_normal = copy.local2world.inverse().transpose().to_3x3();
+                }
+            }
+        }
+
+        for (int mode = 0; mode < MODE_COUNT; mode++)
+        {
+            uint64_t drawn_triangles = 0;
+            auto start = bench_clock::now();
+            begin_bench_view(scene, scene.framebuffer, camera_position);
+            for (standard_uniform &copy : copies)
+            {
+                copy.camera_position = scene.uniform.camera_position;
+                copy.world2clip = scene.uniform.world2clip;
+            }
+            occlusion.clear();
+            if (mode == 1 || mode == 2)
+            {
+                occlusion.draw_occluder(mesh, scene.uniform.world2clip);
+            }
+            else if (mode == 3)
+            {
+                // The frame without culling was rendered just before, its
+                // depth is resolved.
+                occlusion.load_depth(*scene.framebuffer.depth_buffer);
+            }
+            // The model itself is always drawn, first, as the occluder.
+            drawn_triangles += draw_triangles(scene, scene.uniform, 0, mesh.triangle_count);
+            for (const standard_uniform &copy : copies)
+            {
+                matrix4x4 local2clip = copy.world2clip * copy.local2world;
+                if (!is_mesh_visible(extract_frustum(local2clip), mesh))
+                {
+                    continue;
+                }
+                if (mode != 0 && !occlusion.is_visible(mesh.bounds_box, local2clip))
+                {
+                    continue;
+                }
+                if (mode == 2 || mode == 3)
+                {
+                    for (const Meshlet &meshlet : meshlets)
+                    {
+                        if (occlusion.is_visible(meshlet.bounds, local2clip))
+                        {
+                            drawn_triangles +=
+                                draw_triangles(scene, copy, meshlet.first_triangle, meshlet.triangle_count);
+                        }
+                    }
+                }
+                else
+                {
+                    drawn_triangles += draw_triangles(scene, copy, 0, mesh.triangle_count);
+                }
+            }
+            Texture &output = mode == 0 ? reference : frame;
+            resolve_hdr(scene.framebuffer, output, tone_mapping);
+            auto end = bench_clock::now();
+            if (mode == 0)
+            {
+                // Read by the previous depth mode.
+                scene.framebuffer.resolve(attachment_type::DEPTH_ATTACHMENT);
+            }
+
+            mode_result &result = results[mode];
+            double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+            result.milliseconds += milliseconds;
+            result.tested += occlusion.m_tested_count;
+            result.culled += occlusion.m_culled_count;
+            result.drawn_triangles += drawn_triangles;
+            result.same = result.same && memcmp(reference.get_pixels(), output.get_pixels(), pixel_size) == 0;
+            printf("%4d  %-16s  %8.1f  %6u  %6u  %15llu\n", view + 1, names[mode], milliseconds,
+                   occlusion.m_tested_count, occlusion.m_culled_count, (unsigned long long)drawn_triangles);
+        }
+    }
+
+    printf("averages per frame:\n");
+    printf("mode              ms/frame   tested   culled  drawn triangles  frames\n");
+    for (int mode = 0; mode < MODE_COUNT; mode++)
+    {
+        const mode_result &result = results[mode];
+        printf("%-16s  %8.1f  %7.1f  %7.1f  %15.0f  %s\n", names[mode], result.milliseconds / view_count,
+               (double)result.tested / view_count, (double)result.culled / view_count,
+               (double)result.drawn_triangles / view_count, result.same ? "identical" : "differ");
+    }
+    return 0;
+}
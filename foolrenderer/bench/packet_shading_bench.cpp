@@ -0,0 +1,138 @@
+// Compares the standard fragment shader with its packet form: first the
+// shader calls alone on random inputs, then whole frames of the cut_fish
+// sweep, whose images must be identical.
+//
+// Usage: packet_shading_bench [views]
+// Run from the repository root so that the assets can be found.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "bench_scene.h"
+
+#define FRAGMENT_COUNT (1 << 16)
+
+using bench_clock = std::chrono::steady_clock;
+
+// Random shader inputs of FRAGMENT_COUNT fragments, in both forms.
+struct shader_inputs
+{
+    std::vector<ShaderContext> contexts;
+    std::vector<ShaderPacket> packets;
+};
+
+static void make_inputs(shader_inputs &inputs)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> signed_unit(-1.0f, 1.0f);
+    inputs.contexts.resize(FRAGMENT_COUNT);
+    inputs.packets.resize(FRAGMENT_COUNT / PACKET_SIZE);
+    for (size_t i = 0; i < FRAGMENT_COUNT; i++)
+    {
+        ShaderContext &context = inputs.contexts[i];
+        context.clear();
+        // The indices used by the standard shader.
+        vec2 texcoord{unit(generator), unit(generator)};
+        vec3 variables[5];
+        for (int v = 0; v < 4; v++)
+        {
+            variables[v] = vec3{signed_unit(generator), signed_unit(generator), signed_unit(generator)};
+        }
+        variables[4] = vec3{unit(generator), unit(generator), unit(generator)};
+        *context.shader_context_vec2(0) = texcoord;
+
+        ShaderPacket &packet = inputs.packets[i / PACKET_SIZE];
+        size_t lane = i % PACKET_SIZE;
+        packet.vec2_variables[0].x[lane] = texcoord.x;
+        packet.vec2_variables[0].y[lane] = texcoord.y;
+        for (int8_t v = 0; v < 5; v++)
+        {
+            *context.shader_context_vec3(v) = variables[v];
+            packet.vec3_variables[v].x[lane] = variables[v].x;
+            packet.vec3_variables[v].y[lane] = variables[v].y;
+            packet.vec3_variables[v].z[lane] = variables[v].z;
+        }
+        packet.x = 0;
+        packet.y = 0;
+        packet.coverage_mask = (1u << PACKET_SIZE) - 1;
+    }
+}
+
+static void measure_shader_calls(const standard_uniform &uniform, int iterations)
+{
+    shader_inputs inputs;
+    make_inputs(inputs);
+    std::vector<vec4> colors(FRAGMENT_COUNT);
+    std::vector<packet_vec4> packet_colors(FRAGMENT_COUNT / PACKET_SIZE);
+
+    auto start = bench_clock::now();
+    for (int n = 0; n < iterations; n++)
+    {
+        for (size_t i = 0; i < FRAGMENT_COUNT; i++)
+        {
+            colors[i] = standard_fragment_shader(&inputs.contexts[i], &uniform);
+        }
+    }
+    auto middle = bench_clock::now();
+    for (int n = 0; n < iterations; n++)
+    {
+        for (size_t i = 0; i < FRAGMENT_COUNT / PACKET_SIZE; i++)
+        {
+            standard_packet_fragment_shader(&inputs.packets[i], &uniform, &packet_colors[i]);
+        }
+    }
+    auto end = bench_clock::now();
+
+    bool same = true;
+    for (size_t i = 0; i < FRAGMENT_COUNT; i++)
+    {
+        const packet_vec4 &packet = packet_colors[i / PACKET_SIZE];
+        size_t lane = i % PACKET_SIZE;
+        vec4 color{packet.x[lane], packet.y[lane], packet.z[lane], packet.w[lane]};
+        same = same && memcmp(&color, &colors[i], sizeof(vec4)) == 0;
+    }
+    double fragment_count = (double)iterations * FRAGMENT_COUNT;
+    double scalar_ns = std::chrono::duration<double, std::nano>(middle - start).count() / fragment_count;
+    double packet_ns = std::chrono::duration<double, std::nano>(end - middle).count() / fragment_count;
+    printf("shader calls: per fragment %.1f ns, packet %.1f ns per fragment (%.2fx), colors %s\n", scalar_ns,
+           packet_ns, scalar_ns / packet_ns, same ? "identical" : "differ");
+}
+
+int main(int argc, char *argv[])
+{
+    int view_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 6;
+
+    BenchScene scene;
+    if (!initialize_bench_scene(scene))
+    {
+        printf("Can not load the cut_fish assets, run from the repository root.\n");
+        return 1;
+    }
+    scene.uniform.camera_position = vec3{-2.0f, 4.5f, 2.0f};
+    measure_shader_calls(scene.uniform, 20);
+
+    Texture scalar_frame(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    Texture packet_frame(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    size_t frame_size = (size_t)BENCH_IMAGE_SIZE * BENCH_IMAGE_SIZE * 4;
+    double scalar_total = 0.0, packet_total = 0.0;
+    bool all_same = true;
+    for (int view = 0; view < view_count; view++)
+    {
+        // Spread the views over the z sweep of the renderer.
+        vec3 camera_position{-2.0f, 4.5f, 2.0f + 4.0f * (view + 1) / view_count};
+        set_fragment_shader(standard_fragment_shader);
+        scalar_total += render_bench_view(scene, camera_position, scalar_frame);
+        set_packet_fragment_shader(standard_packet_fragment_shader);
+        packet_total += render_bench_view(scene, camera_position, packet_frame);
+        all_same = all_same && memcmp(scalar_frame.get_pixels(), packet_frame.get_pixels(), frame_size) == 0;
+    }
+    printf("%d frames of %dx%d: per fragment %.1f ms, packets %.1f ms per frame (%.2fx), frames %s\n", view_count,
+           BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE, scalar_total / view_count, packet_total / view_count,
+           scalar_total / packet_total, all_same ? "identical" : "differ");
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Reports the pipeline statistics of each draw and of each frame for the views
+// of the cut_fish sweep. Each frame draws the model, and then a copy of it
+// behind the model, most of whose fragments fail the depth test.
+//
+// Usage: pipeline_statistics_report [views]
+// Run from the repository root so that the assets can be found. Built with
+// RASTERIZER_NO_STATISTICS defined, every counter is 0.
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "bench_scene.h"
+
+// The distance of the copy behind the model, along the view direction.
+#define COPY_DISTANCE 0.5f
+
+static void draw_mesh(BenchScene &scene, const standard_uniform &uniform)
+{
+    const Mesh &mesh = *scene.mesh;
+    for (uint32_t t = 0; t < mesh.triangle_count; t++)
+    {
+        standard_vertex_attribute attributes[3];
+        const void *attribute_ptrs[3];
+        for (uint32_t v = 0; v < 3; v++)
+        {
+            attributes[v].position = mesh.get_mesh_position(t, v);
+            attributes[v].normal = mesh.get_mesh_normal(t, v);
+            attributes[v].tangent = mesh.get_mesh_tangent(t, v);
+            attributes[v].texcoord = mesh.get_mesh_texcoord(t, v);
+            attribute_ptrs[v] = attributes + v;
+        }
+        draw_triangle(&scene.framebuffer, &uniform, attribute_ptrs);
+    }
+}
+
+static void print_statistics(int view, const char *name, const pipeline_statistics &statistics)
+{
+    printf("%4d  %-5s  %9llu  %6llu  %11llu  %10llu  %9llu  %9llu  %9llu  %9llu  %9llu\n", view, name,
+           (unsigned long long)statistics.submitted_triangles, (unsigned long long)statistics.culled_triangles,
+           (unsigned long long)statistics.back_facing_triangles,
+           (unsigned long long)statistics.degenerate_triangles, (unsigned long long)statistics.tested_pixels,
+           (unsigned long long)statistics.covered_fragments,
+           (unsigned long long)statistics.depth_rejected_fragments, (unsigned long long)statistics.shaded_fragments,
+           (unsigned long long)statistics.color_writes);
+}
+
+int main(int argc, char *argv[])
+{
+    int view_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 6;
+
+    BenchScene scene;
+    if (!initialize_bench_scene(scene))
+    {
+        printf("Can not load the cut_fish assets, run from the repository root.\n");
+        return 1;
+    }
+    set_packet_fragment_shader(standard_packet_fragment_shader);
+    Texture frame(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    tone_mapping_settings tone_mapping;
+    tone_mapping.exposure = 1.0f;
+    tone_mapping.tone_operator = tone_mapping_operator::TONE_MAPPING_NONE;
+
+    printf("%d views of %dx%d, %u triangles per draw:\n", view_count, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE,
+           scene.mesh->triangle_count);
+    printf("view  draw   submitted  culled  back facing  degenerate     tested    covered   rejected     shaded"
+           "     writes\n");
+    // Counted by the scene set up, not by a frame.
+    end_frame_statistics();
+    for (int view = 0; view < view_count; view++)
+    {
+        // Spread the views over the z sweep of the renderer.
+        vec3 camera_position{-2.0f, 4.5f, 2.0f + 4.0f * (view + 1) / view_count};
+        vec3 forward = (BENCH_CAMERA_TARGET - camera_position).normalize();
+        begin_bench_view(scene, scene.framebuffer, camera_position);
+        standard_uniform copy = scene.uniform;
+        copy.local2world = matrix_t::translate(forward * COPY_DISTANCE);
+
+        begin_draw_statistics();
+        draw_mesh(scene, scene.uniform);
+        print_statistics(view + 1, "model", get_draw_statistics());
+        begin_draw_statistics();
+        draw_mesh(scene, copy);
+        print_statistics(view + 1, "copy", get_draw_statistics());
+        resolve_hdr(scene.framebuffer, frame, tone_mapping);
+        print_statistics(view + 1, "frame", end_frame_statistics());
+    }
+    return 0;
+}
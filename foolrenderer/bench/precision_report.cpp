@@ -0,0 +1,138 @@
+// Renders views of the cut_fish sweep with the precise and the fast standard
+// fragment shader and reports, for each view, the time of both passes and the
+// image difference of the fast frame to the precise one. The cost of the
+// approximated math functions alone is measured first.
+//
+// Usage: precision_report [views] [difference directory]
+// If a directory is given, an amplified difference image of each view is
+// written there. Run from the repository root so that the assets can be
+// found.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_scene.h"
+#include "rmath/fast_math.h"
+#include "utility/image_diff.h"
+
+#define DATA_SIZE 1024
+
+using bench_clock = std::chrono::steady_clock;
+
+// ------------math functions------------
+
+// Returns the nanoseconds per call of the operation over the data set.
+template <typename Operation>
+static double measure(int iterations, float &checksum, Operation operation)
+{
+    auto start = bench_clock::now();
+    float sum = 0.0f;
+    for (int n = 0; n < iterations; n++)
+    {
+        for (size_t i = 0; i < DATA_SIZE; i++)
+        {
+            sum += operation(i);
+        }
+    }
+    auto end = bench_clock::now();
+    checksum += sum;
+    return std::chrono::duration<double, std::nano>(end - start).count() / ((double)iterations * DATA_SIZE);
+}
+
+static void report_function(const char *name, double precise, double fast)
+{
+    printf("%-16s %6.2f ns -> %6.2f ns  (%.1fx)\n", name, precise, fast, precise / fast);
+}
+
+static void measure_functions()
+{
+    using precise = shading_math<math_precision::MATH_PRECISION_PRECISE>;
+    using fast = shading_math<math_precision::MATH_PRECISION_FAST>;
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(0.01f, 1.0f);
+    std::vector<float> values(DATA_SIZE);
+    std::vector<vec3> vectors(DATA_SIZE);
+    for (size_t i = 0; i < DATA_SIZE; i++)
+    {
+        values[i] = distribution(generator);
+        vectors[i] = vec3{distribution(generator), distribution(generator), distribution(generator)};
+    }
+
+    const int iterations = 2000;
+    float checksum = 0.0f;
+    printf("Math functions, precise -> fast:\n");
+    report_function("sqrt",
+                    measure(iterations, checksum, [&](size_t i) { return precise::sqrt(values[i]); }),
+                    measure(iterations, checksum, [&](size_t i) { return fast::sqrt(values[i]); }));
+    report_function("divide",
+                    measure(iterations, checksum, [&](size_t i) { return precise::divide(1.5f, values[i]); }),
+                    measure(iterations, checksum, [&](size_t i) { return fast::divide(1.5f, values[i]); }));
+    report_function("pow",
+                    measure(iterations, checksum, [&](size_t i) { return precise::pow(values[i], 32.0f); }),
+                    measure(iterations, checksum, [&](size_t i) { return fast::pow(values[i], 32.0f); }));
+    report_function("vec3 normalize",
+                    measure(iterations, checksum, [&](size_t i) { return precise::normalize(vectors[i]).y; }),
+                    measure(iterations, checksum, [&](size_t i) { return fast::normalize(vectors[i]).y; }));
+    printf("(checksum %g)\n\n", checksum);
+}
+
+int main(int argc, char *argv[])
+{
+    int view_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 6;
+    const char *difference_directory = argc > 2 ? argv[2] : nullptr;
+
+    measure_functions();
+
+    BenchScene scene;
+    if (!initialize_bench_scene(scene))
+    {
+        printf("Can not load the cut_fish assets, run from the repository root.\n");
+        return 1;
+    }
+    Texture precise_frame(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    Texture fast_frame(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+
+    printf("Standard shader, fast compared to precise, %dx%d:\n", BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    printf("view  precise ms  fast ms  speedup  max error  mean error    PSNR dB  differing pixels\n");
+    double precise_total = 0.0, fast_total = 0.0;
+    uint32_t worst_max_error = 0;
+    double worst_psnr = INFINITY;
+    for (int view = 0; view < view_count; view++)
+    {
+        // Spread the views over the z sweep of the renderer.
+        vec3 camera_position{-2.0f, 4.5f, 2.0f + 4.0f * (view + 1) / view_count};
+        set_fragment_shader(standard_fragment_shader);
+        double precise_ms = render_bench_view(scene, camera_position, precise_frame);
+        set_fragment_shader(standard_fragment_shader_fast);
+        double fast_ms = render_bench_view(scene, camera_position, fast_frame);
+        precise_total += precise_ms;
+        fast_total += fast_ms;
+
+        image_difference difference;
+        compare_images(precise_frame, fast_frame, difference);
+        worst_max_error = std::max(worst_max_error, difference.max_error);
+        worst_psnr = std::min(worst_psnr, difference.psnr);
+        printf("%4d  %10.1f  %7.1f  %6.2fx  %9u  %10.2e  %9.2f  %8u (%.4f%%)\n", view + 1, precise_ms, fast_ms,
+               precise_ms / fast_ms, difference.max_error, difference.mean_error, difference.psnr,
+               difference.differing_pixel_count, 100.0 * difference.differing_pixel_count / difference.pixel_count);
+
+        if (difference_directory)
+        {
+            std::string path = std::string(difference_directory) + "/difference_" + std::to_string(view + 1) + ".tga";
+            std::unique_ptr<Texture> image = make_difference_image(precise_frame, fast_frame);
+            if (!save_image(*image, path, false, true))
+            {
+                printf("Can not write %s\n", path.c_str());
+            }
+        }
+    }
+    printf("total %10.1f  %7.1f  %6.2fx  worst max error %u, worst PSNR %.2f dB\n", precise_total, fast_total,
+           precise_total / fast_total, worst_max_error, worst_psnr);
+    return 0;
+}
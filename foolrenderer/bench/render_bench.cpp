@@ -0,0 +1,276 @@
+// Headless benchmark driver: renders one of the standard scenes along the
+// camera sweep of the renderer, without writing frames unless asked to, and
+// reports the frame times and the throughput as JSON, for capacity planning
+// and for comparing builds.
+//
+// Usage: render_bench [--scene=cut_fish|sphere|suzanne] [--resolution=WxH]
+//                     [--frames=N] [--warmup=N] [--threads=N]
+//                     [--output=prefix] [--json=path]
+//
+// The warm-up frames are rendered first and not measured. --threads sets the
+// threads of the HDR resolve, 0 for one per hardware thread, the rasterizer
+// always uses the calling thread. --output writes the measured frames as TGA
+// files with the prefix, their writing is then part of the frame time. The
+// JSON goes to stdout unless --json gives a file. The triangles and fragments
+// come from the pipeline statistics, they are 0 in builds that define
+// RASTERIZER_NO_STATISTICS. Run from the repository root so that the assets
+// can be found.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench_scene.h"
+#include "utility/frame_sink.h"
+
+// The frames of the camera sweep of the renderer, see render_cut_fish().
+#define SWEEP_FRAME_COUNT 120
+
+struct bench_scene_description
+{
+    const char *name;
+    const char *model_path;
+    // Empty for the default material.
+    const char *material_path;
+};
+
+static const bench_scene_description scene_descriptions[] = {
+    {"cut_fish", "./assets/cut_fish/cut_fish.obj", "./assets/cut_fish/"},
+    {"sphere", "./assets/sphere/sphere.obj", "./assets/rusted_iron/"},
+    {"suzanne", "./assets/suzanne/suzanne.obj", ""}};
+
+struct bench_options
+{
+    const bench_scene_description *scene = &scene_descriptions[0];
+    uint32_t width = BENCH_IMAGE_SIZE;
+    uint32_t height = BENCH_IMAGE_SIZE;
+    uint32_t frame_count = SWEEP_FRAME_COUNT;
+    uint32_t warmup_frame_count = 10;
+    uint32_t thread_count = 0;
+    std::string output_prefix;
+    std::string json_path;
+};
+
+// Parses a whole decimal number, returns false if text is not one.
+static bool parse_number(std::string_view text, uint32_t &value)
+{
+    if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string_view::npos)
+    {
+        return false;
+    }
+    value = (uint32_t)std::stoul(std::string(text));
+    return true;
+}
+
+static bool parse_options(int argc, char *argv[], bench_options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view argument = argv[i];
+        size_t separator = argument.find('=');
+        std::string_view name = argument.substr(0, separator);
+        std::string_view value = separator == std::string_view::npos ? "" : argument.substr(separator + 1);
+        bool is_valid = true;
+        if (name == "--scene")
+        {
+            options.scene = nullptr;
+            for (const bench_scene_description &description : scene_descriptions)
+            {
+                if (value == description.name)
+                {
+                    options.scene = &description;
+                }
+            }
+            is_valid = options.scene != nullptr;
+        }
+        else if (name == "--resolution")
+        {
+            size_t x = value.find('x');
+            is_valid = x != std::string_view::npos && parse_number(value.substr(0, x), options.width) &&
+                       parse_number(value.substr(x + 1), options.height) && options.width > 0 && options.height > 0;
+        }
+        else if (name == "--frames")
+        {
+            is_valid = parse_number(value, options.frame_count) && options.frame_count > 0;
+        }
+        else if (name == "--warmup")
+        {
+            is_valid = parse_number(value, options.warmup_frame_count);
+        }
+        else if (name == "--threads")
+        {
+            is_valid = parse_number(value, options.thread_count);
+        }
+        else if (name == "--output")
+        {
+            options.output_prefix = std::string(value);
+            is_valid = !value.empty();
+        }
+        else if (name == "--json")
+        {
+            options.json_path = std::string(value);
+            is_valid = !value.empty();
+        }
+        else
+        {
+            is_valid = false;
+        }
+        if (!is_valid)
+        {
+            fprintf(stderr, "Invalid option: %s\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// The camera position of a frame of the sweep of the renderer: 40 frames
+// along +z, 40 along -z and -x, and 40 along +x and +y.
+static vec3 get_sweep_camera_position(uint32_t frame)
+{
+    vec3 position{-2.0f, 4.5f, 2.0f};
+    for (uint32_t i = 1; i <= frame % SWEEP_FRAME_COUNT + 1; i++)
+    {
+        if (i <= 40)
+        {
+            position.z += 0.1f;
+        }
+        else if (i <= 80)
+        {
+            position.z -= 0.1f;
+            position.x -= 0.1f;
+        }
+        else
+        {
+            position.x += 0.1f;
+            position.y += 0.1f;
+        }
+    }
+    return position;
+}
+
+// The frame time below which the given fraction of the sorted frame times
+// are, by the nearest rank.
+static double get_percentile(const std::vector<double> &sorted_times, double fraction)
+{
+    size_t rank = (size_t)std::ceil(fraction * sorted_times.size());
+    return sorted_times[std::min(std::max(rank, (size_t)1), sorted_times.size()) - 1];
+}
+
+int main(int argc, char *argv[])
+{
+    bench_options options;
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "Usage: render_bench [--scene=cut_fish|sphere|suzanne] [--resolution=WxH] [--frames=N]\n"
+                        "                    [--warmup=N] [--threads=N] [--output=prefix] [--json=path]\n");
+        return 1;
+    }
+    BenchScene scene;
+    if (!initialize_bench_scene(scene, options.scene->model_path, options.scene->material_path, options.width,
+                                options.height))
+    {
+        fprintf(stderr, "Can not load the %s assets, run from the repository root.\n", options.scene->name);
+        return 1;
+    }
+    std::unique_ptr<FrameSink> sink;
+    if (!options.output_prefix.empty())
+    {
+        sink = std::make_unique<FrameSink>(frame_sink_format::FRAME_SINK_TGA, options.output_prefix, options.width,
+                                           options.height);
+        if (!sink->is_open())
+        {
+            fprintf(stderr, "Can not open output: %s\n", options.output_prefix.c_str());
+            return 1;
+        }
+    }
+    FILE *json = stdout;
+    if (!options.json_path.empty())
+    {
+        json = fopen(options.json_path.c_str(), "w");
+        if (json == nullptr)
+        {
+            fprintf(stderr, "Can not write %s\n", options.json_path.c_str());
+            return 1;
+        }
+    }
+
+    set_packet_fragment_shader(standard_packet_fragment_shader);
+    Texture frame(texture_format::TEXTURE_FORMAT_SRGB8_A8, options.width, options.height);
+    tone_mapping_settings tone_mapping;
+    tone_mapping.exposure = 1.0f;
+    tone_mapping.tone_operator = tone_mapping_operator::TONE_MAPPING_NONE;
+    tone_mapping.thread_count = options.thread_count;
+    std::vector<double> frame_times;
+    frame_times.reserve(options.frame_count);
+    pipeline_statistics statistics{};
+    bool is_output_written = true;
+
+    for (uint32_t f = 0; f < options.warmup_frame_count + options.frame_count; f++)
+    {
+        bool is_measured = f >= options.warmup_frame_count;
+        // The measured frames start the sweep again.
+        uint32_t sweep_frame = is_measured ? f - options.warmup_frame_count : f;
+        // Only the counters of the measured frames are kept.
+        end_frame_statistics();
+        auto start = std::chrono::steady_clock::now();
+        draw_bench_view(scene, scene.framebuffer, get_sweep_camera_position(sweep_frame));
+        resolve_hdr(scene.framebuffer, frame, tone_mapping);
+        if (is_measured && sink)
+        {
+            is_output_written = sink->write_frame(frame) && is_output_written;
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (is_measured)
+        {
+            frame_times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            statistics.add(end_frame_statistics());
+        }
+    }
+    if (sink)
+    {
+        is_output_written = sink->finish() && is_output_written;
+    }
+
+    double total_time = 0.0;
+    for (double time : frame_times)
+    {
+        total_time += time;
+    }
+    std::vector<double> sorted_times = frame_times;
+    std::sort(sorted_times.begin(), sorted_times.end());
+    double total_seconds = total_time / 1000.0;
+    fprintf(json, "{\n");
+    fprintf(json, "  \"scene\": \"%s\",\n", options.scene->name);
+    fprintf(json, "  \"width\": %u,\n  \"height\": %u,\n", options.width, options.height);
+    fprintf(json, "  \"frames\": %u,\n  \"warmup_frames\": %u,\n", options.frame_count,
+            options.warmup_frame_count);
+    fprintf(json, "  \"threads\": %u,\n  \"output\": %s,\n", options.thread_count, sink ? "true" : "false");
+    fprintf(json, "  \"triangles_per_frame\": %u,\n", scene.mesh->triangle_count);
+    fprintf(json, "  \"frame_time_ms\": {\"mean\": %.3f, \"median\": %.3f, \"p95\": %.3f, \"p99\": %.3f, "
+                  "\"min\": %.3f, \"max\": %.3f},\n",
+            total_time / frame_times.size(), get_percentile(sorted_times, 0.5), get_percentile(sorted_times, 0.95),
+            get_percentile(sorted_times, 0.99), sorted_times.front(), sorted_times.back());
+    fprintf(json, "  \"frames_per_second\": %.3f,\n", frame_times.size() / total_seconds);
+    fprintf(json, "  \"triangles_per_second\": %.0f,\n", statistics.submitted_triangles / total_seconds);
+    fprintf(json, "  \"fragments_per_second\": %.0f,\n", statistics.shaded_fragments / total_seconds);
+    fprintf(json, "  \"pixels_per_second\": %.0f\n", (double)options.width * options.height * frame_times.size() /
+                                                           total_seconds);
+    fprintf(json, "}\n");
+    if (json != stdout && fclose(json) != 0)
+    {
+        fprintf(stderr, "Can not write %s\n", options.json_path.c_str());
+        return 1;
+    }
+    if (!is_output_written)
+    {
+        fprintf(stderr, "Can not write the frames to %s\n", options.output_prefix.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Measures the vector and matrix operations of rmath against scalar versions
+// that are compiled out of line, which is how every operator used to be
+// called before rmath became header-inline.
+//
+// Usage: rmath_bench [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "rmath/rmatrix.h"
+#include "rmath/rvector.h"
+
+#define DATA_SIZE 1024
+
+#if defined(_MSC_VER)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+using bench_clock = std::chrono::steady_clock;
+
+// ------------out of line scalar versions------------
+
+BENCH_NOINLINE static vec4 scalar_add(const vec4 &a, const vec4 &b)
+{
+    return vec4{a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+}
+
+BENCH_NOINLINE static vec4 scalar_scale(const vec4 &a, float s)
+{
+    return vec4{a.x * s, a.y * s, a.z * s, a.w * s};
+}
+
+BENCH_NOINLINE static vec3 scalar_normalize(const vec3 &v)
+{
+    float square_magnitude = v.x * v.x + v.y * v.y + v.z * v.z;
+    if (square_magnitude == 0.0f)
+    {
+        return VEC3_ZERO;
+    }
+    float s = 1.0f / sqrtf(square_magnitude);
+    return vec3{v.x * s, v.y * s, v.z * s};
+}
+
+BENCH_NOINLINE static vec4 scalar_transform(const matrix4x4 &m, const vec4 &v)
+{
+    vec4 result = VEC4_ZERO;
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            result.elements[i] += m.elements[i][j] * v.elements[j];
+        }
+    }
+    return result;
+}
+
+BENCH_NOINLINE static matrix4x4 scalar_multiply(const matrix4x4 &a, const matrix4x4 &b)
+{
+    matrix4x4 result = MATRIX4x4_ZERO;
+    for (int v = 0; v < 4; v++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                result.elements[i][v] += a.elements[i][j] * b.elements[j][v];
+            }
+        }
+    }
+    return result;
+}
+
+// ------------measurement------------
+
+// Runs the operation over the data set for the given number of iterations and
+// returns the nanoseconds per operation. The results are accumulated into
+// the checksum, so the work can not be optimized away.
+template <typename Operation>
+static double measure(int iterations, float &checksum, Operation operation)
+{
+    auto start = bench_clock::now();
+    float sum = 0.0f;
+    for (int n = 0; n < iterations; n++)
+    {
+        for (size_t i = 0; i < DATA_SIZE; i++)
+        {
+            sum += operation(i);
+        }
+    }
+    auto end = bench_clock::now();
+    checksum += sum;
+    return std::chrono::duration<double, std::nano>(end - start).count() / ((double)iterations * DATA_SIZE);
+}
+
+static void report(const char *name, double scalar, double inline_simd)
+{
+    printf("%-22s %6.2f ns -> %6.2f ns  (%.1fx)\n", name, scalar, inline_simd, scalar / inline_simd);
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+    std::vector<vec3> vectors3(DATA_SIZE);
+    std::vector<vec4> vectors4(DATA_SIZE);
+    std::vector<matrix4x4> matrices(DATA_SIZE);
+    for (size_t i = 0; i < DATA_SIZE; i++)
+    {
+        vectors3[i] = vec3{distribution(generator), distribution(generator), distribution(generator)};
+        vectors4[i] = vec4{distribution(generator), distribution(generator),
+                           distribution(generator), distribution(generator)};
+        for (int r = 0; r < 4; r++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                matrices[i].elements[r][c] = distribution(generator);
+            }
+        }
+    }
+
+#ifdef RMATH_SSE
+    printf("rmath SIMD: SSE2\n");
+#elif defined(RMATH_NEON)
+    printf("rmath SIMD: NEON\n");
+#else
+    printf("rmath SIMD: none\n");
+#endif
+    printf("%d x %d operations, out of line scalar -> inline.\n", iterations, DATA_SIZE);
+
+    float checksum = 0.0f;
+    const matrix4x4 &m = matrices[0];
+    report("vec4 + vec4",
+           measure(iterations, checksum, [&](size_t i) { return scalar_add(vectors4[i], vectors4[DATA_SIZE - 1 - i]).y; }),
+           measure(iterations, checksum, [&](size_t i) { return (vectors4[i] + vectors4[DATA_SIZE - 1 - i]).y; }));
+    report("vec4 * float",
+           measure(iterations, checksum, [&](size_t i) { return scalar_scale(vectors4[i], 0.5f).z; }),
+           measure(iterations, checksum, [&](size_t i) { return (vectors4[i] * 0.5f).z; }));
+    report("vec3 normalize",
+           measure(iterations, checksum, [&](size_t i) { return scalar_normalize(vectors3[i]).x; }),
+           measure(iterations, checksum, [&](size_t i) { return vectors3[i].normalize().x; }));
+    report("matrix4x4 * vec4",
+           measure(iterations, checksum, [&](size_t i) { return scalar_transform(m, vectors4[i]).w; }),
+           measure(iterations, checksum, [&](size_t i) { return (m * vectors4[i]).w; }));
+    report("matrix4x4 * matrix4x4",
+           measure(iterations / 4, checksum, [&](size_t i) { return scalar_multiply(m, matrices[i]).elements[3][1]; }),
+           measure(iterations / 4, checksum, [&](size_t i) { return (m * matrices[i]).elements[3][1]; }));
+    // The scalar inverse was already inline, this only compares the SIMD path.
+    report("matrix4x4 inverse",
+           measure(iterations / 4, checksum, [&](size_t i) { return matrices[i].inverse_scalar().elements[2][1]; }),
+           measure(iterations / 4, checksum, [&](size_t i) { return matrices[i].inverse().elements[2][1]; }));
+    printf("(checksum %g)\n", checksum);
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Renders views of the cut_fish sweep at each shading rate and reports the
+// time of each pass and the image difference to the frame shaded per pixel.
+// The adaptive rate uses a shading rate image made from the per pixel frame
+// of the view, which stands in for the previous frame of an animation: flat
+// tiles are shaded at 4x4, tiles with some contrast at 2x2, the rest per
+// pixel.
+//
+// Usage: shading_rate_report [views] [difference directory]
+// If a directory is given, an amplified difference image of each view and
+// rate is written there. Run from the repository root so that the assets can
+// be found.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_scene.h"
+#include "utility/image_diff.h"
+
+// Largest difference of the stored 8-bit components inside a tile for it to
+// be shaded at 4x4 or 2x2.
+#define FLAT_TILE_CONTRAST 4
+#define SMOOTH_TILE_CONTRAST 16
+
+#define RATE_COUNT 3
+
+struct rate_result
+{
+    double milliseconds = 0.0;
+    uint32_t max_error = 0;
+    double mean_error = 0.0;
+    double psnr = INFINITY;
+};
+
+// Chooses the rate of each tile from the contrast of the frame in the tile.
+static void make_rate_image(const Texture &frame, std::vector<shading_rate> &rates, uint32_t &width,
+                            uint32_t &height, uint32_t tile_counts[RATE_COUNT])
+{
+    width = (frame.m_width + SHADING_RATE_TILE_SIZE - 1) / SHADING_RATE_TILE_SIZE;
+    height = (frame.m_height + SHADING_RATE_TILE_SIZE - 1) / SHADING_RATE_TILE_SIZE;
+    rates.assign((size_t)width * height, shading_rate::SHADING_RATE_1X1);
+    const uint8_t *pixels = frame.get_pixels();
+    for (uint32_t tile_y = 0; tile_y < height; tile_y++)
+    {
+        for (uint32_t tile_x = 0; tile_x < width; tile_x++)
+        {
+            int contrast = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                int min_value = 255, max_value = 0;
+                for (uint32_t y = tile_y * SHADING_RATE_TILE_SIZE;
+                     y < std::min((tile_y + 1) * SHADING_RATE_TILE_SIZE, frame.m_height); y++)
+                {
+                    for (uint32_t x = tile_x * SHADING_RATE_TILE_SIZE;
+                         x < std::min((tile_x + 1) * SHADING_RATE_TILE_SIZE, frame.m_width); x++)
+                    {
+                        int value = pixels[((size_t)y * frame.m_width + x) * 4 + c];
+                        min_value = std::min(min_value, value);
+                        max_value = std::max(max_value, value);
+                    }
+                }
+                contrast = std::max(contrast, max_value - min_value);
+            }
+            shading_rate rate = contrast <= FLAT_TILE_CONTRAST     ? shading_rate::SHADING_RATE_4X4
+                                : contrast <= SMOOTH_TILE_CONTRAST ? shading_rate::SHADING_RATE_2X2
+                                                                   : shading_rate::SHADING_RATE_1X1;
+            rates[(size_t)tile_y * width + tile_x] = rate;
+            tile_counts[(int)rate]++;
+        }
+    }
+}
+
+static void add_difference(rate_result &result, const Texture &reference, const Texture &frame)
+{
+    image_difference difference;
+    compare_images(reference, frame, difference);
+    result.max_error = std::max(result.max_error, difference.max_error);
+    result.mean_error += difference.mean_error;
+    result.psnr = std::min(result.psnr, difference.psnr);
+}
+
+static void write_difference(const char *directory, const char *name, int view, const Texture &reference,
+                             const Texture &frame)
+{
+    std::string path = std::string(directory) + "/" + name + "_" + std::to_string(view + 1) + ".tga";
+    std::unique_ptr<Texture> image = make_difference_image(reference, frame);
+    if (!save_image(*image, path, false, true))
+    {
+        printf("Can not write %s\n", path.c_str());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int view_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 6;
+    const char *difference_directory = argc > 2 ? argv[2] : nullptr;
+
+    BenchScene scene;
+    if (!initialize_bench_scene(scene))
+    {
+        printf("Can not load the cut_fish assets, run from the repository root.\n");
+        return 1;
+    }
+    set_packet_fragment_shader(standard_packet_fragment_shader);
+    Texture reference(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    Texture frame(texture_format::TEXTURE_FORMAT_SRGB8_A8, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    const shading_rate rates[RATE_COUNT] = {shading_rate::SHADING_RATE_1X1, shading_rate::SHADING_RATE_2X2,
+                                            shading_rate::SHADING_RATE_4X4};
+    const char *names[RATE_COUNT + 1] = {"1x1", "2x2", "4x4", "adaptive"};
+    rate_result results[RATE_COUNT + 1];
+    std::vector<shading_rate> rate_image;
+    uint32_t rate_image_width, rate_image_height;
+    uint32_t tile_counts[RATE_COUNT] = {0, 0, 0};
+
+    for (int view = 0; view < view_count; view++)
+    {
+        // Spread the views over the z sweep of the renderer.
+        vec3 camera_position{-2.0f, 4.5f, 2.0f + 4.0f * (view + 1) / view_count};
+        set_shading_rate(rates[0]);
+        results[0].milliseconds += render_bench_view(scene, camera_position, reference);
+        for (int r = 1; r < RATE_COUNT; r++)
+        {
+            set_shading_rate(rates[r]);
+            results[r].milliseconds += render_bench_view(scene, camera_position, frame);
+            add_difference(results[r], reference, frame);
+            if (difference_directory)
+            {
+                write_difference(difference_directory, names[r], view, reference, frame);
+            }
+        }
+
+        make_rate_image(reference, rate_image, rate_image_width, rate_image_height, tile_counts);
+        set_shading_rate(shading_rate::SHADING_RATE_1X1);
+        set_shading_rate_image(rate_image.data(), rate_image_width, rate_image_height);
+        results[RATE_COUNT].milliseconds += render_bench_view(scene, camera_position, frame);
+        set_shading_rate_image(nullptr, 0, 0);
+        add_difference(results[RATE_COUNT], reference, frame);
+        if (difference_directory)
+        {
+            write_difference(difference_directory, names[RATE_COUNT], view, reference, frame);
+        }
+    }
+
+    printf("%d views of %dx%d, differences to 1x1:\n", view_count, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+    printf("rate      ms/frame  speedup  max error  mean error  worst PSNR dB\n");
+    for (int r = 0; r <= RATE_COUNT; r++)
+    {
+        const rate_result &result = results[r];
+        printf("%-8s  %8.1f  %6.2fx  %9u  %10.3f  %13.2f\n", names[r], result.milliseconds / view_count,
+               results[0].milliseconds / result.milliseconds, result.max_error, result.mean_error / view_count,
+               result.psnr);
+    }
+    uint32_t tile_count = tile_counts[0] + tile_counts[1] + tile_counts[2];
+    printf("adaptive tiles: 1x1 %.1f%%, 2x2 %.1f%%, 4x4 %.1f%%\n", 100.0 * tile_counts[0] / tile_count,
+           100.0 * tile_counts[1] / tile_count, 100.0 * tile_counts[2] / tile_count);
+    return 0;
+}
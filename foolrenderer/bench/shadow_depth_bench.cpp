@@ -0,0 +1,130 @@
+// Renders the cut_fish shadow map with each depth attachment format and
+// reports the pass time, the depth buffer size, the largest difference to the
+// float shadow map, and the size of the DEPTH16 map after tile compression.
+// Sampling costs are measured over the shadow map texels in scanline order.
+//
+// Usage: shadow_depth_bench [model.obj] [passes]
+// Run from the repository root so that the default model can be found.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "graphics/depth_compression.h"
+#include "graphics/framebuffer.h"
+#include "graphics/rasterizer.h"
+#include "graphics/texture.h"
+#include "rmath/rmatrix.h"
+#include "shaders/shadow_casting.h"
+#include "utility/mesh.h"
+
+#define SHADOW_MAP_SIZE 1024
+
+using bench_clock = std::chrono::steady_clock;
+
+// Returns the milliseconds per pass.
+static double render_shadow_map(FrameBuffer &framebuffer, const Mesh &mesh, int pass_count)
+{
+    shadow_casting_uniform uniform;
+    vec3 light_position = vec3{1.0f, 4.0f, -1.0f}.normalize() * 5.0f;
+    matrix4x4 world2view = matrix_t::look_at(light_position, VEC3_ZERO, vec3{0.0f, 1.0f, 0.0f});
+    uniform.local2clip = matrix_t::orthographic(1.5f, 1.5f, 0.1f, 6.0f) * world2view;
+    set_viewport(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+    set_vertex_shader(shadow_casting_vertex_shader);
+    set_fragment_shader(shadow_casting_fragment_shader);
+
+    auto start = bench_clock::now();
+    for (int pass = 0; pass < pass_count; pass++)
+    {
+        framebuffer.clear();
+        for (uint32_t t = 0; t < mesh.triangle_count; t++)
+        {
+            shadow_casting_vertex_attribute attributes[3];
+            const void *attribute_ptrs[3];
+            for (uint32_t v = 0; v < 3; v++)
+            {
+                attributes[v].position = mesh.get_mesh_position(t, v);
+                attribute_ptrs[v] = attributes + v;
+            }
+            draw_triangle(&framebuffer, &uniform, attribute_ptrs);
+        }
+        framebuffer.resolve(attachment_type::DEPTH_ATTACHMENT);
+    }
+    auto end = bench_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / pass_count;
+}
+
+// Returns the nanoseconds per sample and accumulates the sampled values.
+static double time_sampling(const Texture &texture, float &checksum)
+{
+    auto start = bench_clock::now();
+    float sum = 0.0f;
+    for (uint32_t y = 0; y < texture.m_height; y++)
+    {
+        for (uint32_t x = 0; x < texture.m_width; x++)
+        {
+            sum += texture.sample(vec2{(x + 0.5f) / texture.m_width, (y + 0.5f) / texture.m_height}).r;
+        }
+    }
+    auto end = bench_clock::now();
+    checksum += sum;
+    return std::chrono::duration<double, std::nano>(end - start).count() / ((double)texture.m_width * texture.m_height);
+}
+
+static float max_difference(const Texture &a, const Texture &b)
+{
+    float difference = 0.0f;
+    for (uint32_t y = 0; y < a.m_height; y++)
+    {
+        for (uint32_t x = 0; x < a.m_width; x++)
+        {
+            vec2 texcoord{(x + 0.5f) / a.m_width, (y + 0.5f) / a.m_height};
+            difference = std::max(difference, fabsf(a.sample(texcoord).r - b.sample(texcoord).r));
+        }
+    }
+    return difference;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string model_path = argc > 1 ? argv[1] : "./assets/cut_fish/cut_fish.obj";
+    int pass_count = argc > 2 ? atoi(argv[2]) : 5;
+    Mesh mesh(model_path);
+    if (mesh.triangle_count == 0)
+    {
+        printf("Failed to load %s.\n", model_path.c_str());
+        return 1;
+    }
+
+    const char *names[] = {"DEPTH_FLOAT", "DEPTH24", "DEPTH16"};
+    texture_format formats[] = {texture_format::TEXTURE_FORMAT_DEPTH_FLOAT, texture_format::TEXTURE_FORMAT_DEPTH24,
+                                texture_format::TEXTURE_FORMAT_DEPTH16};
+    FrameBuffer framebuffers[3];
+    float checksum = 0.0f;
+    printf("%ux%u shadow map, %u triangles, %d passes\n", SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, mesh.triangle_count,
+           pass_count);
+    for (int i = 0; i < 3; i++)
+    {
+        framebuffers[i].attach_texture(attachment_type::DEPTH_ATTACHMENT,
+                                       std::make_unique<Texture>(formats[i], SHADOW_MAP_SIZE, SHADOW_MAP_SIZE));
+        double pass_ms = render_shadow_map(framebuffers[i], mesh, pass_count);
+        const Texture &depth = *framebuffers[i].depth_buffer;
+        printf("%-12s %8zu bytes  pass %7.2f ms  sample %5.2f ns  max error %.2e\n", names[i],
+               Texture::get_data_size(depth.m_format, depth.m_width, depth.m_height), pass_ms,
+               time_sampling(depth, checksum), max_difference(depth, *framebuffers[0].depth_buffer));
+    }
+
+    depth_compression_stats stats;
+    auto start = bench_clock::now();
+    auto compressed = compress_depth(*framebuffers[2].depth_buffer, &stats);
+    auto end = bench_clock::now();
+    printf("%-12s %8zu bytes  compress %4.2f ms  sample %5.2f ns  max error to DEPTH16 %.2e\n", "DEPTH16_TILED",
+           compressed->pixels.size(), std::chrono::duration<double, std::milli>(end - start).count(),
+           time_sampling(*compressed, checksum), max_difference(*compressed, *framebuffers[2].depth_buffer));
+    printf("tiles: %u constant, %u plane, %u min/max, %u raw  (checksum %g)\n", stats.constant_tiles,
+           stats.plane_tiles, stats.min_max_tiles, stats.raw_tiles, checksum);
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Compares memory footprint, sampling cost and error of the block compressed
+// texture formats against the uncompressed formats.
+//
+// Usage: texture_compression_bench [color.tga] [single_channel.tga]
+// Run from the repository root so that the default assets can be found. If a
+// file can not be loaded, a procedural texture is used instead.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "graphics/texture.h"
+#include "graphics/texture_compression.h"
+#include "utility/image.h"
+
+#define TEXTURE_SIZE 1024
+#define SAMPLE_COUNT (1 << 22)
+
+using bench_clock = std::chrono::steady_clock;
+
+static std::unique_ptr<Texture> make_procedural_texture(texture_format format)
+{
+    auto texture = std::make_unique<Texture>(format, TEXTURE_SIZE, TEXTURE_SIZE);
+    size_t component_count = format == texture_format::TEXTURE_FORMAT_R8 ? 1 : 3;
+    uint8_t *pixel = texture->get_pixels();
+    for (uint32_t y = 0; y < TEXTURE_SIZE; y++)
+    {
+        for (uint32_t x = 0; x < TEXTURE_SIZE; x++)
+        {
+            float fx = (float)x / TEXTURE_SIZE;
+            float fy = (float)y / TEXTURE_SIZE;
+            float values[3] = {0.5f + 0.5f * sinf(fx * 40.0f + fy * 7.0f),
+                               0.5f + 0.5f * cosf(fy * 33.0f),
+                               0.5f + 0.5f * sinf((fx - fy) * 21.0f)};
+            for (size_t c = 0; c < component_count; c++)
+            {
+                pixel[c] = float_to_uint8(values[c]);
+            }
+            pixel += component_count;
+        }
+    }
+    return texture;
+}
+
+// Returns the nanoseconds per sample of sampling the given coordinates.
+static double time_sampling(const Texture &texture, const std::vector<vec2> &texcoords, float &checksum)
+{
+    auto start = bench_clock::now();
+    float sum = 0.0f;
+    for (const vec2 &texcoord : texcoords)
+    {
+        sum += texture.sample(texcoord).r;
+    }
+    auto end = bench_clock::now();
+    checksum += sum;
+    return std::chrono::duration<double, std::nano>(end - start).count() / texcoords.size();
+}
+
+// Returns the peak signal-to-noise ratio of the compressed texture in the
+// first component_count components, measured on the sampled values.
+static double compute_psnr(const Texture &reference, const Texture &compressed, size_t component_count)
+{
+    double squared_error = 0.0;
+    for (uint32_t y = 0; y < reference.m_height; y++)
+    {
+        for (uint32_t x = 0; x < reference.m_width; x++)
+        {
+            vec2 texcoord{(x + 0.5f) / reference.m_width, (y + 0.5f) / reference.m_height};
+            vec4 a = reference.sample(texcoord);
+            vec4 b = compressed.sample(texcoord);
+            for (size_t c = 0; c < component_count; c++)
+            {
+                double difference = a.elements[c] - b.elements[c];
+                squared_error += difference * difference;
+            }
+        }
+    }
+    double mse = squared_error / ((double)reference.m_width * reference.m_height * component_count);
+    return mse == 0.0 ? INFINITY : 10.0 * log10(1.0 / mse);
+}
+
+static void run(const char *name, const Texture &source, texture_format format, size_t error_components,
+                const std::vector<vec2> &coherent, const std::vector<vec2> &random)
+{
+    auto start = bench_clock::now();
+    auto compressed = compress_texture(source, format);
+    auto end = bench_clock::now();
+    if (!compressed)
+    {
+        printf("%-10s compression failed\n", name);
+        return;
+    }
+    double encode_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    float checksum = 0.0f;
+    double source_coherent = time_sampling(source, coherent, checksum);
+    double source_random = time_sampling(source, random, checksum);
+    double compressed_coherent = time_sampling(*compressed, coherent, checksum);
+    double compressed_random = time_sampling(*compressed, random, checksum);
+
+    size_t source_bytes = Texture::get_data_size(source.m_format, source.m_width, source.m_height);
+    size_t compressed_bytes = Texture::get_data_size(compressed->m_format, compressed->m_width, compressed->m_height);
+    printf("%-10s %9zu -> %8zu bytes (%.1fx)  encode %7.1f ms  "
+           "coherent %5.2f -> %5.2f ns  random %5.2f -> %5.2f ns  PSNR %5.1f dB  (checksum %g)\n",
+           name, source_bytes, compressed_bytes, (double)source_bytes / compressed_bytes, encode_ms,
+           source_coherent, compressed_coherent, source_random, compressed_random,
+           compute_psnr(source, *compressed, error_components), checksum);
+}
+
+int main(int argc, char *argv[])
+{
+    std::string color_path = argc > 1 ? argv[1] : "./assets/test_cube/test_cube_diffuse.tga";
+    std::string single_channel_path = argc > 2 ? argv[2] : "./assets/cut_fish/roughness.tga";
+
+    auto color = load_image(color_path, false);
+    if (!color || color->m_format != texture_format::TEXTURE_FORMAT_RGB8)
+    {
+        printf("Using procedural color texture.\n");
+        color = make_procedural_texture(texture_format::TEXTURE_FORMAT_RGB8);
+    }
+    auto srgb_color = std::make_unique<Texture>(*color);
+    srgb_color->m_format = texture_format::TEXTURE_FORMAT_SRGB8;
+    auto single_channel = load_image(single_channel_path, false);
+    if (!single_channel || single_channel->m_format != texture_format::TEXTURE_FORMAT_R8)
+    {
+        printf("Using procedural single channel texture.\n");
+        single_channel = make_procedural_texture(texture_format::TEXTURE_FORMAT_R8);
+    }
+
+    // Coherent coordinates walk the texture in scanline order with a small
+    // step, like neighboring fragments of a triangle. Random coordinates
+    // are the worst case for both caches.
+    std::vector<vec2> coherent(SAMPLE_COUNT);
+    std::vector<vec2> random(SAMPLE_COUNT);
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    uint32_t row_length = 2048;
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        coherent[i] = vec2{(float)(i % row_length) / row_length, (float)(i / row_length) / (SAMPLE_COUNT / row_length)};
+        random[i] = vec2{distribution(generator), distribution(generator)};
+    }
+
+    printf("%d samples per measurement, sampling cost is uncompressed -> compressed.\n", SAMPLE_COUNT);
+    run("BC1", *color, texture_format::TEXTURE_FORMAT_BC1, 3, coherent, random);
+    run("BC1_SRGB", *srgb_color, texture_format::TEXTURE_FORMAT_BC1_SRGB, 3, coherent, random);
+    run("BC4", *single_channel, texture_format::TEXTURE_FORMAT_BC4, 1, coherent, random);
+    run("BC5", *color, texture_format::TEXTURE_FORMAT_BC5, 2, coherent, random);
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Measures save_image() with and without run-length encoding on a frame like
+// the ones the renderer writes: a flat clear color with a shaded object in
+// the middle.
+//
+// Usage: tga_write_bench [frame.tga] [iterations]
+// If the frame can not be loaded, a procedural frame is used instead. First
+// checks that run-length encoded rows that encode to more bytes than the row,
+// grayscale pixels in the pattern A B B A B B, are written and read back
+// unchanged.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_frame.h"
+#include "graphics/texture.h"
+#include "utility/image.h"
+#include "utility/tgafunc_cpp.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+// Writes a grayscale image whose rows alternate single pixels and pairs with
+// run-length encoding, the worst case of the encoder, and compares it to the
+// image read back.
+static bool check_rle_round_trip()
+{
+    const char *path = "tga_write_bench_rle.tga";
+    const int width = 1021, height = 4;
+    std::vector<uint8_t> pixels((size_t)width * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            pixels[(size_t)y * width + x] = x % 3 == 0 ? (uint8_t)(y * 16) : (uint8_t)(x / 3 + y);
+        }
+    }
+    bool is_written;
+    {
+        tga::ImageWriter writer(path, width, height, tga::tga_pixel_format::TGA_PIXEL_BW8, true, false);
+        is_written = true;
+        for (int y = 0; y < height; y++)
+        {
+            is_written = writer.write_row(pixels.data() + (size_t)y * width) && is_written;
+        }
+        is_written = writer.finish() && is_written;
+    }
+    tga::Image image(path);
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return is_written && image.last_error() == tga::tga_error::TGA_NO_ERROR && image.get_width() == width &&
+           image.get_height() == height && image.get_data() == pixels;
+}
+
+static void run(const char *name, const Texture &frame, bool alpha, bool rle, int iterations)
+{
+    const char *path = "tga_write_bench.tga";
+    auto start = bench_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        if (!save_image(frame, path, alpha, rle))
+        {
+            printf("%-14s save failed\n", name);
+            return;
+        }
+    }
+    auto end = bench_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    std::filesystem::remove(path, error);
+    printf("%-14s %9ju bytes  %7.2f ms\n", name, size, ms);
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+    if (!check_rle_round_trip())
+    {
+        printf("Run-length encoded grayscale rows do not read back unchanged.\n");
+        return 1;
+    }
+    printf("Run-length encoded grayscale round trip: ok\n");
+    std::unique_ptr<Texture> frame = argc > 1 ? load_image(argv[1], true) : nullptr;
+    if (!frame)
+    {
+        printf("Using procedural frame.\n");
+        frame = make_procedural_frame();
+    }
+
+    run("RGB24", *frame, false, false, iterations);
+    run("RGB24 RLE", *frame, false, true, iterations);
+    run("ARGB32", *frame, true, false, iterations);
+    run("ARGB32 RLE", *frame, true, true, iterations);
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Compares the per-vertex front end of draw_triangle() with the batched
+// transform_vertices() front end: first on a large set of random positions,
+// then on the cut_fish shadow pass, where it replaces the vertex shader.
+//
+// Usage: vertex_transform_bench [model.obj] [passes]
+// Run from the repository root so that the default model can be found.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "graphics/framebuffer.h"
+#include "graphics/rasterizer.h"
+#include "graphics/texture.h"
+#include "rmath/rmatrix.h"
+#include "shaders/shadow_casting.h"
+#include "utility/mesh.h"
+
+#define POSITION_COUNT (1 << 20)
+#define SHADOW_MAP_SIZE 1024
+
+using bench_clock = std::chrono::steady_clock;
+
+static matrix4x4 get_light_world2clip()
+{
+    vec3 light_position = vec3{1.0f, 4.0f, -1.0f}.normalize() * 5.0f;
+    matrix4x4 world2view = matrix_t::look_at(light_position, VEC3_ZERO, vec3{0.0f, 1.0f, 0.0f});
+    return matrix_t::orthographic(1.5f, 1.5f, 0.1f, 6.0f) * world2view;
+}
+
+// The work draw_triangle() does per vertex, with the shader call inlined.
+// Returns the nanoseconds per position.
+static double time_per_vertex(const matrix4x4 &local2clip, const std::vector<vec3> &positions,
+                              transformed_vertices &output)
+{
+    output.resize(positions.size());
+    auto start = bench_clock::now();
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        vec4 clip = local2clip * positions[i].to4D(1.0f);
+        bool clipped = false;
+        for (int c = 0; c < 3; c++)
+        {
+            clipped = clipped || clip.elements[c] < -clip.w || clip.elements[c] > clip.w;
+        }
+        float inverse_w = 1.0f / clip.w;
+        output.clip_codes[i] = clipped;
+        output.screen_x[i] = (clip.x * inverse_w + 1.0f) * 0.5f * SHADOW_MAP_SIZE;
+        output.screen_y[i] = (clip.y * inverse_w + 1.0f) * 0.5f * SHADOW_MAP_SIZE;
+        output.depth[i] = (clip.z * inverse_w + 1.0f) * 0.5f;
+        output.inverse_w[i] = inverse_w;
+    }
+    auto end = bench_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / positions.size();
+}
+
+// The per vertex front end only marks the vertices outside the viewing volume,
+// transform_vertices() also tells which planes they are outside of.
+static bool same_clipped_vertices(const transformed_vertices &per_vertex, const transformed_vertices &batched)
+{
+    for (size_t i = 0; i < per_vertex.clip_codes.size(); i++)
+    {
+        if ((per_vertex.clip_codes[i] != 0) != (batched.clip_codes[i] != 0))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the milliseconds per shadow pass.
+static double time_shadow_pass(FrameBuffer &framebuffer, const Mesh &mesh, bool batched, int pass_count)
+{
+    shadow_casting_uniform uniform;
+    uniform.local2clip = get_light_world2clip();
+    transformed_vertices vertices;
+
+    auto start = bench_clock::now();
+    for (int pass = 0; pass < pass_count; pass++)
+    {
+        framebuffer.clear();
+        if (batched)
+        {
+            transform_vertices(uniform.local2clip, mesh.positions_x.get(), mesh.positions_y.get(),
+                               mesh.positions_z.get(), mesh.vertex_count, vertices);
+            for (uint32_t t = 0; t < mesh.triangle_count; t++)
+            {
+                draw_transformed_triangle(&framebuffer, &uniform, vertices, mesh.indices.get() + t * 3, nullptr);
+            }
+        }
+        else
+        {
+            for (uint32_t t = 0; t < mesh.triangle_count; t++)
+            {
+                shadow_casting_vertex_attribute attributes[3];
+                const void *attribute_ptrs[3];
+                for (uint32_t v = 0; v < 3; v++)
+                {
+                    attributes[v].position = mesh.get_mesh_position(t, v);
+                    attribute_ptrs[v] = attributes + v;
+                }
+                draw_triangle(&framebuffer, &uniform, attribute_ptrs);
+            }
+        }
+        framebuffer.resolve(attachment_type::DEPTH_ATTACHMENT);
+    }
+    auto end = bench_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / pass_count;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *model_path = argc > 1 ? argv[1] : "./assets/cut_fish/cut_fish.obj";
+    int pass_count = argc > 2 ? atoi(argv[2]) : 20;
+
+    set_viewport(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+    set_vertex_shader(shadow_casting_vertex_shader);
+    set_fragment_shader(shadow_casting_fragment_shader);
+
+    // Random positions, most of them inside the light frustum.
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(-1.2f, 1.2f);
+    std::vector<vec3> positions(POSITION_COUNT);
+    std::vector<float> x(POSITION_COUNT), y(POSITION_COUNT), z(POSITION_COUNT);
+    for (size_t i = 0; i < POSITION_COUNT; i++)
+    {
+        positions[i] = vec3{distribution(generator), distribution(generator), distribution(generator)};
+        x[i] = positions[i].x;
+        y[i] = positions[i].y;
+        z[i] = positions[i].z;
+    }
+    matrix4x4 local2clip = get_light_world2clip();
+    transformed_vertices per_vertex;
+    transformed_vertices batched;
+    double per_vertex_ns = time_per_vertex(local2clip, positions, per_vertex);
+    // The first call allocates the output, only the second one is timed.
+    transform_vertices(local2clip, x.data(), y.data(), z.data(), POSITION_COUNT, batched);
+    auto start = bench_clock::now();
+    transform_vertices(local2clip, x.data(), y.data(), z.data(), POSITION_COUNT, batched);
+    auto end = bench_clock::now();
+    double batched_ns = std::chrono::duration<double, std::nano>(end - start).count() / POSITION_COUNT;
+    bool same = memcmp(per_vertex.screen_x.data(), batched.screen_x.data(), POSITION_COUNT * sizeof(float)) == 0 &&
+                memcmp(per_vertex.depth.data(), batched.depth.data(), POSITION_COUNT * sizeof(float)) == 0 &&
+                same_clipped_vertices(per_vertex, batched);
+    printf("%d positions: per vertex %.2f ns, batched %.2f ns (%.1fx), results %s\n", POSITION_COUNT,
+           per_vertex_ns, batched_ns, per_vertex_ns / batched_ns, same ? "identical" : "differ");
+
+    Mesh mesh(model_path);
+    if (mesh.triangle_count == 0)
+    {
+        printf("Can not load %s, run from the repository root.\n", model_path);
+        return 1;
+    }
+    FrameBuffer framebuffer;
+    framebuffer.attach_texture(attachment_type::DEPTH_ATTACHMENT,
+                               std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_DEPTH16, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE));
+    double per_vertex_ms = time_shadow_pass(framebuffer, mesh, false, pass_count);
+    std::vector<uint8_t> reference(framebuffer.depth_buffer->get_pixels(),
+                                   framebuffer.depth_buffer->get_pixels() + SHADOW_MAP_SIZE * SHADOW_MAP_SIZE * 2);
+    double batched_ms = time_shadow_pass(framebuffer, mesh, true, pass_count);
+    same = memcmp(reference.data(), framebuffer.depth_buffer->get_pixels(), reference.size()) == 0;
+    printf("shadow pass, %u vertices, %u triangles: per vertex %.2f ms, batched %.2f ms, shadow maps %s\n",
+           mesh.vertex_count, mesh.triangle_count, per_vertex_ms, batched_ms, same ? "identical" : "differ");
+    return 0;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <cmath>
 
@@ -35,4 +36,77 @@ inline float convert_to_linear_color(float vlaue)
     // Similar to the convert_to_srgb_color() function, this is just an
     // approximate conversion.
     return powf(vlaue, GAMMA);
-}
\ No newline at end of file
+}
+
+#define SRGB_ENCODE_TABLE_SIZE 4096
+
+///
+/// \brief Precomputed tables used by the per-pixel color conversions.
+///
+/// The tables are built once at program startup from convert_to_linear_color()
+/// and convert_to_srgb_color(), so the lookup functions below return exactly
+/// the same values as the powf() based functions.
+///
+struct color_conversion_tables
+{
+    // srgb8_to_linear[i] == convert_to_linear_color(uint8_to_float(i)).
+    float srgb8_to_linear[256];
+    // srgb8_thresholds[c] is the smallest linear value that is encoded to an
+    // 8-bit sRGB value greater than or equal to c. The last entry is infinity
+    // and acts as a sentinel.
+    float srgb8_thresholds[257];
+    // The smallest 8-bit sRGB value of each of the SRGB_ENCODE_TABLE_SIZE
+    // uniform buckets that [0,1] is divided into.
+    uint8_t srgb8_buckets[SRGB_ENCODE_TABLE_SIZE];
+};
+
+extern const color_conversion_tables color_tables;
+
+///
+/// \brief Converts an 8-bit sRGB color component to linear space.
+///
+/// Equivalent to convert_to_linear_color(uint8_to_float(value)), but uses a
+/// 256-entry lookup table instead of powf().
+///
+inline float srgb8_to_linear(uint8_t value)
+{
+    return color_tables.srgb8_to_linear[value];
+}
+
+///
+/// \brief Converts a linear color component to an 8-bit sRGB value.
+///
+/// Equivalent to float_to_uint8(convert_to_srgb_color(value)). The bucket
+/// table gives a lower bound of the result, which is then refined with the
+/// thresholds table. Except for values very close to black, the refinement
+/// loop runs at most once.
+///
+/// \param value The R, G or B component of a linear color, must be ranged
+///              from [0,1].
+/// \return Returns the encoded value.
+///
+inline uint8_t linear_to_srgb8(float value)
+{
+    const color_conversion_tables &tables = color_tables;
+    uint32_t code = tables.srgb8_buckets[(uint32_t)(value * (SRGB_ENCODE_TABLE_SIZE - 1))];
+    while (value >= tables.srgb8_thresholds[code + 1])
+    {
+        ++code;
+    }
+    return (uint8_t)code;
+}
+
+///
+/// \brief Converts a row of linear RGBA floating-point pixels to RGBA8.
+///
+/// Each component is clamped to [0,1] before conversion. If is_srgb_encoding
+/// is true, the R, G and B components are encoded to sRGB, the alpha component
+/// is always stored linearly.
+///
+/// \param src The source pixels, pixel_count * 4 floats.
+/// \param dst The destination pixels, pixel_count * 4 bytes.
+/// \param pixel_count Number of pixels to convert.
+/// \param is_srgb_encoding Whether the destination is sRGB encoded.
+///
+void linear_row_to_rgba8(const float *src, uint8_t *dst, size_t pixel_count,
+                         bool is_srgb_encoding);
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "texture.h"
+
+// Lossless per-tile compression of TEXTURE_FORMAT_DEPTH16 textures into
+// TEXTURE_FORMAT_DEPTH16_TILED. Each 8x8 tile is stored in the smallest of
+// these modes that reproduces every depth value exactly:
+// - constant: one 16-bit value (2 bytes), e.g. tiles nothing was drawn to.
+// - plane: depth = base + dx * x + dy * y, rounded (12 bytes), tiles covered by
+//   a single flat triangle.
+// - min/max: the tile minimum and an 8-bit offset per pixel (2 bytes + 1 byte
+//   per pixel), tiles whose depth range is below 256.
+// - raw: 16 bits per pixel.
+//
+// The texture data starts with one 32-bit entry per tile, in row order from
+// the bottom-left tile. The high 2 bits of an entry are the mode and the low
+// 30 bits the byte offset of the tile payload from the start of the data.
+// Tiles at the right and top edges only store their pixels inside the
+// texture.
+
+#define DEPTH_TILE_SIZE 8
+
+///
+/// \brief The number of tiles stored in each mode by compress_depth().
+///
+struct depth_compression_stats
+{
+    uint32_t constant_tiles;
+    uint32_t plane_tiles;
+    uint32_t min_max_tiles;
+    uint32_t raw_tiles;
+};
+
+///
+/// \brief Compresses a depth texture.
+///
+/// \param source The texture to compress, in TEXTURE_FORMAT_DEPTH16.
+/// \param stats If not null, receives the number of tiles in each mode.
+/// \return Returns the TEXTURE_FORMAT_DEPTH16_TILED texture on success, null
+///         pointer on failure.
+///
+std::unique_ptr<Texture> compress_depth(const Texture &source, depth_compression_stats *stats = nullptr);
+
+///
+/// \brief Reads one depth value of a TEXTURE_FORMAT_DEPTH16_TILED texture.
+///
+/// \param texture The compressed depth texture.
+/// \param x The x index of the pixel.
+/// \param y The y index of the pixel.
+/// \return Returns the depth in [0,1], the same value as sampling the
+///         uncompressed texture.
+///
+float sample_compressed_depth(const Texture &texture, uint32_t x, uint32_t y);
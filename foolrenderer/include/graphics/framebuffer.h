@@ -2,8 +2,17 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 #include "texture.h"
 
+// The framebuffer is divided into square tiles of this size in pixels, the
+// unit in which clears are deferred.
+#define FRAMEBUFFER_TILE_SIZE 32
+
+// The number of samples per pixel of a multisampled framebuffer, see
+// FrameBuffer::set_sample_count().
+#define MSAA_SAMPLE_COUNT 4
+
 enum class attachment_type : uint8_t
 {
     COLOR_ATTACHMENT,
@@ -17,11 +26,34 @@ enum class attachment_type : uint8_t
 struct FrameBuffer
 {
     uint32_t m_width, m_height;
-    // access color_buffer using uint8_t*
+    // access color_buffer using uint8_t*, or float* if the format is
+    // TEXTURE_FORMAT_RGBA_FLOAT (HDR rendering, see resolve_hdr())
     std::unique_ptr<Texture> color_buffer;
-    // access color_buffer using float*
+    // access depth_buffer using float*, or uint16_t* / 3 bytes per pixel if the
+    // format is TEXTURE_FORMAT_DEPTH16 / TEXTURE_FORMAT_DEPTH24
     std::unique_ptr<Texture> depth_buffer;
 
+    // The number of samples per pixel, 1 or MSAA_SAMPLE_COUNT. A multisampled
+    // framebuffer has a multisample attachment for each attached buffer, in
+    // the same format, that stores the samples of a pixel next to each other
+    // (m_sample_count times as wide). The rasterizer renders to the samples
+    // and resolve() writes the resolved pixels to the attached buffers.
+    uint32_t m_sample_count;
+    std::unique_ptr<Texture> color_samples;
+    std::unique_ptr<Texture> depth_samples;
+
+    // clear() does not write the buffers, it only marks every tile as cleared
+    // in these flags (one bit per attachment, see attachment_type). A tile is
+    // filled with the clear value when it is first accessed through
+    // prepare_region(), or by resolve() before the buffer is read elsewhere.
+    // In a multisampled framebuffer the flags apply to the samples.
+    uint32_t m_tile_columns, m_tile_rows;
+    std::vector<uint8_t> tile_clear_flags;
+    uint32_t m_cleared_tile_count;
+    // The color value of the pending clear, for 8-bit and float color buffers.
+    uint8_t m_clear_color[4];
+    vec4 m_clear_color_float;
+
     FrameBuffer();
     ~FrameBuffer() = default;
 
@@ -45,14 +77,84 @@ struct FrameBuffer
     */
     static void set_clear_color(float red, float green, float blue, float alpha);
 
+    /*
+        \brief Sets the number of samples per pixel for multisample
+            anti-aliasing. With MSAA_SAMPLE_COUNT samples, the rasterizer tests
+            coverage and depth for each sample, runs the fragment shader once
+            per pixel and writes its color to the covered samples. The
+            multisample attachments are allocated here and again when a
+            texture is attached, their contents are undefined until clear()
+            is called.
+        \param sample_count 1 to render to the attached buffers directly, or
+            MSAA_SAMPLE_COUNT.
+        \return Returns false if the sample count is not supported.
+    */
+    bool set_sample_count(uint32_t sample_count);
+
     /*
         \brief Uses preset values to clear all buffers in the framebuffer.
             Each pixel of the color buffer will be cleared using the value previously
             set via the set_clear_color() function. For depth buffers, a fixed value of
             1 will be used to clear each pixel. If framebuffer is a null pointer, the
             function does nothing.
+            The pixels are not written here, the clear is deferred per tile
+            until the tile is accessed or resolve() is called.
 
         \param framebuffer Pointer to the framebuffer to clear.
     */
     void clear();
+
+    /*
+        \brief Fills the tiles overlapping the given pixel rectangle that still
+            have a pending clear. Must be called before any pixel in the
+            rectangle is read or written. The bounds are inclusive and must lie
+            inside the framebuffer.
+    */
+    inline void prepare_region(uint32_t x_min, uint32_t y_min, uint32_t x_max, uint32_t y_max)
+    {
+        if (m_cleared_tile_count == 0)
+        {
+            return;
+        }
+        for (uint32_t tile_y = y_min / FRAMEBUFFER_TILE_SIZE; tile_y <= y_max / FRAMEBUFFER_TILE_SIZE; tile_y++)
+        {
+            for (uint32_t tile_x = x_min / FRAMEBUFFER_TILE_SIZE; tile_x <= x_max / FRAMEBUFFER_TILE_SIZE; tile_x++)
+            {
+                if (tile_clear_flags[tile_y * m_tile_columns + tile_x] != 0)
+                {
+                    materialize_tiles(tile_x, tile_x + 1, tile_y, tile_clear_flags[tile_y * m_tile_columns + tile_x]);
+                }
+            }
+        }
+    }
+
+    /*
+        \brief Fills every tile of the attachment that still has a pending
+            clear, so the whole texture holds valid pixels. Call this before the
+            attached texture is read outside the rasterizer, e.g. saved or
+            sampled as a shadow map.
+            In a multisampled framebuffer the samples are resolved to the
+            attached texture instead: a color is the average of the samples of
+            its pixel, computed on linear values for TEXTURE_FORMAT_SRGB8_A8,
+            and a depth the nearest sample. Tiles with a pending clear are
+            written with the clear value without reading their samples.
+        \param attachment The attachment to resolve.
+    */
+    void resolve(attachment_type attachment);
+
+    /*
+        \brief Fills the tiles [tile_x_begin, tile_x_end) of one tile row with
+            the pending clear value of the attachments selected by
+            attachment_mask and marks them as written. Every tile in the range
+            must have the same pending attachments in attachment_mask.
+    */
+    void materialize_tiles(uint32_t tile_x_begin, uint32_t tile_x_end, uint32_t tile_y, uint8_t attachment_mask);
+
+    // Recomputes the tile grid after the framebuffer size has changed. The
+    // contents of newly attached textures are kept as they are.
+    void reset_tiles();
+
+    // Allocates the multisample attachments for the attached buffers, or
+    // releases them if the framebuffer is not multisampled.
+    void reset_samples();
 };
\ No newline at end of file
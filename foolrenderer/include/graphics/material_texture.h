@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "texture.h"
+#include "rmath/rvector.h"
+
+/*
+    \brief Material values fetched from a material texture at one texture
+        coordinate.
+
+    Every member holds the same value that sampling the corresponding
+    standalone texture would return, so shaders can process them in the same
+    way.
+*/
+struct material_sample
+{
+    // Base color in linear color space.
+    vec3 base_color;
+    // Tangent space normal, each component still ranged from [0,1].
+    vec3 normal;
+    float metallic;
+    float roughness;
+};
+
+/*
+    \brief A material texture interleaves the base color, normal, metallic and
+        roughness maps of a material into one texture.
+
+    Each texel takes 8 bytes and is stored in the order:
+    BASE_R BASE_G BASE_B METALLIC NORMAL_X NORMAL_Y NORMAL_Z ROUGHNESS
+
+    So all material parameters of a fragment are fetched with one address
+    computation from one cache line, instead of four lookups into four
+    textures. The first texel corresponds to the bottom-left corner, same as
+    Texture.
+*/
+struct MaterialTexture
+{
+    uint32_t m_width, m_height;
+    // Whether the base color components are sRGB encoded.
+    bool m_srgb_base_color;
+
+    std::vector<uint8_t> texels;
+
+    MaterialTexture(uint32_t width, uint32_t height, bool srgb_base_color);
+
+    ~MaterialTexture() = default;
+
+    /*
+        \brief Packs separate material maps into one material texture.
+
+        The size of the material texture is the largest width and height among
+        the given maps. A map with smaller size is resampled with nearest
+        filtering, which gives the same texels as sampling the map directly as
+        long as its size divides the material texture size (e.g. power-of-two
+        textures).
+
+        Any map can be a null pointer, the default value is used instead:
+        white base color, the flat normal (0.5, 0.5, 1.0), metallic 1 and
+        roughness 1. Only textures in R8, RGB8, SRGB8, RGBA8 and SRGB8_A8
+        formats, and the block compressed formats, which are decompressed
+        with decompress_texture(), are supported.
+
+        \param base_color_map The base color map, may be sRGB encoded.
+        \param normal_map The tangent space normal map.
+        \param metallic_map The metallic map, only the R component is used.
+        \param roughness_map The roughness map, only the R component is used.
+        \return Returns the material texture on success, null pointer on
+                failure.
+    */
+    static std::unique_ptr<MaterialTexture> pack(const Texture *base_color_map, const Texture *normal_map,
+                                                 const Texture *metallic_map, const Texture *roughness_map);
+
+    /*
+        \brief Samples all material parameters at the given texture coordinate.
+            Uses the same nearest filtering and clamping as Texture::sample().
+
+        \param texcoord Texture coordinate at which the texture will be sampled.
+        \return Returns the material values.
+    */
+    material_sample sample_material(vec2 texcoord) const;
+};
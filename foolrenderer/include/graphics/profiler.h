@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+// A scoped zone profiler. PROFILE_ZONE("name") at the start of a scope records
+// the time the scope took, on the ring buffer of the calling thread, and
+// write_profile_trace() exports the zones of all threads as a Chrome trace,
+// which chrome://tracing and https://ui.perfetto.dev open. Zone names must be
+// string literals, only the pointer is recorded.
+//
+// Nothing is recorded until set_profiler_level() enables the zones, a zone
+// then costs an atomic load and a branch. Defining PROFILER_DISABLED when
+// building removes the zones and the profiler completely.
+
+enum class profiler_level : uint8_t
+{
+    ///
+    /// Nothing is recorded.
+    ///
+    PROFILER_OFF,
+    ///
+    /// The zones of passes, frames and loading, a few per frame.
+    ///
+    PROFILER_ZONES,
+    ///
+    /// Also the zones of PROFILE_DETAIL_ZONE(), such as those of each triangle
+    /// in the rasterizer, which slow the rendering down noticeably.
+    ///
+    PROFILER_DETAIL_ZONES
+};
+
+// The number of zones kept per thread, the oldest are overwritten.
+#define PROFILER_RING_CAPACITY (1 << 18)
+
+#ifndef PROFILER_DISABLED
+
+#define PROFILER_CONCAT_HELPER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_HELPER(a, b)
+#define PROFILE_ZONE(name) \
+    ProfileZone PROFILER_CONCAT(profile_zone_, __LINE__)(name, profiler_level::PROFILER_ZONES)
+#define PROFILE_DETAIL_ZONE(name) \
+    ProfileZone PROFILER_CONCAT(profile_zone_, __LINE__)(name, profiler_level::PROFILER_DETAIL_ZONES)
+
+// The level set by set_profiler_level(), read by every zone.
+extern std::atomic<profiler_level> current_profiler_level;
+
+///
+/// \brief Gets the time of the monotonic clock of the profiler, in
+///        nanoseconds.
+///
+uint64_t get_profiler_time();
+
+///
+/// \brief Records a zone on the ring buffer of the calling thread.
+///
+void record_profile_zone(const char *name, uint64_t begin_time, uint64_t end_time);
+
+///
+/// \brief Records the time from its construction to its destruction, if the
+///        profiler level is at least the level of the zone.
+///
+class ProfileZone
+{
+public:
+    ProfileZone(const char *name, profiler_level level)
+        : m_name(name), m_is_recording(current_profiler_level.load(std::memory_order_relaxed) >= level)
+    {
+        if (m_is_recording)
+        {
+            m_begin_time = get_profiler_time();
+        }
+    }
+
+    ~ProfileZone()
+    {
+        if (m_is_recording)
+        {
+            record_profile_zone(m_name, m_begin_time, get_profiler_time());
+        }
+    }
+
+    ProfileZone(const ProfileZone &) = delete;
+    ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+    const char *m_name;
+    bool m_is_recording;
+    uint64_t m_begin_time{0};
+};
+
+///
+/// \brief Sets which zones are recorded from now on.
+///
+void set_profiler_level(profiler_level level);
+
+///
+/// \brief Names the calling thread in the trace, e.g. "main". Other threads
+///        are named by the order in which they recorded their first zone.
+///
+void set_profiler_thread_name(const char *name);
+
+///
+/// \brief Writes the recorded zones of all threads as Chrome trace JSON.
+///
+/// Must not be called while other threads record zones. The zones stay
+/// recorded.
+///
+/// \param filename The file to write.
+/// \return Returns true on success, false if the file can not be written.
+///
+bool write_profile_trace(std::string_view filename);
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_DETAIL_ZONE(name) ((void)0)
+
+inline void set_profiler_level(profiler_level) {}
+inline void set_profiler_thread_name(const char *) {}
+inline bool write_profile_trace(std::string_view) { return false; }
+
+#endif
@@ -1,10 +1,51 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 #include "framebuffer.h"
 #include "shader_context.h"
 #include "texture.h"
+#include "rmath/rmatrix.h"
 #include "rmath/rvector.h"
 
+// The shading rate image has one rate per tile of SHADING_RATE_TILE_SIZE x
+// SHADING_RATE_TILE_SIZE pixels.
+#define SHADING_RATE_TILE_SIZE 8
+
+///
+/// \brief The comparison of the depth test.
+///
+enum class depth_function : uint8_t
+{
+    ///
+    /// A fragment passes if its depth is less than or equal to the stored
+    /// depth, which it then replaces. The initial function.
+    ///
+    DEPTH_FUNCTION_LESS_EQUAL,
+    ///
+    /// A fragment passes if its depth is equal to the stored depth, the depth
+    /// buffer is not written. After a depth prepass that drew the same
+    /// triangles with the same vertex positions, exactly the visible
+    /// fragments pass, so every pixel is shaded once.
+    ///
+    DEPTH_FUNCTION_EQUAL
+};
+
+///
+/// \brief The number of pixels that share one fragment shader call.
+///
+/// With a coarse rate the fragment shader is called once per coarse pixel of
+/// 2x2 or 4x4 pixels aligned to multiples of its size, and the color is
+/// written to all visible pixels of it.
+///
+enum class shading_rate : uint8_t
+{
+    SHADING_RATE_1X1,
+    SHADING_RATE_2X2,
+    SHADING_RATE_4X4
+};
+
 ///
 /// \brief Pointer to vertex shader.
 ///
@@ -37,10 +78,27 @@ using vertex_shader = vec4 (*)(ShaderContext *output, const void *uniform, const
 /// The input stores the values assigned by the vertex shader, which are
 /// interpolated before being received by the fragment shader.
 ///
+/// Fragments are shaded in 2x2 quads, so the screen space derivatives of the
+/// variables can be read with the ddx and ddy accessors of ShaderContext. The
+/// pixels of a quad that are not covered are helpers, they are not shaded.
+///
 /// The fragment shader returns the color value.
 ///
 using fragment_shader = vec4 (*)(ShaderContext *input, const void *uniform);
 
+///
+/// \brief Pointer to packet fragment shader.
+///
+/// Works like a fragment shader, but shades a 2x2 block of fragments at once,
+/// so the shader can use SIMD instructions across the fragments. The input
+/// holds the interpolated variables of the block and its coverage mask, see
+/// ShaderPacket. The shader writes the color of fragment i to element i of
+/// each component of the output. The colors of fragments that are not in the
+/// coverage mask are ignored, their variables are still interpolated at their
+/// own positions, so the differences between the fragments are derivatives.
+///
+using packet_fragment_shader = void (*)(const ShaderPacket *input, const void *uniform, packet_vec4 *output);
+
 ///
 /// \brief Set the viewport parameters.
 ///
@@ -56,24 +114,84 @@ void set_viewport(int left, int bottom, uint32_t width, uint32_t height);
 
 void set_vertex_shader(vertex_shader shader);
 
+///
+/// \brief Sets the fragment shader, replacing the packet fragment shader if one
+///        was set.
+///
+/// If neither a fragment shader nor a packet fragment shader is set, draws
+/// only run the depth test and write the depth buffer, e.g. for a depth
+/// prepass.
+///
 void set_fragment_shader(fragment_shader shader);
 
+///
+/// \brief Sets the packet fragment shader, replacing the fragment shader if one
+///        was set.
+///
+/// The triangles are always rasterized in 2x2 quads of pixels aligned to even
+/// coordinates. Coverage and the depth test are still evaluated per pixel, a
+/// packet fragment shader is called once for each quad with at least one
+/// visible pixel.
+///
+void set_packet_fragment_shader(packet_fragment_shader shader);
+
+///
+/// \brief Sets the depth test comparison of the following draws.
+///
+void set_depth_function(depth_function function);
+
+///
+/// \brief Sets the shading rate of the following draws, the initial rate is
+///        SHADING_RATE_1X1.
+///
+/// Coverage and the depth test are still evaluated per pixel, so edges and
+/// intersections stay sharp, only the shading is coarser. A coarse pixel is
+/// shaded at its center, or at its first visible pixel if the center is
+/// outside the triangle. The quads of the fragment shader are made of coarse
+/// pixels, so the derivatives are differences between coarse pixels.
+///
+void set_shading_rate(shading_rate rate);
+
+///
+/// \brief Sets a screen space shading rate image, or removes it if rates is a
+///        null pointer.
+///
+/// Each tile of the framebuffer is shaded with the coarser of the rate of its
+/// element in the image and the rate set by set_shading_rate(). Tiles outside
+/// the image use the rate of the draw. The image is not copied, it must stay
+/// valid until it is removed.
+///
+/// \param rates The rates of the tiles, row by row, starting with the tile at
+///              the framebuffer origin.
+/// \param width The number of tiles in a row.
+/// \param height The number of rows.
+///
+void set_shading_rate_image(const shading_rate *rates, uint32_t width, uint32_t height);
+
 ///
 /// \brief Render triangle.
 ///
 /// Before calling this function, need to ensure that the rendering state has
 /// been set through the set_viewport(), set_vertex_shader() and
-/// set_fragment_shader() functions.
+/// set_fragment_shader() or set_packet_fragment_shader() functions.
 ///
 /// When the triangle finally appears on the screen after all transformations,
 /// if the vertex connection sequence is counterclockwise, the triangle is
 /// treated as front face. This function only draws front-facing triangles.
 ///
+/// Triangles that leave the viewport only in x and y are rasterized with their
+/// bounding box clamped to the viewport, as long as they stay inside a guard
+/// band several times its size. Only triangles that cross the near or far
+/// plane or the guard band are clipped, see pipeline_statistics.
+///
 /// Always assumes the shader's output is in linear RGB color space. So if the
 /// color buffer attached to the framebuffer is sRGB encoded, convert the output
-/// from linear RGB to sRGB. If there is no color buffer attached, the fragment
-/// color result is discarded. If the framebuffer is not attached with a depth
-/// buffer, the depth test is not performed.
+/// from linear RGB to sRGB. If the color buffer is TEXTURE_FORMAT_RGBA_FLOAT,
+/// the output is stored unclamped and converted later by resolve_hdr(). If
+/// there is no color buffer attached, the fragment color result is discarded.
+/// If the framebuffer is not attached with a depth buffer, the depth test is
+/// not performed. A multisampled framebuffer is rendered to its samples, see
+/// FrameBuffer::set_sample_count().
 ///
 /// \param framebuffer Buffer for saving rendering results.
 /// \param uniform Contains constants that can be accessed in the vertex shader
@@ -82,4 +200,184 @@ void set_fragment_shader(fragment_shader shader);
 ///                          length of 3.
 ///
 void draw_triangle(FrameBuffer *framebuffer, const void *uniform,
-                   const void *const vertex_attributes[]);
\ No newline at end of file
+                   const void *const vertex_attributes[]);
+
+///
+/// \brief Vertex positions transformed by transform_vertices(), one array per
+///        component.
+///
+struct transformed_vertices
+{
+    // Screen space position, in pixels.
+    std::vector<float> screen_x;
+    std::vector<float> screen_y;
+    // Screen space depth in [0, 1].
+    std::vector<float> depth;
+    // The inverse of the clip space w, for perspective correct interpolation.
+    std::vector<float> inverse_w;
+    // Clip space position, for the triangles that have to be clipped.
+    std::vector<float> clip_x;
+    std::vector<float> clip_y;
+    std::vector<float> clip_z;
+    std::vector<float> clip_w;
+    // A bit for each plane of the viewing volume the vertex is outside of, 0
+    // if it is inside.
+    std::vector<uint8_t> clip_codes;
+
+    void resize(size_t count);
+};
+
+///
+/// \brief Transforms many vertex positions at once.
+///
+/// This is the front end of draw_triangle() for vertex shaders whose position
+/// output is local2clip * vec4{position, 1}: the clip space transform, the
+/// clipping test, the perspective division and the viewport transform are
+/// done in one pass over the positions, 8 at a time with AVX2 when the CPU
+/// supports it. The results are the same as those of draw_triangle().
+///
+/// Uses the viewport set by set_viewport().
+///
+/// \param local2clip The matrix that transforms the positions to clip space.
+/// \param x The x components of the positions.
+/// \param y The y components of the positions.
+/// \param z The z components of the positions.
+/// \param count The number of positions.
+/// \param output The transformed positions, resized to count.
+///
+void transform_vertices(const matrix4x4 &local2clip, const float *x, const float *y, const float *z,
+                        size_t count, transformed_vertices &output);
+
+///
+/// \brief Render triangle whose vertex positions were transformed by
+///        transform_vertices().
+///
+/// Works like draw_triangle(), except that the vertex shader is only called
+/// for the variables it saves in the shader context. If vertex_attributes is
+/// a null pointer, the vertex shader is not called at all, which suits
+/// fragment shaders without inputs, such as shadow casting.
+///
+/// \param framebuffer Buffer for saving rendering results.
+/// \param uniform Contains constants that can be accessed in the vertex shader
+///                and fragment shader.
+/// \param vertices The transformed vertex positions.
+/// \param indices The indices of the three vertices in vertices.
+/// \param vertex_attributes An array containing vertex attributes, with a
+///                          length of 3, or a null pointer.
+///
+void draw_transformed_triangle(FrameBuffer *framebuffer, const void *uniform, const transformed_vertices &vertices,
+                               const uint32_t indices[], const void *const vertex_attributes[]);
+
+///
+/// \brief Runs the vertex shader once for each of many vertices and keeps the
+///        variables it saves in the shader context, for draw_shaded_triangle().
+///
+/// A vertex shared by several triangles is then shaded once instead of once
+/// per triangle. The position the vertex shader returns is not used, the
+/// positions come from transform_vertices().
+///
+/// \param uniform Contains constants that can be accessed in the vertex shader.
+/// \param vertex_attributes The vertex attributes of all vertices, one after
+///                          the other.
+/// \param attribute_size The size of the vertex attributes of one vertex, in
+///                       bytes.
+/// \param count The number of vertices.
+/// \param contexts The shader contexts of the vertices, resized to count.
+///
+void shade_vertices(const void *uniform, const void *vertex_attributes, size_t attribute_size, size_t count,
+                    std::vector<ShaderContext> &contexts);
+
+///
+/// \brief Render triangle whose vertex positions were transformed by
+///        transform_vertices() and whose vertices were shaded by
+///        shade_vertices().
+///
+/// Works like draw_transformed_triangle(), without calling the vertex shader.
+///
+/// \param framebuffer Buffer for saving rendering results.
+/// \param uniform Contains constants that can be accessed in the fragment
+///                shader.
+/// \param vertices The transformed vertex positions.
+/// \param contexts The shader contexts of the vertices, indexed like vertices.
+/// \param indices The indices of the three vertices in vertices.
+///
+void draw_shaded_triangle(FrameBuffer *framebuffer, const void *uniform, const transformed_vertices &vertices,
+                          const ShaderContext contexts[], const uint32_t indices[]);
+
+///
+/// \brief Counters of the work done by draw_triangle() and
+///        draw_transformed_triangle(), like the pipeline statistics queries
+///        of graphics APIs.
+///
+/// Each thread counts its own draws in thread local counters, without
+/// atomics, and adds them to the counters of the frame with
+/// merge_pipeline_statistics(). Defining RASTERIZER_NO_STATISTICS when
+/// building removes the counting, the counters then stay 0.
+///
+/// The triangles of the polygon of a clipped triangle are each counted by the
+/// counters from back_facing_triangles on. Fragments are pixels, or samples
+/// in a multisampled framebuffer.
+///
+struct pipeline_statistics
+{
+    // Vertex shader invocations, and positions transformed by
+    // transform_vertices().
+    uint64_t shaded_vertices;
+    // Triangles passed to the draw functions, each of them took one of the
+    // four paths through clipping below.
+    uint64_t submitted_triangles;
+    // Inside the viewing volume, rasterized directly.
+    uint64_t inside_triangles;
+    // Outside the viewport in x or y, but inside the guard band and between
+    // the near and far planes. Rasterized with the bounding box clamped.
+    uint64_t guard_band_triangles;
+    // Crossing the near or far plane or the guard band. Clipped to a polygon,
+    // which is rasterized as a fan of triangles.
+    uint64_t clipped_triangles;
+    // Outside one plane of the viewing volume with all vertices, not drawn.
+    uint64_t culled_triangles;
+    // Triangles with clockwise winding, and with zero area, not drawn.
+    uint64_t back_facing_triangles;
+    uint64_t degenerate_triangles;
+    // The pixels of the bounding boxes of the drawn triangles, clamped to the
+    // framebuffer.
+    uint64_t tested_pixels;
+    // Fragments inside a triangle, and those of them hidden by the depth test.
+    uint64_t covered_fragments;
+    uint64_t depth_rejected_fragments;
+    // Fragment shader invocations, per pixel or coarse pixel, without the
+    // helpers of the quads.
+    uint64_t shaded_fragments;
+    // Fragments written to the color buffer.
+    uint64_t color_writes;
+
+    // Add or subtract the counters of other, field by field.
+    void add(const pipeline_statistics &other);
+    void subtract(const pipeline_statistics &other);
+};
+
+///
+/// \brief Starts counting a draw on the calling thread, e.g. the triangles of
+///        one model, see get_draw_statistics().
+///
+void begin_draw_statistics();
+
+///
+/// \brief Gets the counters of the calling thread since its last call of
+///        begin_draw_statistics().
+///
+pipeline_statistics get_draw_statistics();
+
+///
+/// \brief Adds the counters of the calling thread to the counters of the
+///        frame, and sets them to 0.
+///
+/// Each thread that draws calls this at the end of a frame, it takes a lock.
+///
+void merge_pipeline_statistics();
+
+///
+/// \brief Merges the counters of the calling thread, returns the counters of
+///        the frame, and sets them to 0 for the next frame.
+///
+pipeline_statistics end_frame_statistics();
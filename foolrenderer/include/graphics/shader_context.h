@@ -45,6 +45,13 @@ struct ShaderContext
     int8_t vec3_variable_count;
     int8_t vec4_variable_count;
 
+    // The shader contexts of the 2x2 quad of fragments this fragment belongs
+    // to, in the order (x, y), (x + 1, y), (x, y + 1), (x + 1, y + 1), and the
+    // index of this fragment in it. Set by the rasterizer before the fragment
+    // shader is called, null otherwise.
+    const ShaderContext *quad;
+    int8_t quad_index;
+
     /*
         \brief Removes all data from the shader context and also serve as an
             initialization function.
@@ -75,6 +82,8 @@ struct ShaderContext
         vec2_variable_count = 0;
         vec3_variable_count = 0;
         vec4_variable_count = 0;
+        quad = nullptr;
+        quad_index = 0;
     }
 
 #define RETURN_VARIABLE(type, max_variables)             \
@@ -162,6 +171,169 @@ struct ShaderContext
     }
 
 #undef RETURN_VARIABLE
+
+#define RETURN_DERIVATIVE(type, max_variables, step)                                              \
+    do                                                                                            \
+    {                                                                                             \
+        if (quad == nullptr || index >= max_variables)                                            \
+        {                                                                                         \
+            return type{};                                                                        \
+        }                                                                                         \
+        int8_t first = quad_index & ~(step);                                                      \
+        return quad[first | (step)].type##_variables[index] - quad[first].type##_variables[index]; \
+    } while (0)
+
+    /*
+        \brief Gets the partial derivatives of the float variable with the
+            specified index in screen space, along x (ddx) or y (ddy).
+
+        The derivatives are the differences to the neighboring fragment in the
+        same 2x2 quad, the same for both fragments of a row (ddx) or a column
+        (ddy). Only valid in the fragment shader, the variable must have been
+        written by the vertex shader.
+
+        \param index The variable index, range from 0 to MAX_FLOAT_VARIABLES-1.
+        \return Returns the derivative. Returns 0 if index is out of range or
+                the fragment is not part of a quad.
+    */
+    float shader_context_float_ddx(int8_t index) const
+    {
+        RETURN_DERIVATIVE(float, MAX_FLOAT_VARIABLES, 1);
+    }
+
+    float shader_context_float_ddy(int8_t index) const
+    {
+        RETURN_DERIVATIVE(float, MAX_FLOAT_VARIABLES, 2);
+    }
+
+    /*
+        \brief Gets the partial derivatives of the vec2 variable with the
+            specified index, see shader_context_float_ddx().
+    */
+    vec2 shader_context_vec2_ddx(int8_t index) const
+    {
+        RETURN_DERIVATIVE(vec2, MAX_VECTOR2_VARIABLES, 1);
+    }
+
+    vec2 shader_context_vec2_ddy(int8_t index) const
+    {
+        RETURN_DERIVATIVE(vec2, MAX_VECTOR2_VARIABLES, 2);
+    }
+
+    /*
+        \brief Gets the partial derivatives of the vec3 variable with the
+            specified index, see shader_context_float_ddx().
+    */
+    vec3 shader_context_vec3_ddx(int8_t index) const
+    {
+        RETURN_DERIVATIVE(vec3, MAX_VECTOR3_VARIABLES, 1);
+    }
+
+    vec3 shader_context_vec3_ddy(int8_t index) const
+    {
+        RETURN_DERIVATIVE(vec3, MAX_VECTOR3_VARIABLES, 2);
+    }
+
+    /*
+        \brief Gets the partial derivatives of the vec4 variable with the
+            specified index, see shader_context_float_ddx().
+    */
+    vec4 shader_context_vec4_ddx(int8_t index) const
+    {
+        RETURN_DERIVATIVE(vec4, MAX_VECTOR4_VARIABLES, 1);
+    }
+
+    vec4 shader_context_vec4_ddy(int8_t index) const
+    {
+        RETURN_DERIVATIVE(vec4, MAX_VECTOR4_VARIABLES, 2);
+    }
+
+#undef RETURN_DERIVATIVE
+};
+
+// Number of fragments shaded together by a packet fragment shader, a 2x2 block
+// of pixels.
+#define PACKET_SIZE 4
+
+/*
+    Variables of the fragments of a shader packet, one array per component
+    with one element per fragment.
+*/
+struct packet_float
+{
+    float x[PACKET_SIZE];
+};
+
+struct packet_vec2
+{
+    float x[PACKET_SIZE];
+    float y[PACKET_SIZE];
+};
+
+struct packet_vec3
+{
+    float x[PACKET_SIZE];
+    float y[PACKET_SIZE];
+    float z[PACKET_SIZE];
+};
+
+struct packet_vec4
+{
+    float x[PACKET_SIZE];
+    float y[PACKET_SIZE];
+    float z[PACKET_SIZE];
+    float w[PACKET_SIZE];
+};
+
+/*
+    \brief The input of a packet fragment shader: the interpolated variables
+        of a 2x2 block of fragments, in structure of arrays form.
+
+    The fragments are the pixels (x, y), (x + 1, y), (x, y + 1) and
+    (x + 1, y + 1), in this order. The variables have the same indices as in
+    the shader context the vertex shader wrote.
+*/
+struct ShaderPacket
+{
+    alignas(16) packet_float float_variables[MAX_FLOAT_VARIABLES];
+    alignas(16) packet_vec2 vec2_variables[MAX_VECTOR2_VARIABLES];
+    alignas(16) packet_vec3 vec3_variables[MAX_VECTOR3_VARIABLES];
+    alignas(16) packet_vec4 vec4_variables[MAX_VECTOR4_VARIABLES];
+
+    // Pixel coordinates of the first fragment.
+    uint32_t x, y;
+    // Bit i is set if fragment i is covered by the triangle and passed the
+    // depth test. The other fragments are helpers, their variables are
+    // interpolated at their own positions outside the triangle, so that
+    // differences between fragments are derivatives, and their outputs are
+    // discarded.
+    uint32_t coverage_mask;
+
+    /*
+        \brief Gets the variables with the specified index.
+
+        \return Returns variable pointer if successful. Returns NULL if index is
+                out of range.
+    */
+    const packet_float *shader_packet_float(int8_t index) const
+    {
+        return index < MAX_FLOAT_VARIABLES ? float_variables + index : nullptr;
+    }
+
+    const packet_vec2 *shader_packet_vec2(int8_t index) const
+    {
+        return index < MAX_VECTOR2_VARIABLES ? vec2_variables + index : nullptr;
+    }
+
+    const packet_vec3 *shader_packet_vec3(int8_t index) const
+    {
+        return index < MAX_VECTOR3_VARIABLES ? vec3_variables + index : nullptr;
+    }
+
+    const packet_vec4 *shader_packet_vec4(int8_t index) const
+    {
+        return index < MAX_VECTOR4_VARIABLES ? vec4_variables + index : nullptr;
+    }
 };
 
 #undef MAX_FLOAT_VARIABLES
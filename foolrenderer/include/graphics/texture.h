@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include "color.h"
 #include "rmath/rvector.h"
@@ -36,9 +37,66 @@ enum class texture_format : uint8_t
     ///
     /// The format used to store depth information, the type is float.
     ///
-    TEXTURE_FORMAT_DEPTH_FLOAT
+    TEXTURE_FORMAT_DEPTH_FLOAT,
+    ///
+    /// Block compressed format with R, G, B components. Each 4x4 block of
+    /// pixels is stored in 8 bytes: two RGB565 endpoint colors and a 2-bit
+    /// palette index per pixel. Equivalent to BC1 (DXT1) without alpha.
+    ///
+    TEXTURE_FORMAT_BC1,
+    ///
+    /// Same as TEXTURE_FORMAT_BC1, and the color values are considered to be
+    /// encoded in the sRGB color space.
+    ///
+    TEXTURE_FORMAT_BC1_SRGB,
+    ///
+    /// Block compressed format with only an R component. Each 4x4 block of
+    /// pixels is stored in 8 bytes: two 8-bit endpoints and a 3-bit palette
+    /// index per pixel. Equivalent to BC4 unsigned.
+    ///
+    TEXTURE_FORMAT_BC4,
+    ///
+    /// Block compressed format with R and G components, each 4x4 block is two
+    /// BC4 blocks (16 bytes). Equivalent to BC5 unsigned. It is meant to store
+    /// tangent space normal maps: the sampled B component is reconstructed
+    /// from R and G, assuming the texture stores unit vectors mapped to [0,1].
+    ///
+    TEXTURE_FORMAT_BC5,
+    ///
+    /// The components included in this format are R, G, B, A, and each
+    /// component is a 32-bit float. Values are in linear color space and are
+    /// not clamped, it is meant for HDR color attachments.
+    ///
+    TEXTURE_FORMAT_RGBA_FLOAT,
+    ///
+    /// The format used to store depth information, the type is 16-bit unsigned
+    /// normalized integer.
+    ///
+    TEXTURE_FORMAT_DEPTH16,
+    ///
+    /// The format used to store depth information, the type is 24-bit unsigned
+    /// normalized integer, stored in 3 bytes in little endian order.
+    ///
+    TEXTURE_FORMAT_DEPTH24,
+    ///
+    /// TEXTURE_FORMAT_DEPTH16 compressed per 8x8 tile, see
+    /// depth_compression.h. The data size depends on the content, so textures
+    /// in this format are only created by compress_depth() and can only be
+    /// sampled, not rendered to.
+    ///
+    TEXTURE_FORMAT_DEPTH16_TILED
 };
 
+// Converts between depth in [0,1] and the unsigned normalized depth formats.
+// Values are rounded to the nearest representable depth.
+inline uint16_t float_to_depth16(float depth) { return (uint16_t)(clamp01(depth) * 65535.0f + 0.5f); }
+
+inline float depth16_to_float(uint16_t depth) { return depth / 65535.0f; }
+
+inline uint32_t float_to_depth24(float depth) { return (uint32_t)((double)clamp01(depth) * 16777215.0 + 0.5); }
+
+inline float depth24_to_float(uint32_t depth) { return (float)(depth / 16777215.0); }
+
 /*
     \brief A texture is an object that saves image pixel data in a specific format.
            The first pixel corresponds to the bottom-left corner of the texture image.
@@ -50,8 +108,14 @@ struct Texture
 
     // Consider this container as array-of-bytes
     // The actual type (float/uint8_t) depends on m_format
+    // Empty if the texture views external memory.
     std::vector<uint8_t> pixels;
 
+    // If not null, the texture views this memory instead of owning its pixels,
+    // e.g. a memory mapped file. external_owner keeps the memory alive.
+    uint8_t *external_pixels{nullptr};
+    std::shared_ptr<void> external_owner;
+
     /*
         \brief Creates a texture.
         \param width The width of the texture.
@@ -59,8 +123,20 @@ struct Texture
     */
     Texture(texture_format form, uint32_t width, uint32_t height);
 
+    /*
+        \brief Creates a texture that views external memory without copying it.
+        \param width The width of the texture.
+        \param height The height of the texture.
+        \param data The pixel data, get_data_size(form, width, height) bytes.
+        \param owner Keeps data alive for as long as the texture (or a moved-to
+            texture) uses it, may be empty if the caller guarantees the lifetime.
+    */
+    Texture(texture_format form, uint32_t width, uint32_t height, uint8_t *data, std::shared_ptr<void> owner);
+
     ~Texture() = default;
 
+    // Copying always creates a texture that owns its pixels, even if other
+    // views external memory.
     Texture(const Texture &other);
 
     Texture(Texture &&other) noexcept;
@@ -71,12 +147,13 @@ struct Texture
 
     /*
         Move given vector data to texture pixels
+        The texture stops viewing external memory
     */
     void set_texture_pixels(std::vector<uint8_t> &&pixels);
 
     /*
         Copy given raw array to texture pixels
-        Be careful that the size of the array should be pixel_size * width * height
+        Be careful that the size of the array should be get_data_size(m_format, width, height)
     */
     bool set_texture_pixels(void *pixels);
 
@@ -88,6 +165,17 @@ struct Texture
 
     const uint8_t *get_pixels() const;
 
+    /*
+        Returns true if the format stores pixels in compressed 4x4 blocks.
+    */
+    static bool is_block_compressed(texture_format format);
+
+    /*
+        Returns the number of bytes needed to store a texture of the given format
+        and size, returns 0 if the format is unknown.
+    */
+    static size_t get_data_size(texture_format format, uint32_t width, uint32_t height);
+
     /*
         \brief Samples pixel from the texture.
             If the texture's m_format is sRGB encoded, the function will inverse-correct
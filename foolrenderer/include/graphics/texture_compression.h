@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "texture.h"
+#include "rmath/rvector.h"
+
+// Software encoder and decoder for the block compressed texture formats
+// TEXTURE_FORMAT_BC1, TEXTURE_FORMAT_BC1_SRGB, TEXTURE_FORMAT_BC4 and
+// TEXTURE_FORMAT_BC5. The block layouts follow the Direct3D specification:
+// https://learn.microsoft.com/en-us/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression
+//
+// Blocks are stored row by row, starting from the block that contains the
+// bottom-left pixel of the texture, the same order as uncompressed pixels.
+
+#define TEXTURE_BLOCK_SIZE 4
+
+///
+/// \brief Returns the number of bytes of one compressed 4x4 block, returns 0
+///        if the format is not block compressed.
+///
+size_t get_block_size(texture_format format);
+
+///
+/// \brief Compresses a texture into a block compressed format.
+///
+/// Supported conversions:
+/// - RGB8, RGBA8 to BC1; SRGB8, SRGB8_A8 to BC1_SRGB. Alpha is discarded.
+/// - R8, RGB8, RGBA8 to BC4, using the R component.
+/// - RGB8, RGBA8 to BC5, using the R and G components.
+///
+/// Texture sizes that are not a multiple of 4 are supported, the pixels of
+/// partial blocks are padded by repeating the edge pixels.
+///
+/// \param source The uncompressed texture.
+/// \param format The block compressed format to convert to.
+/// \return Returns the compressed texture on success, null pointer on failure.
+///
+std::unique_ptr<Texture> compress_texture(const Texture &source, texture_format format);
+
+///
+/// \brief Decompresses a block compressed texture.
+///
+/// BC1 becomes RGB8, BC1_SRGB becomes SRGB8, BC4 becomes R8 and BC5 becomes
+/// RGB8 with the B component reconstructed the same way as
+/// sample_compressed_texel() does.
+///
+/// \param source The block compressed texture.
+/// \return Returns the uncompressed texture on success, null pointer if the
+///         format is not block compressed.
+///
+std::unique_ptr<Texture> decompress_texture(const Texture &source);
+
+///
+/// \brief Decodes one compressed block into 16 RGBA8 pixels.
+///
+/// Pixels are written row by row. Components that the format does not store
+/// are set to 0, except alpha which is set to 0xFF.
+///
+/// \param format The block compressed format.
+/// \param block Pointer to the compressed block data.
+/// \param pixels Decoded pixels.
+///
+void decode_block(texture_format format, const uint8_t *block, uint8_t pixels[16][4]);
+
+///
+/// \brief Samples a pixel of a block compressed texture.
+///
+/// Only the block that contains the pixel is decoded. Each thread keeps a
+/// small cache of recently decoded blocks, so neighboring samples in the same
+/// block are not decoded again.
+///
+/// \param texture The block compressed texture.
+/// \param x The x index of the pixel.
+/// \param y The y index of the pixel.
+/// \return Returns the pixel in the same form as Texture::sample().
+///
+vec4 sample_compressed_texel(const Texture &texture, uint32_t x, uint32_t y);
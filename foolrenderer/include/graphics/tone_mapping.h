@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "framebuffer.h"
+#include "texture.h"
+
+enum class tone_mapping_operator : uint8_t
+{
+    ///
+    /// Values are only clamped to [0,1], the same as writing the shader output
+    /// directly to an 8-bit color buffer.
+    ///
+    TONE_MAPPING_NONE,
+    ///
+    /// Reinhard operator, c / (1 + c).
+    ///
+    TONE_MAPPING_REINHARD,
+    ///
+    /// Krzysztof Narkowicz's fit of the ACES filmic curve:
+    /// https://knarkowicz.wordpress.com/2016/01/06/aces-filmic-tone-mapping-curve/
+    ///
+    TONE_MAPPING_ACES
+};
+
+///
+/// \brief Parameters of the HDR resolve.
+///
+struct tone_mapping_settings
+{
+    // The R, G and B components are multiplied by this value before the tone
+    // mapping operator is applied. Alpha is not affected.
+    float exposure{1.0f};
+    tone_mapping_operator tone_operator{tone_mapping_operator::TONE_MAPPING_NONE};
+    // The number of threads used by resolve_hdr(), 0 uses one thread per
+    // hardware thread.
+    uint32_t thread_count{0};
+};
+
+///
+/// \brief Applies exposure and the tone mapping operator to a row of RGBA
+///        float pixels. The result is in [0,1] for TONE_MAPPING_REINHARD and
+///        TONE_MAPPING_ACES; TONE_MAPPING_NONE leaves clamping to the
+///        encoder.
+///
+/// \param src Source pixels, 4 floats per pixel.
+/// \param dst Destination pixels, 4 floats per pixel, may be the same as src.
+/// \param pixel_count The number of pixels in the row.
+/// \param settings The exposure and operator to apply.
+///
+void tone_map_row(const float *src, float *dst, size_t pixel_count, const tone_mapping_settings &settings);
+
+///
+/// \brief Converts the HDR color buffer of a framebuffer to an 8-bit texture.
+///
+/// The framebuffer color buffer must be in TEXTURE_FORMAT_RGBA_FLOAT. Every
+/// pixel is exposed, tone mapped, sRGB encoded if the target is
+/// TEXTURE_FORMAT_SRGB8_A8 and packed to 8 bits, in one pass over the
+/// buffer. Rows are distributed over settings.thread_count threads, the
+/// calling thread and workers that are started on first use and kept for the
+/// following calls. Small images use fewer threads. Pending tile clears of the
+/// color buffer are resolved first.
+///
+/// \param framebuffer The framebuffer with the HDR color buffer.
+/// \param target The texture to write to, in TEXTURE_FORMAT_RGBA8 or
+///               TEXTURE_FORMAT_SRGB8_A8 and with the same size as the color
+///               buffer.
+/// \param settings The exposure, tone mapping operator and thread count.
+/// \return Returns true on success, false if the formats or sizes are not
+///         supported.
+///
+bool resolve_hdr(FrameBuffer &framebuffer, Texture &target, const tone_mapping_settings &settings);
@@ -0,0 +1,189 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "rvector.h"
+
+/*
+	Approximations of the square root, reciprocal, exp2, log2 and pow
+	functions, used by the shaders in fast precision mode.
+
+	fast_rsqrt() and fast_rcp() start from the hardware estimates where the
+	target has them and refine them with one Newton-Raphson step, the
+	relative error is about 2e-7 on SSE and NEON. fast_exp2() and
+	fast_log2() are polynomials with a relative error below 2e-7 and an
+	absolute error below 2e-7 on [0.5, 2) respectively. None of them
+	handle infinities or NaNs.
+*/
+
+enum class math_precision : uint8_t
+{
+	// The functions of <cmath> and exact division, results do not change
+	// with the precision mode.
+	MATH_PRECISION_PRECISE,
+	// The approximations in this file, small differences in the last bits of
+	// the shaded colors are expected.
+	MATH_PRECISION_FAST
+};
+
+// Defining RMATH_FAST_MATH when building selects the fast mode by default,
+// callers can still choose either mode at run time.
+#ifdef RMATH_FAST_MATH
+constexpr math_precision DEFAULT_MATH_PRECISION = math_precision::MATH_PRECISION_FAST;
+#else
+constexpr math_precision DEFAULT_MATH_PRECISION = math_precision::MATH_PRECISION_PRECISE;
+#endif
+
+/*
+	\brief Approximates 1 / sqrt(x) for x > 0.
+*/
+inline float fast_rsqrt(float x)
+{
+#if defined(RMATH_SSE)
+	float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+	return y * (1.5f - 0.5f * x * y * y);
+#elif defined(RMATH_NEON)
+	float y = vrsqrtes_f32(x);
+	return y * vrsqrtss_f32(x * y, y);
+#else
+	// The bit level estimate is only accurate to 4%, so it takes two steps.
+	uint32_t i;
+	memcpy(&i, &x, sizeof(float));
+	i = 0x5F375A86 - (i >> 1);
+	float y;
+	memcpy(&y, &i, sizeof(float));
+	y = y * (1.5f - 0.5f * x * y * y);
+	return y * (1.5f - 0.5f * x * y * y);
+#endif
+}
+
+/*
+	\brief Approximates 1 / x for finite x != 0.
+*/
+inline float fast_rcp(float x)
+{
+#if defined(RMATH_SSE)
+	float y = _mm_cvtss_f32(_mm_rcp_ss(_mm_set_ss(x)));
+	return y * (2.0f - x * y);
+#elif defined(RMATH_NEON)
+	float y = vrecpes_f32(x);
+	return y * vrecpss_f32(x, y);
+#else
+	return 1.0f / x;
+#endif
+}
+
+/*
+	\brief Approximates sqrt(x) for x >= 0.
+*/
+inline float fast_sqrt(float x)
+{
+	// rsqrt(0) is infinity, the clamp keeps sqrt(0) at 0.
+	return x * fast_rsqrt(std::max(x, 1e-30f));
+}
+
+/*
+	\brief Approximates 2^x, x is clamped to [-126, 127].
+*/
+inline float fast_exp2(float x)
+{
+	x = clamp(x, -126.0f, 127.0f);
+	// Adding 1.5 * 2^23 rounds x to the nearest integer, which then is the
+	// difference of the bits to those of 1.5 * 2^23. floorf() would be a
+	// library call without SSE4.1.
+	float shifted = x + 12582912.0f;
+	int32_t integer;
+	memcpy(&integer, &shifted, sizeof(float));
+	integer -= 0x4B400000;
+	float f = x - (shifted - 12582912.0f);
+	// Polynomial fit of 2^f on [-0.5, 0.5], in Estrin's scheme.
+	float f2 = f * f;
+	float p01 = 1.00000008f + 0.693147188f * f;
+	float p23 = 0.240221075f + 0.0555035711f * f;
+	float p45 = 0.00967603192f + 0.00133908634f * f;
+	float p = p01 + (p23 + p45 * f2) * f2;
+	uint32_t bits = (uint32_t)(integer + 127) << 23;
+	float scale;
+	memcpy(&scale, &bits, sizeof(float));
+	return p * scale;
+}
+
+/*
+	\brief Approximates log2(x) for normal x > 0.
+*/
+inline float fast_log2(float x)
+{
+	// Split x into 2^exponent * m with m in [sqrt(0.5), sqrt(2)), the
+	// interval around 1 the polynomial is fitted on. Done on the bits, a
+	// comparison of m would be a badly predicted branch.
+	uint32_t bits;
+	memcpy(&bits, &x, sizeof(float));
+	uint32_t offset_bits = bits - 0x3F3504F3; // sqrt(0.5)
+	float exponent = (float)((int32_t)offset_bits >> 23);
+	bits -= offset_bits & 0xFF800000;
+	float m;
+	memcpy(&m, &bits, sizeof(float));
+	// Polynomial fit of log2(1 + t) / t on [sqrt(0.5) - 1, sqrt(2) - 1],
+	// evaluated in pairs of terms (Estrin's scheme) to keep the dependency
+	// chain short.
+	float t = m - 1.0f;
+	float t2 = t * t;
+	float t4 = t2 * t2;
+	float p01 = 1.44269499f - 0.721352931f * t;
+	float p23 = 0.480916708f - 0.360225182f * t;
+	float p45 = 0.287288882f - 0.249271822f * t;
+	float p67 = 0.232652579f - 0.142759734f * t;
+	float p = (p01 + p23 * t2) + (p45 + p67 * t2) * t4;
+	return p * t + exponent;
+}
+
+/*
+	\brief Approximates x^y for x >= 0, returns 0 if x is 0.
+*/
+inline float fast_pow(float x, float y)
+{
+	if (x <= 0.0f)
+	{
+		return 0.0f;
+	}
+	return fast_exp2(y * fast_log2(x));
+}
+
+/*
+	\brief Normalizes v with fast_rsqrt(), zero vectors stay zero.
+*/
+inline vec3 fast_normalize(const vec3 &v)
+{
+	float square_magnitude = v.magnitude_squared();
+	if (square_magnitude == 0.0f)
+	{
+		return VEC3_ZERO;
+	}
+	return v * fast_rsqrt(square_magnitude);
+}
+
+/*
+	The operations whose cost depends on the precision mode, so shader code
+	can be written once as a template over math_precision and instantiated
+	for both modes. The precise mode is exactly the code the shaders used
+	before the fast mode existed.
+*/
+template <math_precision precision>
+struct shading_math;
+
+template <>
+struct shading_math<math_precision::MATH_PRECISION_PRECISE>
+{
+	static float sqrt(float x) { return sqrtf(x); }
+	static float divide(float a, float b) { return a / b; }
+	static float pow(float x, float y) { return powf(x, y); }
+	static vec3 normalize(const vec3 &v) { return v.normalize(); }
+};
+
+template <>
+struct shading_math<math_precision::MATH_PRECISION_FAST>
+{
+	static float sqrt(float x) { return fast_sqrt(x); }
+	static float divide(float a, float b) { return a * fast_rcp(b); }
+	static float pow(float x, float y) { return fast_pow(x, y); }
+	static vec3 normalize(const vec3 &v) { return fast_normalize(v); }
+};
@@ -130,6 +130,17 @@ struct matrix
 	template <size_t U = row, std::enable_if_t<U == 4, bool> = true>
 	vec4 operator*(const vec4 &v) const
 	{
+#ifdef RMATH_SIMD
+		// Multiplies each row by the vector, then transposes the products so
+		// that the sums are added in the same order as the scalar loop.
+		simd4f vector = simd4f_load(v.elements);
+		vec4 result;
+		simd4f_store(result.elements, simd4f_sum4(simd4f_mul(simd4f_load(elements[0]), vector),
+												  simd4f_mul(simd4f_load(elements[1]), vector),
+												  simd4f_mul(simd4f_load(elements[2]), vector),
+												  simd4f_mul(simd4f_load(elements[3]), vector)));
+		return result;
+#else
 		auto result = VEC4_ZERO;
 
 		for (int i = 0; i < row; i++)
@@ -141,11 +152,31 @@ struct matrix
 		}
 
 		return result;
+#endif
 	}
 
 	template <size_t U = row, std::enable_if_t<U == 4, bool> = true>
 	matrix4x4 operator*(const matrix4x4 &right) const
 	{
+#ifdef RMATH_SIMD
+		// Each result row is a combination of the rows of the right matrix,
+		// accumulated in the same order as the scalar loop.
+		simd4f right0 = simd4f_load(right.elements[0]);
+		simd4f right1 = simd4f_load(right.elements[1]);
+		simd4f right2 = simd4f_load(right.elements[2]);
+		simd4f right3 = simd4f_load(right.elements[3]);
+		matrix4x4 result;
+		for (int i = 0; i < 4; i++)
+		{
+			simd4f left = simd4f_load(elements[i]);
+			simd4f sum = simd4f_mul(simd4f_splat<0>(left), right0);
+			sum = simd4f_add(sum, simd4f_mul(simd4f_splat<1>(left), right1));
+			sum = simd4f_add(sum, simd4f_mul(simd4f_splat<2>(left), right2));
+			sum = simd4f_add(sum, simd4f_mul(simd4f_splat<3>(left), right3));
+			simd4f_store(result.elements[i], sum);
+		}
+		return result;
+#else
 		auto result = MATRIX4x4_ZERO;
 
 		for (int v = 0; v < 4; v++)
@@ -160,6 +191,7 @@ struct matrix
 		}
 
 		return result;
+#endif
 	}
 
 	/*
@@ -169,6 +201,19 @@ struct matrix
 	*/
 	template <size_t U = row, std::enable_if_t<U == 4, bool> = true>
 	matrix4x4 inverse() const
+	{
+#ifdef RMATH_SSE
+		return inverse_sse();
+#else
+		return inverse_scalar();
+#endif
+	}
+
+	/*
+		\brief The inverse by the adjugate, used when there is no SIMD path.
+	*/
+	template <size_t U = row, std::enable_if_t<U == 4, bool> = true>
+	matrix4x4 inverse_scalar() const
 	{
 		const float a11 = elements[0][0], a12 = elements[0][1],
 					a13 = elements[0][2], a14 = elements[0][3];
@@ -228,6 +273,100 @@ struct matrix
 		return adj * (1.0f / determinant);
 	}
 
+#ifdef RMATH_SSE
+	/*
+		\brief The inverse by 2x2 blocks, see
+			https://lxjk.github.io/2017/09/03/Fast-4x4-Matrix-Inverse-with-SSE-SIMD-Explained.html
+			Each 2x2 block is kept row by row in one register. The result may
+			differ from the scalar version in the last bits.
+	*/
+	template <size_t U = row, std::enable_if_t<U == 4, bool> = true>
+	matrix4x4 inverse_sse() const
+	{
+		__m128 row0 = _mm_loadu_ps(elements[0]);
+		__m128 row1 = _mm_loadu_ps(elements[1]);
+		__m128 row2 = _mm_loadu_ps(elements[2]);
+		__m128 row3 = _mm_loadu_ps(elements[3]);
+
+		// The blocks of | A B |
+		//               | C D |
+		__m128 a = _mm_movelh_ps(row0, row1);
+		__m128 b = _mm_movehl_ps(row1, row0);
+		__m128 c = _mm_movelh_ps(row2, row3);
+		__m128 d = _mm_movehl_ps(row3, row2);
+
+		// The determinants of the blocks, (|A|, |B|, |C|, |D|).
+		__m128 determinants = _mm_sub_ps(
+			_mm_mul_ps(_mm_shuffle_ps(row0, row2, _MM_SHUFFLE(2, 0, 2, 0)),
+					   _mm_shuffle_ps(row1, row3, _MM_SHUFFLE(3, 1, 3, 1))),
+			_mm_mul_ps(_mm_shuffle_ps(row0, row2, _MM_SHUFFLE(3, 1, 3, 1)),
+					   _mm_shuffle_ps(row1, row3, _MM_SHUFFLE(2, 0, 2, 0))));
+		__m128 determinant_a = simd4f_splat<0>(determinants);
+		__m128 determinant_b = simd4f_splat<1>(determinants);
+		__m128 determinant_c = simd4f_splat<2>(determinants);
+		__m128 determinant_d = simd4f_splat<3>(determinants);
+
+		// adj(D) * C and adj(A) * B.
+		__m128 adj_d_c = block_adjugate_multiply(d, c);
+		__m128 adj_a_b = block_adjugate_multiply(a, b);
+		// The adjugates of the blocks of the inverse, up to the determinant.
+		__m128 x = _mm_sub_ps(_mm_mul_ps(determinant_d, a), block_multiply(b, adj_d_c));
+		__m128 w = _mm_sub_ps(_mm_mul_ps(determinant_a, d), block_multiply(c, adj_a_b));
+		__m128 y = _mm_sub_ps(_mm_mul_ps(determinant_b, c), block_multiply_adjugate(d, adj_a_b));
+		__m128 z = _mm_sub_ps(_mm_mul_ps(determinant_c, b), block_multiply_adjugate(a, adj_d_c));
+
+		// |M| = |A| |D| + |B| |C| - tr(adj(A) B adj(D) C)
+		__m128 trace = _mm_mul_ps(adj_a_b, _mm_shuffle_ps(adj_d_c, adj_d_c, _MM_SHUFFLE(3, 1, 2, 0)));
+		trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(2, 3, 0, 1)));
+		trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(1, 0, 3, 2)));
+		__m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(determinant_a, determinant_d),
+												   _mm_mul_ps(determinant_b, determinant_c)),
+										trace);
+		if (_mm_cvtss_f32(determinant) == 0.0f)
+		{
+			// The matrix is not invertible.
+			return MATRIX4x4_ZERO;
+		}
+		__m128 reciprocal = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), determinant);
+		x = _mm_mul_ps(x, reciprocal);
+		y = _mm_mul_ps(y, reciprocal);
+		z = _mm_mul_ps(z, reciprocal);
+		w = _mm_mul_ps(w, reciprocal);
+
+		// Takes the adjugates of the blocks and stores them row by row.
+		matrix4x4 result;
+		_mm_storeu_ps(result.elements[0], _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+		_mm_storeu_ps(result.elements[1], _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+		_mm_storeu_ps(result.elements[2], _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+		_mm_storeu_ps(result.elements[3], _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+		return result;
+	}
+
+	// 2x2 blocks multiply, A * B.
+	static __m128 block_multiply(__m128 a, __m128 b)
+	{
+		return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+						  _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+									 _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+	}
+
+	// 2x2 blocks multiply, adj(A) * B.
+	static __m128 block_adjugate_multiply(__m128 a, __m128 b)
+	{
+		return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+						  _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)),
+									 _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+	}
+
+	// 2x2 blocks multiply, A * adj(B).
+	static __m128 block_multiply_adjugate(__m128 a, __m128 b)
+	{
+		return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+						  _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+									 _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+	}
+#endif
+
 	// ------------general utility------------
 
 	matrix<row, column> operator*(float scalar) const
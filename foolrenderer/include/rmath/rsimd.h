@@ -0,0 +1,107 @@
+#pragma once
+
+/*
+	Thin wrappers over the 4-wide float SIMD instructions of the target,
+	used by the vec4 and matrix4x4 implementations.
+	RMATH_SSE is defined on x86 with SSE2, RMATH_NEON on AArch64.
+	RMATH_SIMD is defined if either is available, otherwise callers use
+	their scalar code.
+
+	Loads and stores are unaligned, vec4 and matrix4x4 keep their plain
+	float layouts and may be placed anywhere.
+*/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RMATH_SSE
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RMATH_NEON
+#endif
+
+#if defined(RMATH_SSE) || defined(RMATH_NEON)
+#define RMATH_SIMD
+
+#ifdef RMATH_SSE
+
+using simd4f = __m128;
+
+inline simd4f simd4f_load(const float *p) { return _mm_loadu_ps(p); }
+inline void simd4f_store(float *p, simd4f v) { _mm_storeu_ps(p, v); }
+inline simd4f simd4f_set1(float s) { return _mm_set1_ps(s); }
+inline simd4f simd4f_add(simd4f a, simd4f b) { return _mm_add_ps(a, b); }
+inline simd4f simd4f_sub(simd4f a, simd4f b) { return _mm_sub_ps(a, b); }
+inline simd4f simd4f_mul(simd4f a, simd4f b) { return _mm_mul_ps(a, b); }
+inline simd4f simd4f_div(simd4f a, simd4f b) { return _mm_div_ps(a, b); }
+inline simd4f simd4f_sqrt(simd4f v) { return _mm_sqrt_ps(v); }
+// Same results as std::min(a, b) and std::max(a, b) in each lane, including
+// the sign of zero and NaNs.
+inline simd4f simd4f_min(simd4f a, simd4f b) { return _mm_min_ps(b, a); }
+inline simd4f simd4f_max(simd4f a, simd4f b) { return _mm_max_ps(b, a); }
+// Comparisons return all bits set in the lanes where they are true.
+inline simd4f simd4f_equal(simd4f a, simd4f b) { return _mm_cmpeq_ps(a, b); }
+inline simd4f simd4f_less(simd4f a, simd4f b) { return _mm_cmplt_ps(a, b); }
+inline simd4f simd4f_greater(simd4f a, simd4f b) { return _mm_cmpgt_ps(a, b); }
+inline simd4f simd4f_abs(simd4f v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+// Returns a in the lanes where mask is set, b in the others.
+inline simd4f simd4f_select(simd4f mask, simd4f a, simd4f b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+// Broadcasts lane i of v to all lanes.
+template <int i>
+inline simd4f simd4f_splat(simd4f v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i)); }
+
+inline void simd4f_transpose(simd4f &a, simd4f &b, simd4f &c, simd4f &d)
+{
+	_MM_TRANSPOSE4_PS(a, b, c, d);
+}
+
+#else
+
+using simd4f = float32x4_t;
+
+inline simd4f simd4f_load(const float *p) { return vld1q_f32(p); }
+inline void simd4f_store(float *p, simd4f v) { vst1q_f32(p, v); }
+inline simd4f simd4f_set1(float s) { return vdupq_n_f32(s); }
+inline simd4f simd4f_add(simd4f a, simd4f b) { return vaddq_f32(a, b); }
+inline simd4f simd4f_sub(simd4f a, simd4f b) { return vsubq_f32(a, b); }
+inline simd4f simd4f_mul(simd4f a, simd4f b) { return vmulq_f32(a, b); }
+inline simd4f simd4f_div(simd4f a, simd4f b) { return vdivq_f32(a, b); }
+inline simd4f simd4f_sqrt(simd4f v) { return vsqrtq_f32(v); }
+inline simd4f simd4f_min(simd4f a, simd4f b) { return vbslq_f32(vcltq_f32(b, a), b, a); }
+inline simd4f simd4f_max(simd4f a, simd4f b) { return vbslq_f32(vcltq_f32(a, b), b, a); }
+inline simd4f simd4f_equal(simd4f a, simd4f b) { return vreinterpretq_f32_u32(vceqq_f32(a, b)); }
+inline simd4f simd4f_less(simd4f a, simd4f b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+inline simd4f simd4f_greater(simd4f a, simd4f b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+inline simd4f simd4f_abs(simd4f v) { return vabsq_f32(v); }
+inline simd4f simd4f_select(simd4f mask, simd4f a, simd4f b)
+{
+	return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+}
+template <int i>
+inline simd4f simd4f_splat(simd4f v) { return vdupq_laneq_f32(v, i); }
+
+inline void simd4f_transpose(simd4f &a, simd4f &b, simd4f &c, simd4f &d)
+{
+	float32x4x2_t ab = vtrnq_f32(a, b);
+	float32x4x2_t cd = vtrnq_f32(c, d);
+	a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+	b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+	c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+	d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+
+#endif
+
+/*
+	\brief Returns the sums of the lanes of a, b, c and d in lanes 0 to 3.
+		Each sum is ((v0 + v1) + v2) + v3, the same order as a scalar loop.
+*/
+inline simd4f simd4f_sum4(simd4f a, simd4f b, simd4f c, simd4f d)
+{
+	simd4f_transpose(a, b, c, d);
+	return simd4f_add(simd4f_add(simd4f_add(a, b), c), d);
+}
+
+#endif
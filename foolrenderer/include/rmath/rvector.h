@@ -1,5 +1,6 @@
 #pragma once
 #include "base_util.h"
+#include "rsimd.h"
 #include <cmath>
 
 struct vec2;
@@ -170,4 +171,331 @@ struct vec4
 #define VEC3_ZERO vec3 { 0.0f, 0.0f, 0.0f }
 #define VEC3_ONE vec3 { 1.0f, 1.0f, 1.0f }
 #define VEC4_ZERO vec4 { 0.0f, 0.0f, 0.0f, 0.0f }
-#define VEC4_ONE vec4 { 1.0f, 1.0f, 1.0f, 1.0f }
\ No newline at end of file
+#define VEC4_ONE vec4 { 1.0f, 1.0f, 1.0f, 1.0f }
+
+// All operators are defined inline, so that the shaders do not pay a function
+// call for every vector operation.
+
+// -------------vec2 implementation-------------
+inline vec3 vec2::to3D(float z) const
+{
+	return vec3{x, y, z};
+}
+
+inline vec2 vec2::operator+(const vec2 &rhs) const
+{
+	return vec2{x + rhs.x, y + rhs.y};
+}
+
+inline vec2 vec2::operator+(float scalar) const
+{
+	return vec2{x + scalar, y + scalar};
+}
+
+inline vec2 vec2::operator-(const vec2 &rhs) const
+{
+	return vec2{x - rhs.x, y - rhs.y};
+}
+
+inline vec2 vec2::operator-(float scalar) const
+{
+	return vec2{x - scalar, y - scalar};
+}
+
+inline vec2 vec2::operator*(const vec2 &rhs) const
+{
+	return vec2{x * rhs.x, y * rhs.y};
+}
+
+inline vec2 vec2::operator*(float scalar) const
+{
+	return vec2{x * scalar, y * scalar};
+}
+
+inline vec2 vec2::operator/(const vec2 &rhs) const
+{
+	return vec2{x / rhs.x, y / rhs.y};
+}
+
+inline vec2 vec2::operator/(float scalar) const
+{
+	return vec2{x / scalar, y / scalar};
+}
+
+inline float vec2::dot(const vec2 &rhs) const
+{
+	return x * rhs.x + y * rhs.y;
+}
+
+inline float vec2::magnitude() const
+{
+	return sqrtf(dot(*this));
+}
+
+inline float vec2::magnitude_squared() const
+{
+	return dot(*this);
+}
+
+inline vec2 vec2::normalize() const
+{
+	float square_magnitude = magnitude_squared();
+	if (square_magnitude == 0.0f)
+	{
+		return VEC2_ZERO;
+	}
+	if (fabsf(square_magnitude - 1.0f) < SMALL_ABSOLUTE_FLOAT)
+	{
+		return *this;
+	}
+	return this->operator*(1.0f / sqrtf(square_magnitude));
+}
+
+inline vec2 vec2::vec2_lerp(const vec2 &rhs, float t) const
+{
+	float _x = lerp(x, rhs.x, t);
+	float _y = lerp(y, rhs.y, t);
+	return vec2{_x, _y};
+}
+
+// -------------vec3 implementation-------------
+inline vec2 vec3::to2D() const
+{
+	return vec2{x, y};
+}
+
+inline vec4 vec3::to4D(float w) const
+{
+	return vec4{x, y, z, w};
+}
+
+inline vec3 vec3::operator+(const vec3 &rhs) const
+{
+	return vec3{x + rhs.x, y + rhs.y, z + rhs.z};
+}
+
+inline vec3 vec3::operator+(float scalar) const
+{
+	return vec3{x + scalar, y + scalar, z + scalar};
+}
+
+inline vec3 vec3::operator-(const vec3 &rhs) const
+{
+	return vec3{x - rhs.x, y - rhs.y, z - rhs.z};
+}
+
+inline vec3 vec3::operator-(float scalar) const
+{
+	return vec3{x - scalar, y - scalar, z - scalar};
+}
+
+inline vec3 vec3::operator*(const vec3 &rhs) const
+{
+	return vec3{x * rhs.x, y * rhs.y, z * rhs.z};
+}
+
+inline vec3 vec3::operator*(float scalar) const
+{
+	return vec3{x * scalar, y * scalar, z * scalar};
+}
+
+inline vec3 vec3::operator/(const vec3 &rhs) const
+{
+	return vec3{x / rhs.x, y / rhs.y, z / rhs.z};
+}
+
+inline vec3 vec3::operator/(float scalar) const
+{
+	return vec3{x / scalar, y / scalar, z / scalar};
+}
+
+inline float vec3::dot(const vec3 &rhs) const
+{
+	return x * rhs.x + y * rhs.y + z * rhs.z;
+}
+
+inline vec3 vec3::cross(const vec3 &rhs) const
+{
+	return vec3{
+		y * rhs.z - z * rhs.y,
+		z * rhs.x - x * rhs.z,
+		x * rhs.y - y * rhs.x};
+}
+
+inline float vec3::magnitude() const
+{
+	return sqrtf(dot(*this));
+}
+
+inline float vec3::magnitude_squared() const
+{
+	return dot(*this);
+}
+
+inline vec3 vec3::normalize() const
+{
+	float square_magnitude = magnitude_squared();
+	if (square_magnitude == 0.0f)
+	{
+		return VEC3_ZERO;
+	}
+	if (fabsf(square_magnitude - 1.0f) < SMALL_ABSOLUTE_FLOAT)
+	{
+		return (*this);
+	}
+	return this->operator*(1.0f / sqrtf(square_magnitude));
+}
+
+inline vec3 vec3::vec3_lerp(const vec3 &b, float t) const
+{
+	float _x = lerp(x, b.x, t);
+	float _y = lerp(y, b.y, t);
+	float _z = lerp(z, b.z, t);
+	return vec3{_x, _y, _z};
+}
+
+// -------------vec4 implementation-------------
+inline vec2 vec4::to2D() const
+{
+	return vec2{x, y};
+}
+
+inline vec3 vec4::to3D() const
+{
+	return vec3{x, y, z};
+}
+
+inline vec4 vec4::operator+(const vec4 &rhs) const
+{
+#ifdef RMATH_SIMD
+	vec4 result;
+	simd4f_store(result.elements, simd4f_add(simd4f_load(elements), simd4f_load(rhs.elements)));
+	return result;
+#else
+	return vec4{x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w};
+#endif
+}
+
+inline vec4 vec4::operator+(float scalar) const
+{
+#ifdef RMATH_SIMD
+	vec4 result;
+	simd4f_store(result.elements, simd4f_add(simd4f_load(elements), simd4f_set1(scalar)));
+	return result;
+#else
+	return vec4{x + scalar, y + scalar, z + scalar, w + scalar};
+#endif
+}
+
+inline vec4 vec4::operator-(const vec4 &rhs) const
+{
+#ifdef RMATH_SIMD
+	vec4 result;
+	simd4f_store(result.elements, simd4f_sub(simd4f_load(elements), simd4f_load(rhs.elements)));
+	return result;
+#else
+	return vec4{x - rhs.x, y - rhs.y, z - rhs.z, w - rhs.w};
+#endif
+}
+
+inline vec4 vec4::operator-(float scalar) const
+{
+#ifdef RMATH_SIMD
+	vec4 result;
+	simd4f_store(result.elements, simd4f_sub(simd4f_load(elements), simd4f_set1(scalar)));
+	return result;
+#else
+	return vec4{x - scalar, y - scalar, z - scalar, w - scalar};
+#endif
+}
+
+inline vec4 vec4::operator*(const vec4 &rhs) const
+{
+#ifdef RMATH_SIMD
+	vec4 result;
+	simd4f_store(result.elements, simd4f_mul(simd4f_load(elements), simd4f_load(rhs.elements)));
+	return result;
+#else
+	return vec4{x * rhs.x, y * rhs.y, z * rhs.z, w * rhs.w};
+#endif
+}
+
+inline vec4 vec4::operator*(float scalar) const
+{
+#ifdef RMATH_SIMD
+	vec4 result;
+	simd4f_store(result.elements, simd4f_mul(simd4f_load(elements), simd4f_set1(scalar)));
+	return result;
+#else
+	return vec4{x * scalar, y * scalar, z * scalar, w * scalar};
+#endif
+}
+
+inline vec4 vec4::operator/(const vec4 &rhs) const
+{
+#ifdef RMATH_SIMD
+	vec4 result;
+	simd4f_store(result.elements, simd4f_div(simd4f_load(elements), simd4f_load(rhs.elements)));
+	return result;
+#else
+	return vec4{x / rhs.x, y / rhs.y, z / rhs.z, w / rhs.w};
+#endif
+}
+
+inline vec4 vec4::operator/(float scalar) const
+{
+#ifdef RMATH_SIMD
+	vec4 result;
+	simd4f_store(result.elements, simd4f_div(simd4f_load(elements), simd4f_set1(scalar)));
+	return result;
+#else
+	return vec4{x / scalar, y / scalar, z / scalar, w / scalar};
+#endif
+}
+
+inline float vec4::dot(const vec4 &rhs) const
+{
+	return x * rhs.x + y * rhs.y + z * rhs.z + w * rhs.w;
+}
+
+inline float vec4::magnitude() const
+{
+	return sqrtf(dot(*this));
+}
+
+inline float vec4::magnitude_squared() const
+{
+	return dot(*this);
+}
+
+inline vec4 vec4::normalize() const
+{
+	float square_magnitude = magnitude_squared();
+	if (square_magnitude == 0.0f)
+	{
+		return VEC4_ZERO;
+	}
+	if (fabsf(square_magnitude - 1.0f) < SMALL_ABSOLUTE_FLOAT)
+	{
+		return (*this);
+	}
+	return this->operator*(1.0f / sqrtf(square_magnitude));
+}
+
+inline vec4 vec4::vec4_lerp(const vec4 &b, float t) const
+{
+#ifdef RMATH_SIMD
+	// Same operation order as lerp(), a + t * (b - a).
+	simd4f va = simd4f_load(elements);
+	simd4f difference = simd4f_sub(simd4f_load(b.elements), va);
+	vec4 result;
+	simd4f_store(result.elements, simd4f_add(va, simd4f_mul(simd4f_set1(t), difference)));
+	return result;
+#else
+	float _x = lerp(x, b.x, t);
+	float _y = lerp(y, b.y, t);
+	float _z = lerp(z, b.z, t);
+	float _w = lerp(w, b.w, t);
+	return vec4{_x, _y, _z, _w};
+#endif
+}
@@ -43,4 +43,8 @@ struct basic_vertex_attribute
 
 vec4 basic_vertex_shader(ShaderContext *output, const void *uniform, const void *vertex_attribute);
 
-vec4 basic_fragment_shader(ShaderContext *input, const void *uniform);
\ No newline at end of file
+vec4 basic_fragment_shader(ShaderContext *input, const void *uniform);
+
+// Same as basic_fragment_shader(), but normalizes and computes the specular
+// power with the approximations in rmath/fast_math.h.
+vec4 basic_fragment_shader_fast(ShaderContext *input, const void *uniform);
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "graphics/material_texture.h"
 #include "graphics/shader_context.h"
 #include "graphics/texture.h"
 #include "rmath/rmatrix.h"
@@ -54,6 +55,10 @@ struct standard_uniform
     // dielectric can be found in the Filament documentation:
     // https://google.github.io/filament/Filament.html#table_commonmatreflectance
     float reflectance;
+    // Optional packed form of normal_map, base_color_map, metallic_map and
+    // roughness_map. If it is not a null pointer, the four maps are ignored and
+    // all of them are fetched from this texture at once.
+    MaterialTexture *material_map;
 };
 
 struct standard_vertex_attribute
@@ -66,4 +71,12 @@ struct standard_vertex_attribute
 
 vec4 standard_vertex_shader(ShaderContext *output, const void *uniform, const void *vertex_attribute);
 
-vec4 standard_fragment_shader(ShaderContext *input, const void *uniform);
\ No newline at end of file
+vec4 standard_fragment_shader(ShaderContext *input, const void *uniform);
+
+// Same as standard_fragment_shader(), but normalizes, divides and takes square
+// roots with the approximations in rmath/fast_math.h.
+vec4 standard_fragment_shader_fast(ShaderContext *input, const void *uniform);
+
+// Packet form of standard_fragment_shader(), see set_packet_fragment_shader().
+// Gives the same results as standard_fragment_shader(), bit for bit.
+void standard_packet_fragment_shader(const ShaderPacket *input, const void *uniform, packet_vec4 *output);
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "rmath/rmatrix.h"
+#include "rmath/rvector.h"
+#include "utility/mesh.h"
+
+// Draw level culling: whole models are tested against the view frustum with
+// their bounds, before any of their vertices are fetched.
+
+///
+/// \brief The six planes of a view frustum, facing inwards.
+///
+/// A point p is inside a plane if dot(plane.xyz, p) + plane.w >= 0. The planes
+/// are normalized, so this is the distance of p to the plane.
+///
+struct Frustum
+{
+    // Left, right, bottom, top, near and far.
+    vec4 planes[6];
+};
+
+///
+/// \brief Extracts the frustum of a clip space transform.
+///
+/// The planes are in the space that the matrix transforms from, so with a
+/// local2clip matrix the bounds of a mesh are tested without transforming
+/// them. Follows the OpenGL clip volume, -w <= x, y, z <= w.
+///
+/// \param local2clip The matrix that transforms to clip space, e.g.
+///        world2clip * local2world.
+/// \return Returns the frustum.
+///
+Frustum extract_frustum(const matrix4x4 &local2clip);
+
+///
+/// \brief Returns true if the sphere is completely outside one plane of the
+///        frustum.
+///
+bool is_outside_frustum(const Frustum &frustum, const bounding_sphere &sphere);
+
+///
+/// \brief Returns true if the box is completely outside one plane of the
+///        frustum.
+///
+bool is_outside_frustum(const Frustum &frustum, const axis_aligned_box &box);
+
+///
+/// \brief Returns true if the mesh may be visible through the frustum.
+///
+/// Tests the bounding sphere of the mesh first, which is cheaper, then its
+/// bounding box, which is tighter. Both tests are conservative: a mesh near a
+/// corner of the frustum may pass and still not be visible.
+///
+/// \param frustum The frustum, in the local space of the mesh.
+/// \param mesh The mesh.
+///
+bool is_mesh_visible(const Frustum &frustum, const Mesh &mesh);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "rmath/rmatrix.h"
+#include "rmath/rvector.h"
+#include "utility/mesh.h"
+
+// Coarse front-to-back ordering of draws, so that the depth test rejects the
+// hidden fragments of later draws before they are shaded. The order comes from
+// bounding spheres, per object or per meshlet, triangles are not sorted.
+
+///
+/// \brief A run of consecutive triangles of a mesh that is sorted and drawn as
+///        one unit.
+///
+struct Meshlet
+{
+    uint32_t first_triangle;
+    uint32_t triangle_count;
+    // The bounds of the vertices of the triangles, in the space of the mesh.
+    bounding_sphere bounds;
+};
+
+///
+/// \brief Splits the triangles of a mesh into meshlets of consecutive
+///        triangles.
+///
+/// The triangles of a mesh loaded from a file are usually stored surface by
+/// surface, so consecutive triangles are close to each other.
+///
+/// \param mesh The mesh to split.
+/// \param max_triangle_count The number of triangles of a meshlet, the last
+///        one may have fewer.
+/// \return Returns the meshlets in the order of the triangles.
+///
+std::vector<Meshlet> build_meshlets(const Mesh &mesh, uint32_t max_triangle_count = 64);
+
+///
+/// \brief Sorts bounding spheres front to back.
+///
+/// The spheres are ordered by the view space depth of their nearest point, the
+/// camera looks down the negative z axis as set up by matrix_t::look_at().
+/// local2view must not scale, otherwise the radii are not transformed.
+///
+/// \param bounds The bounding spheres, e.g. of objects.
+/// \param count The number of spheres.
+/// \param local2view The matrix that transforms the spheres to view space.
+/// \param order Receives the indices of the spheres, nearest first.
+///
+void sort_front_to_back(const bounding_sphere bounds[], size_t count, const matrix4x4 &local2view,
+                        std::vector<uint32_t> &order);
+
+///
+/// \brief Sorts the meshlets of a mesh front to back, see the overload above.
+///
+void sort_front_to_back(const std::vector<Meshlet> &meshlets, const matrix4x4 &local2view,
+                        std::vector<uint32_t> &order);
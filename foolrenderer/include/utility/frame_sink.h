@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "graphics/texture.h"
+
+// Frame sinks write the frames of a rendered sequence either as one image
+// file per frame or as one uncompressed video stream. A stream can go to a
+// regular file, to stdout or to a named pipe, so frames can be fed to a video
+// encoder without temporary files, e.g.
+//
+//   FoolRenderer_Cpp y4m - | ffmpeg -i - sweep.mp4
+//
+// Frames must be in TEXTURE_FORMAT_RGB8, TEXTURE_FORMAT_SRGB8,
+// TEXTURE_FORMAT_RGBA8 or TEXTURE_FORMAT_SRGB8_A8 and have the size the sink
+// was created with.
+
+enum class frame_sink_format : uint8_t
+{
+    ///
+    /// One run-length encoded TGA file per frame.
+    ///
+    FRAME_SINK_TGA,
+    ///
+    /// One QOI file per frame, see https://qoiformat.org/qoi-specification.pdf.
+    /// Lossless, about half the size of TGA with RLE at a similar encoding
+    /// cost.
+    ///
+    FRAME_SINK_QOI,
+    ///
+    /// A YUV4MPEG2 stream, BT.601 limited range 4:2:0 with centered chroma
+    /// (C420jpeg). Accepted by most video encoders as raw input.
+    ///
+    FRAME_SINK_Y4M,
+    ///
+    /// A stream of binary PPM (P6) images, 8-bit RGB. Lossless, but twice the
+    /// size of a 4:2:0 Y4M stream.
+    ///
+    FRAME_SINK_PPM
+};
+
+///
+/// \brief Gets the frame sink format from its name: "tga", "qoi", "y4m" or
+///        "ppm".
+///
+/// \return Returns true if the name is known, false otherwise.
+///
+bool parse_frame_sink_format(std::string_view name, frame_sink_format &format);
+
+///
+/// \brief Encodes the texture as a QOI image.
+///
+/// The image is written top row first, alpha is kept if the texture has an
+/// alpha component. sRGB textures are tagged as sRGB, others as linear.
+///
+/// \param texture The texture to encode.
+/// \param output The encoded image, replaces the previous contents. The
+///        capacity is kept, so reusing the vector avoids reallocation.
+/// \return Returns true on success, false if the texture format is not
+///         supported.
+///
+bool encode_qoi(const Texture &texture, std::vector<uint8_t> &output);
+
+class FrameSink
+{
+public:
+    ///
+    /// \brief Creates a frame sink.
+    ///
+    /// \param format The output format.
+    /// \param path For TGA and QOI, the prefix of the frame files, the frame
+    ///        number (starting at 1) and the extension are appended. For Y4M
+    ///        and PPM, the file or named pipe to write the stream to, "-" for
+    ///        stdout. Opening a named pipe blocks until a reader opens it.
+    /// \param width The width of the frames.
+    /// \param height The height of the frames.
+    /// \param frame_rate The frame rate stored in the Y4M header.
+    ///
+    FrameSink(frame_sink_format format, std::string_view path, uint32_t width, uint32_t height,
+              uint32_t frame_rate = 30);
+    ~FrameSink();
+
+    FrameSink(const FrameSink &) = delete;
+    FrameSink &operator=(const FrameSink &) = delete;
+
+    // Returns false if the stream could not be opened or a write failed.
+    bool is_open() const;
+    // Returns true if the sink writes to stdout, in which case nothing else
+    // may be printed there.
+    bool writes_to_stdout() const;
+    uint32_t get_frame_count() const;
+
+    bool write_frame(const Texture &frame);
+    // Flushes and closes the stream. Called by the destructor.
+    bool finish();
+
+private:
+    bool write_stream(const void *data, size_t size);
+    void convert_to_y4m(const Texture &frame);
+    void convert_to_ppm(const Texture &frame);
+
+    frame_sink_format format;
+    std::string path;
+    uint32_t width;
+    uint32_t height;
+    uint32_t frame_count{0};
+    FILE *stream{nullptr};
+    bool is_stdout{false};
+    bool failed{false};
+    // Encoded or converted frame, reused between frames.
+    std::vector<uint8_t> frame_buffer;
+};
@@ -1,41 +1,13 @@
 #pragma once
 
+#include "graphics/material_texture.h"
+#include "graphics/profiler.h"
 #include "graphics/texture.h"
 #include "tgafunc_cpp.h"
+#include "texture_cache.h"
 #include <string_view>
 #include <memory>
 
-// Convert TGA image pixels to texture's pixels or texture's pixels to TGA image
-// pixels. Each component of the pixel must be an 8-bit unsigned integer type,
-// and the number of components of pixels must be greater than or equal to 3.
-inline static void pixel_endian_inversion(uint8_t *pixel)
-{
-    // Swap the values of the 1st and 3rd components of a pixel.
-    std::swap(pixel[0], pixel[2]);
-}
-
-// Modify the components of the TGA image pixels to the order expected by the
-// texture. Only TGA images with pixel formats TGA_PIXEL_RGB24 and
-// TGA_PIXEL_ARGB32 are supported.
-inline static void modify_tga_image_pixel(tga::Image &img)
-{
-    auto pixel_format = img.get_pixel_format();
-    if (pixel_format != tga::tga_pixel_format::TGA_PIXEL_RGB24 && pixel_format != tga::tga_pixel_format::TGA_PIXEL_ARGB32)
-    {
-        return;
-    }
-    uint32_t width = img.get_width();
-    uint32_t height = img.get_height();
-    for (uint32_t y = 0; y < width; y++)
-    {
-        for (uint32_t x = 0; x < height; x++)
-        {
-            uint8_t *pixel = img.get_pixel(x, y);
-            pixel_endian_inversion(pixel);
-        }
-    }
-}
-
 ///
 /// \brief Loads image data from a TGA format file.
 ///
@@ -49,12 +21,20 @@ inline static void modify_tga_image_pixel(tga::Image &img)
 ///
 inline std::unique_ptr<Texture> load_image(std::string_view filename, bool is_srgb_encoding)
 {
+    PROFILE_ZONE("load_image");
     if (filename.empty())
     {
         return nullptr;
     }
 
-    tga::Image img(filename);
+    // The coordinate system used by the loaded image data and the coordinate
+    // system used by the texture are opposite on the Y axis, and the TGA
+    // components are stored in BGR(A) order. The decoder flips the rows and
+    // swaps the components while decoding.
+    tga::tga_load_options options;
+    options.bottom_left_origin = true;
+    options.swap_red_blue = true;
+    tga::Image img(filename, options);
 
     auto error_code = img.last_error();
     if (error_code != tga::tga_error::TGA_NO_ERROR)
@@ -64,10 +44,6 @@ inline std::unique_ptr<Texture> load_image(std::string_view filename, bool is_sr
     auto image_pixel_format = img.get_pixel_format();
     uint32_t width = img.get_width();
     uint32_t height = img.get_height();
-    // The coordinate system used by the loaded image data and the coordinate
-    // system used by the texture are opposite on the Y axis. So need to flip
-    // the image in the Y-axis direction.
-    img.flip_v();
 
     std::unique_ptr<Texture> texture{nullptr};
     if (image_pixel_format == tga::tga_pixel_format::TGA_PIXEL_BW8)
@@ -80,7 +56,6 @@ inline std::unique_ptr<Texture> load_image(std::string_view filename, bool is_sr
     }
     else if (image_pixel_format == tga::tga_pixel_format::TGA_PIXEL_RGB24)
     {
-        modify_tga_image_pixel(img);
         enum texture_format texture_format =
             is_srgb_encoding ? texture_format::TEXTURE_FORMAT_SRGB8 : texture_format::TEXTURE_FORMAT_RGB8;
         texture = std::make_unique<Texture>(texture_format, width, height);
@@ -91,7 +66,6 @@ inline std::unique_ptr<Texture> load_image(std::string_view filename, bool is_sr
     }
     else if (image_pixel_format == tga::tga_pixel_format::TGA_PIXEL_ARGB32)
     {
-        modify_tga_image_pixel(img);
         enum texture_format texture_format =
             is_srgb_encoding ? texture_format::TEXTURE_FORMAT_SRGB8_A8 : texture_format::TEXTURE_FORMAT_RGBA8;
         texture = std::make_unique<Texture>(texture_format, width, height);
@@ -104,6 +78,52 @@ inline std::unique_ptr<Texture> load_image(std::string_view filename, bool is_sr
     return texture;
 }
 
+///
+/// \brief Loads the maps of a material from TGA format files and packs them
+///        into one material texture.
+///
+/// The base color map is treated as sRGB encoded, the other maps are treated
+/// as linear. A map that fails to load is replaced with the default value
+/// described in MaterialTexture::pack().
+///
+/// \param base_color_filename The base color TGA file to load.
+/// \param normal_filename The normal TGA file to load.
+/// \param metallic_filename The metallic TGA file to load.
+/// \param roughness_filename The roughness TGA file to load.
+/// \param cache_directory If not empty, the maps are loaded through the
+///        texture cache in this directory, see load_image_cached().
+/// \param use_compression Whether the maps are block compressed when loaded,
+///        the normal map to BC5 and the others to BC1 or BC4, see
+///        load_image_cached(). The compressed maps are cached, and decoded
+///        when packed, so the material has the compression error but loads
+///        from smaller containers.
+/// \return Returns a material texture pointer on success, null pointer on
+///         failure.
+///
+inline std::unique_ptr<MaterialTexture> load_material(std::string_view base_color_filename,
+                                                      std::string_view normal_filename,
+                                                      std::string_view metallic_filename,
+                                                      std::string_view roughness_filename,
+                                                      std::string_view cache_directory = {},
+                                                      bool use_compression = false)
+{
+    PROFILE_ZONE("load_material");
+    texture_cache_compression color_compression = use_compression
+                                                       ? texture_cache_compression::TEXTURE_CACHE_COLOR
+                                                       : texture_cache_compression::TEXTURE_CACHE_UNCOMPRESSED;
+    texture_cache_compression normal_compression = use_compression
+                                                        ? texture_cache_compression::TEXTURE_CACHE_NORMAL
+                                                        : texture_cache_compression::TEXTURE_CACHE_UNCOMPRESSED;
+    auto base_color_map = load_image_cached(base_color_filename, true, cache_directory, color_compression);
+    auto normal_map = load_image_cached(normal_filename, false, cache_directory, normal_compression);
+    auto metallic_map = load_image_cached(metallic_filename, false, cache_directory, color_compression);
+    auto roughness_map = load_image_cached(roughness_filename, false, cache_directory, color_compression);
+    // The source textures are released when this function returns, only the
+    // packed texture stays resident.
+    return MaterialTexture::pack(base_color_map.get(), normal_map.get(),
+                                 metallic_map.get(), roughness_map.get());
+}
+
 ///
 /// \brief Saves the texture as a TGA format file.
 ///
@@ -113,14 +133,19 @@ inline std::unique_ptr<Texture> load_image(std::string_view filename, bool is_sr
 /// When saving the alpha channel, if the texture does not contain alpha channel
 /// data, the alpha channel in the saved image is all set to 0xFF.
 ///
-/// \param texture Pointer to the texture to save.
+/// The texture rows are converted and written one at a time, bottom row first,
+/// so no copy of the whole image is made.
+///
+/// \param texture The texture to save.
 /// \param filename The file to save to.
 /// \param alpha Whether to save the alpha channel.
+/// \param rle Whether to run-length encode the image.
 /// \return Returns true on success, false on failure.
 ///
-inline bool save_image(const Texture &texture, std::string_view filename, bool alpha)
+inline bool save_image(const Texture &texture, std::string_view filename, bool alpha, bool rle = false)
 {
-    size_t texture_pixel_size;
+    PROFILE_ZONE("save_image");
+    int texture_pixel_size;
     auto texture_format = texture.m_format;
     if (texture_format == texture_format::TEXTURE_FORMAT_RGB8 ||
         texture_format == texture_format::TEXTURE_FORMAT_SRGB8)
@@ -136,131 +161,29 @@ inline bool save_image(const Texture &texture, std::string_view filename, bool a
     {
         return false;
     }
-
-    uint32_t texture_width = texture.m_width;
-    uint32_t texture_height = texture.m_height;
     const uint8_t *texture_data = texture.get_pixels();
-
-    size_t image_pixel_size;
-    tga::tga_pixel_format image_format;
-    if (alpha)
+    if (texture_data == nullptr)
     {
-        image_pixel_size = 4;
-        image_format = tga::tga_pixel_format::TGA_PIXEL_ARGB32;
-    }
-    else
-    {
-        image_pixel_size = 3;
-        image_format = tga::tga_pixel_format::TGA_PIXEL_RGB24;
+        return false;
     }
 
-    tga::Image img(texture_width, texture_height, image_format);
-
-    // Copy the color buffer data to the TGA image.
-    for (uint32_t y = 0; y < texture_height; y++)
+    auto image_format = alpha ? tga::tga_pixel_format::TGA_PIXEL_ARGB32 : tga::tga_pixel_format::TGA_PIXEL_RGB24;
+    // The first row of the texture is the bottom row, which is the first row
+    // of a TGA image with a bottom left origin, so no flip is needed.
+    tga::ImageWriter writer(filename, texture.m_width, texture.m_height, image_format, rle, true);
+    size_t row_size = (size_t)texture.m_width * texture_pixel_size;
+    for (uint32_t y = 0; y < texture.m_height; y++)
     {
-        for (uint32_t x = 0; x < texture_width; x++)
+        if (!writer.write_rgb_row(texture_data + y * row_size, texture_pixel_size))
         {
-            const uint8_t *texture_pixel =
-                texture_data + (y * texture_width + x) * texture_pixel_size;
-            uint8_t *image_pixel = img.get_pixel(x, y);
-            for (size_t i = 0; i < image_pixel_size; i++)
-            {
-                if (i == texture_pixel_size)
-                {
-                    // That is, i == 3 && texture_pixel_size == 3.
-                    // The texture has no alpha channel, the alpha channel of
-                    // image pixels is set to 0xFF.
-                    image_pixel[i] = 0xFF;
-                }
-                else
-                {
-                    image_pixel[i] = texture_pixel[i];
-                }
-            }
-            // Convert the pixel components to the desired arrangement order of
-            // the TGA image.
-            pixel_endian_inversion(image_pixel);
+            break;
         }
     }
-    // For the same reason as inverting the image data vertically in the
-    // load_image() function.
-    img.flip_v();
-    img.save(filename);
-
-    return true;
+    return writer.finish();
 }
 
 // overload for Texture*
-inline bool save_image(const Texture *texture, std::string_view filename, bool alpha)
+inline bool save_image(const Texture *texture, std::string_view filename, bool alpha, bool rle = false)
 {
-    size_t texture_pixel_size;
-    auto texture_format = texture->m_format;
-    if (texture_format == texture_format::TEXTURE_FORMAT_RGB8 ||
-        texture_format == texture_format::TEXTURE_FORMAT_SRGB8)
-    {
-        texture_pixel_size = 3;
-    }
-    else if (texture_format == texture_format::TEXTURE_FORMAT_RGBA8 ||
-             texture_format == texture_format::TEXTURE_FORMAT_SRGB8_A8)
-    {
-        texture_pixel_size = 4;
-    }
-    else
-    {
-        return false;
-    }
-
-    uint32_t texture_width = texture->m_width;
-    uint32_t texture_height = texture->m_height;
-    const uint8_t *texture_data = texture->get_pixels();
-
-    size_t image_pixel_size;
-    tga::tga_pixel_format image_format;
-    if (alpha)
-    {
-        image_pixel_size = 4;
-        image_format = tga::tga_pixel_format::TGA_PIXEL_ARGB32;
-    }
-    else
-    {
-        image_pixel_size = 3;
-        image_format = tga::tga_pixel_format::TGA_PIXEL_RGB24;
-    }
-
-    tga::Image img(texture_width, texture_height, image_format);
-
-    // Copy the color buffer data to the TGA image.
-    for (uint32_t y = 0; y < texture_height; y++)
-    {
-        for (uint32_t x = 0; x < texture_width; x++)
-        {
-            const uint8_t *texture_pixel =
-                texture_data + (y * texture_width + x) * texture_pixel_size;
-            uint8_t *image_pixel = img.get_pixel(x, y);
-            for (size_t i = 0; i < image_pixel_size; i++)
-            {
-                if (i == texture_pixel_size)
-                {
-                    // That is, i == 3 && texture_pixel_size == 3.
-                    // The texture has no alpha channel, the alpha channel of
-                    // image pixels is set to 0xFF.
-                    image_pixel[i] = 0xFF;
-                }
-                else
-                {
-                    image_pixel[i] = texture_pixel[i];
-                }
-            }
-            // Convert the pixel components to the desired arrangement order of
-            // the TGA image.
-            pixel_endian_inversion(image_pixel);
-        }
-    }
-    // For the same reason as inverting the image data vertically in the
-    // load_image() function.
-    img.flip_v();
-    img.save(filename);
-
-    return true;
-}
\ No newline at end of file
+    return texture != nullptr && save_image(*texture, filename, alpha, rle);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "graphics/texture.h"
+
+// Compares rendered images, e.g. the frames of two rendering modes that
+// should look the same. Only the RGB components of 8-bit textures
+// (TEXTURE_FORMAT_RGB8, TEXTURE_FORMAT_SRGB8, TEXTURE_FORMAT_RGBA8 and
+// TEXTURE_FORMAT_SRGB8_A8) are compared, the stored values are compared
+// without decoding sRGB.
+
+struct image_difference
+{
+    uint32_t pixel_count;
+    // Number of pixels with any component differing by more than the
+    // threshold passed to compare_images().
+    uint32_t differing_pixel_count;
+    // Largest absolute difference of a component, 0 to 255.
+    uint32_t max_error;
+    // Mean absolute difference over all components.
+    double mean_error;
+    // Peak signal-to-noise ratio in dB, infinity if the images are identical.
+    double psnr;
+};
+
+///
+/// \brief Compares two textures of the same size.
+///
+/// The two textures may have different formats, e.g. RGB8 and RGBA8.
+///
+/// \param a The first texture.
+/// \param b The second texture.
+/// \param difference The result of the comparison.
+/// \param threshold Component differences up to this value do not count a
+///        pixel as differing.
+/// \return Returns true on success, false if the sizes differ or a format is
+///         not supported.
+///
+bool compare_images(const Texture &a, const Texture &b, image_difference &difference, uint8_t threshold = 0);
+
+///
+/// \brief Creates an RGB8 image of the absolute differences of two textures,
+///        multiplied by scale, so small differences become visible.
+///
+/// \return Returns the difference image, nullptr if the sizes differ or a
+///         format is not supported.
+///
+std::unique_ptr<Texture> make_difference_image(const Texture &a, const Texture &b, uint32_t scale = 16);
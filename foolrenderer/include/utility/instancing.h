@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "graphics/framebuffer.h"
+#include "graphics/rasterizer.h"
+#include "graphics/shader_context.h"
+#include "rmath/rmatrix.h"
+#include "rmath/rvector.h"
+#include "shaders/standard.h"
+#include "utility/mesh.h"
+
+///
+/// \brief The data of one instance of draw_standard_instances().
+///
+struct standard_instance
+{
+    matrix4x4 local2world;
+    // Replace the material parameters of the shared uniform.
+    vec3 base_color;
+    float metallic;
+    float roughness;
+};
+
+///
+/// \brief The memory draw_standard_instances() works in, owned by the caller
+///        and reused between calls, so that drawing does not allocate once the
+///        sizes of the mesh and the instances are reached.
+///
+struct standard_instance_scratch
+{
+    // The vertex attributes of the mesh, indexed like its positions.
+    std::vector<standard_vertex_attribute> attributes;
+    // The uniforms of the instances in the view.
+    std::vector<standard_uniform> instance_uniforms;
+    // The positions and the shaded variables of the vertices of the instance
+    // being drawn.
+    transformed_vertices vertices;
+    std::vector<ShaderContext> varyings;
+};
+
+///
+/// \brief Draws many copies of a mesh with the standard shader.
+///
+/// The vertex attributes of the mesh are gathered once for all instances, and
+/// the per instance matrices, local2world_direction and local2world_normal,
+/// are computed in one pass before drawing. Each instance is tested against
+/// the view frustum with the bounds of the mesh, then its positions are
+/// transformed at once by transform_vertices(), each vertex is shaded once by
+/// shade_vertices(), and its triangles are drawn by draw_shaded_triangle(), in
+/// the order of the instances.
+///
+/// The vertex shader must be standard_vertex_shader, and the viewport and the
+/// fragment shader must be set, as for draw_triangle().
+///
+/// \param framebuffer Buffer for saving rendering results.
+/// \param mesh The mesh of all instances.
+/// \param uniform The uniform shared by all instances, its local2world,
+///        local2world_direction, local2world_normal and the material
+///        parameters of standard_instance are replaced for each instance.
+/// \param instances The instances.
+/// \param instance_count The number of instances.
+/// \param scratch The memory to work in, see standard_instance_scratch.
+/// \return Returns the number of instances drawn, the others are outside the
+///         view.
+///
+uint32_t draw_standard_instances(FrameBuffer *framebuffer, const Mesh &mesh, const standard_uniform &uniform,
+                                 const standard_instance instances[], size_t instance_count,
+                                 standard_instance_scratch &scratch);
@@ -6,6 +6,24 @@
 #include <string>
 #include <string_view>
 
+///
+/// \brief An axis-aligned bounding box.
+///
+struct axis_aligned_box
+{
+    vec3 min;
+    vec3 max;
+};
+
+///
+/// \brief A bounding sphere.
+///
+struct bounding_sphere
+{
+    vec3 center;
+    float radius;
+};
+
 ///
 /// The mesh is made of triangles, each triangle is defined by three vertex
 /// indices. For example, a cube mesh has 12 triangles, then the indices array
@@ -52,7 +70,22 @@ struct Mesh
     /// tangent exists.
     ///
     std::unique_ptr<vec4[]> tangents;
+    ///
+    /// \brief The positions again, as separate x, y and z arrays.
+    ///
+    /// Used by transform_vertices(), which transforms many positions at once.
+    ///
+    std::unique_ptr<float[]> positions_x;
+    std::unique_ptr<float[]> positions_y;
+    std::unique_ptr<float[]> positions_z;
     std::unique_ptr<uint32_t[]> indices;
+    ///
+    /// \brief The bounds of the positions, computed when the mesh is loaded.
+    ///
+    /// The sphere is centered on the box, it is not the smallest one.
+    ///
+    axis_aligned_box bounds_box;
+    bounding_sphere bounds_sphere;
     std::string diffuse_texture_path;
     uint32_t vertex_count;
     uint32_t triangle_count;
@@ -69,6 +102,16 @@ struct Mesh
     vec3 get_mesh_normal(uint32_t triangle_index, uint32_t vertex_index) const;
     vec4 get_mesh_tangent(uint32_t triangle_index, uint32_t vertex_index) const;
 
+    ///
+    /// \brief Computes the bounds of the vertices of the triangles
+    ///        [first_triangle, first_triangle + count).
+    ///
+    /// The sphere is centered on the box and reaches the farthest vertex, it
+    /// is not the smallest one. Both are zero if there are no triangles.
+    ///
+    void compute_triangle_bounds(uint32_t first_triangle, uint32_t count, axis_aligned_box &box,
+                                 bounding_sphere &sphere) const;
+
 private:
     // Returns false if failed, otherwise returns true.
     bool set_vertex_attributes(const fastObjMesh *data);
@@ -76,6 +119,15 @@ private:
     // Returns false if failed, otherwise returns true.
     bool set_diffuse_texture_name(const fastObjMesh *data);
 
+    // Copies the positions into the positions_x, positions_y and positions_z
+    // arrays.
+    //
+    // Returns false if failed, otherwise returns true.
+    bool set_position_streams();
+
+    // Computes bounds_box and bounds_sphere from all triangles.
+    void compute_bounds();
+
     // Calculates the average unit-length normal vector for each vertex in the mesh.
     //
     // Returns false if failed, otherwise returns true.
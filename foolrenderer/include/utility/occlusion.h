@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "graphics/texture.h"
+#include "rmath/rmatrix.h"
+#include "rmath/rvector.h"
+#include "utility/mesh.h"
+
+// The width of an occlusion buffer must be a multiple of this, the occluders
+// are rasterized this many texels at a time.
+#define OCCLUSION_BUFFER_ALIGNMENT 4
+
+///
+/// \brief A low resolution depth buffer for software occlusion culling.
+///
+/// Each frame, the buffer is cleared, filled with a few large occluders or
+/// with the depth of the previous frame, and then the bounds of models or
+/// meshlets are tested against it before they are drawn.
+///
+/// The buffer is conservative: each texel holds a depth that is at least as
+/// far as the occluders that cover the whole texel, so a model that is
+/// reported hidden is hidden at every pixel of the texel. Depths are in the
+/// [0, 1] range of the rasterizer, the texels cover the whole viewport.
+///
+struct OcclusionBuffer
+{
+    uint32_t m_width, m_height;
+    std::unique_ptr<float[]> depths;
+    // Scratch for the erosion of the occluders, see draw_occluder().
+    std::unique_ptr<float[]> row_depths;
+    // Whether occluders were drawn since the buffer was last eroded.
+    bool m_has_new_occluders;
+    // The bounds tested and the bounds reported hidden since the last clear().
+    uint32_t m_tested_count;
+    uint32_t m_culled_count;
+    // The vertices of the last occluder in buffer space, x and y in texels,
+    // z the depth, w 0 if the vertex is in front of the near plane.
+    std::vector<vec4> projected_vertices;
+
+    OcclusionBuffer();
+    ~OcclusionBuffer() = default;
+
+    ///
+    /// \brief Allocates the buffer.
+    ///
+    /// \param width The width in texels, a multiple of
+    ///        OCCLUSION_BUFFER_ALIGNMENT.
+    /// \param height The height in texels.
+    /// \return Returns false if the size is not supported.
+    ///
+    bool initialize(uint32_t width, uint32_t height);
+
+    ///
+    /// \brief Sets every texel to the far depth 1 and the counters to 0.
+    ///
+    void clear();
+
+    ///
+    /// \brief Rasterizes the front-facing triangles of a mesh as occluders.
+    ///
+    /// A texel is written if a triangle covers its center, with the farthest
+    /// depth of the triangle. Before the next test the buffer is eroded by one
+    /// texel, each texel takes the farthest depth of its 3x3 neighbourhood, so
+    /// that the texels on the silhouette of the occluders, which are partly
+    /// covered, are cleared. Triangles that cross the near plane are skipped.
+    /// Occluders should be meshes that cover much of the screen, such as
+    /// simplified walls, floors and large models.
+    ///
+    /// \param mesh The occluder.
+    /// \param local2clip The matrix that transforms the mesh to clip space.
+    ///
+    void draw_occluder(const Mesh &mesh, const matrix4x4 &local2clip);
+
+    ///
+    /// \brief Fills the buffer with the farthest depth of each block of a full
+    ///        resolution depth buffer, e.g. that of the previous frame.
+    ///
+    /// The depth buffer must be in TEXTURE_FORMAT_DEPTH_FLOAT and resolved, see
+    /// FrameBuffer::resolve(). The result is only conservative for the camera
+    /// that rendered the depth: if the camera has moved since, models that
+    /// came into view may be culled for one frame.
+    ///
+    /// \return Returns false if the depth buffer is not supported.
+    ///
+    bool load_depth(const Texture &depth_buffer);
+
+    ///
+    /// \brief Tests whether a box may be visible.
+    ///
+    /// Projects the corners of the box and compares its nearest depth to the
+    /// texels of its screen rectangle. A box that crosses the near plane is
+    /// always visible. Erodes the occluders drawn since the last test first.
+    /// Counts the test, see m_tested_count and m_culled_count.
+    ///
+    /// \param box The box, in the space local2clip transforms from.
+    /// \param local2clip The matrix that transforms the box to clip space.
+    /// \return Returns false if the box is hidden by the occluders or outside
+    ///         the viewport.
+    ///
+    bool is_visible(const axis_aligned_box &box, const matrix4x4 &local2clip);
+
+    ///
+    /// \brief Tests whether a sphere may be visible, by the box around it.
+    ///
+    bool is_visible(const bounding_sphere &sphere, const matrix4x4 &local2clip);
+};
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include "graphics/texture.h"
+
+// A texture container stores the pixels of a texture exactly as Texture keeps
+// them in memory: same format, same row order (bottom row first), no padding.
+// Loading a container therefore needs no decoding, the file is memory mapped
+// and the texture views the mapped pixels directly.
+//
+// Layout, all fields little endian:
+//   0  char     magic[4] = "FTEX"
+//   4  uint32_t version
+//   8  uint32_t format (texture_format)
+//  12  uint32_t width
+//  16  uint32_t height
+//  20  uint32_t mip_count, always 1 for now
+//  24  uint32_t tiling, always 0 (linear rows) for now
+//  28  uint32_t data_offset
+//  32  uint64_t data_size
+//  40  uint64_t source_size, size of the file the texture was converted from
+//  48  int64_t  source_time, modification time of that file
+//  56  reserved, zero
+//  64  pixel data
+
+#define TEXTURE_CONTAINER_VERSION 1
+#define TEXTURE_CONTAINER_HEADER_SIZE 64
+
+///
+/// \brief Saves the texture as a texture container file.
+///
+/// \param texture The texture to save.
+/// \param filename The file to save to.
+/// \param source_size The size of the file the texture was converted from,
+///        0 if there is none.
+/// \param source_time The modification time of the file the texture was
+///        converted from, 0 if there is none.
+/// \return Returns true on success, false on failure.
+///
+bool save_texture_container(const Texture &texture, std::string_view filename,
+                            uint64_t source_size, int64_t source_time);
+
+///
+/// \brief Maps a texture container file into memory.
+///
+/// The returned texture views the mapped file, the mapping is released when
+/// the texture is destroyed. The mapping is private, writing to the pixels
+/// does not modify the file.
+///
+/// \param filename The texture container file to load.
+/// \param source_size If not 0, the container is rejected unless it was
+///        converted from a file of this size.
+/// \param source_time If source_size is not 0, the container is rejected
+///        unless it was converted from a file with this modification time.
+/// \return Returns a texture pointer on success, null pointer on failure.
+///
+std::unique_ptr<Texture> map_texture_container(std::string_view filename,
+                                               uint64_t source_size, int64_t source_time);
+
+///
+/// \brief Whether load_image_cached() block compresses the image, see
+///        texture_compression.h.
+///
+enum class texture_cache_compression : uint8_t
+{
+    ///
+    /// The texture keeps the format of the image.
+    ///
+    TEXTURE_CACHE_UNCOMPRESSED,
+    ///
+    /// Color and single channel maps: single channel images become
+    /// TEXTURE_FORMAT_BC4, the others TEXTURE_FORMAT_BC1, or
+    /// TEXTURE_FORMAT_BC1_SRGB if they are sRGB encoded. Alpha is discarded.
+    ///
+    TEXTURE_CACHE_COLOR,
+    ///
+    /// Tangent space normal maps, which become TEXTURE_FORMAT_BC5.
+    ///
+    TEXTURE_CACHE_NORMAL
+};
+
+///
+/// \brief Loads a TGA image through the texture cache.
+///
+/// On first use the image is loaded with load_image(), compressed if asked
+/// to, and saved as a texture container in cache_directory. Later calls map
+/// the container instead of decoding and compressing the image again, as long
+/// as the size and modification time of the TGA file have not changed. If the
+/// cache can not be written, the texture is still returned.
+///
+/// \param filename The TGA file to load.
+/// \param is_srgb_encoding Whether the pixel value is sRGB encoded.
+/// \param cache_directory The directory to keep the containers in, created if
+///        it does not exist. If empty, the cache is not used.
+/// \param compression Whether to block compress the texture. If the image can
+///        not be compressed, the uncompressed texture is returned.
+/// \return Returns a texture pointer on success, null pointer on failure.
+///
+std::unique_ptr<Texture> load_image_cached(std::string_view filename, bool is_srgb_encoding,
+                                           std::string_view cache_directory,
+                                           texture_cache_compression compression =
+                                               texture_cache_compression::TEXTURE_CACHE_UNCOMPRESSED);
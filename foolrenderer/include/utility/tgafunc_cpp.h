@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <cstdint>
+#include <fstream>
+#include <string>
 #include <string_view>
 
 namespace tga
@@ -64,12 +66,32 @@ namespace tga
         tga_pixel_format pixel_format;
     };
 
+    ///
+    /// \brief Transformations applied while an image is decoded, at no extra
+    ///        cost compared to a plain load.
+    ///
+    struct tga_load_options
+    {
+        ///
+        /// \brief Store the rows bottom-up, so the first pixel is the
+        /// bottom-left corner of the image. By default the first pixel is the
+        /// upper-left corner.
+        ///
+        bool bottom_left_origin{false};
+        ///
+        /// \brief Swap the 1st and 3rd components of TGA_PIXEL_RGB24 and
+        /// TGA_PIXEL_ARGB32 pixels, giving RGB(A) order instead of the
+        /// little-endian BGR(A) order described in tga_pixel_format.
+        ///
+        bool swap_red_blue{false};
+    };
+
     class Image
     {
     public:
         Image(int width, int height, tga_pixel_format format);
-        Image(std::string_view filepath);
-        bool load(std::string_view filepath);
+        Image(std::string_view filepath, const tga_load_options &options = {});
+        bool load(std::string_view filepath, const tga_load_options &options = {});
         bool save(std::string_view filename);
 
         void flip_h();
@@ -92,4 +114,61 @@ namespace tga
         tga_info img_info;
         tga_error err{tga_error::TGA_NO_ERROR};
     };
+
+    ///
+    /// \brief Converts a row of RGB or RGBA pixels to the component order of a
+    ///        TGA_PIXEL_RGB24 or TGA_PIXEL_ARGB32 image.
+    ///
+    /// If the source has no alpha and the destination does, alpha is set to
+    /// 0xFF. Uses SSSE3 byte shuffles for RGBA sources when the CPU supports
+    /// them.
+    ///
+    /// \param src The source pixels.
+    /// \param component_count The number of components of a source pixel, 3
+    ///        or 4.
+    /// \param dst The converted pixels.
+    /// \param format TGA_PIXEL_RGB24 or TGA_PIXEL_ARGB32.
+    /// \param pixel_count The number of pixels in the row.
+    ///
+    void convert_rgb_row(const uint8_t *src, int component_count, uint8_t *dst, tga_pixel_format format,
+                         int pixel_count);
+
+    ///
+    /// \brief Writes a TGA file row by row, without an image in memory.
+    ///
+    /// Rows are written in the order they are given, the first row is the
+    /// bottom row if bottom_left_origin is set, otherwise the top row. With
+    /// rle set, each row is run-length encoded as it is written. The file is
+    /// complete once all rows are written and finish() is called, a file that
+    /// is incomplete or failed to write is removed.
+    ///
+    class ImageWriter
+    {
+    public:
+        ImageWriter(std::string_view filepath, int width, int height, tga_pixel_format format,
+                    bool rle, bool bottom_left_origin);
+        ~ImageWriter();
+
+        ImageWriter(const ImageWriter &) = delete;
+        ImageWriter &operator=(const ImageWriter &) = delete;
+
+        // Writes a row of pixels that are already in the image pixel format.
+        bool write_row(const uint8_t *row);
+        // Writes a row of RGB or RGBA pixels, converted with convert_rgb_row().
+        bool write_rgb_row(const uint8_t *row, int component_count);
+        bool finish();
+
+        tga_error last_error() const;
+
+    private:
+        std::string filepath;
+        std::ofstream stream;
+        tga_info img_info;
+        int pixel_size{0};
+        bool rle;
+        uint16_t rows_written{0};
+        std::vector<uint8_t> row_buffer;
+        std::vector<uint8_t> encode_buffer;
+        tga_error err{tga_error::TGA_NO_ERROR};
+    };
 }
\ No newline at end of file
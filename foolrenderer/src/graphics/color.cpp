@@ -0,0 +1,130 @@
+#include "graphics/color.h"
+#include "rmath/base_util.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLOR_USE_SSE2
+#endif
+
+// The reference encoder that all lookup tables must agree with.
+static uint8_t encode_srgb8_reference(float value)
+{
+    return float_to_uint8(convert_to_srgb_color(value));
+}
+
+// Finds the smallest float in [0,1] whose encoded value is at least code. The
+// bit patterns of non-negative floats are ordered the same as their values, so
+// a binary search over the bit patterns finds the exact boundary.
+static float find_srgb8_threshold(uint32_t code)
+{
+    uint32_t low = 0;
+    float one = 1.0f;
+    uint32_t high;
+    memcpy(&high, &one, sizeof(float));
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        float value;
+        memcpy(&value, &middle, sizeof(float));
+        if (encode_srgb8_reference(value) >= code)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    float threshold;
+    memcpy(&threshold, &low, sizeof(float));
+    return threshold;
+}
+
+static color_conversion_tables build_color_conversion_tables()
+{
+    color_conversion_tables tables;
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        tables.srgb8_to_linear[i] = convert_to_linear_color(uint8_to_float((uint8_t)i));
+    }
+
+    tables.srgb8_thresholds[0] = 0.0f;
+    for (uint32_t code = 1; code < 256; code++)
+    {
+        tables.srgb8_thresholds[code] = find_srgb8_threshold(code);
+    }
+    tables.srgb8_thresholds[256] = INFINITY;
+
+    for (uint32_t i = 0; i < SRGB_ENCODE_TABLE_SIZE; i++)
+    {
+        // Step one ulp down from the start of the bucket, so that every value
+        // falling into this bucket is encoded to at least the stored value.
+        float start = nextafterf((float)i / (SRGB_ENCODE_TABLE_SIZE - 1), 0.0f);
+        tables.srgb8_buckets[i] = encode_srgb8_reference(start);
+    }
+    return tables;
+}
+
+const color_conversion_tables color_tables = build_color_conversion_tables();
+
+void linear_row_to_rgba8(const float *src, uint8_t *dst, size_t pixel_count,
+                         bool is_srgb_encoding)
+{
+    size_t p = 0;
+#ifdef COLOR_USE_SSE2
+    // Clamp a whole pixel at once. The table lookups themselves cannot be
+    // vectorized without gather instructions, so they stay scalar.
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (; p < pixel_count; p++)
+    {
+        __m128 color = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src), zero), one);
+        alignas(16) float clamped[4];
+        _mm_store_ps(clamped, color);
+        if (is_srgb_encoding)
+        {
+            dst[0] = linear_to_srgb8(clamped[0]);
+            dst[1] = linear_to_srgb8(clamped[1]);
+            dst[2] = linear_to_srgb8(clamped[2]);
+            dst[3] = float_to_uint8(clamped[3]);
+        }
+        else
+        {
+            // Truncation, same as float_to_uint8().
+            __m128i bytes = _mm_cvttps_epi32(_mm_mul_ps(color, scale));
+            bytes = _mm_packs_epi32(bytes, bytes);
+            bytes = _mm_packus_epi16(bytes, bytes);
+            uint32_t packed = (uint32_t)_mm_cvtsi128_si32(bytes);
+            memcpy(dst, &packed, sizeof(uint32_t));
+        }
+        src += 4;
+        dst += 4;
+    }
+#endif
+    for (; p < pixel_count; p++)
+    {
+        float r = clamp01(src[0]);
+        float g = clamp01(src[1]);
+        float b = clamp01(src[2]);
+        float a = clamp01(src[3]);
+        if (is_srgb_encoding)
+        {
+            dst[0] = linear_to_srgb8(r);
+            dst[1] = linear_to_srgb8(g);
+            dst[2] = linear_to_srgb8(b);
+        }
+        else
+        {
+            dst[0] = float_to_uint8(r);
+            dst[1] = float_to_uint8(g);
+            dst[2] = float_to_uint8(b);
+        }
+        dst[3] = float_to_uint8(a);
+        src += 4;
+        dst += 4;
+    }
+}
+
+#undef COLOR_USE_SSE2
@@ -0,0 +1,205 @@
+#include "graphics/depth_compression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+enum depth_tile_mode : uint32_t
+{
+    DEPTH_TILE_CONSTANT = 0,
+    DEPTH_TILE_PLANE = 1,
+    DEPTH_TILE_MIN_MAX = 2,
+    DEPTH_TILE_RAW = 3
+};
+
+#define DEPTH_TILE_MODE_SHIFT 30
+#define DEPTH_TILE_OFFSET_MASK ((1u << DEPTH_TILE_MODE_SHIFT) - 1)
+
+// The payload of a plane tile: base depth at the bottom-left pixel of the tile
+// and the depth step per pixel along x and y, in 16-bit depth units.
+struct depth_plane
+{
+    float base, dx, dy;
+};
+
+static inline uint16_t evaluate_plane(const depth_plane &plane, uint32_t x, uint32_t y)
+{
+    float depth = plane.base + plane.dx * x + plane.dy * y;
+    return (uint16_t)std::min(std::max(floorf(depth + 0.5f), 0.0f), 65535.0f);
+}
+
+// Least squares fit of a plane to the tile, returns true if the rounded plane
+// reproduces every value of the tile.
+static bool fit_plane(const uint16_t *tile, uint32_t width, uint32_t height, depth_plane &plane)
+{
+    if (width < 2 || height < 2)
+    {
+        return false;
+    }
+    // The pixel coordinates of a full grid are uncorrelated, so the slopes
+    // along x and y can be fitted separately around the centroid.
+    double mean_x = (width - 1) * 0.5;
+    double mean_y = (height - 1) * 0.5;
+    double mean = 0.0, sum_xz = 0.0, sum_yz = 0.0, sum_xx = 0.0, sum_yy = 0.0;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            double z = tile[y * width + x];
+            mean += z;
+            sum_xz += (x - mean_x) * z;
+            sum_yz += (y - mean_y) * z;
+            sum_xx += (x - mean_x) * (x - mean_x);
+            sum_yy += (y - mean_y) * (y - mean_y);
+        }
+    }
+    mean /= (double)width * height;
+    double dx = sum_xz / sum_xx;
+    double dy = sum_yz / sum_yy;
+    plane.base = (float)(mean - dx * mean_x - dy * mean_y);
+    plane.dx = (float)dx;
+    plane.dy = (float)dy;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            if (evaluate_plane(plane, x, y) != tile[y * width + x])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::unique_ptr<Texture> compress_depth(const Texture &source, depth_compression_stats *stats)
+{
+    if (source.m_format != texture_format::TEXTURE_FORMAT_DEPTH16 || source.m_width == 0 || source.m_height == 0)
+    {
+        return nullptr;
+    }
+    uint32_t tile_columns = (source.m_width + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+    uint32_t tile_rows = (source.m_height + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+    size_t tile_count = (size_t)tile_columns * tile_rows;
+    std::vector<uint8_t> data(tile_count * sizeof(uint32_t));
+    depth_compression_stats counts{};
+
+    const uint16_t *pixels = (const uint16_t *)source.get_pixels();
+    uint16_t tile[DEPTH_TILE_SIZE * DEPTH_TILE_SIZE];
+    for (uint32_t tile_y = 0; tile_y < tile_rows; tile_y++)
+    {
+        for (uint32_t tile_x = 0; tile_x < tile_columns; tile_x++)
+        {
+            uint32_t x_min = tile_x * DEPTH_TILE_SIZE;
+            uint32_t y_min = tile_y * DEPTH_TILE_SIZE;
+            uint32_t width = std::min<uint32_t>(DEPTH_TILE_SIZE, source.m_width - x_min);
+            uint32_t height = std::min<uint32_t>(DEPTH_TILE_SIZE, source.m_height - y_min);
+            uint16_t min_depth = UINT16_MAX;
+            uint16_t max_depth = 0;
+            for (uint32_t y = 0; y < height; y++)
+            {
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    uint16_t depth = pixels[(size_t)(y_min + y) * source.m_width + x_min + x];
+                    tile[y * width + x] = depth;
+                    min_depth = std::min(min_depth, depth);
+                    max_depth = std::max(max_depth, depth);
+                }
+            }
+
+            size_t offset = data.size();
+            if (offset > DEPTH_TILE_OFFSET_MASK)
+            {
+                return nullptr;
+            }
+            uint32_t mode;
+            depth_plane plane;
+            if (min_depth == max_depth)
+            {
+                mode = DEPTH_TILE_CONSTANT;
+                data.resize(offset + sizeof(uint16_t));
+                memcpy(data.data() + offset, &min_depth, sizeof(uint16_t));
+                counts.constant_tiles++;
+            }
+            else if (fit_plane(tile, width, height, plane))
+            {
+                mode = DEPTH_TILE_PLANE;
+                data.resize(offset + sizeof(depth_plane));
+                memcpy(data.data() + offset, &plane, sizeof(depth_plane));
+                counts.plane_tiles++;
+            }
+            else if (max_depth - min_depth <= UINT8_MAX)
+            {
+                mode = DEPTH_TILE_MIN_MAX;
+                data.resize(offset + sizeof(uint16_t) + width * height);
+                memcpy(data.data() + offset, &min_depth, sizeof(uint16_t));
+                uint8_t *deltas = data.data() + offset + sizeof(uint16_t);
+                for (uint32_t i = 0; i < width * height; i++)
+                {
+                    deltas[i] = (uint8_t)(tile[i] - min_depth);
+                }
+                counts.min_max_tiles++;
+            }
+            else
+            {
+                mode = DEPTH_TILE_RAW;
+                data.resize(offset + sizeof(uint16_t) * width * height);
+                memcpy(data.data() + offset, tile, sizeof(uint16_t) * width * height);
+                counts.raw_tiles++;
+            }
+            uint32_t entry = mode << DEPTH_TILE_MODE_SHIFT | (uint32_t)offset;
+            memcpy(data.data() + ((size_t)tile_y * tile_columns + tile_x) * sizeof(uint32_t), &entry,
+                   sizeof(uint32_t));
+        }
+    }
+
+    auto texture = std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_DEPTH16_TILED, source.m_width,
+                                             source.m_height);
+    texture->set_texture_pixels(std::move(data));
+    if (stats)
+    {
+        *stats = counts;
+    }
+    return texture;
+}
+
+float sample_compressed_depth(const Texture &texture, uint32_t x, uint32_t y)
+{
+    const uint8_t *data = texture.get_pixels();
+    uint32_t tile_columns = (texture.m_width + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+    uint32_t tile_x = x / DEPTH_TILE_SIZE;
+    uint32_t tile_y = y / DEPTH_TILE_SIZE;
+    uint32_t entry;
+    memcpy(&entry, data + ((size_t)tile_y * tile_columns + tile_x) * sizeof(uint32_t), sizeof(uint32_t));
+    const uint8_t *payload = data + (entry & DEPTH_TILE_OFFSET_MASK);
+
+    uint32_t local_x = x - tile_x * DEPTH_TILE_SIZE;
+    uint32_t local_y = y - tile_y * DEPTH_TILE_SIZE;
+    uint32_t width = std::min<uint32_t>(DEPTH_TILE_SIZE, texture.m_width - tile_x * DEPTH_TILE_SIZE);
+    uint32_t index = local_y * width + local_x;
+    uint16_t depth;
+    switch (entry >> DEPTH_TILE_MODE_SHIFT)
+    {
+    case DEPTH_TILE_CONSTANT:
+        memcpy(&depth, payload, sizeof(uint16_t));
+        break;
+    case DEPTH_TILE_PLANE:
+    {
+        depth_plane plane;
+        memcpy(&plane, payload, sizeof(depth_plane));
+        depth = evaluate_plane(plane, local_x, local_y);
+        break;
+    }
+    case DEPTH_TILE_MIN_MAX:
+        memcpy(&depth, payload, sizeof(uint16_t));
+        depth += payload[sizeof(uint16_t) + index];
+        break;
+    default:
+        memcpy(&depth, payload + index * sizeof(uint16_t), sizeof(uint16_t));
+        break;
+    }
+    return depth16_to_float(depth);
+}
+
+#undef DEPTH_TILE_MODE_SHIFT
+#undef DEPTH_TILE_OFFSET_MASK
@@ -1,8 +1,19 @@
 #include "graphics/framebuffer.h"
+#include <algorithm>
+#include <cstring>
+#include "graphics/color.h"
+#include "graphics/profiler.h"
+#include "rmath/rsimd.h"
 
 inline static uint8_t clear_color[4]{0};
 
-FrameBuffer::FrameBuffer() : m_width(0), m_height(0), color_buffer(nullptr), depth_buffer(nullptr) {}
+// Bits of tile_clear_flags.
+#define COLOR_CLEAR_FLAG (1 << 0)
+#define DEPTH_CLEAR_FLAG (1 << 1)
+
+FrameBuffer::FrameBuffer()
+    : m_width(0), m_height(0), color_buffer(nullptr), depth_buffer(nullptr), m_sample_count(1),
+      color_samples(nullptr), depth_samples(nullptr), m_tile_columns(0), m_tile_rows(0), m_cleared_tile_count(0), m_clear_color{0}, m_clear_color_float{} {}
 
 // This macro is used in attach_texture to update width and height
 #define SET_MIN_SIZE(buffer)                              \
@@ -26,14 +37,17 @@ bool FrameBuffer::attach_texture(attachment_type attachment, Texture *texture)
         {
         case attachment_type::COLOR_ATTACHMENT:
             if (texture->m_format == texture_format::TEXTURE_FORMAT_RGBA8 ||
-                texture->m_format == texture_format::TEXTURE_FORMAT_SRGB8_A8)
+                texture->m_format == texture_format::TEXTURE_FORMAT_SRGB8_A8 ||
+                texture->m_format == texture_format::TEXTURE_FORMAT_RGBA_FLOAT)
             {
                 color_buffer.reset(texture);
                 result = true;
             }
             break;
         case attachment_type::DEPTH_ATTACHMENT:
-            if (texture->m_format == texture_format::TEXTURE_FORMAT_DEPTH_FLOAT)
+            if (texture->m_format == texture_format::TEXTURE_FORMAT_DEPTH_FLOAT ||
+                texture->m_format == texture_format::TEXTURE_FORMAT_DEPTH16 ||
+                texture->m_format == texture_format::TEXTURE_FORMAT_DEPTH24)
             {
                 depth_buffer.reset(texture);
                 result = true;
@@ -71,6 +85,8 @@ bool FrameBuffer::attach_texture(attachment_type attachment, Texture *texture)
             SET_MIN_SIZE(color_buffer);
             SET_MIN_SIZE(depth_buffer);
         }
+        reset_tiles();
+        reset_samples();
     }
     return result;
 }
@@ -84,14 +100,17 @@ bool FrameBuffer::attach_texture(attachment_type attachment, std::unique_ptr<Tex
         {
         case attachment_type::COLOR_ATTACHMENT:
             if (texture->m_format == texture_format::TEXTURE_FORMAT_RGBA8 ||
-                texture->m_format == texture_format::TEXTURE_FORMAT_SRGB8_A8)
+                texture->m_format == texture_format::TEXTURE_FORMAT_SRGB8_A8 ||
+                texture->m_format == texture_format::TEXTURE_FORMAT_RGBA_FLOAT)
             {
                 color_buffer.swap(texture);
                 result = true;
             }
             break;
         case attachment_type::DEPTH_ATTACHMENT:
-            if (texture->m_format == texture_format::TEXTURE_FORMAT_DEPTH_FLOAT)
+            if (texture->m_format == texture_format::TEXTURE_FORMAT_DEPTH_FLOAT ||
+                texture->m_format == texture_format::TEXTURE_FORMAT_DEPTH16 ||
+                texture->m_format == texture_format::TEXTURE_FORMAT_DEPTH24)
             {
                 depth_buffer.swap(texture);
                 result = true;
@@ -129,6 +148,8 @@ bool FrameBuffer::attach_texture(attachment_type attachment, std::unique_ptr<Tex
             SET_MIN_SIZE(color_buffer);
             SET_MIN_SIZE(depth_buffer);
         }
+        reset_tiles();
+        reset_samples();
     }
     return result;
 }
@@ -151,38 +172,394 @@ void FrameBuffer::set_clear_color(float red, float green, float blue, float alph
     clear_color[3] = float_to_uint8(clamp01(alpha));
 }
 
+bool FrameBuffer::set_sample_count(uint32_t sample_count)
+{
+    if (sample_count != 1 && sample_count != MSAA_SAMPLE_COUNT)
+    {
+        return false;
+    }
+    if (sample_count == m_sample_count)
+    {
+        return true;
+    }
+    m_sample_count = sample_count;
+    reset_tiles();
+    reset_samples();
+    return true;
+}
+
 /*
     \brief Uses preset values to clear all buffers in the framebuffer.
         Each pixel of the color buffer will be cleared using the value previously
         set via the set_clear_color() function. For depth buffers, a fixed value of
         1 will be used to clear each pixel. If framebuffer is a null pointer, the
         function does nothing.
+        The pixels are not written here, the clear is deferred per tile
+        until the tile is accessed or resolve() is called.
 
     \param framebuffer Pointer to the framebuffer to clear.
 */
 void FrameBuffer::clear()
 {
-    size_t pixel_cnt = m_width * m_height;
-    if (color_buffer)
+    PROFILE_ZONE("clear framebuffer");
+    uint8_t flags = (color_buffer ? COLOR_CLEAR_FLAG : 0) | (depth_buffer ? DEPTH_CLEAR_FLAG : 0);
+    memcpy(m_clear_color, clear_color, 4);
+    // The 8-bit clear color is stored as is in RGBA8 and SRGB8_A8 buffers. A
+    // float buffer holds linear values that are sRGB encoded when resolved,
+    // so store the value that encodes back to the same bytes.
+    m_clear_color_float = vec4{srgb8_to_linear(clear_color[0]), srgb8_to_linear(clear_color[1]),
+                               srgb8_to_linear(clear_color[2]), uint8_to_float(clear_color[3])};
+    std::fill(tile_clear_flags.begin(), tile_clear_flags.end(), flags);
+    m_cleared_tile_count = flags != 0 ? (uint32_t)tile_clear_flags.size() : 0;
+}
+
+// Fills the pixels [x_min, x_min + width) of the rows [y_min, y_max) of a
+// color texture with the clear value of its format.
+static void fill_color(Texture &texture, const uint8_t color[4], const vec4 &color_float, uint32_t x_min,
+                       uint32_t width, uint32_t y_min, uint32_t y_max)
+{
+    uint32_t row_length = texture.m_width;
+    if (texture.m_format == texture_format::TEXTURE_FORMAT_RGBA_FLOAT)
     {
-        uint8_t *pixels = color_buffer->get_pixels();
-        for (size_t i = 0; i < pixel_cnt; i++)
+        vec4 *pixels = (vec4 *)texture.get_pixels();
+        for (uint32_t y = y_min; y < y_max; y++)
         {
-            uint8_t *pixel = pixels + i * 4;
-            pixel[0] = clear_color[0];
-            pixel[1] = clear_color[1];
-            pixel[2] = clear_color[2];
-            pixel[3] = clear_color[3];
+            std::fill_n(pixels + (size_t)y * row_length + x_min, width, color_float);
         }
     }
-    if (depth_buffer)
+    else
+    {
+        uint32_t value;
+        memcpy(&value, color, 4);
+        uint32_t *pixels = (uint32_t *)texture.get_pixels();
+        for (uint32_t y = y_min; y < y_max; y++)
+        {
+            std::fill_n(pixels + (size_t)y * row_length + x_min, width, value);
+        }
+    }
+}
+
+// Fills the pixels [x_min, x_min + width) of the rows [y_min, y_max) of a
+// depth texture with 1.
+static void fill_depth(Texture &texture, uint32_t x_min, uint32_t width, uint32_t y_min, uint32_t y_max)
+{
+    uint32_t row_length = texture.m_width;
+    uint8_t *pixels = texture.get_pixels();
+    for (uint32_t y = y_min; y < y_max; y++)
+    {
+        size_t row_offset = (size_t)y * row_length + x_min;
+        switch (texture.m_format)
+        {
+        case texture_format::TEXTURE_FORMAT_DEPTH16:
+            std::fill_n((uint16_t *)pixels + row_offset, width, UINT16_MAX);
+            break;
+        case texture_format::TEXTURE_FORMAT_DEPTH24:
+            // 1 is all bits set.
+            memset(pixels + row_offset * 3, 0xFF, (size_t)width * 3);
+            break;
+        default:
+            std::fill_n((float *)pixels + row_offset, width, 1.0f);
+            break;
+        }
+    }
+}
+
+// The resolve functions below add the samples of a pixel pairwise.
+static_assert(MSAA_SAMPLE_COUNT == 4, "The sample resolve expects 4 samples per pixel.");
+
+// Averages the samples of the pixels [x_begin, x_end) of row y.
+static void resolve_color_row(const Texture &samples, Texture &target, uint32_t x_begin, uint32_t x_end, uint32_t y)
+{
+    size_t first_pixel = (size_t)y * target.m_width + x_begin;
+    uint32_t count = x_end - x_begin;
+    if (target.m_format == texture_format::TEXTURE_FORMAT_RGBA_FLOAT)
+    {
+        const float *src = (const float *)samples.get_pixels() + first_pixel * MSAA_SAMPLE_COUNT * 4;
+        float *dst = (float *)target.get_pixels() + first_pixel * 4;
+        for (uint32_t i = 0; i < count; i++, src += MSAA_SAMPLE_COUNT * 4, dst += 4)
+        {
+#ifdef RMATH_SIMD
+            // One pixel is one vector.
+            simd4f sum = simd4f_add(simd4f_add(simd4f_load(src), simd4f_load(src + 4)),
+                                    simd4f_add(simd4f_load(src + 8), simd4f_load(src + 12)));
+            simd4f_store(dst, simd4f_mul(sum, simd4f_set1(0.25f)));
+#else
+            for (int c = 0; c < 4; c++)
+            {
+                dst[c] = ((src[c] + src[4 + c]) + (src[8 + c] + src[12 + c])) * 0.25f;
+            }
+#endif
+        }
+        return;
+    }
+    const uint8_t *src = samples.get_pixels() + first_pixel * MSAA_SAMPLE_COUNT * 4;
+    uint8_t *dst = target.get_pixels() + first_pixel * 4;
+    bool is_srgb = target.m_format == texture_format::TEXTURE_FORMAT_SRGB8_A8;
+    uint32_t i = 0;
+#ifdef RMATH_SIMD
+    if (is_srgb)
+    {
+        // One pixel is one vector. The color components of each sample are
+        // decoded once, alpha is kept as its byte value, so that rounding
+        // the average gives the same result as the integer path below. The
+        // table lookups of the decoding and the encoding stay scalar.
+        for (; i < count; i++, src += MSAA_SAMPLE_COUNT * 4, dst += 4)
+        {
+            simd4f sample_values[MSAA_SAMPLE_COUNT];
+            for (int s = 0; s < MSAA_SAMPLE_COUNT; s++)
+            {
+                const uint8_t *sample = src + s * 4;
+                float values[4] = {srgb8_to_linear(sample[0]), srgb8_to_linear(sample[1]),
+                                   srgb8_to_linear(sample[2]), (float)sample[3]};
+                sample_values[s] = simd4f_load(values);
+            }
+            simd4f sum = simd4f_add(simd4f_add(sample_values[0], sample_values[1]),
+                                    simd4f_add(sample_values[2], sample_values[3]));
+            float average[4];
+            simd4f_store(average, simd4f_mul(sum, simd4f_set1(0.25f)));
+            dst[0] = linear_to_srgb8(average[0]);
+            dst[1] = linear_to_srgb8(average[1]);
+            dst[2] = linear_to_srgb8(average[2]);
+            dst[3] = (uint8_t)(average[3] + 0.5f);
+        }
+    }
+#endif
+#ifdef RMATH_SSE
+    if (!is_srgb)
+    {
+        // The 4 samples of a pixel are 16 bytes, widened to 16 bits and
+        // summed per component.
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi16(2);
+        for (; i < count; i++, src += MSAA_SAMPLE_COUNT * 4, dst += 4)
+        {
+            __m128i pixel_samples = _mm_loadu_si128((const __m128i *)src);
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi8(pixel_samples, zero),
+                                        _mm_unpackhi_epi8(pixel_samples, zero));
+            sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+            uint32_t packed = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+            memcpy(dst, &packed, sizeof(uint32_t));
+        }
+    }
+#endif
+    for (; i < count; i++, src += MSAA_SAMPLE_COUNT * 4, dst += 4)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            if (is_srgb && c < 3)
+            {
+                float sum = (srgb8_to_linear(src[c]) + srgb8_to_linear(src[4 + c])) +
+                            (srgb8_to_linear(src[8 + c]) + srgb8_to_linear(src[12 + c]));
+                dst[c] = linear_to_srgb8(sum * 0.25f);
+            }
+            else
+            {
+                dst[c] = (uint8_t)((src[c] + src[4 + c] + src[8 + c] + src[12 + c] + 2) >> 2);
+            }
+        }
+    }
+}
+
+// Writes the nearest sample of the pixels [x_begin, x_end) of row y.
+static void resolve_depth_row(const Texture &samples, Texture &target, uint32_t x_begin, uint32_t x_end, uint32_t y)
+{
+    size_t first_pixel = (size_t)y * target.m_width + x_begin;
+    uint32_t count = x_end - x_begin;
+    switch (target.m_format)
+    {
+    case texture_format::TEXTURE_FORMAT_DEPTH16:
+    {
+        const uint16_t *src = (const uint16_t *)samples.get_pixels() + first_pixel * MSAA_SAMPLE_COUNT;
+        uint16_t *dst = (uint16_t *)target.get_pixels() + first_pixel;
+        for (uint32_t i = 0; i < count; i++, src += MSAA_SAMPLE_COUNT)
+        {
+            dst[i] = std::min(std::min(src[0], src[1]), std::min(src[2], src[3]));
+        }
+        break;
+    }
+    case texture_format::TEXTURE_FORMAT_DEPTH24:
     {
-        float *pixels = (float *)depth_buffer->get_pixels();
-        for (size_t i = 0; i < pixel_cnt; i++)
+        const uint8_t *src = samples.get_pixels() + first_pixel * MSAA_SAMPLE_COUNT * 3;
+        uint8_t *dst = target.get_pixels() + first_pixel * 3;
+        for (uint32_t i = 0; i < count; i++, dst += 3)
         {
-            pixels[i] = 1.0f;
+            uint32_t nearest = UINT32_MAX;
+            for (int s = 0; s < MSAA_SAMPLE_COUNT; s++, src += 3)
+            {
+                nearest = std::min(nearest, src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16);
+            }
+            dst[0] = (uint8_t)nearest;
+            dst[1] = (uint8_t)(nearest >> 8);
+            dst[2] = (uint8_t)(nearest >> 16);
+        }
+        break;
+    }
+    default:
+    {
+        const float *src = (const float *)samples.get_pixels() + first_pixel * MSAA_SAMPLE_COUNT;
+        float *dst = (float *)target.get_pixels() + first_pixel;
+        for (uint32_t i = 0; i < count; i++, src += MSAA_SAMPLE_COUNT)
+        {
+            dst[i] = std::min(std::min(src[0], src[1]), std::min(src[2], src[3]));
+        }
+        break;
+    }
+    }
+}
+
+// Resolves the samples of a multisampled framebuffer to the attached texture,
+// tile by tile. The pending clears stay pending for the samples.
+static void resolve_samples(FrameBuffer &framebuffer, attachment_type attachment, uint8_t mask)
+{
+    bool is_color = attachment == attachment_type::COLOR_ATTACHMENT;
+    Texture *target = is_color ? framebuffer.color_buffer.get() : framebuffer.depth_buffer.get();
+    Texture *samples = is_color ? framebuffer.color_samples.get() : framebuffer.depth_samples.get();
+    if (target == nullptr || samples == nullptr)
+    {
+        return;
+    }
+    for (uint32_t tile_y = 0; tile_y < framebuffer.m_tile_rows; tile_y++)
+    {
+        uint32_t y_min = tile_y * FRAMEBUFFER_TILE_SIZE;
+        uint32_t y_max = std::min<uint32_t>(y_min + FRAMEBUFFER_TILE_SIZE, framebuffer.m_height);
+        for (uint32_t tile_x = 0; tile_x < framebuffer.m_tile_columns; tile_x++)
+        {
+            uint32_t x_min = tile_x * FRAMEBUFFER_TILE_SIZE;
+            uint32_t x_max = std::min<uint32_t>(x_min + FRAMEBUFFER_TILE_SIZE, framebuffer.m_width);
+            if (framebuffer.tile_clear_flags[(size_t)tile_y * framebuffer.m_tile_columns + tile_x] & mask)
+            {
+                if (is_color)
+                {
+                    fill_color(*target, framebuffer.m_clear_color, framebuffer.m_clear_color_float, x_min,
+                               x_max - x_min, y_min, y_max);
+                }
+                else
+                {
+                    fill_depth(*target, x_min, x_max - x_min, y_min, y_max);
+                }
+                continue;
+            }
+            for (uint32_t y = y_min; y < y_max; y++)
+            {
+                if (is_color)
+                {
+                    resolve_color_row(*samples, *target, x_min, x_max, y);
+                }
+                else
+                {
+                    resolve_depth_row(*samples, *target, x_min, x_max, y);
+                }
+            }
+        }
+    }
+}
+
+void FrameBuffer::resolve(attachment_type attachment)
+{
+    PROFILE_ZONE("resolve framebuffer");
+    uint8_t mask = attachment == attachment_type::COLOR_ATTACHMENT ? COLOR_CLEAR_FLAG : DEPTH_CLEAR_FLAG;
+    if (m_sample_count > 1)
+    {
+        resolve_samples(*this, attachment, mask);
+        return;
+    }
+    if (m_cleared_tile_count == 0)
+    {
+        return;
+    }
+    for (uint32_t tile_y = 0; tile_y < m_tile_rows; tile_y++)
+    {
+        // Fill runs of adjacent pending tiles together, so untouched areas
+        // are written with long contiguous stores.
+        const uint8_t *flags = tile_clear_flags.data() + (size_t)tile_y * m_tile_columns;
+        uint32_t tile_x = 0;
+        while (tile_x < m_tile_columns)
+        {
+            if ((flags[tile_x] & mask) == 0)
+            {
+                tile_x++;
+                continue;
+            }
+            uint32_t run_end = tile_x + 1;
+            while (run_end < m_tile_columns && (flags[run_end] & mask) != 0)
+            {
+                run_end++;
+            }
+            materialize_tiles(tile_x, run_end, tile_y, mask);
+            tile_x = run_end;
+        }
+    }
+}
+
+void FrameBuffer::materialize_tiles(uint32_t tile_x_begin, uint32_t tile_x_end, uint32_t tile_y,
+                                    uint8_t attachment_mask)
+{
+    uint8_t *flags = tile_clear_flags.data() + (size_t)tile_y * m_tile_columns;
+    uint8_t pending = 0;
+    for (uint32_t tile_x = tile_x_begin; tile_x < tile_x_end; tile_x++)
+    {
+        pending |= flags[tile_x] & attachment_mask;
+    }
+    if (pending == 0)
+    {
+        return;
+    }
+    // Callers only pass runs in which every tile has the same pending bits.
+    // In a multisampled framebuffer the samples are cleared, each pixel is
+    // m_sample_count elements wide.
+    uint32_t x_min = tile_x_begin * FRAMEBUFFER_TILE_SIZE;
+    uint32_t width = std::min<uint32_t>(tile_x_end * FRAMEBUFFER_TILE_SIZE, m_width) - x_min;
+    uint32_t y_min = tile_y * FRAMEBUFFER_TILE_SIZE;
+    uint32_t y_max = std::min<uint32_t>(y_min + FRAMEBUFFER_TILE_SIZE, m_height);
+    bool is_multisampled = m_sample_count > 1;
+    if (pending & COLOR_CLEAR_FLAG)
+    {
+        Texture &color = is_multisampled ? *color_samples : *color_buffer;
+        fill_color(color, m_clear_color, m_clear_color_float, x_min * m_sample_count, width * m_sample_count, y_min,
+                   y_max);
+    }
+    if (pending & DEPTH_CLEAR_FLAG)
+    {
+        Texture &depth = is_multisampled ? *depth_samples : *depth_buffer;
+        fill_depth(depth, x_min * m_sample_count, width * m_sample_count, y_min, y_max);
+    }
+    for (uint32_t tile_x = tile_x_begin; tile_x < tile_x_end; tile_x++)
+    {
+        flags[tile_x] &= ~pending;
+        if (flags[tile_x] == 0)
+        {
+            m_cleared_tile_count--;
         }
     }
 }
 
+void FrameBuffer::reset_tiles()
+{
+    m_tile_columns = (m_width + FRAMEBUFFER_TILE_SIZE - 1) / FRAMEBUFFER_TILE_SIZE;
+    m_tile_rows = (m_height + FRAMEBUFFER_TILE_SIZE - 1) / FRAMEBUFFER_TILE_SIZE;
+    tile_clear_flags.assign((size_t)m_tile_columns * m_tile_rows, 0);
+    m_cleared_tile_count = 0;
+}
+
+void FrameBuffer::reset_samples()
+{
+    color_samples.reset();
+    depth_samples.reset();
+    if (m_sample_count == 1)
+    {
+        return;
+    }
+    if (color_buffer)
+    {
+        color_samples = std::make_unique<Texture>(color_buffer->m_format, m_width * m_sample_count, m_height);
+    }
+    if (depth_buffer)
+    {
+        depth_samples = std::make_unique<Texture>(depth_buffer->m_format, m_width * m_sample_count, m_height);
+    }
+}
+
+#undef COLOR_CLEAR_FLAG
+#undef DEPTH_CLEAR_FLAG
 #undef SET_MIN_SIZE
\ No newline at end of file
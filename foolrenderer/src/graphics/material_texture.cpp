@@ -0,0 +1,187 @@
+#include "graphics/material_texture.h"
+#include "graphics/color.h"
+#include "graphics/profiler.h"
+#include "graphics/texture_compression.h"
+
+#define MATERIAL_TEXEL_SIZE 8
+
+// Returns the number of components of the supported source formats, returns 0
+// if the format can not be packed.
+static size_t get_component_count(texture_format format)
+{
+    switch (format)
+    {
+    case texture_format::TEXTURE_FORMAT_R8:
+        return 1;
+    case texture_format::TEXTURE_FORMAT_RGB8:
+    case texture_format::TEXTURE_FORMAT_SRGB8:
+        return 3;
+    case texture_format::TEXTURE_FORMAT_RGBA8:
+    case texture_format::TEXTURE_FORMAT_SRGB8_A8:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+// Reads the R, G and B components of the texel of source that covers the texel
+// (x, y) of a texture with the given size. A single channel texel is expanded
+// to the three components, the same as Texture::sample() does.
+static void fetch_texel(uint8_t result[3], const Texture *source, uint32_t x, uint32_t y,
+                        uint32_t width, uint32_t height)
+{
+    uint32_t source_x = (uint32_t)((uint64_t)x * source->m_width / width);
+    uint32_t source_y = (uint32_t)((uint64_t)y * source->m_height / height);
+    size_t component_count = get_component_count(source->m_format);
+    const uint8_t *texel = source->get_pixels() +
+                           ((size_t)source_y * source->m_width + source_x) * component_count;
+    if (component_count == 1)
+    {
+        result[0] = texel[0];
+        result[1] = texel[0];
+        result[2] = texel[0];
+    }
+    else
+    {
+        result[0] = texel[0];
+        result[1] = texel[1];
+        result[2] = texel[2];
+    }
+}
+
+MaterialTexture::MaterialTexture(uint32_t width, uint32_t height, bool srgb_base_color)
+    : m_width(width), m_height(height), m_srgb_base_color(srgb_base_color)
+{
+    texels.resize((size_t)MATERIAL_TEXEL_SIZE * m_width * m_height);
+}
+
+std::unique_ptr<MaterialTexture> MaterialTexture::pack(const Texture *base_color_map, const Texture *normal_map,
+                                                       const Texture *metallic_map, const Texture *roughness_map)
+{
+    PROFILE_ZONE("pack material");
+    const Texture *maps[4] = {base_color_map, normal_map, metallic_map, roughness_map};
+    // Block compressed maps are decompressed first, the packed texels are
+    // always uncompressed.
+    std::unique_ptr<Texture> decompressed_maps[4];
+    for (int i = 0; i < 4; i++)
+    {
+        if (maps[i] != nullptr && Texture::is_block_compressed(maps[i]->m_format))
+        {
+            decompressed_maps[i] = decompress_texture(*maps[i]);
+            maps[i] = decompressed_maps[i].get();
+        }
+    }
+    base_color_map = maps[0];
+    normal_map = maps[1];
+    metallic_map = maps[2];
+    roughness_map = maps[3];
+    uint32_t width = 1;
+    uint32_t height = 1;
+    for (const Texture *map : maps)
+    {
+        if (map == nullptr)
+        {
+            continue;
+        }
+        if (get_component_count(map->m_format) == 0 || map->m_width == 0 || map->m_height == 0)
+        {
+            return nullptr;
+        }
+        width = std::max(width, map->m_width);
+        height = std::max(height, map->m_height);
+    }
+
+    bool srgb_base_color = base_color_map != nullptr &&
+                           (base_color_map->m_format == texture_format::TEXTURE_FORMAT_SRGB8 ||
+                            base_color_map->m_format == texture_format::TEXTURE_FORMAT_SRGB8_A8);
+    auto material = std::make_unique<MaterialTexture>(width, height, srgb_base_color);
+
+    uint8_t *texel = material->texels.data();
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint8_t value[3];
+            if (base_color_map)
+            {
+                fetch_texel(value, base_color_map, x, y, width, height);
+                texel[0] = value[0];
+                texel[1] = value[1];
+                texel[2] = value[2];
+            }
+            else
+            {
+                texel[0] = texel[1] = texel[2] = 0xFF;
+            }
+            if (normal_map)
+            {
+                fetch_texel(value, normal_map, x, y, width, height);
+                texel[4] = value[0];
+                texel[5] = value[1];
+                texel[6] = value[2];
+            }
+            else
+            {
+                texel[4] = 0x80;
+                texel[5] = 0x80;
+                texel[6] = 0xFF;
+            }
+            if (metallic_map)
+            {
+                fetch_texel(value, metallic_map, x, y, width, height);
+                texel[3] = value[0];
+            }
+            else
+            {
+                texel[3] = 0xFF;
+            }
+            if (roughness_map)
+            {
+                fetch_texel(value, roughness_map, x, y, width, height);
+                texel[7] = value[0];
+            }
+            else
+            {
+                texel[7] = 0xFF;
+            }
+            texel += MATERIAL_TEXEL_SIZE;
+        }
+    }
+    return material;
+}
+
+material_sample MaterialTexture::sample_material(vec2 texcoord) const
+{
+    float u = clamp01(texcoord.u);
+    float v = clamp01(texcoord.v);
+    uint32_t u_index = (uint32_t)(u * m_width);
+    uint32_t v_index = (uint32_t)(v * m_height);
+
+    // Prevent array access out of bounds.
+    u_index = u_index >= m_width ? m_width - 1 : u_index;
+    v_index = v_index >= m_height ? m_height - 1 : v_index;
+    const uint8_t *texel =
+        texels.data() + ((size_t)u_index + (size_t)v_index * m_width) * MATERIAL_TEXEL_SIZE;
+
+    material_sample result;
+    if (m_srgb_base_color)
+    {
+        result.base_color.r = srgb8_to_linear(texel[0]);
+        result.base_color.g = srgb8_to_linear(texel[1]);
+        result.base_color.b = srgb8_to_linear(texel[2]);
+    }
+    else
+    {
+        result.base_color.r = uint8_to_float(texel[0]);
+        result.base_color.g = uint8_to_float(texel[1]);
+        result.base_color.b = uint8_to_float(texel[2]);
+    }
+    result.metallic = uint8_to_float(texel[3]);
+    result.normal.x = uint8_to_float(texel[4]);
+    result.normal.y = uint8_to_float(texel[5]);
+    result.normal.z = uint8_to_float(texel[6]);
+    result.roughness = uint8_to_float(texel[7]);
+    return result;
+}
+
+#undef MATERIAL_TEXEL_SIZE
@@ -0,0 +1,154 @@
+#include "graphics/profiler.h"
+
+#ifndef PROFILER_DISABLED
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct profile_event
+{
+    const char *name;
+    uint64_t begin_time;
+    uint64_t end_time;
+};
+
+// The zones of one thread. Its storage grows up to PROFILER_RING_CAPACITY
+// zones, then the oldest are overwritten. When a thread exits, its ring is
+// kept for the next thread that starts, so that short lived threads share a
+// few rings instead of adding one each.
+struct profile_ring
+{
+    uint32_t thread_index;
+    std::string thread_name;
+    std::vector<profile_event> events;
+    // Where the next zone is written once the ring is full.
+    size_t next_event{0};
+};
+
+std::atomic<profiler_level> current_profiler_level{profiler_level::PROFILER_OFF};
+
+static std::mutex rings_mutex;
+static std::vector<std::unique_ptr<profile_ring>> rings;
+static std::vector<profile_ring *> free_rings;
+// The zones are written relative to this time.
+static const uint64_t profiler_start_time = get_profiler_time();
+
+static thread_local profile_ring *thread_ring = nullptr;
+
+// Gives the ring of the thread back when the thread exits.
+struct ring_releaser
+{
+    ~ring_releaser()
+    {
+        if (thread_ring != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            free_rings.push_back(thread_ring);
+            thread_ring = nullptr;
+        }
+    }
+};
+
+static profile_ring *acquire_thread_ring()
+{
+    static thread_local ring_releaser releaser;
+    (void)releaser;
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    if (!free_rings.empty())
+    {
+        thread_ring = free_rings.back();
+        free_rings.pop_back();
+        return thread_ring;
+    }
+    auto ring = std::make_unique<profile_ring>();
+    ring->thread_index = (uint32_t)rings.size();
+    ring->thread_name = "thread " + std::to_string(ring->thread_index);
+    thread_ring = ring.get();
+    rings.push_back(std::move(ring));
+    return thread_ring;
+}
+
+uint64_t get_profiler_time()
+{
+    auto time = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+}
+
+void record_profile_zone(const char *name, uint64_t begin_time, uint64_t end_time)
+{
+    profile_ring *ring = thread_ring != nullptr ? thread_ring : acquire_thread_ring();
+    if (ring->events.size() < PROFILER_RING_CAPACITY)
+    {
+        ring->events.push_back(profile_event{name, begin_time, end_time});
+        return;
+    }
+    ring->events[ring->next_event] = profile_event{name, begin_time, end_time};
+    ring->next_event = (ring->next_event + 1) % PROFILER_RING_CAPACITY;
+}
+
+void set_profiler_level(profiler_level level) { current_profiler_level.store(level, std::memory_order_relaxed); }
+
+void set_profiler_thread_name(const char *name)
+{
+    profile_ring *ring = thread_ring != nullptr ? thread_ring : acquire_thread_ring();
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    ring->thread_name = name;
+}
+
+// Writes a string as a JSON string, the zone names are literals of the
+// renderer, so only quotes and backslashes are escaped.
+static void write_json_string(FILE *file, const char *text)
+{
+    fputc('"', file);
+    for (const char *c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+bool write_profile_trace(std::string_view filename)
+{
+    FILE *file = fopen(std::string(filename).c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    // Complete events, "ph":"X", with the times in microseconds.
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    bool is_first = true;
+    for (const std::unique_ptr<profile_ring> &ring : rings)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                is_first ? "" : ",\n", ring->thread_index);
+        write_json_string(file, ring->thread_name.c_str());
+        fputs("}}", file);
+        is_first = false;
+        // Oldest first, once the ring has wrapped the oldest is the next to
+        // be overwritten.
+        size_t count = ring->events.size();
+        for (size_t i = 0; i < count; i++)
+        {
+            const profile_event &event = ring->events[(ring->next_event + i) % count];
+            fputs(",\n{\"name\":", file);
+            write_json_string(file, event.name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", ring->thread_index,
+                    (int64_t)(event.begin_time - profiler_start_time) / 1000.0,
+                    (event.end_time - event.begin_time) / 1000.0);
+        }
+    }
+    fputs("\n]}\n", file);
+    bool is_written = ferror(file) == 0;
+    return fclose(file) == 0 && is_written;
+}
+
+#endif
@@ -1,7 +1,16 @@
 #include "graphics/rasterizer.h"
 #include "graphics/color.h"
+#include "graphics/profiler.h"
 #include <cstdint>
 #include <cfloat>
+#ifndef RASTERIZER_NO_STATISTICS
+#include <mutex>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RASTERIZER_USE_AVX2
+#endif
 
 static struct
 {
@@ -9,6 +18,25 @@ static struct
 	uint32_t width, height;
 } viewport;
 
+// The bits of a clip code, the planes of the viewing volume a vertex is
+// outside of. The guard band is GUARD_BAND_SCALE times the viewing volume in
+// x and y: triangles that leave the viewport only in x and y are rasterized
+// with their bounding box clamped to the viewport, only triangles that cross
+// the near or far plane or the guard band are clipped.
+#define CLIP_LEFT 0x01
+#define CLIP_RIGHT 0x02
+#define CLIP_BOTTOM 0x04
+#define CLIP_TOP 0x08
+#define CLIP_NEAR 0x10
+#define CLIP_FAR 0x20
+#define CLIP_GUARD_BAND 0x40
+#define CLIP_VIEW_PLANES 0x3f
+// Large enough for nearly all visible triangles, small enough that the edge
+// functions keep sub-pixel precision.
+#define GUARD_BAND_SCALE 8.0f
+// A triangle clipped by the near, far and the four guard band planes.
+#define MAX_CLIPPED_VERTICES 9
+
 struct vertex
 {
 	ShaderContext context;
@@ -24,20 +52,25 @@ struct vertex
 
 	/*
 		The vertex position should be in clippig space.
-		Returns true if the vertex needs to be clipped, otherwise returns false.
+		Returns the CLIP_* bits of the planes the vertex is outside of, 0 if it
+		is inside the viewing volume.
 	*/
-	bool clipping_test()
+	uint8_t compute_clip_code() const
 	{
-		float w = this->position.w;
-		for (int c = 0; c < 3; c++)
+		float x = position.x, y = position.y, z = position.z, w = position.w;
+		float guard_band_w = GUARD_BAND_SCALE * w;
+		uint8_t code = 0;
+		code |= x < -w ? CLIP_LEFT : 0;
+		code |= x > w ? CLIP_RIGHT : 0;
+		code |= y < -w ? CLIP_BOTTOM : 0;
+		code |= y > w ? CLIP_TOP : 0;
+		code |= z < -w ? CLIP_NEAR : 0;
+		code |= z > w ? CLIP_FAR : 0;
+		if (x < -guard_band_w || x > guard_band_w || y < -guard_band_w || y > guard_band_w)
 		{
-			float component = this->position.elements[c];
-			if (component < -w || component > w)
-			{
-				return true;
-			}
+			code |= CLIP_GUARD_BAND;
 		}
-		return false;
+		return code;
 	}
 
 	// Transform vertex position from clip space to normalized device coordinates
@@ -82,40 +115,82 @@ struct bounding_box
 
 static vertex_shader vs = nullptr;
 static fragment_shader fs = nullptr;
+// At most one of fs and packet_fs is set.
+static packet_fragment_shader packet_fs = nullptr;
+
+// Shading rate state, see set_shading_rate() and set_shading_rate_image().
+static shading_rate draw_shading_rate = shading_rate::SHADING_RATE_1X1;
+static const shading_rate *shading_rate_image = nullptr;
+static uint32_t shading_rate_image_width = 0;
+static uint32_t shading_rate_image_height = 0;
 
 // Framebuffer data.
 static uint32_t framebuffer_width = 0;
 static uint32_t framebuffer_height = 0;
 static uint8_t *color_buffer = nullptr;
 static bool is_srgb_encoding = false;
-static float *depth_buffer = nullptr;
+// The color buffer stores unclamped linear floats, see write_color_float().
+static bool is_float_color = false;
+static uint8_t *depth_buffer = nullptr;
+static texture_format depth_format = texture_format::TEXTURE_FORMAT_DEPTH_FLOAT;
+// The number of samples per pixel. With more than one, color_buffer and
+// depth_buffer point to the multisample attachments, which store the samples
+// of a pixel next to each other.
+static uint32_t sample_count = 1;
+// See set_depth_function(), an equal test does not write the depth buffer.
+static bool is_depth_test_equal = false;
+#ifndef RASTERIZER_NO_STATISTICS
+// The counters of the calling thread since its last merge, and their values at
+// its last begin_draw_statistics(), see pipeline_statistics.
+static thread_local pipeline_statistics thread_counters;
+static thread_local pipeline_statistics draw_start_counters;
+static std::mutex frame_counters_mutex;
+static pipeline_statistics frame_counters;
+#define COUNT_STATISTIC(counter, value) (thread_counters.counter += (value))
+#else
+#define COUNT_STATISTIC(counter, value) ((void)0)
+#endif
+
+// The positions of the samples of a multisampled pixel relative to its
+// center, the rotated grid of the standard 4x pattern of Direct3D.
+static const float sample_offsets[MSAA_SAMPLE_COUNT][2] = {
+	{-0.125f, -0.375f}, {0.375f, -0.125f}, {-0.375f, 0.125f}, {0.125f, 0.375f}};
+// The largest distance of a sample to the pixel center along x or y.
+#define SAMPLE_MARGIN 0.375f
 
 void parse_framebuffer(FrameBuffer &framebuffer)
 {
 	framebuffer_width = framebuffer.m_width;
 	framebuffer_height = framebuffer.m_height;
+	sample_count = framebuffer.m_sample_count;
+	bool is_multisampled = sample_count > 1;
 
-	auto &color_attachment = framebuffer.color_buffer;
+	Texture *color_attachment =
+		is_multisampled ? framebuffer.color_samples.get() : framebuffer.color_buffer.get();
 	if (!color_attachment)
 	{
 		color_buffer = nullptr;
 		is_srgb_encoding = false;
+		is_float_color = false;
 	}
 	else
 	{
 		color_buffer = color_attachment->get_pixels();
 		is_srgb_encoding =
 			(color_attachment->m_format == texture_format::TEXTURE_FORMAT_SRGB8_A8) ? true : false;
+		is_float_color = color_attachment->m_format == texture_format::TEXTURE_FORMAT_RGBA_FLOAT;
 	}
 
-	auto &depth_attachment = framebuffer.depth_buffer;
+	Texture *depth_attachment =
+		is_multisampled ? framebuffer.depth_samples.get() : framebuffer.depth_buffer.get();
 	if (!depth_attachment)
 	{
 		depth_buffer = nullptr;
 	}
 	else
 	{
-		depth_buffer = (float *)depth_attachment->get_pixels();
+		depth_buffer = depth_attachment->get_pixels();
+		depth_format = depth_attachment->m_format;
 	}
 }
 
@@ -130,8 +205,8 @@ float edge_function(const vec2 &a, const vec2 &b, const vec2 &c)
 
 // Returns true if the fragment is hidden. If the fragment is not hidden, return
 // false. If depth_test is a null pointer, skip the depth test and always return
-// false.
-bool depth_test(uint32_t x, uint32_t y, const struct vertex vertices[], const float barycentric[])
+// false. Tests and writes the given sample of the pixel.
+bool depth_test(uint32_t x, uint32_t y, uint32_t sample, const struct vertex vertices[], const float barycentric[])
 {
 	if (depth_buffer == nullptr)
 	{
@@ -146,11 +221,52 @@ bool depth_test(uint32_t x, uint32_t y, const struct vertex vertices[], const fl
 	float new_depth = barycentric[0] * vertices[0].depth +
 					  barycentric[1] * vertices[1].depth +
 					  barycentric[2] * vertices[2].depth;
-	float *depth = depth_buffer + (y * framebuffer_width + x);
-	bool is_hidden = new_depth > *depth;
-	if (!is_hidden)
+	size_t pixel_offset = ((size_t)y * framebuffer_width + x) * sample_count + sample;
+	bool is_hidden;
+	if (depth_format == texture_format::TEXTURE_FORMAT_DEPTH16)
 	{
-		*depth = new_depth;
+		// Compare in the stored precision, so that equal depths still pass.
+		uint16_t *depth = (uint16_t *)depth_buffer + pixel_offset;
+		uint16_t quantized_depth = float_to_depth16(new_depth);
+		if (is_depth_test_equal)
+		{
+			return quantized_depth != *depth;
+		}
+		is_hidden = quantized_depth > *depth;
+		if (!is_hidden)
+		{
+			*depth = quantized_depth;
+		}
+	}
+	else if (depth_format == texture_format::TEXTURE_FORMAT_DEPTH24)
+	{
+		uint8_t *depth = depth_buffer + pixel_offset * 3;
+		uint32_t stored_depth = depth[0] | (uint32_t)depth[1] << 8 | (uint32_t)depth[2] << 16;
+		uint32_t quantized_depth = float_to_depth24(new_depth);
+		if (is_depth_test_equal)
+		{
+			return quantized_depth != stored_depth;
+		}
+		is_hidden = quantized_depth > stored_depth;
+		if (!is_hidden)
+		{
+			depth[0] = (uint8_t)quantized_depth;
+			depth[1] = (uint8_t)(quantized_depth >> 8);
+			depth[2] = (uint8_t)(quantized_depth >> 16);
+		}
+	}
+	else
+	{
+		float *depth = (float *)depth_buffer + pixel_offset;
+		if (is_depth_test_equal)
+		{
+			return new_depth != *depth;
+		}
+		is_hidden = new_depth > *depth;
+		if (!is_hidden)
+		{
+			*depth = new_depth;
+		}
 	}
 	return is_hidden;
 }
@@ -216,6 +332,61 @@ void set_fragment_shader_input(ShaderContext *result, const vertex vertices[], c
 	INTERPOLATION_HELPER(vec4, 4);
 }
 
+// Interpolates a variable for each fragment of a shader packet, the result has
+// one array of PACKET_SIZE elements per component. The computation for each
+// fragment is the same as that of interpolate_variables().
+static void interpolate_packet_variables(float *result, const float *const sources[], size_t component_count,
+										 const float inverse_denominator[], const float bc_over_w[][PACKET_SIZE])
+{
+	const float *s0 = sources[0];
+	const float *s1 = sources[1];
+	const float *s2 = sources[2];
+	for (size_t i = 0; i < component_count; i++)
+	{
+		for (int lane = 0; lane < PACKET_SIZE; lane++)
+		{
+			float numerator =
+				s0[i] * bc_over_w[0][lane] + s1[i] * bc_over_w[1][lane] + s2[i] * bc_over_w[2][lane];
+			result[i * PACKET_SIZE + lane] = numerator * inverse_denominator[lane];
+		}
+	}
+}
+
+#define PACKET_INTERPOLATION_HELPER(type, component_count)                            \
+	do                                                                                \
+	{                                                                                 \
+		variable_count = vertices[0].context.type##_variable_count;                   \
+		for (int8_t i = 0; i < variable_count; i++)                                   \
+		{                                                                             \
+			int8_t index = vertices[0].context.type##_index_queue[i];                 \
+			variables[0] = (float *)(vertices[0].context.type##_variables + index);   \
+			variables[1] = (float *)(vertices[1].context.type##_variables + index);   \
+			variables[2] = (float *)(vertices[2].context.type##_variables + index);   \
+			interpolate_packet_variables((float *)(packet->type##_variables + index), \
+										 variables, component_count,                  \
+										 inverse_denominator, bc_over_w);             \
+		}                                                                             \
+	} while (0)
+
+// bc_over_w holds the barycentric coordinates divided by w of each fragment,
+// one array per vertex.
+static void set_packet_shader_input(ShaderPacket *packet, const vertex vertices[],
+									const float bc_over_w[][PACKET_SIZE])
+{
+	float inverse_denominator[PACKET_SIZE];
+	for (int lane = 0; lane < PACKET_SIZE; lane++)
+	{
+		inverse_denominator[lane] = 1.0f / (bc_over_w[0][lane] + bc_over_w[1][lane] + bc_over_w[2][lane]);
+	}
+
+	const float *variables[3];
+	int8_t variable_count;
+	PACKET_INTERPOLATION_HELPER(float, 1);
+	PACKET_INTERPOLATION_HELPER(vec2, 2);
+	PACKET_INTERPOLATION_HELPER(vec3, 3);
+	PACKET_INTERPOLATION_HELPER(vec4, 4);
+}
+
 void write_color(uint8_t *pixel, vec4 color)
 {
 	color.r = clamp01(color.r);
@@ -225,17 +396,31 @@ void write_color(uint8_t *pixel, vec4 color)
 	if (is_srgb_encoding)
 	{
 		// Perform gamma correction if the color buffer to be written is sRGB
-		// encoded.
-		color.r = convert_to_srgb_color(color.r);
-		color.g = convert_to_srgb_color(color.g);
-		color.b = convert_to_srgb_color(color.b);
-	}
-	pixel[0] = float_to_uint8(color.r);
-	pixel[1] = float_to_uint8(color.g);
-	pixel[2] = float_to_uint8(color.b);
+		// encoded. The table based encoder gives the same result as
+		// float_to_uint8(convert_to_srgb_color()) without calling powf().
+		pixel[0] = linear_to_srgb8(color.r);
+		pixel[1] = linear_to_srgb8(color.g);
+		pixel[2] = linear_to_srgb8(color.b);
+	}
+	else
+	{
+		pixel[0] = float_to_uint8(color.r);
+		pixel[1] = float_to_uint8(color.g);
+		pixel[2] = float_to_uint8(color.b);
+	}
 	pixel[3] = float_to_uint8(color.a);
 }
 
+// Stores the shader output as is. Clamping, encoding and quantization are left
+// to resolve_hdr(), which does them once per pixel instead of once per write.
+void write_color_float(float *pixel, const vec4 &color)
+{
+	pixel[0] = color.r;
+	pixel[1] = color.g;
+	pixel[2] = color.b;
+	pixel[3] = color.a;
+}
+
 void set_viewport(int left, int bottom, uint32_t width, uint32_t height)
 {
 	viewport.left = left;
@@ -246,34 +431,323 @@ void set_viewport(int left, int bottom, uint32_t width, uint32_t height)
 
 void set_vertex_shader(vertex_shader shader) { vs = shader; }
 
-void set_fragment_shader(fragment_shader shader) { fs = shader; }
+void set_fragment_shader(fragment_shader shader)
+{
+	fs = shader;
+	packet_fs = nullptr;
+}
 
-// Using edge functions to raster triangles, refer to:
-// https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation/rasterization-stage
-void draw_triangle(FrameBuffer *framebuffer, const void *uniform, const void *const vertex_attributes[])
+void set_packet_fragment_shader(packet_fragment_shader shader)
 {
-	if (vs == nullptr || fs == nullptr || framebuffer == nullptr)
+	packet_fs = shader;
+	fs = nullptr;
+}
+
+void set_depth_function(depth_function function)
+{
+	is_depth_test_equal = function == depth_function::DEPTH_FUNCTION_EQUAL;
+}
+
+void set_shading_rate(shading_rate rate) { draw_shading_rate = rate; }
+
+void set_shading_rate_image(const shading_rate *rates, uint32_t width, uint32_t height)
+{
+	shading_rate_image = rates;
+	shading_rate_image_width = rates == nullptr ? 0 : width;
+	shading_rate_image_height = rates == nullptr ? 0 : height;
+}
+
+// Computes the barycentric coordinates of the point (x, y), which are also
+// computed for points outside the triangle. Returns false if the point is
+// outside the triangle.
+static inline bool compute_barycentric(const vertex vertices[], float inverse_area, float x, float y, float bc[])
+{
+	vec2 p{x, y};
+	// Note that this is not the final barycentric coordinates.
+	bc[0] = edge_function(vertices[1].screen_space_position,
+						  vertices[2].screen_space_position, p);
+	bc[1] = edge_function(vertices[2].screen_space_position,
+						  vertices[0].screen_space_position, p);
+	bc[2] = edge_function(vertices[0].screen_space_position,
+						  vertices[1].screen_space_position, p);
+	// If any component of the barycentric coordinates is greater than 0, it
+	// means that the pixel is outside the triangle.
+	bool inside = !(bc[0] > 0.0f || bc[1] > 0.0f || bc[2] > 0.0f);
+	// Calculate the barycentric coordinates of point p.
+	bc[0] *= inverse_area;
+	bc[1] *= inverse_area;
+	bc[2] *= inverse_area;
+	return inside;
+}
+
+static inline void write_fragment(uint32_t x, uint32_t y, uint32_t sample, const vec4 &fragment_color)
+{
+	size_t offset = ((size_t)y * framebuffer_width + x) * sample_count + sample;
+	if (is_float_color)
+	{
+		float *pixel = (float *)color_buffer + offset * 4;
+		write_color_float(pixel, fragment_color);
+		COUNT_STATISTIC(color_writes, 1);
+	}
+	else if (color_buffer != nullptr)
+	{
+		uint8_t *pixel = color_buffer + offset * 4;
+		write_color(pixel, fragment_color);
+		COUNT_STATISTIC(color_writes, 1);
+	}
+}
+
+// Tests the coverage and depth of the samples of the coarse pixel of size x
+// size pixels whose first pixel is (x, y), only for pixels in the bounding
+// box. Returns the visible samples, bit i * sample_count + s for sample s of
+// pixel (x + i % size, y + i / size). bc receives the barycentric coordinates
+// to shade the coarse pixel with: those of its center, or of its first
+// visible sample if the center is outside the triangle, so that the variables
+// are not extrapolated far beyond the edges.
+static uint64_t cover_coarse_pixel(const vertex vertices[], float inverse_area, uint32_t x, uint32_t y,
+								   uint32_t size, uint32_t x_min, uint32_t y_min, uint32_t x_max, uint32_t y_max,
+								   float bc[])
+{
+	float center_offset = (size - 1) * 0.5f;
+	bool is_center_inside = compute_barycentric(vertices, inverse_area, x + center_offset, y + center_offset, bc);
+	uint64_t sample_mask = 0;
+	for (uint32_t i = 0; i < size * size; i++)
 	{
+		uint32_t pixel_x = x + i % size;
+		uint32_t pixel_y = y + i / size;
+		if (pixel_x < x_min || pixel_x > x_max || pixel_y < y_min || pixel_y > y_max)
+		{
+			continue;
+		}
+		for (uint32_t s = 0; s < sample_count; s++)
+		{
+			float sample_bc[3];
+			float sample_x = sample_count > 1 ? pixel_x + sample_offsets[s][0] : pixel_x;
+			float sample_y = sample_count > 1 ? pixel_y + sample_offsets[s][1] : pixel_y;
+			if (!compute_barycentric(vertices, inverse_area, sample_x, sample_y, sample_bc))
+			{
+				continue;
+			}
+			COUNT_STATISTIC(covered_fragments, 1);
+			if (depth_test(pixel_x, pixel_y, s, vertices, sample_bc))
+			{
+				COUNT_STATISTIC(depth_rejected_fragments, 1);
+				continue;
+			}
+			if (!is_center_inside && sample_mask == 0)
+			{
+				bc[0] = sample_bc[0];
+				bc[1] = sample_bc[1];
+				bc[2] = sample_bc[2];
+			}
+			sample_mask |= (uint64_t)1 << (i * sample_count + s);
+		}
+	}
+	return sample_mask;
+}
+
+// cover_coarse_pixel() for a single multisampled pixel.
+static inline uint64_t cover_multisampled_pixel(const vertex vertices[], float inverse_area, uint32_t x,
+												uint32_t y, float bc[])
+{
+	bool is_center_inside = compute_barycentric(vertices, inverse_area, x, y, bc);
+	uint64_t sample_mask = 0;
+	for (uint32_t s = 0; s < MSAA_SAMPLE_COUNT; s++)
+	{
+		float sample_bc[3];
+		if (!compute_barycentric(vertices, inverse_area, x + sample_offsets[s][0], y + sample_offsets[s][1],
+								 sample_bc))
+		{
+			continue;
+		}
+		COUNT_STATISTIC(covered_fragments, 1);
+		if (depth_test(x, y, s, vertices, sample_bc))
+		{
+			COUNT_STATISTIC(depth_rejected_fragments, 1);
+			continue;
+		}
+		if (!is_center_inside && sample_mask == 0)
+		{
+			bc[0] = sample_bc[0];
+			bc[1] = sample_bc[1];
+			bc[2] = sample_bc[2];
+		}
+		sample_mask |= 1u << s;
+	}
+	return sample_mask;
+}
+
+// Writes the color to the visible samples of a coarse pixel, see
+// cover_coarse_pixel().
+static inline void write_coarse_fragment(uint32_t x, uint32_t y, uint32_t size, uint64_t sample_mask,
+										 const vec4 &fragment_color)
+{
+	if (size == 1)
+	{
+		for (uint32_t s = 0; sample_mask != 0; s++, sample_mask >>= 1)
+		{
+			if (sample_mask & 1u)
+			{
+				write_fragment(x, y, s, fragment_color);
+			}
+		}
 		return;
 	}
-	parse_framebuffer(*framebuffer);
-	vertex vertices[3];
-	// The bounding box of the triangle.
-	bounding_box bound = {{FLT_MAX, FLT_MAX}, {FLT_MIN, FLT_MIN}};
-	for (int i = 0; i < 3; i++)
+	for (uint32_t i = 0; sample_mask != 0; i++, sample_mask >>= 1)
 	{
-		auto &vtx = vertices[i];
-		vtx.context.clear();
-		vtx.position = vs(&vtx.context, uniform, vertex_attributes[i]);
-		// Perform a rough clipping test, if at least one vertex is outside the
-		// viewing volume, the entire triangle will be discarded.
-		if (vtx.clipping_test())
+		if (sample_mask & 1u)
 		{
-			return;
+			uint32_t pixel = i / sample_count;
+			write_fragment(x + pixel % size, y + pixel / size, i % sample_count, fragment_color);
 		}
-		vtx.perspective_division();
-		vtx.viewport_transform();
-		bound.update(vtx);
+	}
+}
+
+// Rasterizes the pixels of the bounding box in 2x2 quads of coarse pixels of
+// size x size pixels, size is 1 when shading every pixel. Coverage and the
+// depth test are evaluated per pixel, or per sample in a multisampled
+// framebuffer. The coarse pixels with at least one visible sample are shaded,
+// with one call of the packet fragment shader per quad or one call of the
+// fragment shader per coarse pixel, and the color is written to their visible
+// samples. The other coarse pixels of a quad are
+// helpers: their variables are interpolated at their own positions outside
+// the triangle so that the fragment shader can take derivatives, and they are
+// never written.
+static void rasterize_quads(const void *uniform, const vertex vertices[], float inverse_area, uint32_t size,
+							uint32_t x_min, uint32_t y_min, uint32_t x_max, uint32_t y_max)
+{
+	ShaderContext inputs[PACKET_SIZE];
+	ShaderPacket packet;
+	packet_vec4 colors;
+	uint32_t quad_size = size * 2;
+	for (uint32_t y = y_min & ~(quad_size - 1); y <= y_max; y += quad_size)
+	{
+		for (uint32_t x = x_min & ~(quad_size - 1); x <= x_max; x += quad_size)
+		{
+			float bc[PACKET_SIZE][3];
+			uint64_t sample_masks[PACKET_SIZE];
+			uint32_t coverage_mask = 0;
+			for (int lane = 0; lane < PACKET_SIZE; lane++)
+			{
+				uint32_t coarse_x = x + (lane & 1) * size;
+				uint32_t coarse_y = y + (lane >> 1) * size;
+				if (size == 1 && sample_count == 1)
+				{
+					// The quad may reach past the bounding box, which may end
+					// at the edge of the framebuffer.
+					bool inside = compute_barycentric(vertices, inverse_area, coarse_x, coarse_y, bc[lane]) &&
+								  coarse_x >= x_min && coarse_x <= x_max && coarse_y >= y_min && coarse_y <= y_max;
+					sample_masks[lane] = inside && !depth_test(coarse_x, coarse_y, 0, vertices, bc[lane]);
+					COUNT_STATISTIC(covered_fragments, inside);
+					COUNT_STATISTIC(depth_rejected_fragments, inside && sample_masks[lane] == 0);
+				}
+				else if (size == 1)
+				{
+					if (coarse_x >= x_min && coarse_x <= x_max && coarse_y >= y_min && coarse_y <= y_max)
+					{
+						sample_masks[lane] = cover_multisampled_pixel(vertices, inverse_area, coarse_x, coarse_y,
+																	  bc[lane]);
+					}
+					else
+					{
+						// Helpers outside the bounding box still need their
+						// barycentric coordinates.
+						compute_barycentric(vertices, inverse_area, coarse_x, coarse_y, bc[lane]);
+						sample_masks[lane] = 0;
+					}
+				}
+				else
+				{
+					sample_masks[lane] = cover_coarse_pixel(vertices, inverse_area, coarse_x, coarse_y, size, x_min,
+														   y_min, x_max, y_max, bc[lane]);
+				}
+				if (sample_masks[lane] != 0)
+				{
+					coverage_mask |= 1u << lane;
+				}
+			}
+			// Without a fragment shader only the depth is written.
+			if (coverage_mask == 0 || (fs == nullptr && packet_fs == nullptr))
+			{
+				continue;
+			}
+
+			if (packet_fs != nullptr)
+			{
+				float bc_over_w[3][PACKET_SIZE];
+				for (int lane = 0; lane < PACKET_SIZE; lane++)
+				{
+					for (int i = 0; i < 3; i++)
+					{
+						bc_over_w[i][lane] = bc[lane][i] * vertices[i].inverse_w;
+					}
+				}
+				packet.x = x;
+				packet.y = y;
+				packet.coverage_mask = coverage_mask;
+				set_packet_shader_input(&packet, vertices, bc_over_w);
+				packet_fs(&packet, uniform, &colors);
+				for (int lane = 0; lane < PACKET_SIZE; lane++)
+				{
+					if (coverage_mask & (1u << lane))
+					{
+						COUNT_STATISTIC(shaded_fragments, 1);
+						vec4 color{colors.x[lane], colors.y[lane], colors.z[lane], colors.w[lane]};
+						write_coarse_fragment(x + (lane & 1) * size, y + (lane >> 1) * size, size,
+											  sample_masks[lane], color);
+					}
+				}
+				continue;
+			}
+
+			// All inputs of the quad are ready before the first call, the
+			// derivatives of a fragment are read from its neighbors.
+			for (int lane = 0; lane < PACKET_SIZE; lane++)
+			{
+				inputs[lane].clear();
+				set_fragment_shader_input(&inputs[lane], vertices, bc[lane]);
+				inputs[lane].quad = inputs;
+				inputs[lane].quad_index = (int8_t)lane;
+			}
+			for (int lane = 0; lane < PACKET_SIZE; lane++)
+			{
+				if (coverage_mask & (1u << lane))
+				{
+					COUNT_STATISTIC(shaded_fragments, 1);
+					write_coarse_fragment(x + (lane & 1) * size, y + (lane >> 1) * size, size, sample_masks[lane],
+										  fs(&inputs[lane], uniform));
+				}
+			}
+		}
+	}
+}
+
+// Returns the width of the coarse pixels of the shading rate, in pixels.
+static inline uint32_t get_coarse_pixel_size(shading_rate rate)
+{
+	switch (rate)
+	{
+	case shading_rate::SHADING_RATE_2X2:
+		return 2;
+	case shading_rate::SHADING_RATE_4X4:
+		return 4;
+	default:
+		return 1;
+	}
+}
+
+// Using edge functions to raster triangles, refer to:
+// https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation/rasterization-stage
+//
+// The vertices must have gone through the perspective division and the
+// viewport transform.
+static void rasterize_triangle(FrameBuffer *framebuffer, const void *uniform, const vertex vertices[])
+{
+	// The bounding box of the triangle.
+	bounding_box bound = {{FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX}};
+	for (int i = 0; i < 3; i++)
+	{
+		bound.update(vertices[i]);
 	}
 	// Compute the area of the triangle multiplied by 2.
 	float area = edge_function(vertices[0].screen_space_position,
@@ -284,56 +758,587 @@ void draw_triangle(FrameBuffer *framebuffer, const void *uniform, const void *co
 		// If the area is 0, it means this is a degenerate triangle. If the area
 		// is positive, the triangle with clockwise winding.
 		// In both cases, the triangle does not need to be drawn.
+		if (area > 0)
+		{
+			COUNT_STATISTIC(back_facing_triangles, 1);
+		}
+		else
+		{
+			COUNT_STATISTIC(degenerate_triangles, 1);
+		}
 		return;
 	}
 	float inverse_area = 1 / area;
 
 	// Traverse find the pixels covered by the triangle. If found, compute the
 	// barycentric coordinates of the point in the triangle.
-	// No need to traverses pixels outside the screen.
-	uint32_t x_min = clamp<uint32_t>(floorf(bound.min.x), 0, framebuffer_width - 1);
-	uint32_t y_min = clamp<uint32_t>(floorf(bound.min.y), 0, framebuffer_height - 1);
-	uint32_t x_max = clamp<uint32_t>(floorf(bound.max.x), 0, framebuffer_width - 1);
-	uint32_t y_max = clamp<uint32_t>(floorf(bound.max.y), 0, framebuffer_height - 1);
+	// No need to traverses pixels outside the screen, triangles in the guard
+	// band may reach beyond it.
+	// The samples of a multisampled pixel reach beyond its center.
+	float margin = sample_count > 1 ? SAMPLE_MARGIN : 0.0f;
+	float left = floorf(bound.min.x - margin), bottom = floorf(bound.min.y - margin);
+	float right = floorf(bound.max.x + margin), top = floorf(bound.max.y + margin);
+	float last_x = (float)(framebuffer_width - 1), last_y = (float)(framebuffer_height - 1);
+	if (right < 0.0f || top < 0.0f || left > last_x || bottom > last_y)
+	{
+		return;
+	}
+	// Clamp before the conversion, negative floats do not convert to uint32_t.
+	uint32_t x_min = (uint32_t)clamp(left, 0.0f, last_x);
+	uint32_t y_min = (uint32_t)clamp(bottom, 0.0f, last_y);
+	uint32_t x_max = (uint32_t)clamp(right, 0.0f, last_x);
+	uint32_t y_max = (uint32_t)clamp(top, 0.0f, last_y);
+	COUNT_STATISTIC(tested_pixels, (uint64_t)(x_max - x_min + 1) * (y_max - y_min + 1));
+	// Materialize pending clears of the tiles that the loop below may touch.
+	framebuffer->prepare_region(x_min, y_min, x_max, y_max);
+
+	uint32_t draw_size = get_coarse_pixel_size(draw_shading_rate);
+	if (shading_rate_image == nullptr)
+	{
+		rasterize_quads(uniform, vertices, inverse_area, draw_size, x_min, y_min, x_max, y_max);
+		return;
+	}
+	// Each tile of the rate image is rasterized on its own, with the coarser
+	// of its rate and the rate of the draw. The quads of all rates are aligned
+	// to the tiles.
+	for (uint32_t tile_y = y_min / SHADING_RATE_TILE_SIZE; tile_y <= y_max / SHADING_RATE_TILE_SIZE; tile_y++)
+	{
+		for (uint32_t tile_x = x_min / SHADING_RATE_TILE_SIZE; tile_x <= x_max / SHADING_RATE_TILE_SIZE; tile_x++)
+		{
+			uint32_t size = draw_size;
+			if (tile_x < shading_rate_image_width && tile_y < shading_rate_image_height)
+			{
+				shading_rate tile_rate = shading_rate_image[tile_y * shading_rate_image_width + tile_x];
+				size = std::max(size, get_coarse_pixel_size(tile_rate));
+			}
+			uint32_t tile_x_min = std::max(x_min, tile_x * SHADING_RATE_TILE_SIZE);
+			uint32_t tile_y_min = std::max(y_min, tile_y * SHADING_RATE_TILE_SIZE);
+			uint32_t tile_x_max = std::min(x_max, tile_x * SHADING_RATE_TILE_SIZE + SHADING_RATE_TILE_SIZE - 1);
+			uint32_t tile_y_max = std::min(y_max, tile_y * SHADING_RATE_TILE_SIZE + SHADING_RATE_TILE_SIZE - 1);
+			rasterize_quads(uniform, vertices, inverse_area, size, tile_x_min, tile_y_min, tile_x_max, tile_y_max);
+		}
+	}
+}
 
-	for (uint32_t y = y_min; y <= y_max; y++)
+// The signed distance of a clip space position to one of the planes that
+// triangles are clipped against, negative outside.
+static inline float get_plane_distance(const vec4 &position, int plane)
+{
+	float guard_band_w = GUARD_BAND_SCALE * position.w;
+	switch (plane)
 	{
-		for (uint32_t x = x_min; x <= x_max; x++)
+	case 0:
+		return position.w + position.z;
+	case 1:
+		return position.w - position.z;
+	case 2:
+		return guard_band_w + position.x;
+	case 3:
+		return guard_band_w - position.x;
+	case 4:
+		return guard_band_w + position.y;
+	default:
+		return guard_band_w - position.y;
+	}
+}
+
+#define LERP_VARIABLES_HELPER(type)                                          \
+	do                                                                       \
+	{                                                                        \
+		for (int8_t i = 0; i < a.context.type##_variable_count; i++)         \
+		{                                                                    \
+			int8_t index = a.context.type##_index_queue[i];                  \
+			const type &from = a.context.type##_variables[index];            \
+			const type &to = b.context.type##_variables[index];              \
+			result.context.type##_variables[index] = from + (to - from) * t; \
+		}                                                                    \
+	} while (0)
+
+// Interpolates the clip space position and the variables of two vertices of
+// a triangle. Linear in clip space is perspective correct, the rasterizer
+// divides by w afterwards.
+static void lerp_vertex(vertex &result, const vertex &a, const vertex &b, float t)
+{
+	result.context = a.context;
+	result.position = a.position + (b.position - a.position) * t;
+	LERP_VARIABLES_HELPER(float);
+	LERP_VARIABLES_HELPER(vec2);
+	LERP_VARIABLES_HELPER(vec3);
+	LERP_VARIABLES_HELPER(vec4);
+}
+
+// Clips a triangle that crosses the near or far plane or the guard band, its
+// vertices in clip space, and rasterizes the polygon that remains as a fan of
+// triangles. This is the slow path: the vertices are copied for each plane.
+static void rasterize_clipped_triangle(FrameBuffer *framebuffer, const void *uniform, const vertex triangle[])
+{
+	vertex polygons[2][MAX_CLIPPED_VERTICES];
+	int count = 3;
+	for (int i = 0; i < 3; i++)
+	{
+		polygons[0][i] = triangle[i];
+	}
+	int current = 0;
+	for (int plane = 0; plane < 6; plane++)
+	{
+		const vertex *input = polygons[current];
+		float distances[MAX_CLIPPED_VERTICES];
+		bool is_inside = true;
+		for (int i = 0; i < count; i++)
+		{
+			distances[i] = get_plane_distance(input[i].position, plane);
+			is_inside = is_inside && distances[i] >= 0.0f;
+		}
+		if (is_inside)
+		{
+			continue;
+		}
+		vertex *output = polygons[current ^ 1];
+		int output_count = 0;
+		for (int i = 0; i < count; i++)
 		{
-			vec2 p{x, y};
-			// The barycentric coordinates of p.
-			float bc[3];
-			// Note that this is not the final barycentric coordinates.
-			bc[0] = edge_function(vertices[1].screen_space_position,
-								  vertices[2].screen_space_position, p);
-			bc[1] = edge_function(vertices[2].screen_space_position,
-								  vertices[0].screen_space_position, p);
-			bc[2] = edge_function(vertices[0].screen_space_position,
-								  vertices[1].screen_space_position, p);
-			if (bc[0] > 0.0f || bc[1] > 0.0f || bc[2] > 0.0f)
+			int next = i + 1 == count ? 0 : i + 1;
+			bool is_current_inside = distances[i] >= 0.0f;
+			bool is_next_inside = distances[next] >= 0.0f;
+			if (is_current_inside)
 			{
-				// If any component of the barycentric coordinates is greater
-				// than 0, it means that the pixel is outside the triangle.
-				continue;
+				output[output_count++] = input[i];
+			}
+			// Always interpolate from the inside vertex, so that the edge
+			// shared with the neighbor triangle is cut at the same point.
+			if (is_current_inside && !is_next_inside)
+			{
+				lerp_vertex(output[output_count++], input[i], input[next],
+							distances[i] / (distances[i] - distances[next]));
+			}
+			else if (!is_current_inside && is_next_inside)
+			{
+				lerp_vertex(output[output_count++], input[next], input[i],
+							distances[next] / (distances[next] - distances[i]));
 			}
-			// Calculate the barycentric coordinates of point p.
-			bc[0] *= inverse_area;
-			bc[1] *= inverse_area;
-			bc[2] *= inverse_area;
+		}
+		count = output_count;
+		current ^= 1;
+		if (count < 3)
+		{
+			return;
+		}
+	}
+
+	vertex *polygon = polygons[current];
+	for (int i = 0; i < count; i++)
+	{
+		// Only the eye itself can be on both the near and far side.
+		if (!(polygon[i].position.w > 0.0f))
+		{
+			return;
+		}
+		polygon[i].perspective_division();
+		polygon[i].viewport_transform();
+	}
+	vertex fan[3];
+	fan[0] = polygon[0];
+	for (int i = 1; i + 1 < count; i++)
+	{
+		fan[1] = polygon[i];
+		fan[2] = polygon[i + 1];
+		rasterize_triangle(framebuffer, uniform, fan);
+	}
+}
 
-			if (depth_test(x, y, vertices, bc))
+// The path of a triangle through clipping.
+enum class clipping_path : uint8_t
+{
+	CULLED,
+	INSIDE,
+	GUARD_BAND,
+	CLIPPED
+};
+
+// Chooses the path of a triangle from the clip codes of its vertices and
+// counts it.
+static clipping_path classify_triangle(uint8_t code0, uint8_t code1, uint8_t code2)
+{
+	if ((code0 & code1 & code2) & CLIP_VIEW_PLANES)
+	{
+		// All vertices are outside the same plane.
+		COUNT_STATISTIC(culled_triangles, 1);
+		return clipping_path::CULLED;
+	}
+	uint8_t codes = code0 | code1 | code2;
+	if (codes & (CLIP_NEAR | CLIP_FAR | CLIP_GUARD_BAND))
+	{
+		COUNT_STATISTIC(clipped_triangles, 1);
+		return clipping_path::CLIPPED;
+	}
+	if (codes != 0)
+	{
+		COUNT_STATISTIC(guard_band_triangles, 1);
+		return clipping_path::GUARD_BAND;
+	}
+	COUNT_STATISTIC(inside_triangles, 1);
+	return clipping_path::INSIDE;
+}
+
+// The counters of pipeline_statistics, for the functions that handle them
+// all. A counter missing here fails the size check below.
+#define PIPELINE_STATISTICS_COUNTERS(COUNTER) \
+	COUNTER(shaded_vertices)                  \
+	COUNTER(submitted_triangles)              \
+	COUNTER(inside_triangles)                 \
+	COUNTER(guard_band_triangles)             \
+	COUNTER(clipped_triangles)                \
+	COUNTER(culled_triangles)                 \
+	COUNTER(back_facing_triangles)            \
+	COUNTER(degenerate_triangles)             \
+	COUNTER(tested_pixels)                    \
+	COUNTER(covered_fragments)                \
+	COUNTER(depth_rejected_fragments)         \
+	COUNTER(shaded_fragments)                 \
+	COUNTER(color_writes)
+#define COUNTER_SIZE_HELPER(counter) +sizeof(pipeline_statistics::counter)
+static_assert(sizeof(pipeline_statistics) == 0 PIPELINE_STATISTICS_COUNTERS(COUNTER_SIZE_HELPER),
+			  "A counter of pipeline_statistics is missing from PIPELINE_STATISTICS_COUNTERS.");
+
+void pipeline_statistics::add(const pipeline_statistics &other)
+{
+#define ADD_COUNTER_HELPER(counter) counter += other.counter;
+	PIPELINE_STATISTICS_COUNTERS(ADD_COUNTER_HELPER)
+}
+
+void pipeline_statistics::subtract(const pipeline_statistics &other)
+{
+#define SUBTRACT_COUNTER_HELPER(counter) counter -= other.counter;
+	PIPELINE_STATISTICS_COUNTERS(SUBTRACT_COUNTER_HELPER)
+}
+
+void begin_draw_statistics()
+{
+#ifndef RASTERIZER_NO_STATISTICS
+	draw_start_counters = thread_counters;
+#endif
+}
+
+pipeline_statistics get_draw_statistics()
+{
+	pipeline_statistics result{};
+#ifndef RASTERIZER_NO_STATISTICS
+	result = thread_counters;
+	result.subtract(draw_start_counters);
+#endif
+	return result;
+}
+
+void merge_pipeline_statistics()
+{
+#ifndef RASTERIZER_NO_STATISTICS
+	{
+		std::lock_guard<std::mutex> lock(frame_counters_mutex);
+		frame_counters.add(thread_counters);
+	}
+	thread_counters = pipeline_statistics{};
+	draw_start_counters = pipeline_statistics{};
+#endif
+}
+
+pipeline_statistics end_frame_statistics()
+{
+	pipeline_statistics result{};
+#ifndef RASTERIZER_NO_STATISTICS
+	merge_pipeline_statistics();
+	std::lock_guard<std::mutex> lock(frame_counters_mutex);
+	result = frame_counters;
+	frame_counters = pipeline_statistics{};
+#endif
+	return result;
+}
+
+void draw_triangle(FrameBuffer *framebuffer, const void *uniform, const void *const vertex_attributes[])
+{
+	if (vs == nullptr || framebuffer == nullptr)
+	{
+		return;
+	}
+	parse_framebuffer(*framebuffer);
+	COUNT_STATISTIC(submitted_triangles, 1);
+	COUNT_STATISTIC(shaded_vertices, 3);
+	vertex vertices[3];
+	uint8_t codes[3];
+	{
+		PROFILE_DETAIL_ZONE("vertex processing");
+		for (int i = 0; i < 3; i++)
+		{
+			auto &vtx = vertices[i];
+			vtx.context.clear();
+			vtx.position = vs(&vtx.context, uniform, vertex_attributes[i]);
+			codes[i] = vtx.compute_clip_code();
+		}
+	}
+	// The coverage, depth test and fragment shading of each quad are done
+	// together, so they are one zone.
+	PROFILE_DETAIL_ZONE("rasterization");
+	switch (classify_triangle(codes[0], codes[1], codes[2]))
+	{
+	case clipping_path::CULLED:
+		return;
+	case clipping_path::CLIPPED:
+		rasterize_clipped_triangle(framebuffer, uniform, vertices);
+		return;
+	default:
+		break;
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		vertices[i].perspective_division();
+		vertices[i].viewport_transform();
+	}
+	rasterize_triangle(framebuffer, uniform, vertices);
+}
+
+void transformed_vertices::resize(size_t count)
+{
+	screen_x.resize(count);
+	screen_y.resize(count);
+	depth.resize(count);
+	inverse_w.resize(count);
+	clip_x.resize(count);
+	clip_y.resize(count);
+	clip_z.resize(count);
+	clip_w.resize(count);
+	clip_codes.resize(count);
+}
+
+#ifdef RASTERIZER_USE_AVX2
+// Transforms 8 positions per iteration. The products are added in the same
+// order as matrix4x4 * vec4 and no FMA is used, so the results are the same as
+// the scalar path, bit for bit. Returns the number of positions transformed,
+// the caller transforms the rest.
+__attribute__((target("avx2"))) static size_t transform_vertices_avx2(const matrix4x4 &local2clip, const float *x,
+																	   const float *y, const float *z, size_t count,
+																	   transformed_vertices &output)
+{
+	__m256 m[4][4];
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			m[r][c] = _mm256_set1_ps(local2clip.elements[r][c]);
+		}
+	}
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 width = _mm256_set1_ps((float)viewport.width);
+	const __m256 height = _mm256_set1_ps((float)viewport.height);
+	const __m256 left = _mm256_set1_ps((float)viewport.left);
+	const __m256 bottom = _mm256_set1_ps((float)viewport.bottom);
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	const __m256 guard_band_scale = _mm256_set1_ps(GUARD_BAND_SCALE);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 px = _mm256_loadu_ps(x + i);
+		__m256 py = _mm256_loadu_ps(y + i);
+		__m256 pz = _mm256_loadu_ps(z + i);
+		__m256 clip[4];
+		for (int r = 0; r < 4; r++)
+		{
+			// The w component of the position is 1, m[r][3] * 1 is m[r][3].
+			__m256 sum = _mm256_mul_ps(m[r][0], px);
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(m[r][1], py));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(m[r][2], pz));
+			clip[r] = _mm256_add_ps(sum, m[r][3]);
+		}
+
+		// The clip codes, see vertex::compute_clip_code(). Each plane gives
+		// one bit per lane, in the order of the CLIP_* bits.
+		__m256 negative_w = _mm256_xor_ps(clip[3], sign);
+		__m256 guard_band_w = _mm256_mul_ps(guard_band_scale, clip[3]);
+		__m256 negative_guard_band_w = _mm256_xor_ps(guard_band_w, sign);
+		int plane_masks[7];
+		for (int c = 0; c < 3; c++)
+		{
+			plane_masks[c * 2] = _mm256_movemask_ps(_mm256_cmp_ps(clip[c], negative_w, _CMP_LT_OQ));
+			plane_masks[c * 2 + 1] = _mm256_movemask_ps(_mm256_cmp_ps(clip[c], clip[3], _CMP_GT_OQ));
+		}
+		__m256 outside_guard_band = _mm256_cmp_ps(clip[0], negative_guard_band_w, _CMP_LT_OQ);
+		outside_guard_band = _mm256_or_ps(outside_guard_band, _mm256_cmp_ps(clip[0], guard_band_w, _CMP_GT_OQ));
+		outside_guard_band =
+			_mm256_or_ps(outside_guard_band, _mm256_cmp_ps(clip[1], negative_guard_band_w, _CMP_LT_OQ));
+		outside_guard_band = _mm256_or_ps(outside_guard_band, _mm256_cmp_ps(clip[1], guard_band_w, _CMP_GT_OQ));
+		plane_masks[6] = _mm256_movemask_ps(outside_guard_band);
+		for (int k = 0; k < 8; k++)
+		{
+			uint8_t code = 0;
+			for (int plane = 0; plane < 7; plane++)
 			{
-				continue;
+				code |= (uint8_t)(((plane_masks[plane] >> k) & 1) << plane);
 			}
-			ShaderContext input;
-			input.clear();
-			set_fragment_shader_input(&input, vertices, bc);
-			vec4 fragment_color = fs(&input, uniform);
-			if (color_buffer != nullptr)
+			output.clip_codes[i + k] = code;
+		}
+		_mm256_storeu_ps(output.clip_x.data() + i, clip[0]);
+		_mm256_storeu_ps(output.clip_y.data() + i, clip[1]);
+		_mm256_storeu_ps(output.clip_z.data() + i, clip[2]);
+		_mm256_storeu_ps(output.clip_w.data() + i, clip[3]);
+
+		__m256 inverse_w = _mm256_div_ps(one, clip[3]);
+		__m256 ndc_x = _mm256_mul_ps(clip[0], inverse_w);
+		__m256 ndc_y = _mm256_mul_ps(clip[1], inverse_w);
+		__m256 ndc_z = _mm256_mul_ps(clip[2], inverse_w);
+		__m256 screen_x = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(ndc_x, one), half), width), left);
+		__m256 screen_y = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(ndc_y, one), half), height), bottom);
+		__m256 depth = _mm256_mul_ps(_mm256_add_ps(ndc_z, one), half);
+		_mm256_storeu_ps(output.screen_x.data() + i, screen_x);
+		_mm256_storeu_ps(output.screen_y.data() + i, screen_y);
+		_mm256_storeu_ps(output.depth.data() + i, depth);
+		_mm256_storeu_ps(output.inverse_w.data() + i, inverse_w);
+	}
+	return i;
+}
+#endif
+
+void transform_vertices(const matrix4x4 &local2clip, const float *x, const float *y, const float *z,
+						size_t count, transformed_vertices &output)
+{
+	PROFILE_ZONE("transform vertices");
+	output.resize(count);
+	COUNT_STATISTIC(shaded_vertices, count);
+	size_t i = 0;
+#ifdef RASTERIZER_USE_AVX2
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	if (has_avx2)
+	{
+		i = transform_vertices_avx2(local2clip, x, y, z, count, output);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		vertex vtx;
+		vtx.position = local2clip * vec4{x[i], y[i], z[i], 1.0f};
+		output.clip_codes[i] = vtx.compute_clip_code();
+		output.clip_x[i] = vtx.position.x;
+		output.clip_y[i] = vtx.position.y;
+		output.clip_z[i] = vtx.position.z;
+		output.clip_w[i] = vtx.position.w;
+		vtx.perspective_division();
+		vtx.viewport_transform();
+		output.screen_x[i] = vtx.screen_space_position.x;
+		output.screen_y[i] = vtx.screen_space_position.y;
+		output.depth[i] = vtx.depth;
+		output.inverse_w[i] = vtx.inverse_w;
+	}
+}
+
+// The common part of draw_transformed_triangle() and draw_shaded_triangle():
+// the variables of a vertex are copied from contexts if it is not null,
+// otherwise they are saved by the vertex shader if vertex_attributes is not
+// null.
+static void draw_indexed_triangle(FrameBuffer *framebuffer, const void *uniform, const transformed_vertices &vertices,
+								  const uint32_t indices[], const void *const vertex_attributes[],
+								  const ShaderContext contexts[])
+{
+	COUNT_STATISTIC(submitted_triangles, 1);
+	clipping_path path = classify_triangle(vertices.clip_codes[indices[0]], vertices.clip_codes[indices[1]],
+										   vertices.clip_codes[indices[2]]);
+	if (path == clipping_path::CULLED)
+	{
+		return;
+	}
+	parse_framebuffer(*framebuffer);
+	vertex triangle[3];
+	{
+		PROFILE_DETAIL_ZONE("vertex processing");
+		for (int i = 0; i < 3; i++)
+		{
+			auto &vtx = triangle[i];
+			uint32_t index = indices[i];
+			if (contexts != nullptr)
+			{
+				vtx.context = contexts[index];
+			}
+			else
 			{
-				uint8_t *pixel = color_buffer + (y * framebuffer_width + x) * 4;
-				write_color(pixel, fragment_color);
+				vtx.context.clear();
+				if (vertex_attributes != nullptr)
+				{
+					// Only the variables are used, the position comes from the
+					// transformed vertices.
+					vs(&vtx.context, uniform, vertex_attributes[i]);
+					COUNT_STATISTIC(shaded_vertices, 1);
+				}
 			}
+			vtx.position = vec4{vertices.clip_x[index], vertices.clip_y[index], vertices.clip_z[index],
+								vertices.clip_w[index]};
+			vtx.screen_space_position = vec2{vertices.screen_x[index], vertices.screen_y[index]};
+			vtx.depth = vertices.depth[index];
+			vtx.inverse_w = vertices.inverse_w[index];
 		}
 	}
+	PROFILE_DETAIL_ZONE("rasterization");
+	if (path == clipping_path::CLIPPED)
+	{
+		rasterize_clipped_triangle(framebuffer, uniform, triangle);
+		return;
+	}
+	rasterize_triangle(framebuffer, uniform, triangle);
+}
+
+void draw_transformed_triangle(FrameBuffer *framebuffer, const void *uniform, const transformed_vertices &vertices,
+							   const uint32_t indices[], const void *const vertex_attributes[])
+{
+	if (framebuffer == nullptr || (vertex_attributes != nullptr && vs == nullptr))
+	{
+		return;
+	}
+	draw_indexed_triangle(framebuffer, uniform, vertices, indices, vertex_attributes, nullptr);
+}
+
+void shade_vertices(const void *uniform, const void *vertex_attributes, size_t attribute_size, size_t count,
+					std::vector<ShaderContext> &contexts)
+{
+	contexts.resize(count);
+	if (vs == nullptr)
+	{
+		return;
+	}
+	PROFILE_ZONE("shade vertices");
+	COUNT_STATISTIC(shaded_vertices, count);
+	const uint8_t *attributes = (const uint8_t *)vertex_attributes;
+	for (size_t i = 0; i < count; i++)
+	{
+		// Only the variables are used, the position comes from the
+		// transformed vertices.
+		contexts[i].clear();
+		vs(&contexts[i], uniform, attributes + i * attribute_size);
+	}
+}
+
+void draw_shaded_triangle(FrameBuffer *framebuffer, const void *uniform, const transformed_vertices &vertices,
+						  const ShaderContext contexts[], const uint32_t indices[])
+{
+	if (framebuffer == nullptr || contexts == nullptr)
+	{
+		return;
+	}
+	draw_indexed_triangle(framebuffer, uniform, vertices, indices, nullptr, contexts);
 }
+
+#undef PACKET_INTERPOLATION_HELPER
+#undef PIPELINE_STATISTICS_COUNTERS
+#undef COUNTER_SIZE_HELPER
+#undef ADD_COUNTER_HELPER
+#undef SUBTRACT_COUNTER_HELPER
+#undef COUNT_STATISTIC
+#undef SAMPLE_MARGIN
+#undef LERP_VARIABLES_HELPER
+#undef CLIP_LEFT
+#undef CLIP_RIGHT
+#undef CLIP_BOTTOM
+#undef CLIP_TOP
+#undef CLIP_NEAR
+#undef CLIP_FAR
+#undef CLIP_GUARD_BAND
+#undef CLIP_VIEW_PLANES
+#undef GUARD_BAND_SCALE
+#undef MAX_CLIPPED_VERTICES
+#undef RASTERIZER_USE_AVX2
@@ -1,4 +1,6 @@
 #include "graphics/texture.h"
+#include "graphics/depth_compression.h"
+#include "graphics/texture_compression.h"
 #include <cstring>
 
 inline static size_t get_pixel_size(texture_format format)
@@ -15,6 +17,12 @@ inline static size_t get_pixel_size(texture_format format)
         return 4;
     case texture_format::TEXTURE_FORMAT_DEPTH_FLOAT:
         return sizeof(float);
+    case texture_format::TEXTURE_FORMAT_RGBA_FLOAT:
+        return 4 * sizeof(float);
+    case texture_format::TEXTURE_FORMAT_DEPTH16:
+        return sizeof(uint16_t);
+    case texture_format::TEXTURE_FORMAT_DEPTH24:
+        return 3;
     default:
         return 0;
     }
@@ -29,6 +37,22 @@ inline static bool is_srgb_encoding(texture_format format)
     return false;
 }
 
+bool Texture::is_block_compressed(texture_format format)
+{
+    return get_block_size(format) != 0;
+}
+
+size_t Texture::get_data_size(texture_format format, uint32_t width, uint32_t height)
+{
+    if (is_block_compressed(format))
+    {
+        size_t blocks_per_row = (width + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+        size_t blocks_per_column = (height + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+        return get_block_size(format) * blocks_per_row * blocks_per_column;
+    }
+    return get_pixel_size(format) * width * height;
+}
+
 Texture::Texture(texture_format form, uint32_t width, uint32_t height)
     : m_format(form), m_width(width), m_height(height)
 {
@@ -37,20 +61,31 @@ Texture::Texture(texture_format form, uint32_t width, uint32_t height)
         return;
     }
 
-    size_t pixel_size = get_pixel_size(m_format);
-    if (pixel_size == 0)
+    size_t data_size = get_data_size(m_format, m_width, m_height);
+    if (data_size == 0)
     {
         return;
     }
 
-    pixels.resize(pixel_size * m_width * m_height);
+    pixels.resize(data_size);
 }
 
+Texture::Texture(texture_format form, uint32_t width, uint32_t height, uint8_t *data, std::shared_ptr<void> owner)
+    : m_format(form), m_width(width), m_height(height), external_pixels(data), external_owner(std::move(owner)) {}
+
 Texture::Texture(const Texture &other)
-    : m_format(other.m_format), m_width(other.m_width), m_height(other.m_height), pixels(other.pixels) {}
+    : m_format(other.m_format), m_width(other.m_width), m_height(other.m_height)
+{
+    const uint8_t *data = other.get_pixels();
+    pixels.assign(data, data + (other.external_pixels ? get_data_size(m_format, m_width, m_height) : other.pixels.size()));
+}
 
 Texture::Texture(Texture &&other) noexcept
-    : m_format(other.m_format), m_width(other.m_width), m_height(other.m_height), pixels(std::move(other.pixels)) {}
+    : m_format(other.m_format), m_width(other.m_width), m_height(other.m_height), pixels(std::move(other.pixels)),
+      external_pixels(other.external_pixels), external_owner(std::move(other.external_owner))
+{
+    other.external_pixels = nullptr;
+}
 
 Texture &Texture::operator=(Texture &&other) noexcept
 {
@@ -58,41 +93,54 @@ Texture &Texture::operator=(Texture &&other) noexcept
     this->m_width = other.m_width;
     this->m_height = other.m_height;
     this->pixels = std::move(other.pixels);
+    this->external_pixels = other.external_pixels;
+    this->external_owner = std::move(other.external_owner);
+    other.external_pixels = nullptr;
 
     return *this;
 }
 
 Texture &Texture::operator=(const Texture &other)
 {
+    if (this == &other)
+    {
+        return *this;
+    }
     this->m_format = other.m_format;
     this->m_width = other.m_width;
     this->m_height = other.m_height;
-    this->pixels = other.pixels;
+    const uint8_t *data = other.get_pixels();
+    this->pixels.assign(data, data + (other.external_pixels ? get_data_size(m_format, m_width, m_height) : other.pixels.size()));
+    this->external_pixels = nullptr;
+    this->external_owner.reset();
 
     return *this;
 }
 
 /*
     Move given vector data to texture pixels
+    The texture stops viewing external memory
 */
 void Texture::set_texture_pixels(std::vector<uint8_t> &&pixels)
 {
     this->pixels = std::move(pixels);
+    external_pixels = nullptr;
+    external_owner.reset();
 }
 
 /*
     Copy given raw array to texture pixels
-    Be careful that the size of the array should be pixel_size * width * height
+    Be careful that the size of the array should be get_data_size(m_format, width, height)
 */
 bool Texture::set_texture_pixels(void *pixels)
 {
-    size_t pixel_size = get_pixel_size(m_format);
-    if (pixel_size == 0)
+    size_t data_size = get_data_size(m_format, m_width, m_height);
+    if (data_size == 0)
     {
         return false;
     }
 
-    memcpy(this->pixels.data(), pixels, pixel_size * m_width * m_height);
+    memcpy(get_pixels(), pixels, data_size);
     return true;
 }
 
@@ -102,12 +150,12 @@ bool Texture::set_texture_pixels(void *pixels)
 */
 uint8_t *Texture::get_pixels()
 {
-    return pixels.data();
+    return external_pixels ? external_pixels : pixels.data();
 }
 
 const uint8_t *Texture::get_pixels() const
 {
-    return pixels.data();
+    return external_pixels ? external_pixels : pixels.data();
 }
 
 /*
@@ -129,6 +177,16 @@ vec4 Texture::sample(vec2 texcoord) const
     // Prevent array access out of bounds.
     u_index = u_index >= m_width ? m_width - 1 : u_index;
     v_index = v_index >= m_height ? m_height - 1 : v_index;
+    if (is_block_compressed(m_format))
+    {
+        // Only decodes the 4x4 block that contains the pixel.
+        return sample_compressed_texel(*this, u_index, v_index);
+    }
+    if (m_format == texture_format::TEXTURE_FORMAT_DEPTH16_TILED)
+    {
+        float depth = sample_compressed_depth(*this, u_index, v_index);
+        return vec4{depth, depth, depth, 1.0f};
+    }
     size_t pixel_offset = (size_t)u_index + v_index * m_width;
 
     auto pixel = VEC4_ONE;
@@ -140,6 +198,25 @@ vec4 Texture::sample(vec2 texcoord) const
         pixel.g = *target;
         pixel.b = *target;
     }
+    else if (m_format == texture_format::TEXTURE_FORMAT_DEPTH16)
+    {
+        uint16_t depth;
+        memcpy(&depth, raw_pixels + pixel_offset * sizeof(uint16_t), sizeof(uint16_t));
+        pixel.r = depth16_to_float(depth);
+        pixel.g = pixel.r;
+        pixel.b = pixel.r;
+    }
+    else if (m_format == texture_format::TEXTURE_FORMAT_DEPTH24)
+    {
+        const uint8_t *target = raw_pixels + pixel_offset * 3;
+        pixel.r = depth24_to_float(target[0] | (uint32_t)target[1] << 8 | (uint32_t)target[2] << 16);
+        pixel.g = pixel.r;
+        pixel.b = pixel.r;
+    }
+    else if (m_format == texture_format::TEXTURE_FORMAT_RGBA_FLOAT)
+    {
+        memcpy(pixel.elements, (float *)raw_pixels + pixel_offset * 4, sizeof(pixel.elements));
+    }
     else if (m_format == texture_format::TEXTURE_FORMAT_R8)
     {
         const uint8_t *target = (uint8_t *)raw_pixels + pixel_offset;
@@ -162,15 +239,23 @@ vec4 Texture::sample(vec2 texcoord) const
             // m_format == TEXTURE_FORMAT_SRGB8_A8)
             const uint8_t *target =
                 (uint8_t *)raw_pixels + pixel_offset * pixel_size;
-            for (size_t i = 0; i < pixel_size; i++)
+            if (is_srgb_encoding(m_format))
             {
-                pixel.elements[i] = uint8_to_float(target[i]);
+                // Decode through the lookup table, no powf() per texel.
+                pixel.r = srgb8_to_linear(target[0]);
+                pixel.g = srgb8_to_linear(target[1]);
+                pixel.b = srgb8_to_linear(target[2]);
+                if (pixel_size == 4)
+                {
+                    pixel.a = uint8_to_float(target[3]);
+                }
             }
-            if (is_srgb_encoding(m_format))
+            else
             {
-                pixel.r = convert_to_linear_color(pixel.r);
-                pixel.g = convert_to_linear_color(pixel.g);
-                pixel.b = convert_to_linear_color(pixel.b);
+                for (size_t i = 0; i < pixel_size; i++)
+                {
+                    pixel.elements[i] = uint8_to_float(target[i]);
+                }
             }
         }
     }
@@ -0,0 +1,572 @@
+#include "graphics/texture_compression.h"
+#include "graphics/color.h"
+#include <cfloat>
+#include <cstring>
+
+// Number of decoded blocks cached per thread, must be a power of two.
+#define DECODED_BLOCK_CACHE_SIZE 64
+
+size_t get_block_size(texture_format format)
+{
+    switch (format)
+    {
+    case texture_format::TEXTURE_FORMAT_BC1:
+    case texture_format::TEXTURE_FORMAT_BC1_SRGB:
+    case texture_format::TEXTURE_FORMAT_BC4:
+        return 8;
+    case texture_format::TEXTURE_FORMAT_BC5:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+// ----------------------Decoding----------------------
+
+// Expands a RGB565 color to RGB888 by replicating the high bits.
+static void unpack_rgb565(uint16_t color, uint8_t result[3])
+{
+    uint8_t r = (color >> 11) & 0x1F;
+    uint8_t g = (color >> 5) & 0x3F;
+    uint8_t b = color & 0x1F;
+    result[0] = (r << 3) | (r >> 2);
+    result[1] = (g << 2) | (g >> 4);
+    result[2] = (b << 3) | (b >> 2);
+}
+
+static void bc1_palette(uint16_t color0, uint16_t color1, uint8_t palette[4][4])
+{
+    unpack_rgb565(color0, palette[0]);
+    unpack_rgb565(color1, palette[1]);
+    palette[0][3] = 0xFF;
+    palette[1][3] = 0xFF;
+    for (int c = 0; c < 3; c++)
+    {
+        int c0 = palette[0][c];
+        int c1 = palette[1][c];
+        if (color0 > color1)
+        {
+            palette[2][c] = (uint8_t)((2 * c0 + c1 + 1) / 3);
+            palette[3][c] = (uint8_t)((c0 + 2 * c1 + 1) / 3);
+        }
+        else
+        {
+            palette[2][c] = (uint8_t)((c0 + c1 + 1) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 0xFF;
+    // In the 3-color mode, the 4th color is transparent black.
+    palette[3][3] = color0 > color1 ? 0xFF : 0;
+}
+
+static void bc4_palette(uint8_t red0, uint8_t red1, uint8_t palette[8])
+{
+    palette[0] = red0;
+    palette[1] = red1;
+    if (red0 > red1)
+    {
+        for (int i = 1; i < 7; i++)
+        {
+            palette[i + 1] = (uint8_t)(((7 - i) * red0 + i * red1 + 3) / 7);
+        }
+    }
+    else
+    {
+        for (int i = 1; i < 5; i++)
+        {
+            palette[i + 1] = (uint8_t)(((5 - i) * red0 + i * red1 + 2) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 0xFF;
+    }
+}
+
+static uint64_t read_uint48(const uint8_t *bytes)
+{
+    uint64_t result = 0;
+    for (int i = 5; i >= 0; i--)
+    {
+        result = (result << 8) | bytes[i];
+    }
+    return result;
+}
+
+// Decodes a BC4 block into the given component of the pixels.
+static void decode_bc4_block(const uint8_t *block, uint8_t pixels[16][4], int component)
+{
+    uint8_t palette[8];
+    bc4_palette(block[0], block[1], palette);
+    uint64_t indices = read_uint48(block + 2);
+    for (int i = 0; i < 16; i++)
+    {
+        pixels[i][component] = palette[(indices >> (3 * i)) & 0x7];
+    }
+}
+
+void decode_block(texture_format format, const uint8_t *block, uint8_t pixels[16][4])
+{
+    switch (format)
+    {
+    case texture_format::TEXTURE_FORMAT_BC1:
+    case texture_format::TEXTURE_FORMAT_BC1_SRGB:
+    {
+        uint16_t color0 = (uint16_t)(block[0] | (block[1] << 8));
+        uint16_t color1 = (uint16_t)(block[2] | (block[3] << 8));
+        uint8_t palette[4][4];
+        bc1_palette(color0, color1, palette);
+        uint32_t indices = (uint32_t)block[4] | ((uint32_t)block[5] << 8) |
+                           ((uint32_t)block[6] << 16) | ((uint32_t)block[7] << 24);
+        for (int i = 0; i < 16; i++)
+        {
+            memcpy(pixels[i], palette[(indices >> (2 * i)) & 0x3], 4);
+        }
+        break;
+    }
+    case texture_format::TEXTURE_FORMAT_BC4:
+        for (int i = 0; i < 16; i++)
+        {
+            pixels[i][1] = 0;
+            pixels[i][2] = 0;
+            pixels[i][3] = 0xFF;
+        }
+        decode_bc4_block(block, pixels, 0);
+        break;
+    case texture_format::TEXTURE_FORMAT_BC5:
+        for (int i = 0; i < 16; i++)
+        {
+            pixels[i][2] = 0;
+            pixels[i][3] = 0xFF;
+        }
+        decode_bc4_block(block, pixels, 0);
+        decode_bc4_block(block + 8, pixels, 1);
+        break;
+    default:
+        memset(pixels, 0, 16 * 4);
+        break;
+    }
+}
+
+// ----------------------Encoding----------------------
+
+static uint16_t pack_rgb565(const float color[3])
+{
+    int r = (int)(clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = (int)(clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = (int)(clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static int color_distance(const uint8_t a[4], const uint8_t b[4])
+{
+    int dr = a[0] - b[0];
+    int dg = a[1] - b[1];
+    int db = a[2] - b[2];
+    return dr * dr + dg * dg + db * db;
+}
+
+// Chooses the endpoints along the principal axis of the block colors, similar
+// to the approach of stb_dxt:
+// https://github.com/nothings/stb/blob/master/stb_dxt.h
+static void encode_bc1_block(const uint8_t pixels[16][4], uint8_t *block)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            mean[c] += pixels[i][c];
+        }
+    }
+    for (int c = 0; c < 3; c++)
+    {
+        mean[c] /= 16.0f;
+    }
+
+    // Covariance matrix of the colors.
+    float covariance[3][3] = {{0.0f}};
+    for (int i = 0; i < 16; i++)
+    {
+        float d[3] = {pixels[i][0] - mean[0], pixels[i][1] - mean[1], pixels[i][2] - mean[2]};
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                covariance[r][c] += d[r] * d[c];
+            }
+        }
+    }
+
+    // A few steps of power iteration find the principal axis.
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 4; iteration++)
+    {
+        float next[3];
+        for (int r = 0; r < 3; r++)
+        {
+            next[r] = covariance[r][0] * axis[0] + covariance[r][1] * axis[1] + covariance[r][2] * axis[2];
+        }
+        float length = std::max(std::max(fabsf(next[0]), fabsf(next[1])), fabsf(next[2]));
+        if (length < SMALL_ABSOLUTE_FLOAT)
+        {
+            break;
+        }
+        for (int c = 0; c < 3; c++)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    // Project the colors on the axis to find the extremes.
+    float min_projection = FLT_MAX;
+    float max_projection = -FLT_MAX;
+    for (int i = 0; i < 16; i++)
+    {
+        float projection = (pixels[i][0] - mean[0]) * axis[0] +
+                           (pixels[i][1] - mean[1]) * axis[1] +
+                           (pixels[i][2] - mean[2]) * axis[2];
+        min_projection = std::min(min_projection, projection);
+        max_projection = std::max(max_projection, projection);
+    }
+    float axis_length_squared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    // Inset the endpoints by 1/16 of the range, which reduces the error of the
+    // interpolated colors.
+    float inset = (max_projection - min_projection) / 16.0f;
+    float endpoint_max[3], endpoint_min[3];
+    for (int c = 0; c < 3; c++)
+    {
+        endpoint_max[c] = mean[c] + axis[c] * (max_projection - inset) / axis_length_squared;
+        endpoint_min[c] = mean[c] + axis[c] * (min_projection + inset) / axis_length_squared;
+    }
+
+    uint16_t color0 = pack_rgb565(endpoint_max);
+    uint16_t color1 = pack_rgb565(endpoint_min);
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        // color0 > color1 selects the 4-color mode.
+        uint8_t palette[4][4];
+        bc1_palette(color0, color1, palette);
+        for (int i = 0; i < 16; i++)
+        {
+            uint32_t best_index = 0;
+            int best_distance = color_distance(pixels[i], palette[0]);
+            for (uint32_t p = 1; p < 4; p++)
+            {
+                int distance = color_distance(pixels[i], palette[p]);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best_index = p;
+                }
+            }
+            indices |= best_index << (2 * i);
+        }
+    }
+
+    block[0] = color0 & 0xFF;
+    block[1] = color0 >> 8;
+    block[2] = color1 & 0xFF;
+    block[3] = color1 >> 8;
+    block[4] = indices & 0xFF;
+    block[5] = (indices >> 8) & 0xFF;
+    block[6] = (indices >> 16) & 0xFF;
+    block[7] = (indices >> 24) & 0xFF;
+}
+
+// Encodes the given component of the pixels as a BC4 block.
+static void encode_bc4_block(const uint8_t pixels[16][4], int component, uint8_t *block)
+{
+    uint8_t min_value = 0xFF;
+    uint8_t max_value = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        min_value = std::min(min_value, pixels[i][component]);
+        max_value = std::max(max_value, pixels[i][component]);
+    }
+
+    // red0 > red1 selects the mode with 6 interpolated values. If all values
+    // are the same, red0 == red1 and every index can be 0.
+    uint8_t palette[8];
+    bc4_palette(max_value, min_value, palette);
+    uint64_t indices = 0;
+    if (max_value != min_value)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int value = pixels[i][component];
+            uint64_t best_index = 0;
+            int best_distance = abs(value - palette[0]);
+            for (uint64_t p = 1; p < 8; p++)
+            {
+                int distance = abs(value - palette[p]);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best_index = p;
+                }
+            }
+            indices |= best_index << (3 * i);
+        }
+    }
+
+    block[0] = max_value;
+    block[1] = min_value;
+    for (int i = 0; i < 6; i++)
+    {
+        block[2 + i] = (indices >> (8 * i)) & 0xFF;
+    }
+}
+
+// Reads the block of pixels whose bottom-left pixel is (x, y) as RGBA8, pixels
+// outside the texture are clamped to the edge.
+static void fetch_block(const Texture &source, size_t component_count, uint32_t x, uint32_t y,
+                        uint8_t pixels[16][4])
+{
+    const uint8_t *data = source.get_pixels();
+    for (uint32_t j = 0; j < TEXTURE_BLOCK_SIZE; j++)
+    {
+        uint32_t source_y = std::min(y + j, source.m_height - 1);
+        for (uint32_t i = 0; i < TEXTURE_BLOCK_SIZE; i++)
+        {
+            uint32_t source_x = std::min(x + i, source.m_width - 1);
+            const uint8_t *pixel = data + ((size_t)source_y * source.m_width + source_x) * component_count;
+            uint8_t *result = pixels[j * TEXTURE_BLOCK_SIZE + i];
+            if (component_count == 1)
+            {
+                result[0] = result[1] = result[2] = pixel[0];
+                result[3] = 0xFF;
+            }
+            else
+            {
+                result[0] = pixel[0];
+                result[1] = pixel[1];
+                result[2] = pixel[2];
+                result[3] = component_count == 4 ? pixel[3] : 0xFF;
+            }
+        }
+    }
+}
+
+std::unique_ptr<Texture> compress_texture(const Texture &source, texture_format format)
+{
+    size_t component_count;
+    switch (source.m_format)
+    {
+    case texture_format::TEXTURE_FORMAT_R8:
+        component_count = 1;
+        break;
+    case texture_format::TEXTURE_FORMAT_RGB8:
+    case texture_format::TEXTURE_FORMAT_SRGB8:
+        component_count = 3;
+        break;
+    case texture_format::TEXTURE_FORMAT_RGBA8:
+    case texture_format::TEXTURE_FORMAT_SRGB8_A8:
+        component_count = 4;
+        break;
+    default:
+        return nullptr;
+    }
+    bool is_srgb_source = source.m_format == texture_format::TEXTURE_FORMAT_SRGB8 ||
+                          source.m_format == texture_format::TEXTURE_FORMAT_SRGB8_A8;
+
+    // Check whether the conversion is supported.
+    switch (format)
+    {
+    case texture_format::TEXTURE_FORMAT_BC1:
+        if (is_srgb_source || component_count == 1)
+        {
+            return nullptr;
+        }
+        break;
+    case texture_format::TEXTURE_FORMAT_BC1_SRGB:
+        if (!is_srgb_source)
+        {
+            return nullptr;
+        }
+        break;
+    case texture_format::TEXTURE_FORMAT_BC4:
+        if (is_srgb_source)
+        {
+            return nullptr;
+        }
+        break;
+    case texture_format::TEXTURE_FORMAT_BC5:
+        if (is_srgb_source || component_count == 1)
+        {
+            return nullptr;
+        }
+        break;
+    default:
+        return nullptr;
+    }
+    if (source.m_width == 0 || source.m_height == 0)
+    {
+        return nullptr;
+    }
+
+    auto texture = std::make_unique<Texture>(format, source.m_width, source.m_height);
+    size_t block_size = get_block_size(format);
+    uint8_t *block = texture->get_pixels();
+    for (uint32_t y = 0; y < source.m_height; y += TEXTURE_BLOCK_SIZE)
+    {
+        for (uint32_t x = 0; x < source.m_width; x += TEXTURE_BLOCK_SIZE)
+        {
+            uint8_t pixels[16][4];
+            fetch_block(source, component_count, x, y, pixels);
+            if (format == texture_format::TEXTURE_FORMAT_BC1 ||
+                format == texture_format::TEXTURE_FORMAT_BC1_SRGB)
+            {
+                encode_bc1_block(pixels, block);
+            }
+            else if (format == texture_format::TEXTURE_FORMAT_BC4)
+            {
+                encode_bc4_block(pixels, 0, block);
+            }
+            else
+            {
+                encode_bc4_block(pixels, 0, block);
+                encode_bc4_block(pixels, 1, block + 8);
+            }
+            block += block_size;
+        }
+    }
+    return texture;
+}
+
+std::unique_ptr<Texture> decompress_texture(const Texture &source)
+{
+    texture_format format;
+    switch (source.m_format)
+    {
+    case texture_format::TEXTURE_FORMAT_BC1:
+    case texture_format::TEXTURE_FORMAT_BC5:
+        format = texture_format::TEXTURE_FORMAT_RGB8;
+        break;
+    case texture_format::TEXTURE_FORMAT_BC1_SRGB:
+        format = texture_format::TEXTURE_FORMAT_SRGB8;
+        break;
+    case texture_format::TEXTURE_FORMAT_BC4:
+        format = texture_format::TEXTURE_FORMAT_R8;
+        break;
+    default:
+        return nullptr;
+    }
+    auto texture = std::make_unique<Texture>(format, source.m_width, source.m_height);
+    size_t component_count = format == texture_format::TEXTURE_FORMAT_R8 ? 1 : 3;
+    size_t block_size = get_block_size(source.m_format);
+    const uint8_t *block = source.get_pixels();
+    uint8_t *pixels = texture->get_pixels();
+    for (uint32_t y = 0; y < source.m_height; y += TEXTURE_BLOCK_SIZE)
+    {
+        for (uint32_t x = 0; x < source.m_width; x += TEXTURE_BLOCK_SIZE)
+        {
+            uint8_t decoded[16][4];
+            decode_block(source.m_format, block, decoded);
+            block += block_size;
+            // The pixels of partial blocks outside the texture are dropped.
+            uint32_t block_width = std::min<uint32_t>(TEXTURE_BLOCK_SIZE, source.m_width - x);
+            uint32_t block_height = std::min<uint32_t>(TEXTURE_BLOCK_SIZE, source.m_height - y);
+            for (uint32_t j = 0; j < block_height; j++)
+            {
+                for (uint32_t i = 0; i < block_width; i++)
+                {
+                    const uint8_t *pixel = decoded[j * TEXTURE_BLOCK_SIZE + i];
+                    uint8_t *target = pixels + ((size_t)(y + j) * source.m_width + x + i) * component_count;
+                    for (size_t c = 0; c < component_count; c++)
+                    {
+                        target[c] = pixel[c];
+                    }
+                    if (source.m_format == texture_format::TEXTURE_FORMAT_BC5)
+                    {
+                        // Reconstruct the Z component of the unit normal.
+                        float normal_x = uint8_to_float(pixel[0]) * 2.0f - 1.0f;
+                        float normal_y = uint8_to_float(pixel[1]) * 2.0f - 1.0f;
+                        float normal_z = sqrtf(std::max(0.0f, 1.0f - normal_x * normal_x - normal_y * normal_y));
+                        target[2] = (uint8_t)((normal_z * 0.5f + 0.5f) * 255.0f + 0.5f);
+                    }
+                }
+            }
+        }
+    }
+    return texture;
+}
+
+// ----------------------Sampling----------------------
+
+struct decoded_block
+{
+    texture_format format;
+    // The compressed data, used to validate a cache hit. Two blocks with the
+    // same data and format decode to the same pixels, so there is no need to
+    // invalidate the cache when a texture is destroyed.
+    uint8_t data[16];
+    uint8_t pixels[16][4];
+};
+
+// Zero initialized, the format of every entry is TEXTURE_FORMAT_R8 which never
+// matches a block compressed format.
+static thread_local decoded_block decoded_block_cache[DECODED_BLOCK_CACHE_SIZE];
+
+vec4 sample_compressed_texel(const Texture &texture, uint32_t x, uint32_t y)
+{
+    texture_format format = texture.m_format;
+    size_t block_size = get_block_size(format);
+    uint32_t blocks_per_row = (texture.m_width + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+    size_t block_index = (size_t)(y / TEXTURE_BLOCK_SIZE) * blocks_per_row + x / TEXTURE_BLOCK_SIZE;
+    const uint8_t *block = texture.get_pixels() + block_index * block_size;
+
+    uintptr_t address = (uintptr_t)block;
+    size_t slot = ((address >> 3) ^ (address >> 11)) & (DECODED_BLOCK_CACHE_SIZE - 1);
+    decoded_block &entry = decoded_block_cache[slot];
+    if (entry.format != format || memcmp(entry.data, block, block_size) != 0)
+    {
+        entry.format = format;
+        memcpy(entry.data, block, block_size);
+        decode_block(format, block, entry.pixels);
+    }
+
+    const uint8_t *pixel =
+        entry.pixels[(y % TEXTURE_BLOCK_SIZE) * TEXTURE_BLOCK_SIZE + x % TEXTURE_BLOCK_SIZE];
+    vec4 result = VEC4_ONE;
+    switch (format)
+    {
+    case texture_format::TEXTURE_FORMAT_BC1:
+        result.r = uint8_to_float(pixel[0]);
+        result.g = uint8_to_float(pixel[1]);
+        result.b = uint8_to_float(pixel[2]);
+        break;
+    case texture_format::TEXTURE_FORMAT_BC1_SRGB:
+        result.r = srgb8_to_linear(pixel[0]);
+        result.g = srgb8_to_linear(pixel[1]);
+        result.b = srgb8_to_linear(pixel[2]);
+        break;
+    case texture_format::TEXTURE_FORMAT_BC4:
+        result.r = uint8_to_float(pixel[0]);
+        result.g = result.r;
+        result.b = result.r;
+        break;
+    case texture_format::TEXTURE_FORMAT_BC5:
+    {
+        result.r = uint8_to_float(pixel[0]);
+        result.g = uint8_to_float(pixel[1]);
+        // Reconstruct the Z component of the unit normal.
+        float x = result.r * 2.0f - 1.0f;
+        float y = result.g * 2.0f - 1.0f;
+        float z = sqrtf(std::max(0.0f, 1.0f - x * x - y * y));
+        result.b = z * 0.5f + 0.5f;
+        break;
+    }
+    default:
+        result = VEC4_ZERO;
+        break;
+    }
+    return result;
+}
+
+#undef DECODED_BLOCK_CACHE_SIZE
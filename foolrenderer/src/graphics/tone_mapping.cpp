@@ -0,0 +1,254 @@
+#include "graphics/tone_mapping.h"
+#include "graphics/color.h"
+#include "graphics/profiler.h"
+#include "rmath/base_util.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TONE_MAPPING_USE_SSE2
+#endif
+
+// Coefficients of the ACES fit, (c * (a * c + b)) / (c * (c * c + d) + e).
+#define ACES_A 2.51f
+#define ACES_B 0.03f
+#define ACES_C 2.43f
+#define ACES_D 0.59f
+#define ACES_E 0.14f
+
+// Images with fewer rows per thread than this are resolved by fewer threads,
+// down to the calling thread alone, as handing out smaller chunks costs more
+// than it saves.
+#define MIN_ROWS_PER_THREAD 32
+
+static inline float tone_map_component(float value, tone_mapping_operator tone_operator)
+{
+    switch (tone_operator)
+    {
+    case tone_mapping_operator::TONE_MAPPING_REINHARD:
+        value = std::max(value, 0.0f);
+        return value / (1.0f + value);
+    case tone_mapping_operator::TONE_MAPPING_ACES:
+        value = std::max(value, 0.0f);
+        return clamp01((value * (ACES_A * value + ACES_B)) / (value * (ACES_C * value + ACES_D) + ACES_E));
+    default:
+        return value;
+    }
+}
+
+void tone_map_row(const float *src, float *dst, size_t pixel_count, const tone_mapping_settings &settings)
+{
+    float exposure = settings.exposure;
+    tone_mapping_operator tone_operator = settings.tone_operator;
+    size_t p = 0;
+#ifdef TONE_MAPPING_USE_SSE2
+    // One pixel per register, the alpha lane is passed through unchanged.
+    const __m128 exposure_scale = _mm_setr_ps(exposure, exposure, exposure, 1.0f);
+    const __m128 alpha_mask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; p < pixel_count; p++)
+    {
+        __m128 pixel = _mm_loadu_ps(src);
+        __m128 color = _mm_mul_ps(pixel, exposure_scale);
+        if (tone_operator == tone_mapping_operator::TONE_MAPPING_REINHARD)
+        {
+            color = _mm_max_ps(color, zero);
+            color = _mm_div_ps(color, _mm_add_ps(one, color));
+        }
+        else if (tone_operator == tone_mapping_operator::TONE_MAPPING_ACES)
+        {
+            color = _mm_max_ps(color, zero);
+            __m128 numerator = _mm_mul_ps(color, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ACES_A), color),
+                                                            _mm_set1_ps(ACES_B)));
+            __m128 denominator = _mm_add_ps(_mm_mul_ps(color, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ACES_C), color),
+                                                                          _mm_set1_ps(ACES_D))),
+                                            _mm_set1_ps(ACES_E));
+            color = _mm_min_ps(_mm_max_ps(_mm_div_ps(numerator, denominator), zero), one);
+        }
+        color = _mm_or_ps(_mm_andnot_ps(alpha_mask, color), _mm_and_ps(alpha_mask, pixel));
+        _mm_storeu_ps(dst, color);
+        src += 4;
+        dst += 4;
+    }
+#endif
+    for (; p < pixel_count; p++)
+    {
+        float alpha = src[3];
+        dst[0] = tone_map_component(src[0] * exposure, tone_operator);
+        dst[1] = tone_map_component(src[1] * exposure, tone_operator);
+        dst[2] = tone_map_component(src[2] * exposure, tone_operator);
+        dst[3] = alpha;
+        src += 4;
+        dst += 4;
+    }
+}
+
+// Resolves the rows [row_begin, row_end) of source into target.
+static void resolve_rows(const Texture *source, Texture *target, const tone_mapping_settings *settings,
+                         uint32_t row_begin, uint32_t row_end)
+{
+    PROFILE_ZONE("resolve rows");
+    uint32_t width = source->m_width;
+    bool is_srgb_encoding = target->m_format == texture_format::TEXTURE_FORMAT_SRGB8_A8;
+    bool is_identity = settings->exposure == 1.0f &&
+                       settings->tone_operator == tone_mapping_operator::TONE_MAPPING_NONE;
+    std::vector<float> row(is_identity ? 0 : (size_t)width * 4);
+    const float *src_pixels = (const float *)source->get_pixels();
+    uint8_t *dst_pixels = target->get_pixels();
+    for (uint32_t y = row_begin; y < row_end; y++)
+    {
+        const float *src = src_pixels + (size_t)y * width * 4;
+        if (!is_identity)
+        {
+            tone_map_row(src, row.data(), width, *settings);
+            src = row.data();
+        }
+        linear_row_to_rgba8(src, dst_pixels + (size_t)y * width * 4, width, is_srgb_encoding);
+    }
+}
+
+// The worker threads of resolve_hdr(). They are started on first use and kept
+// until the program exits, so that a frame does not pay for creating and
+// joining threads. run() hands chunk i of the rows to worker i - 1, resolves
+// chunk 0 on the calling thread and waits for the workers.
+class ResolveWorkers
+{
+public:
+    ~ResolveWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            is_stopping = true;
+        }
+        job_ready.notify_all();
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    void run(const Texture *source, Texture *target, const tone_mapping_settings *settings, uint32_t chunk_count,
+             uint32_t rows_per_chunk)
+    {
+        // One resolve at a time, a second caller waits for the workers.
+        std::lock_guard<std::mutex> run_lock(run_mutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (threads.size() + 1 < chunk_count)
+            {
+                threads.emplace_back(&ResolveWorkers::work, this, (uint32_t)threads.size());
+            }
+            job_source = source;
+            job_target = target;
+            job_settings = settings;
+            job_chunk_count = chunk_count;
+            job_rows_per_chunk = rows_per_chunk;
+            pending_chunks = chunk_count - 1;
+            generation++;
+        }
+        job_ready.notify_all();
+        resolve_chunk(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        job_done.wait(lock, [this] { return pending_chunks == 0; });
+    }
+
+private:
+    void resolve_chunk(uint32_t chunk)
+    {
+        uint32_t height = job_source->m_height;
+        uint32_t row_begin = std::min(height, chunk * job_rows_per_chunk);
+        uint32_t row_end = std::min(height, row_begin + job_rows_per_chunk);
+        resolve_rows(job_source, job_target, job_settings, row_begin, row_end);
+    }
+
+    void work(uint32_t index)
+    {
+        uint64_t done_generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                job_ready.wait(lock, [&] { return is_stopping || generation != done_generation; });
+                if (is_stopping)
+                {
+                    return;
+                }
+                done_generation = generation;
+                // Workers beyond the chunks of this resolve sit it out.
+                if (index + 1 >= job_chunk_count)
+                {
+                    continue;
+                }
+            }
+            resolve_chunk(index + 1);
+            bool is_last;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                is_last = --pending_chunks == 0;
+            }
+            if (is_last)
+            {
+                job_done.notify_one();
+            }
+        }
+    }
+
+    std::mutex run_mutex;
+    // Guards the members below.
+    std::mutex mutex;
+    std::condition_variable job_ready;
+    std::condition_variable job_done;
+    std::vector<std::thread> threads;
+    bool is_stopping{false};
+    // Incremented for each resolve, so that a worker takes each job once.
+    uint64_t generation{0};
+    uint32_t pending_chunks{0};
+    const Texture *job_source{nullptr};
+    Texture *job_target{nullptr};
+    const tone_mapping_settings *job_settings{nullptr};
+    uint32_t job_chunk_count{0};
+    uint32_t job_rows_per_chunk{0};
+};
+
+bool resolve_hdr(FrameBuffer &framebuffer, Texture &target, const tone_mapping_settings &settings)
+{
+    PROFILE_ZONE("resolve_hdr");
+    Texture *source = framebuffer.color_buffer.get();
+    if (source == nullptr || source->m_format != texture_format::TEXTURE_FORMAT_RGBA_FLOAT ||
+        (target.m_format != texture_format::TEXTURE_FORMAT_RGBA8 &&
+         target.m_format != texture_format::TEXTURE_FORMAT_SRGB8_A8) ||
+        target.m_width != source->m_width || target.m_height != source->m_height)
+    {
+        return false;
+    }
+    framebuffer.resolve(attachment_type::COLOR_ATTACHMENT);
+
+    uint32_t height = source->m_height;
+    uint32_t thread_count = settings.thread_count;
+    if (thread_count == 0)
+    {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    thread_count = std::min(thread_count, std::max(1u, height / MIN_ROWS_PER_THREAD));
+    if (thread_count == 1)
+    {
+        resolve_rows(source, &target, &settings, 0, height);
+        return true;
+    }
+    static ResolveWorkers workers;
+    workers.run(source, &target, &settings, thread_count, (height + thread_count - 1) / thread_count);
+    return true;
+}
+
+#undef ACES_A
+#undef ACES_B
+#undef ACES_C
+#undef ACES_D
+#undef ACES_E
+#undef MIN_ROWS_PER_THREAD
+#undef TONE_MAPPING_USE_SSE2
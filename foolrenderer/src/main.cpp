@@ -1,13 +1,22 @@
+#include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <memory>
 
 #include "graphics/framebuffer.h"
+#include "graphics/profiler.h"
 #include "graphics/rasterizer.h"
 #include "graphics/texture.h"
+#include "graphics/tone_mapping.h"
+#include "rmath/fast_math.h"
 #include "rmath/rmatrix.h"
 #include "rmath/rvector.h"
 #include "shaders/shadow_casting.h"
 #include "shaders/standard.h"
+#include "utility/culling.h"
+#include "utility/draw_order.h"
+#include "utility/frame_sink.h"
 #include "utility/image.h"
 #include "utility/mesh.h"
 
@@ -15,6 +24,10 @@
 #define SHADOW_MAP_HEIGHT 1024
 #define IMAGE_WIDTH 1024
 #define IMAGE_HEIGHT 1024
+#define MESHLET_TRIANGLE_COUNT 64
+// Decoded textures are kept here, so later runs map them instead of decoding
+// the TGA files again.
+#define TEXTURE_CACHE_DIRECTORY "./.texture_cache/"
 
 struct Model
 {
@@ -23,6 +36,8 @@ struct Model
     std::unique_ptr<Texture> normal_map;
     std::unique_ptr<Texture> metallic_map;
     std::unique_ptr<Texture> roughness_map;
+    // If present, used instead of the four maps above.
+    std::unique_ptr<MaterialTexture> material_map;
 };
 
 static vec3 light_direction{1.0f, 4.0f, -1.0f};
@@ -32,29 +47,56 @@ static vec3 camera_target{0.0f, 0.4f, 0.0f};
 static FrameBuffer shadow_framebuffer;
 static Texture *shadow_map{nullptr}; // this is only a pointer, does not have ownership
 static FrameBuffer framebuffer;
+// The framebuffer renders to an HDR color buffer, which is resolved to this
+// texture at the end of each frame.
+static std::unique_ptr<Texture> color_buffer_output;
 static Texture *color_buffer{nullptr};
+static tone_mapping_settings tone_mapping;
 static Texture *depth_buffer{nullptr};
 
 static matrix4x4 light_world2clip;
+// Progress messages go to stderr when the frames are streamed to stdout.
+static std::ostream *progress = &std::cout;
+static math_precision shading_precision = DEFAULT_MATH_PRECISION;
+static shading_rate model_shading_rate = shading_rate::SHADING_RATE_1X1;
+static uint32_t sample_count = 1;
+static bool use_depth_prepass = false;
+static bool use_front_to_back = false;
+static bool use_texture_compression = false;
+// MESHLET_TRIANGLE_COUNT consecutive triangles of the model, the units of the
+// front-to-back order.
+static std::vector<Meshlet> meshlets;
+// The models drawn and the models outside the view, in all frames.
+static uint32_t drawn_model_count = 0;
+static uint32_t culled_model_count = 0;
 
 static void initialize_rendering()
 {
-    shadow_framebuffer.attach_texture(attachment_type::DEPTH_ATTACHMENT, std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_DEPTH_FLOAT, SHADOW_MAP_WIDTH,
+    shadow_framebuffer.attach_texture(attachment_type::DEPTH_ATTACHMENT, std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_DEPTH16, SHADOW_MAP_WIDTH,
                                                                                                    SHADOW_MAP_HEIGHT));
     shadow_map = shadow_framebuffer.depth_buffer.get();
 
-    framebuffer.attach_texture(attachment_type::COLOR_ATTACHMENT, std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_SRGB8_A8, IMAGE_WIDTH, IMAGE_HEIGHT));
+    framebuffer.attach_texture(attachment_type::COLOR_ATTACHMENT, std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_RGBA_FLOAT, IMAGE_WIDTH, IMAGE_HEIGHT));
     framebuffer.attach_texture(attachment_type::DEPTH_ATTACHMENT, std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_DEPTH_FLOAT, IMAGE_WIDTH, IMAGE_HEIGHT));
 
-    color_buffer = framebuffer.color_buffer.get();
+    color_buffer_output = std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_SRGB8_A8, IMAGE_WIDTH, IMAGE_HEIGHT);
+    color_buffer = color_buffer_output.get();
+    // Without exposure and tone mapping the resolved frames are the same as
+    // rendering to an SRGB8_A8 color buffer directly.
+    tone_mapping.exposure = 1.0f;
+    tone_mapping.tone_operator = tone_mapping_operator::TONE_MAPPING_NONE;
     depth_buffer = framebuffer.depth_buffer.get();
+    framebuffer.set_sample_count(sample_count);
 }
 
 static void render_shadow_map(const Model *model)
 {
+    PROFILE_ZONE("shadow pass");
     set_viewport(0, 0, SHADOW_MAP_WIDTH, SHADOW_MAP_HEIGHT);
     set_vertex_shader(shadow_casting_vertex_shader);
     set_fragment_shader(shadow_casting_fragment_shader);
+    set_shading_rate(shading_rate::SHADING_RATE_1X1);
+    set_depth_function(depth_function::DEPTH_FUNCTION_LESS_EQUAL);
     shadow_framebuffer.clear();
 
     shadow_casting_uniform uniform;
@@ -66,26 +108,152 @@ static void render_shadow_map(const Model *model)
     // matrix is the world2clip matrix.
     uniform.local2clip = light_world2clip;
 
+    // The shadow casting vertex shader only transforms the position, so all
+    // vertices are transformed at once and the vertex shader is skipped.
     const Mesh *mesh = model->mesh.get();
-    uint32_t triangle_count = mesh->triangle_count;
-    for (size_t t = 0; t < triangle_count; t++)
+    if (is_mesh_visible(extract_frustum(uniform.local2clip), *mesh))
     {
-        shadow_casting_vertex_attribute attributes[3];
+        static transformed_vertices vertices;
+        transform_vertices(uniform.local2clip, mesh->positions_x.get(), mesh->positions_y.get(),
+                           mesh->positions_z.get(), mesh->vertex_count, vertices);
+        uint32_t triangle_count = mesh->triangle_count;
+        for (size_t t = 0; t < triangle_count; t++)
+        {
+            draw_transformed_triangle(&shadow_framebuffer, &uniform, vertices, mesh->indices.get() + t * 3,
+                                      nullptr);
+        }
+    }
+    // The shadow map is sampled as a texture, so the tiles no triangle covered
+    // must hold the clear value too.
+    shadow_framebuffer.resolve(attachment_type::DEPTH_ATTACHMENT);
+}
+
+static void set_model_fragment_shader()
+{
+    if (shading_precision == math_precision::MATH_PRECISION_FAST)
+    {
+        set_fragment_shader(standard_fragment_shader_fast);
+    }
+    else
+    {
+        // Same results as standard_fragment_shader, 4 fragments at a time.
+        set_packet_fragment_shader(standard_packet_fragment_shader);
+    }
+}
+
+static void get_model_attributes(const Mesh *mesh, uint32_t triangle, standard_vertex_attribute attributes[3],
+                                 const void *attribute_ptrs[3])
+{
+    for (uint32_t v = 0; v < 3; v++)
+    {
+        attributes[v].position = mesh->get_mesh_position(triangle, v);
+        attributes[v].normal = mesh->get_mesh_normal(triangle, v);
+        attributes[v].tangent = mesh->get_mesh_tangent(triangle, v);
+        attributes[v].texcoord = mesh->get_mesh_texcoord(triangle, v);
+        attribute_ptrs[v] = attributes + v;
+    }
+}
+
+static void draw_model_triangles(const Mesh *mesh, const standard_uniform *uniform, uint32_t first_triangle,
+                                 uint32_t triangle_count)
+{
+    for (uint32_t t = first_triangle; t < first_triangle + triangle_count; t++)
+    {
+        standard_vertex_attribute attributes[3];
         const void *attribute_ptrs[3];
-        for (uint32_t v = 0; v < 3; v++)
+        get_model_attributes(mesh, t, attributes, attribute_ptrs);
+        draw_triangle(&framebuffer, uniform, attribute_ptrs);
+    }
+}
+
+// Draws with the transformed vertex positions. The depth prepass needs no
+// vertex attributes, the vertex shader is skipped.
+static void draw_transformed_model_triangles(const Mesh *mesh, const standard_uniform *uniform,
+                                             const transformed_vertices &vertices, uint32_t first_triangle,
+                                             uint32_t triangle_count, bool with_attributes)
+{
+    for (uint32_t t = first_triangle; t < first_triangle + triangle_count; t++)
+    {
+        standard_vertex_attribute attributes[3];
+        const void *attribute_ptrs[3];
+        if (with_attributes)
+        {
+            get_model_attributes(mesh, t, attributes, attribute_ptrs);
+        }
+        draw_transformed_triangle(&framebuffer, uniform, vertices, mesh->indices.get() + t * 3,
+                                  with_attributes ? attribute_ptrs : nullptr);
+    }
+}
+
+// Draws the triangles of the model in the order and with the passes that were
+// chosen on the command line.
+static void draw_model(const Mesh *mesh, const standard_uniform *uniform, const matrix4x4 &world2view)
+{
+    std::vector<uint32_t> order;
+    if (use_front_to_back)
+    {
+        if (meshlets.empty())
+        {
+            meshlets = build_meshlets(*mesh, MESHLET_TRIANGLE_COUNT);
+        }
+        sort_front_to_back(meshlets, world2view * uniform->local2world, order);
+    }
+    if (!use_depth_prepass)
+    {
+        if (use_front_to_back)
+        {
+            for (uint32_t m : order)
+            {
+                draw_model_triangles(mesh, uniform, meshlets[m].first_triangle, meshlets[m].triangle_count);
+            }
+        }
+        else
+        {
+            draw_model_triangles(mesh, uniform, 0, mesh->triangle_count);
+        }
+    }
+    else
+    {
+        // Both passes draw the same transformed positions, so the color pass
+        // computes exactly the depths of the prepass and the equal depth test
+        // lets only the visible fragments through.
+        static transformed_vertices vertices;
+        transform_vertices(uniform->world2clip * uniform->local2world, mesh->positions_x.get(),
+                           mesh->positions_y.get(), mesh->positions_z.get(), mesh->vertex_count, vertices);
+        set_fragment_shader(nullptr);
+        for (uint32_t pass = 0; pass < 2; pass++)
         {
-            attributes[v].position = mesh->get_mesh_position(t, v);
-            attribute_ptrs[v] = attributes + v;
+            bool is_color_pass = pass == 1;
+            PROFILE_ZONE(is_color_pass ? "color pass" : "depth prepass");
+            if (is_color_pass)
+            {
+                set_model_fragment_shader();
+                set_depth_function(depth_function::DEPTH_FUNCTION_EQUAL);
+            }
+            if (use_front_to_back)
+            {
+                for (uint32_t m : order)
+                {
+                    draw_transformed_model_triangles(mesh, uniform, vertices, meshlets[m].first_triangle,
+                                                     meshlets[m].triangle_count, is_color_pass);
+                }
+            }
+            else
+            {
+                draw_transformed_model_triangles(mesh, uniform, vertices, 0, mesh->triangle_count, is_color_pass);
+            }
         }
-        draw_triangle(&shadow_framebuffer, &uniform, attribute_ptrs);
+        set_depth_function(depth_function::DEPTH_FUNCTION_LESS_EQUAL);
     }
 }
 
 static void render_model(const Model *model)
 {
+    PROFILE_ZONE("render model");
     set_viewport(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT);
     set_vertex_shader(standard_vertex_shader);
-    set_fragment_shader(standard_fragment_shader);
+    set_model_fragment_shader();
+    set_shading_rate(model_shading_rate);
     FrameBuffer::set_clear_color(0.49f, 0.33f, 0.41f, 1.0f);
     framebuffer.clear();
 
@@ -118,26 +286,52 @@ static void render_model(const Model *model)
     uniform.roughness = 1.0f;
     uniform.roughness_map = model->roughness_map.get();
     uniform.reflectance = 0.5f; // Common dielectric surfaces F0.
+    uniform.material_map = model->material_map.get();
 
     const Mesh *mesh = model->mesh.get();
-    uint32_t triangle_count = mesh->triangle_count;
-    for (size_t t = 0; t < triangle_count; t++)
+    // Models outside the view are skipped before any of their vertices are
+    // fetched.
+    if (is_mesh_visible(extract_frustum(uniform.world2clip * uniform.local2world), *mesh))
     {
-        standard_vertex_attribute attributes[3];
-        const void *attribute_ptrs[3];
-        for (uint32_t v = 0; v < 3; v++)
-        {
-            attributes[v].position = mesh->get_mesh_position(t, v);
-            attributes[v].normal = mesh->get_mesh_normal(t, v);
-            attributes[v].tangent = mesh->get_mesh_tangent(t, v);
-            attributes[v].texcoord = mesh->get_mesh_texcoord(t, v);
-            attribute_ptrs[v] = attributes + v;
-        }
-        draw_triangle(&framebuffer, &uniform, attribute_ptrs);
+        PROFILE_ZONE("draw model");
+        draw_model(mesh, &uniform, world2view);
+        drawn_model_count++;
+    }
+    else
+    {
+        culled_model_count++;
     }
+    // Only the color buffer is read back, the depth of untouched tiles is
+    // never needed.
+    resolve_hdr(framebuffer, *color_buffer, tone_mapping);
+}
+
+// Prints the pipeline statistics of a pass: the path of the triangles through
+// clipping, and the work of the rasterizer.
+static void print_pipeline_statistics(const char *pass, const pipeline_statistics &statistics)
+{
+    *progress << pass << " triangles: " << statistics.submitted_triangles << " submitted, "
+              << statistics.inside_triangles << " inside, " << statistics.guard_band_triangles << " guard band, "
+              << statistics.clipped_triangles << " clipped, " << statistics.culled_triangles << " culled, "
+              << statistics.back_facing_triangles << " back facing, " << statistics.degenerate_triangles
+              << " degenerate\n";
+    *progress << pass << " fragments: " << statistics.tested_pixels << " pixels tested, "
+              << statistics.covered_fragments << " covered, " << statistics.depth_rejected_fragments
+              << " depth rejected, " << statistics.shaded_fragments << " shaded, " << statistics.color_writes
+              << " color writes, " << statistics.shaded_vertices << " vertices shaded\n";
+}
+
+// Renders the model, writes the frame to the sink and adds the pipeline
+// statistics of the frame to statistics.
+static void render_frame(const Model *model, FrameSink &sink, pipeline_statistics &statistics)
+{
+    PROFILE_ZONE("frame");
+    render_model(model);
+    statistics.add(end_frame_statistics());
+    sink.write_frame(*color_buffer);
 }
 
-void render_cut_fish()
+void render_cut_fish(FrameSink &sink)
 {
     auto const base_path = std::string("./assets/cut_fish/");
     auto const model_path = base_path + "cut_fish.obj";
@@ -148,47 +342,48 @@ void render_cut_fish()
 
     Model model;
     model.mesh = std::make_unique<Mesh>(model_path);
-    model.base_color_map = load_image(base_color_map_path, true);
-    model.normal_map = load_image(normal_map_path, false);
-    model.metallic_map = load_image(metallic_map_path, false);
-    model.roughness_map = load_image(roughness_map_path, false);
+    model.material_map = load_material(base_color_map_path, normal_map_path,
+                                       metallic_map_path, roughness_map_path, TEXTURE_CACHE_DIRECTORY,
+                                       use_texture_compression);
 
     initialize_rendering();
+    end_frame_statistics();
     render_shadow_map(&model);
+    print_pipeline_statistics("shadow map", end_frame_statistics());
+    // The sum of the statistics of the frames.
+    pipeline_statistics frame_statistics{};
 
-    std::string frame_path = "./Render/";
     int i = 1;
     for (i; i <= 40; i++)
     {
         camera_position.z += 0.1f;
 
-        render_model(&model);
-        save_image(color_buffer, frame_path + std::to_string(i) + ".tga", false);
+        render_frame(&model, sink, frame_statistics);
     }
-    std::cout << "z flip done\n";
+    *progress << "z flip done\n";
 
     for (i; i <= 80; i++)
     {
         camera_position.z -= 0.1f;
         camera_position.x -= 0.1f;
 
-        render_model(&model);
-        save_image(color_buffer, frame_path + std::to_string(i) + ".tga", false);
+        render_frame(&model, sink, frame_statistics);
     }
-    std::cout << "x flip done\n";
+    *progress << "x flip done\n";
 
     for (i; i <= 120; i++)
     {
         camera_position.x += 0.1f;
         camera_position.y += 0.1f;
 
-        render_model(&model);
-        save_image(color_buffer, frame_path + std::to_string(i) + ".tga", false);
+        render_frame(&model, sink, frame_statistics);
     }
-    std::cout << "y flip done\n";
+    *progress << "y flip done\n";
+    print_pipeline_statistics("frames", frame_statistics);
+    *progress << "models: " << drawn_model_count << " drawn, " << culled_model_count << " culled\n";
 }
 
-void render_sphere(std::string base_path)
+void render_sphere(std::string base_path, FrameSink &sink)
 {
     if (base_path.back() != '/' || base_path.back() != '\\')
     {
@@ -203,24 +398,22 @@ void render_sphere(std::string base_path)
 
     Model model;
     model.mesh = std::make_unique<Mesh>(model_path);
-    model.base_color_map = load_image(base_color_map_path, true);
-    model.normal_map = load_image(normal_map_path, false);
-    model.metallic_map = load_image(metallic_map_path, false);
-    model.roughness_map = load_image(roughness_map_path, false);
+    model.material_map = load_material(base_color_map_path, normal_map_path,
+                                       metallic_map_path, roughness_map_path, TEXTURE_CACHE_DIRECTORY,
+                                       use_texture_compression);
 
     initialize_rendering();
     render_shadow_map(&model);
 
-    std::string frame_path = "./Render/";
     int i = 1;
     for (i; i <= 40; i++)
     {
         camera_position.z += 0.1f;
 
         render_model(&model);
-        save_image(color_buffer, frame_path + std::to_string(i) + ".tga", false);
+        sink.write_frame(*color_buffer);
     }
-    std::cout << "z flip done\n";
+    *progress << "z flip done\n";
 
     for (i; i <= 80; i++)
     {
@@ -228,9 +421,9 @@ void render_sphere(std::string base_path)
         camera_position.x -= 0.1f;
 
         render_model(&model);
-        save_image(color_buffer, frame_path + std::to_string(i) + ".tga", false);
+        sink.write_frame(*color_buffer);
     }
-    std::cout << "x flip done\n";
+    *progress << "x flip done\n";
 
     for (i; i <= 120; i++)
     {
@@ -238,14 +431,123 @@ void render_sphere(std::string base_path)
         camera_position.y += 0.1f;
 
         render_model(&model);
-        save_image(color_buffer, frame_path + std::to_string(i) + ".tga", false);
+        sink.write_frame(*color_buffer);
     }
-    std::cout << "y flip done\n";
+    *progress << "y flip done\n";
 }
 
-int main()
+int main(int argc, char *argv[])
 {
-    render_cut_fish();
+    // Usage: FoolRenderer_Cpp [--fast-math|--precise-math] [--shading-rate=1x1|2x2|4x4]
+    //                        [--msaa] [--depth-prepass] [--front-to-back]
+    //                        [--compressed-textures] [--trace=path] [--trace-detail]
+    //                        [tga|qoi|y4m|ppm] [path]
+    // Image formats write one file per frame, path is the file name prefix.
+    // Stream formats write one stream, path is a file or named pipe, "-" for
+    // stdout. --fast-math shades with the approximations of rmath/fast_math.h,
+    // --precise-math with <cmath>, the default is chosen when building.
+    // --shading-rate shades the model once per pixel (the default) or once
+    // per 2x2 or 4x4 pixels, for quicker previews. --msaa renders with
+    // MSAA_SAMPLE_COUNT samples per pixel. --depth-prepass draws the depth of
+    // the model first, so that the color pass shades every pixel once.
+    // --front-to-back draws the meshlets of the model nearest first, so that
+    // the depth test rejects more hidden fragments before they are shaded.
+    // --compressed-textures block compresses the material maps in the texture
+    // cache, see load_material().
+    // --trace=path records the time of the passes, frames and loading, and
+    // writes it as a Chrome trace to path at the end, --trace-detail also
+    // records the vertex processing and rasterization of each triangle.
+    std::vector<std::string_view> arguments;
+    std::string_view trace_path;
+    bool use_trace_detail = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view argument = argv[i];
+        if (argument == "--fast-math")
+        {
+            shading_precision = math_precision::MATH_PRECISION_FAST;
+        }
+        else if (argument == "--precise-math")
+        {
+            shading_precision = math_precision::MATH_PRECISION_PRECISE;
+        }
+        else if (argument == "--msaa")
+        {
+            sample_count = MSAA_SAMPLE_COUNT;
+        }
+        else if (argument == "--depth-prepass")
+        {
+            use_depth_prepass = true;
+        }
+        else if (argument == "--front-to-back")
+        {
+            use_front_to_back = true;
+        }
+        else if (argument == "--compressed-textures")
+        {
+            use_texture_compression = true;
+        }
+        else if (argument.substr(0, 8) == "--trace=")
+        {
+            trace_path = argument.substr(8);
+        }
+        else if (argument == "--trace-detail")
+        {
+            use_trace_detail = true;
+        }
+        else if (argument == "--shading-rate=1x1")
+        {
+            model_shading_rate = shading_rate::SHADING_RATE_1X1;
+        }
+        else if (argument == "--shading-rate=2x2")
+        {
+            model_shading_rate = shading_rate::SHADING_RATE_2X2;
+        }
+        else if (argument == "--shading-rate=4x4")
+        {
+            model_shading_rate = shading_rate::SHADING_RATE_4X4;
+        }
+        else
+        {
+            arguments.push_back(argument);
+        }
+    }
+    frame_sink_format format = frame_sink_format::FRAME_SINK_TGA;
+    if (arguments.size() > 0 && !parse_frame_sink_format(arguments[0], format))
+    {
+        std::cerr << "Unknown output format: " << arguments[0] << "\n";
+        return 1;
+    }
+    bool is_stream = format == frame_sink_format::FRAME_SINK_Y4M || format == frame_sink_format::FRAME_SINK_PPM;
+    std::string path = arguments.size() > 1 ? std::string(arguments[1]) : (is_stream ? "-" : "./Render/");
+
+    FrameSink sink(format, path, IMAGE_WIDTH, IMAGE_HEIGHT);
+    if (!sink.is_open())
+    {
+        std::cerr << "Can not open output: " << path << "\n";
+        return 1;
+    }
+    if (sink.writes_to_stdout())
+    {
+        progress = &std::cerr;
+    }
+    if (!trace_path.empty())
+    {
+        set_profiler_thread_name("main");
+        set_profiler_level(use_trace_detail ? profiler_level::PROFILER_DETAIL_ZONES : profiler_level::PROFILER_ZONES);
+    }
+    render_cut_fish(sink);
 
-    return 0;
+    bool is_finished = sink.finish();
+    if (!trace_path.empty())
+    {
+        set_profiler_level(profiler_level::PROFILER_OFF);
+        if (!write_profile_trace(trace_path))
+        {
+            std::cerr << "Can not write the trace: " << trace_path << "\n";
+            return 1;
+        }
+        *progress << "trace written to " << trace_path << "\n";
+    }
+    return is_finished ? 0 : 1;
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "shaders/basic.h"
 #include "graphics/texture.h"
+#include "rmath/fast_math.h"
 
 #define TEXCOORD 0
 #define VIEW_SPACE_POSITION 0
@@ -55,8 +56,10 @@ vec4 basic_vertex_shader(ShaderContext *output, const void *uniform, const void
     return unif->view2clip * view_space_position;
 }
 
-vec4 basic_fragment_shader(ShaderContext *input, const void *uniform)
+template <math_precision precision>
+static inline vec4 shade_fragment(ShaderContext *input, const void *uniform)
 {
+    using math = shading_math<precision>;
     const basic_uniform *unif = (const basic_uniform *)uniform;
     vec2 texcoord = *input->shader_context_vec2(TEXCOORD);
 
@@ -65,9 +68,9 @@ vec4 basic_fragment_shader(ShaderContext *input, const void *uniform)
     normal = normal * 2.0f - 1.0f;
 
     // Transform the normal from tangent space to view space
-    vec3 t = input->shader_context_vec3(VIEW_SPACE_TANGENT)->normalize();
-    vec3 b = input->shader_context_vec3(VIEW_SPACE_BITANGENT)->normalize();
-    vec3 n = input->shader_context_vec3(VIEW_SPACE_NORMAL)->normalize();
+    vec3 t = math::normalize(*input->shader_context_vec3(VIEW_SPACE_TANGENT));
+    vec3 b = math::normalize(*input->shader_context_vec3(VIEW_SPACE_BITANGENT));
+    vec3 n = math::normalize(*input->shader_context_vec3(VIEW_SPACE_NORMAL));
     normal = matrix3x3(t, b, n) * normal;
 
     // Ambient lighting.
@@ -88,13 +91,13 @@ vec4 basic_fragment_shader(ShaderContext *input, const void *uniform)
         // the calculation of the view direction is simplified.
         vec3 postion = *input->shader_context_vec3(VIEW_SPACE_POSITION);
         vec3 view_direction = postion * -1.0f;
-        view_direction = view_direction.normalize();
+        view_direction = math::normalize(view_direction);
         // Calculate the halfway vector between the light direction and the view
         // direction.
         vec3 halfway = view_direction + unif->light_direction;
-        halfway = halfway.normalize();
+        halfway = math::normalize(halfway);
         float n_dot_h = normal.dot(halfway);
-        float specular_intensity = powf(std::max(0.0f, n_dot_h), unif->shininess);
+        float specular_intensity = math::pow(std::max(0.0f, n_dot_h), unif->shininess);
         specular_lighting = unif->light_color * specular_intensity;
         specular_lighting = specular_lighting * unif->specular_reflectance;
     }
@@ -110,4 +113,14 @@ vec4 basic_fragment_shader(ShaderContext *input, const void *uniform)
     fragment_color = fragment_color * texture_color.to3D();
     fragment_color = fragment_color + specular_lighting;
     return fragment_color.to4D(1.0f);
-}
\ No newline at end of file
+}
+
+vec4 basic_fragment_shader(ShaderContext *input, const void *uniform)
+{
+    return shade_fragment<math_precision::MATH_PRECISION_PRECISE>(input, uniform);
+}
+
+vec4 basic_fragment_shader_fast(ShaderContext *input, const void *uniform)
+{
+    return shade_fragment<math_precision::MATH_PRECISION_FAST>(input, uniform);
+}
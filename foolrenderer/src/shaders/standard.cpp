@@ -1,4 +1,5 @@
 #include "shaders/standard.h"
+#include "rmath/fast_math.h"
 
 #define TEXCOORD 0
 #define WORLD_SPACE_POSITION 0
@@ -16,9 +17,9 @@ struct material_parameter
     float reflectance;
 };
 
-static inline float shadow(ShaderContext *input, const standard_uniform *uniform)
+// The position is in light space.
+static inline float shadow(vec3 position, const standard_uniform *uniform)
 {
-    vec3 position = *input->shader_context_vec3(LIGHT_SPACE_POSITION);
     float current_depth = position.z;
     float bias = 0.005f; // Slove shadow acne.
     float closest_depth = uniform->shadow_map->sample(position.to2D()).r;
@@ -31,6 +32,17 @@ static inline float shadow(ShaderContext *input, const standard_uniform *uniform
 static inline void compute_material_parameter(material_parameter *param, const standard_uniform *uniform,
                                               vec2 texcoord)
 {
+    if (uniform->material_map)
+    {
+        // All maps are fetched with one address computation.
+        material_sample sample = uniform->material_map->sample_material(texcoord);
+        param->normal = sample.normal * 2.0f - 1.0f;
+        param->base_color = uniform->base_color * sample.base_color;
+        param->metallic = sample.metallic * uniform->metallic;
+        param->roughness = sample.roughness * uniform->roughness;
+        param->reflectance = uniform->reflectance;
+        return;
+    }
     vec3 normal = uniform->normal_map->sample(texcoord).to3D();
     normal = normal * 2.0f - 1.0f;
     param->normal = normal;
@@ -55,11 +67,13 @@ static inline float perceptual_roughness_to_a2(float perceptual_roughness)
     return roughness * roughness;
 }
 
+template <math_precision precision>
 static inline matrix3x3 construct_tangent2world(ShaderContext *input)
 {
-    vec3 t = input->shader_context_vec3(WORLD_SPACE_TANGENT)->normalize();
-    vec3 b = input->shader_context_vec3(WORLD_SPACE_BITANGENT)->normalize();
-    vec3 n = input->shader_context_vec3(WORLD_SPACE_NORMAL)->normalize();
+    using math = shading_math<precision>;
+    vec3 t = math::normalize(*input->shader_context_vec3(WORLD_SPACE_TANGENT));
+    vec3 b = math::normalize(*input->shader_context_vec3(WORLD_SPACE_BITANGENT));
+    vec3 n = math::normalize(*input->shader_context_vec3(WORLD_SPACE_NORMAL));
     return matrix3x3(t, b, n);
 }
 
@@ -78,12 +92,14 @@ static inline vec3 f_schlick(vec3 f0, float l_dot_h)
     return f0 * (1.0f - f) + f;
 }
 
+template <math_precision precision>
 static inline float d_ggx(float a2, float n_dot_h)
 {
     float f = (n_dot_h * a2 - n_dot_h) * n_dot_h + 1.0;
-    return a2 / (PI * f * f);
+    return shading_math<precision>::divide(a2, PI * f * f);
 }
 
+template <math_precision precision>
 static inline float v_smith_ggx_correlated(float a2, float n_dot_l,
                                            float n_dot_v)
 {
@@ -94,19 +110,21 @@ static inline float v_smith_ggx_correlated(float a2, float n_dot_l,
     // v_smith_ggx_correlated = g_smith_ggx_correlated /
     //                      (4.0f * n_dot_l * n_dot_v)
     // This is the optimized code.
-    float lambda_v = n_dot_l * sqrtf((n_dot_v - a2 * n_dot_v) * n_dot_v + a2);
-    float lambda_l = n_dot_v * sqrtf((n_dot_l - a2 * n_dot_l) * n_dot_l + a2);
-    return 0.5 / (lambda_v + lambda_l);
+    using math = shading_math<precision>;
+    float lambda_v = n_dot_l * math::sqrt((n_dot_v - a2 * n_dot_v) * n_dot_v + a2);
+    float lambda_l = n_dot_v * math::sqrt((n_dot_l - a2 * n_dot_l) * n_dot_l + a2);
+    return math::divide(0.5f, lambda_v + lambda_l);
 }
 
+template <math_precision precision>
 static inline vec3 specular_lobe(float a2, vec3 f0, float n_dot_h,
                                  float n_dot_l, float n_dot_v,
                                  float l_dot_h)
 {
     // Using Cook-Torrance microfacet BRDF.
     vec3 f = f_schlick(f0, l_dot_h);
-    float d = d_ggx(a2, n_dot_h);
-    float v = v_smith_ggx_correlated(a2, n_dot_l, n_dot_v);
+    float d = d_ggx<precision>(a2, n_dot_h);
+    float v = v_smith_ggx_correlated<precision>(a2, n_dot_l, n_dot_v);
     return f * d * v;
 }
 
@@ -147,8 +165,10 @@ vec4 standard_vertex_shader(ShaderContext *output, const void *uniform, const vo
     return unif->world2clip * world_position;
 }
 
-vec4 standard_fragment_shader(ShaderContext *input, const void *uniform)
+template <math_precision precision>
+static inline vec4 shade_fragment(ShaderContext *input, const void *uniform)
 {
+    using math = shading_math<precision>;
     vec2 texcoord = *input->shader_context_vec2(TEXCOORD);
     vec3 position = *input->shader_context_vec3(WORLD_SPACE_POSITION);
     const standard_uniform *unif = (const standard_uniform *)uniform;
@@ -166,22 +186,22 @@ vec4 standard_fragment_shader(ShaderContext *input, const void *uniform)
     vec3 conductor_f0 = material.base_color * material.metallic;
     vec3 f0 = conductor_f0 + dielectric_f0;
     float a2 = perceptual_roughness_to_a2(material.roughness);
-    matrix3x3 tangent2world = construct_tangent2world(input);
+    matrix3x3 tangent2world = construct_tangent2world<precision>(input);
     // Normalized normal, in world space.
     vec3 normal = tangent2world * material.normal;
     // Normalized vector from the fragment to the camera, in world space.
-    vec3 view = (camera_position - position).normalize();
+    vec3 view = math::normalize(camera_position - position);
     // Normalized halfway vector between the light direction and the view
     // direction, in world space.
-    vec3 halfway = (view + light_direction).normalize();
+    vec3 halfway = math::normalize(view + light_direction);
 
     float n_dot_v = std::max(normal.dot(view), 1e-4f); // Avoid artifact.
     float n_dot_l = std::max(normal.dot(light_direction), 0.0f);
     float n_dot_h = std::max(normal.dot(halfway), 0.0f);
     float l_dot_h = std::max(light_direction.dot(halfway), 0.0f);
 
-    float visibility = shadow(input, unif);
-    vec3 fr = specular_lobe(a2, f0, n_dot_h, n_dot_l, n_dot_v, l_dot_h);
+    float visibility = shadow(*input->shader_context_vec3(LIGHT_SPACE_POSITION), unif);
+    vec3 fr = specular_lobe<precision>(a2, f0, n_dot_h, n_dot_l, n_dot_v, l_dot_h);
     vec3 fd = diffuse_lobe(diffuse_color);
     // According to the ambient lighting is uniform:
     // ambient_illuminance = PI * ambient_luminance
@@ -195,3 +215,205 @@ vec4 standard_fragment_shader(ShaderContext *input, const void *uniform)
     output = output + ambient_output;
     return output.to4D(1.0f);
 }
+
+vec4 standard_fragment_shader(ShaderContext *input, const void *uniform)
+{
+    return shade_fragment<math_precision::MATH_PRECISION_PRECISE>(input, uniform);
+}
+
+vec4 standard_fragment_shader_fast(ShaderContext *input, const void *uniform)
+{
+    return shade_fragment<math_precision::MATH_PRECISION_FAST>(input, uniform);
+}
+
+// ------------packet form------------
+//
+// The computations of shade_fragment() in precise mode, on the 4 fragments of
+// a shader packet at once. The operations are done in the same order, so the
+// results are the same bit for bit. Texture fetches stay per fragment.
+
+#ifdef RMATH_SIMD
+
+struct simd_vec3
+{
+    simd4f x, y, z;
+};
+
+static inline simd_vec3 load_packet(const packet_vec3 &v)
+{
+    return simd_vec3{simd4f_load(v.x), simd4f_load(v.y), simd4f_load(v.z)};
+}
+
+static inline simd_vec3 splat(const vec3 &v)
+{
+    return simd_vec3{simd4f_set1(v.x), simd4f_set1(v.y), simd4f_set1(v.z)};
+}
+
+static inline simd_vec3 add(const simd_vec3 &a, const simd_vec3 &b)
+{
+    return simd_vec3{simd4f_add(a.x, b.x), simd4f_add(a.y, b.y), simd4f_add(a.z, b.z)};
+}
+
+static inline simd_vec3 add(const simd_vec3 &a, simd4f s)
+{
+    return simd_vec3{simd4f_add(a.x, s), simd4f_add(a.y, s), simd4f_add(a.z, s)};
+}
+
+static inline simd_vec3 sub(const simd_vec3 &a, const simd_vec3 &b)
+{
+    return simd_vec3{simd4f_sub(a.x, b.x), simd4f_sub(a.y, b.y), simd4f_sub(a.z, b.z)};
+}
+
+static inline simd_vec3 mul(const simd_vec3 &a, const simd_vec3 &b)
+{
+    return simd_vec3{simd4f_mul(a.x, b.x), simd4f_mul(a.y, b.y), simd4f_mul(a.z, b.z)};
+}
+
+static inline simd_vec3 mul(const simd_vec3 &a, simd4f s)
+{
+    return simd_vec3{simd4f_mul(a.x, s), simd4f_mul(a.y, s), simd4f_mul(a.z, s)};
+}
+
+static inline simd4f dot(const simd_vec3 &a, const simd_vec3 &b)
+{
+    return simd4f_add(simd4f_add(simd4f_mul(a.x, b.x), simd4f_mul(a.y, b.y)), simd4f_mul(a.z, b.z));
+}
+
+// Same as vec3::normalize().
+static inline simd_vec3 normalize(const simd_vec3 &v)
+{
+    simd4f square_magnitude = dot(v, v);
+    simd_vec3 scaled = mul(v, simd4f_div(simd4f_set1(1.0f), simd4f_sqrt(square_magnitude)));
+    simd4f is_zero = simd4f_equal(square_magnitude, simd4f_set1(0.0f));
+    simd4f is_unit = simd4f_less(simd4f_abs(simd4f_sub(square_magnitude, simd4f_set1(1.0f))),
+                                 simd4f_set1(SMALL_ABSOLUTE_FLOAT));
+    simd4f zero = simd4f_set1(0.0f);
+    return simd_vec3{simd4f_select(is_zero, zero, simd4f_select(is_unit, v.x, scaled.x)),
+                     simd4f_select(is_zero, zero, simd4f_select(is_unit, v.y, scaled.y)),
+                     simd4f_select(is_zero, zero, simd4f_select(is_unit, v.z, scaled.z))};
+}
+
+static inline simd_vec3 f_schlick(const simd_vec3 &f0, simd4f l_dot_h)
+{
+    simd4f one = simd4f_set1(1.0f);
+    simd4f x = simd4f_sub(one, l_dot_h);
+    simd4f x2 = simd4f_mul(x, x);
+    simd4f f = simd4f_mul(simd4f_mul(x2, x2), x);
+    return add(mul(f0, simd4f_sub(one, f)), f);
+}
+
+static inline simd4f d_ggx(simd4f a2, simd4f n_dot_h)
+{
+    simd4f f = simd4f_sub(simd4f_mul(n_dot_h, a2), n_dot_h);
+    f = simd4f_add(simd4f_mul(f, n_dot_h), simd4f_set1(1.0f));
+    return simd4f_div(a2, simd4f_mul(simd4f_mul(simd4f_set1(PI), f), f));
+}
+
+static inline simd4f v_smith_ggx_correlated(simd4f a2, simd4f n_dot_l, simd4f n_dot_v)
+{
+    simd4f lambda_v = simd4f_sub(n_dot_v, simd4f_mul(a2, n_dot_v));
+    lambda_v = simd4f_mul(n_dot_l, simd4f_sqrt(simd4f_add(simd4f_mul(lambda_v, n_dot_v), a2)));
+    simd4f lambda_l = simd4f_sub(n_dot_l, simd4f_mul(a2, n_dot_l));
+    lambda_l = simd4f_mul(n_dot_v, simd4f_sqrt(simd4f_add(simd4f_mul(lambda_l, n_dot_l), a2)));
+    return simd4f_div(simd4f_set1(0.5f), simd4f_add(lambda_v, lambda_l));
+}
+
+void standard_packet_fragment_shader(const ShaderPacket *input, const void *uniform, packet_vec4 *output)
+{
+    const standard_uniform *unif = (const standard_uniform *)uniform;
+    const packet_vec2 &texcoords = *input->shader_packet_vec2(TEXCOORD);
+    const packet_vec3 &light_space_positions = *input->shader_packet_vec3(LIGHT_SPACE_POSITION);
+
+    // Texture fetches and the shadow test, per fragment.
+    alignas(16) packet_vec3 material_normals;
+    alignas(16) packet_vec3 base_colors;
+    alignas(16) float metallics[PACKET_SIZE];
+    alignas(16) float roughnesses[PACKET_SIZE];
+    alignas(16) float visibilities[PACKET_SIZE];
+    for (int i = 0; i < PACKET_SIZE; i++)
+    {
+        material_parameter material;
+        compute_material_parameter(&material, unif, vec2{texcoords.x[i], texcoords.y[i]});
+        material_normals.x[i] = material.normal.x;
+        material_normals.y[i] = material.normal.y;
+        material_normals.z[i] = material.normal.z;
+        base_colors.x[i] = material.base_color.x;
+        base_colors.y[i] = material.base_color.y;
+        base_colors.z[i] = material.base_color.z;
+        metallics[i] = material.metallic;
+        roughnesses[i] = material.roughness;
+        vec3 light_space_position{light_space_positions.x[i], light_space_positions.y[i],
+                                  light_space_positions.z[i]};
+        visibilities[i] = shadow(light_space_position, unif);
+    }
+
+    simd4f zero = simd4f_set1(0.0f);
+    simd4f one = simd4f_set1(1.0f);
+    simd4f metallic = simd4f_load(metallics);
+    simd_vec3 base_color = load_packet(base_colors);
+    simd_vec3 diffuse_color = mul(base_color, simd4f_sub(one, metallic));
+    simd4f reflectance = simd4f_set1(unif->reflectance);
+    simd4f dielectric_f0 = simd4f_mul(simd4f_mul(simd4f_mul(simd4f_set1(0.16f), reflectance), reflectance),
+                                      simd4f_sub(one, metallic));
+    simd_vec3 f0 = add(mul(base_color, metallic), dielectric_f0);
+    simd4f roughness = simd4f_max(simd4f_load(roughnesses), simd4f_set1(0.045f));
+    roughness = simd4f_mul(roughness, roughness);
+    simd4f a2 = simd4f_mul(roughness, roughness);
+
+    simd_vec3 t = normalize(load_packet(*input->shader_packet_vec3(WORLD_SPACE_TANGENT)));
+    simd_vec3 b = normalize(load_packet(*input->shader_packet_vec3(WORLD_SPACE_BITANGENT)));
+    simd_vec3 n = normalize(load_packet(*input->shader_packet_vec3(WORLD_SPACE_NORMAL)));
+    // matrix3x3(t, b, n) * material normal, summed from 0 like the matrix
+    // product.
+    simd_vec3 m = load_packet(material_normals);
+    simd_vec3 normal = add(add(add(mul(t, m.x), zero), mul(b, m.y)), mul(n, m.z));
+    simd_vec3 light_direction = splat(unif->light_direction);
+    simd_vec3 view = normalize(sub(splat(unif->camera_position),
+                                   load_packet(*input->shader_packet_vec3(WORLD_SPACE_POSITION))));
+    simd_vec3 halfway = normalize(add(view, light_direction));
+
+    simd4f n_dot_v = simd4f_max(dot(normal, view), simd4f_set1(1e-4f));
+    simd4f n_dot_l = simd4f_max(dot(normal, light_direction), zero);
+    simd4f n_dot_h = simd4f_max(dot(normal, halfway), zero);
+    simd4f l_dot_h = simd4f_max(dot(light_direction, halfway), zero);
+
+    simd_vec3 fr = mul(mul(f_schlick(f0, l_dot_h), d_ggx(a2, n_dot_h)), v_smith_ggx_correlated(a2, n_dot_l, n_dot_v));
+    simd_vec3 fd = mul(diffuse_color, simd4f_set1(1.0f / PI));
+    simd_vec3 ambient_output = mul(diffuse_color, splat(unif->ambient_luminance));
+    simd_vec3 color = mul(add(fr, fd), splat(unif->illuminance));
+    color = mul(color, n_dot_l);
+    color = mul(color, simd4f_load(visibilities));
+    color = add(color, ambient_output);
+    simd4f_store(output->x, color.x);
+    simd4f_store(output->y, color.y);
+    simd4f_store(output->z, color.z);
+    simd4f_store(output->w, one);
+}
+
+#else
+
+void standard_packet_fragment_shader(const ShaderPacket *input, const void *uniform, packet_vec4 *output)
+{
+    // Without SIMD instructions, each fragment is shaded on its own.
+    const int8_t vec3_indices[] = {WORLD_SPACE_POSITION, WORLD_SPACE_NORMAL, WORLD_SPACE_TANGENT,
+                                   WORLD_SPACE_BITANGENT, LIGHT_SPACE_POSITION};
+    for (int i = 0; i < PACKET_SIZE; i++)
+    {
+        ShaderContext context;
+        context.clear();
+        const packet_vec2 *texcoord = input->shader_packet_vec2(TEXCOORD);
+        *context.shader_context_vec2(TEXCOORD) = vec2{texcoord->x[i], texcoord->y[i]};
+        for (int8_t index : vec3_indices)
+        {
+            const packet_vec3 *variable = input->shader_packet_vec3(index);
+            *context.shader_context_vec3(index) = vec3{variable->x[i], variable->y[i], variable->z[i]};
+        }
+        vec4 color = standard_fragment_shader(&context, uniform);
+        output->x[i] = color.x;
+        output->y[i] = color.y;
+        output->z[i] = color.z;
+        output->w[i] = color.w;
+    }
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include "utility/culling.h"
+#include <cmath>
+
+// Refer to "Fast Extraction of Viewing Frustum Planes from the World-View-
+// Projection Matrix" by Gil Gribb and Klaus Hartmann: each plane is the sum or
+// difference of the last row of the matrix and one of the other rows.
+Frustum extract_frustum(const matrix4x4 &local2clip)
+{
+    Frustum frustum;
+    const float(*m)[4] = local2clip.elements;
+    for (int row = 0; row < 3; row++)
+    {
+        for (int side = 0; side < 2; side++)
+        {
+            float sign = side == 0 ? 1.0f : -1.0f;
+            vec4 plane{m[3][0] + sign * m[row][0], m[3][1] + sign * m[row][1], m[3][2] + sign * m[row][2],
+                       m[3][3] + sign * m[row][3]};
+            float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            frustum.planes[row * 2 + side] = length > 0.0f ? plane * (1.0f / length) : plane;
+        }
+    }
+    return frustum;
+}
+
+bool is_outside_frustum(const Frustum &frustum, const bounding_sphere &sphere)
+{
+    for (const vec4 &plane : frustum.planes)
+    {
+        float distance = plane.x * sphere.center.x + plane.y * sphere.center.y + plane.z * sphere.center.z + plane.w;
+        if (distance < -sphere.radius)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_outside_frustum(const Frustum &frustum, const axis_aligned_box &box)
+{
+    for (const vec4 &plane : frustum.planes)
+    {
+        // The corner of the box farthest along the plane normal.
+        float x = plane.x >= 0.0f ? box.max.x : box.min.x;
+        float y = plane.y >= 0.0f ? box.max.y : box.min.y;
+        float z = plane.z >= 0.0f ? box.max.z : box.min.z;
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_mesh_visible(const Frustum &frustum, const Mesh &mesh)
+{
+    if (mesh.triangle_count == 0)
+    {
+        return false;
+    }
+    return !is_outside_frustum(frustum, mesh.bounds_sphere) && !is_outside_frustum(frustum, mesh.bounds_box);
+}
@@ -0,0 +1,54 @@
+#include "utility/draw_order.h"
+#include <algorithm>
+
+std::vector<Meshlet> build_meshlets(const Mesh &mesh, uint32_t max_triangle_count)
+{
+    std::vector<Meshlet> meshlets;
+    if (max_triangle_count == 0)
+    {
+        return meshlets;
+    }
+    meshlets.reserve((mesh.triangle_count + max_triangle_count - 1) / max_triangle_count);
+    for (uint32_t first = 0; first < mesh.triangle_count; first += max_triangle_count)
+    {
+        Meshlet meshlet;
+        meshlet.first_triangle = first;
+        meshlet.triangle_count = std::min(max_triangle_count, mesh.triangle_count - first);
+        axis_aligned_box box;
+        mesh.compute_triangle_bounds(first, meshlet.triangle_count, box, meshlet.bounds);
+        meshlets.push_back(meshlet);
+    }
+    return meshlets;
+}
+
+// Sorts the indices [0, count) by the nearest view space depth of the sphere
+// returned by get_bounds(i).
+template <typename GetBounds>
+static void sort_by_nearest_depth(size_t count, const matrix4x4 &local2view, std::vector<uint32_t> &order,
+                                  GetBounds get_bounds)
+{
+    std::vector<float> depths(count);
+    order.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const bounding_sphere &bounds = get_bounds(i);
+        vec4 view_center = local2view * bounds.center.to4D(1.0f);
+        depths[i] = -view_center.z - bounds.radius;
+        order[i] = (uint32_t)i;
+    }
+    // Stable, so that items at the same depth keep the submission order.
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+}
+
+void sort_front_to_back(const bounding_sphere bounds[], size_t count, const matrix4x4 &local2view,
+                        std::vector<uint32_t> &order)
+{
+    sort_by_nearest_depth(count, local2view, order, [&](size_t i) -> const bounding_sphere & { return bounds[i]; });
+}
+
+void sort_front_to_back(const std::vector<Meshlet> &meshlets, const matrix4x4 &local2view,
+                        std::vector<uint32_t> &order)
+{
+    sort_by_nearest_depth(meshlets.size(), local2view, order,
+                          [&](size_t i) -> const bounding_sphere & { return meshlets[i].bounds; });
+}
@@ -0,0 +1,432 @@
+#include "utility/frame_sink.h"
+#include <cstring>
+#include "graphics/profiler.h"
+#include "utility/image.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xC0
+#define QOI_OP_RGB 0xFE
+#define QOI_OP_RGBA 0xFF
+#define QOI_HEADER_SIZE 14
+#define QOI_END_MARKER_SIZE 8
+#define QOI_MAX_RUN 62
+#define QOI_HASH(r, g, b, a) (((r) * 3 + (g) * 5 + (b) * 7 + (a) * 11) & 63)
+
+// Returns the number of bytes of a pixel of a frame, 0 if the format can not
+// be written by a frame sink.
+static int get_frame_pixel_size(texture_format format)
+{
+    switch (format)
+    {
+    case texture_format::TEXTURE_FORMAT_RGB8:
+    case texture_format::TEXTURE_FORMAT_SRGB8:
+        return 3;
+    case texture_format::TEXTURE_FORMAT_RGBA8:
+    case texture_format::TEXTURE_FORMAT_SRGB8_A8:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static void write_u32_be(uint8_t *dst, uint32_t value)
+{
+    dst[0] = (uint8_t)(value >> 24);
+    dst[1] = (uint8_t)(value >> 16);
+    dst[2] = (uint8_t)(value >> 8);
+    dst[3] = (uint8_t)value;
+}
+
+bool parse_frame_sink_format(std::string_view name, frame_sink_format &format)
+{
+    if (name == "tga")
+    {
+        format = frame_sink_format::FRAME_SINK_TGA;
+    }
+    else if (name == "qoi")
+    {
+        format = frame_sink_format::FRAME_SINK_QOI;
+    }
+    else if (name == "y4m")
+    {
+        format = frame_sink_format::FRAME_SINK_Y4M;
+    }
+    else if (name == "ppm")
+    {
+        format = frame_sink_format::FRAME_SINK_PPM;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool encode_qoi(const Texture &texture, std::vector<uint8_t> &output)
+{
+    int pixel_size = get_frame_pixel_size(texture.m_format);
+    const uint8_t *pixels = texture.get_pixels();
+    if (pixel_size == 0 || pixels == nullptr)
+    {
+        return false;
+    }
+    uint32_t width = texture.m_width;
+    uint32_t height = texture.m_height;
+    bool is_srgb = texture.m_format == texture_format::TEXTURE_FORMAT_SRGB8 ||
+                   texture.m_format == texture_format::TEXTURE_FORMAT_SRGB8_A8;
+
+    // The worst case is one QOI_OP_RGBA per pixel.
+    size_t max_size = QOI_HEADER_SIZE + (size_t)width * height * 5 + QOI_END_MARKER_SIZE;
+    output.resize(max_size);
+    uint8_t *dst = output.data();
+    memcpy(dst, "qoif", 4);
+    write_u32_be(dst + 4, width);
+    write_u32_be(dst + 8, height);
+    dst[12] = (uint8_t)pixel_size;
+    dst[13] = is_srgb ? 0 : 1;
+    dst += QOI_HEADER_SIZE;
+
+    uint8_t index[64][4] = {};
+    uint8_t previous[4] = {0, 0, 0, 0xFF};
+    int run = 0;
+    // QOI images start with the top row, texture rows start with the bottom
+    // row.
+    for (uint32_t row = 0; row < height; row++)
+    {
+        const uint8_t *src = pixels + (size_t)(height - 1 - row) * width * pixel_size;
+        for (uint32_t x = 0; x < width; x++, src += pixel_size)
+        {
+            uint8_t r = src[0], g = src[1], b = src[2];
+            uint8_t a = pixel_size == 4 ? src[3] : 0xFF;
+            if (r == previous[0] && g == previous[1] && b == previous[2] && a == previous[3])
+            {
+                if (++run == QOI_MAX_RUN)
+                {
+                    *dst++ = (uint8_t)(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0)
+            {
+                *dst++ = (uint8_t)(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            int hash = QOI_HASH(r, g, b, a);
+            uint8_t *entry = index[hash];
+            if (entry[0] == r && entry[1] == g && entry[2] == b && entry[3] == a)
+            {
+                *dst++ = (uint8_t)(QOI_OP_INDEX | hash);
+            }
+            else
+            {
+                entry[0] = r;
+                entry[1] = g;
+                entry[2] = b;
+                entry[3] = a;
+                if (a == previous[3])
+                {
+                    // Differences wrap around, as in the specification.
+                    int8_t dr = (int8_t)(r - previous[0]);
+                    int8_t dg = (int8_t)(g - previous[1]);
+                    int8_t db = (int8_t)(b - previous[2]);
+                    int8_t dr_dg = (int8_t)(dr - dg);
+                    int8_t db_dg = (int8_t)(db - dg);
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    {
+                        *dst++ = (uint8_t)(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                    }
+                    else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+                    {
+                        *dst++ = (uint8_t)(QOI_OP_LUMA | (dg + 32));
+                        *dst++ = (uint8_t)((dr_dg + 8) << 4 | (db_dg + 8));
+                    }
+                    else
+                    {
+                        *dst++ = QOI_OP_RGB;
+                        *dst++ = r;
+                        *dst++ = g;
+                        *dst++ = b;
+                    }
+                }
+                else
+                {
+                    *dst++ = QOI_OP_RGBA;
+                    *dst++ = r;
+                    *dst++ = g;
+                    *dst++ = b;
+                    *dst++ = a;
+                }
+            }
+            previous[0] = r;
+            previous[1] = g;
+            previous[2] = b;
+            previous[3] = a;
+        }
+    }
+    if (run > 0)
+    {
+        *dst++ = (uint8_t)(QOI_OP_RUN | (run - 1));
+    }
+    static const uint8_t end_marker[QOI_END_MARKER_SIZE] = {0, 0, 0, 0, 0, 0, 0, 1};
+    memcpy(dst, end_marker, QOI_END_MARKER_SIZE);
+    dst += QOI_END_MARKER_SIZE;
+    output.resize(dst - output.data());
+    return true;
+}
+
+FrameSink::FrameSink(frame_sink_format format, std::string_view path, uint32_t width, uint32_t height,
+                     uint32_t frame_rate)
+    : format(format), path(path), width(width), height(height)
+{
+    if (width == 0 || height == 0)
+    {
+        failed = true;
+        return;
+    }
+    if (format != frame_sink_format::FRAME_SINK_Y4M && format != frame_sink_format::FRAME_SINK_PPM)
+    {
+        return;
+    }
+
+    if (this->path == "-")
+    {
+        stream = stdout;
+        is_stdout = true;
+#ifdef _WIN32
+        // Otherwise every 0x0A byte of a frame is written as 0x0D 0x0A.
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    }
+    else
+    {
+        stream = fopen(this->path.c_str(), "wb");
+        if (stream == nullptr)
+        {
+            failed = true;
+            return;
+        }
+    }
+    // Frames are written with one call each, a large buffer only adds a copy.
+    setvbuf(stream, nullptr, _IONBF, 0);
+
+    if (format == frame_sink_format::FRAME_SINK_Y4M)
+    {
+        std::string header = "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) +
+                             " F" + std::to_string(frame_rate) + ":1 Ip A1:1 C420jpeg\n";
+        write_stream(header.data(), header.size());
+    }
+}
+
+FrameSink::~FrameSink()
+{
+    finish();
+}
+
+bool FrameSink::is_open() const
+{
+    return !failed;
+}
+
+bool FrameSink::writes_to_stdout() const
+{
+    return is_stdout;
+}
+
+uint32_t FrameSink::get_frame_count() const
+{
+    return frame_count;
+}
+
+bool FrameSink::write_stream(const void *data, size_t size)
+{
+    if (failed || stream == nullptr)
+    {
+        return false;
+    }
+    if (fwrite(data, 1, size, stream) != size)
+    {
+        failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool FrameSink::write_frame(const Texture &frame)
+{
+    PROFILE_ZONE("write_frame");
+    if (failed || frame.m_width != width || frame.m_height != height ||
+        get_frame_pixel_size(frame.m_format) == 0 || frame.get_pixels() == nullptr)
+    {
+        return false;
+    }
+
+    std::string frame_path;
+    if (format == frame_sink_format::FRAME_SINK_TGA || format == frame_sink_format::FRAME_SINK_QOI)
+    {
+        frame_path = path + std::to_string(frame_count + 1);
+    }
+
+    bool success = false;
+    switch (format)
+    {
+    case frame_sink_format::FRAME_SINK_TGA:
+        success = save_image(frame, frame_path + ".tga", false, true);
+        break;
+    case frame_sink_format::FRAME_SINK_QOI:
+    {
+        if (!encode_qoi(frame, frame_buffer))
+        {
+            break;
+        }
+        FILE *file = fopen((frame_path + ".qoi").c_str(), "wb");
+        if (file == nullptr)
+        {
+            break;
+        }
+        success = fwrite(frame_buffer.data(), 1, frame_buffer.size(), file) == frame_buffer.size();
+        success = fclose(file) == 0 && success;
+        break;
+    }
+    case frame_sink_format::FRAME_SINK_Y4M:
+        convert_to_y4m(frame);
+        success = write_stream("FRAME\n", 6) && write_stream(frame_buffer.data(), frame_buffer.size());
+        break;
+    case frame_sink_format::FRAME_SINK_PPM:
+        convert_to_ppm(frame);
+        success = write_stream(frame_buffer.data(), frame_buffer.size());
+        break;
+    }
+    if (success)
+    {
+        frame_count++;
+    }
+    return success;
+}
+
+bool FrameSink::finish()
+{
+    if (stream == nullptr)
+    {
+        return !failed;
+    }
+    if (is_stdout)
+    {
+        failed = fflush(stream) != 0 || failed;
+    }
+    else
+    {
+        failed = fclose(stream) != 0 || failed;
+    }
+    stream = nullptr;
+    return !failed;
+}
+
+// Converts 8-bit R'G'B' to BT.601 limited range Y'CbCr with the usual 8-bit
+// fixed point approximation.
+static inline uint8_t rgb_to_y(int r, int g, int b)
+{
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline uint8_t rgb_to_cb(int r, int g, int b)
+{
+    return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline uint8_t rgb_to_cr(int r, int g, int b)
+{
+    return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+void FrameSink::convert_to_y4m(const Texture &frame)
+{
+    int pixel_size = get_frame_pixel_size(frame.m_format);
+    uint32_t chroma_width = (width + 1) / 2;
+    uint32_t chroma_height = (height + 1) / 2;
+    size_t luma_size = (size_t)width * height;
+    size_t chroma_size = (size_t)chroma_width * chroma_height;
+    frame_buffer.resize(luma_size + chroma_size * 2);
+    uint8_t *y_plane = frame_buffer.data();
+    uint8_t *cb_plane = y_plane + luma_size;
+    uint8_t *cr_plane = cb_plane + chroma_size;
+
+    const uint8_t *pixels = frame.get_pixels();
+    size_t row_size = (size_t)width * pixel_size;
+    // Each chroma sample is computed from the average of the 2x2 pixels it
+    // covers. Y4M rows start with the top row.
+    for (uint32_t chroma_y = 0; chroma_y < chroma_height; chroma_y++)
+    {
+        uint32_t row0 = chroma_y * 2;
+        uint32_t row1 = row0 + 1 < height ? row0 + 1 : row0;
+        const uint8_t *src0 = pixels + (height - 1 - row0) * row_size;
+        const uint8_t *src1 = pixels + (height - 1 - row1) * row_size;
+        uint8_t *y0 = y_plane + (size_t)row0 * width;
+        uint8_t *y1 = y_plane + (size_t)row1 * width;
+        for (uint32_t chroma_x = 0; chroma_x < chroma_width; chroma_x++)
+        {
+            uint32_t x0 = chroma_x * 2;
+            uint32_t x1 = x0 + 1 < width ? x0 + 1 : x0;
+            const uint8_t *p00 = src0 + x0 * pixel_size;
+            const uint8_t *p01 = src0 + x1 * pixel_size;
+            const uint8_t *p10 = src1 + x0 * pixel_size;
+            const uint8_t *p11 = src1 + x1 * pixel_size;
+            y0[x0] = rgb_to_y(p00[0], p00[1], p00[2]);
+            y0[x1] = rgb_to_y(p01[0], p01[1], p01[2]);
+            y1[x0] = rgb_to_y(p10[0], p10[1], p10[2]);
+            y1[x1] = rgb_to_y(p11[0], p11[1], p11[2]);
+            int r = (p00[0] + p01[0] + p10[0] + p11[0] + 2) >> 2;
+            int g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) >> 2;
+            int b = (p00[2] + p01[2] + p10[2] + p11[2] + 2) >> 2;
+            cb_plane[(size_t)chroma_y * chroma_width + chroma_x] = rgb_to_cb(r, g, b);
+            cr_plane[(size_t)chroma_y * chroma_width + chroma_x] = rgb_to_cr(r, g, b);
+        }
+    }
+}
+
+void FrameSink::convert_to_ppm(const Texture &frame)
+{
+    int pixel_size = get_frame_pixel_size(frame.m_format);
+    std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    frame_buffer.resize(header.size() + (size_t)width * height * 3);
+    memcpy(frame_buffer.data(), header.data(), header.size());
+    uint8_t *dst = frame_buffer.data() + header.size();
+
+    const uint8_t *pixels = frame.get_pixels();
+    size_t row_size = (size_t)width * pixel_size;
+    for (uint32_t row = 0; row < height; row++)
+    {
+        const uint8_t *src = pixels + (height - 1 - row) * row_size;
+        if (pixel_size == 3)
+        {
+            memcpy(dst, src, row_size);
+            dst += row_size;
+            continue;
+        }
+        for (uint32_t x = 0; x < width; x++, src += 4, dst += 3)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+}
+
+#undef QOI_OP_INDEX
+#undef QOI_OP_DIFF
+#undef QOI_OP_LUMA
+#undef QOI_OP_RUN
+#undef QOI_OP_RGB
+#undef QOI_OP_RGBA
+#undef QOI_HEADER_SIZE
+#undef QOI_END_MARKER_SIZE
+#undef QOI_MAX_RUN
+#undef QOI_HASH
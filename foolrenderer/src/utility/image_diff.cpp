@@ -0,0 +1,107 @@
+#include "utility/image_diff.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+// Returns the number of bytes of a pixel, 0 if the format can not be compared.
+static int get_pixel_size(texture_format format)
+{
+    switch (format)
+    {
+    case texture_format::TEXTURE_FORMAT_RGB8:
+    case texture_format::TEXTURE_FORMAT_SRGB8:
+        return 3;
+    case texture_format::TEXTURE_FORMAT_RGBA8:
+    case texture_format::TEXTURE_FORMAT_SRGB8_A8:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static bool can_compare(const Texture &a, const Texture &b)
+{
+    return a.m_width == b.m_width && a.m_height == b.m_height &&
+           get_pixel_size(a.m_format) != 0 && get_pixel_size(b.m_format) != 0;
+}
+
+bool compare_images(const Texture &a, const Texture &b, image_difference &difference, uint8_t threshold)
+{
+    if (!can_compare(a, b))
+    {
+        return false;
+    }
+    int a_pixel_size = get_pixel_size(a.m_format);
+    int b_pixel_size = get_pixel_size(b.m_format);
+    const uint8_t *a_pixel = a.get_pixels();
+    const uint8_t *b_pixel = b.get_pixels();
+    size_t pixel_count = (size_t)a.m_width * a.m_height;
+
+    uint32_t differing_pixel_count = 0;
+    uint32_t max_error = 0;
+    uint64_t error_sum = 0;
+    uint64_t square_error_sum = 0;
+    for (size_t i = 0; i < pixel_count; i++)
+    {
+        uint32_t pixel_max_error = 0;
+        for (int c = 0; c < 3; c++)
+        {
+            uint32_t error = (uint32_t)abs((int)a_pixel[c] - (int)b_pixel[c]);
+            pixel_max_error = std::max(pixel_max_error, error);
+            error_sum += error;
+            square_error_sum += error * error;
+        }
+        if (pixel_max_error > threshold)
+        {
+            differing_pixel_count++;
+        }
+        max_error = std::max(max_error, pixel_max_error);
+        a_pixel += a_pixel_size;
+        b_pixel += b_pixel_size;
+    }
+
+    double component_count = (double)pixel_count * 3.0;
+    difference.pixel_count = (uint32_t)pixel_count;
+    difference.differing_pixel_count = differing_pixel_count;
+    difference.max_error = max_error;
+    difference.mean_error = error_sum / component_count;
+    if (square_error_sum == 0)
+    {
+        difference.psnr = std::numeric_limits<double>::infinity();
+    }
+    else
+    {
+        double mean_square_error = square_error_sum / component_count;
+        difference.psnr = 10.0 * log10(255.0 * 255.0 / mean_square_error);
+    }
+    return true;
+}
+
+std::unique_ptr<Texture> make_difference_image(const Texture &a, const Texture &b, uint32_t scale)
+{
+    if (!can_compare(a, b))
+    {
+        return nullptr;
+    }
+    int a_pixel_size = get_pixel_size(a.m_format);
+    int b_pixel_size = get_pixel_size(b.m_format);
+    const uint8_t *a_pixel = a.get_pixels();
+    const uint8_t *b_pixel = b.get_pixels();
+    size_t pixel_count = (size_t)a.m_width * a.m_height;
+
+    auto image = std::make_unique<Texture>(texture_format::TEXTURE_FORMAT_RGB8, a.m_width, a.m_height);
+    uint8_t *pixel = image->get_pixels();
+    for (size_t i = 0; i < pixel_count; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            uint32_t error = (uint32_t)abs((int)a_pixel[c] - (int)b_pixel[c]);
+            pixel[c] = (uint8_t)std::min(error * scale, 255u);
+        }
+        a_pixel += a_pixel_size;
+        b_pixel += b_pixel_size;
+        pixel += 3;
+    }
+    return image;
+}
@@ -0,0 +1,66 @@
+#include "utility/instancing.h"
+#include "utility/culling.h"
+
+// Gathers the vertex attributes of the mesh, indexed like its positions.
+static void gather_attributes(const Mesh &mesh, std::vector<standard_vertex_attribute> &attributes)
+{
+    attributes.resize(mesh.vertex_count);
+    for (uint32_t v = 0; v < mesh.vertex_count; v++)
+    {
+        standard_vertex_attribute &attribute = attributes[v];
+        attribute.position = mesh.positions[v];
+        attribute.normal = mesh.normals ? mesh.normals[v] : VEC3_ZERO;
+        attribute.tangent = mesh.tangents ? mesh.tangents[v] : VEC4_ZERO;
+        attribute.texcoord = mesh.texcoords ? mesh.texcoords[v] : VEC2_ZERO;
+    }
+}
+
+uint32_t draw_standard_instances(FrameBuffer *framebuffer, const Mesh &mesh, const standard_uniform &uniform,
+                                 const standard_instance instances[], size_t instance_count,
+                                 standard_instance_scratch &scratch)
+{
+    if (framebuffer == nullptr || mesh.triangle_count == 0 || instance_count == 0)
+    {
+        return 0;
+    }
+    // The uniforms of the instances in the view, in the order of the
+    // instances.
+    std::vector<standard_uniform> &instance_uniforms = scratch.instance_uniforms;
+    instance_uniforms.clear();
+    for (size_t i = 0; i < instance_count; i++)
+    {
+        const standard_instance &instance = instances[i];
+        if (!is_mesh_visible(extract_frustum(uniform.world2clip * instance.local2world), mesh))
+        {
+            continue;
+        }
+        instance_uniforms.push_back(uniform);
+        standard_uniform &instance_uniform = instance_uniforms.back();
+        instance_uniform.local2world = instance.local2world;
+        instance_uniform.local2world_direction = instance.local2world.to_3x3();
+        instance_uniform.local2world_normal = instance.local2world.inverse().transpose().to_3x3();
+        instance_uniform.base_color = instance.base_color;
+        instance_uniform.metallic = instance.metallic;
+        instance_uniform.roughness = instance.roughness;
+    }
+    if (instance_uniforms.empty())
+    {
+        return 0;
+    }
+
+    gather_attributes(mesh, scratch.attributes);
+    const uint32_t *indices = mesh.indices.get();
+    for (const standard_uniform &instance_uniform : instance_uniforms)
+    {
+        transform_vertices(instance_uniform.world2clip * instance_uniform.local2world, mesh.positions_x.get(),
+                           mesh.positions_y.get(), mesh.positions_z.get(), mesh.vertex_count, scratch.vertices);
+        shade_vertices(&instance_uniform, scratch.attributes.data(), sizeof(standard_vertex_attribute),
+                       mesh.vertex_count, scratch.varyings);
+        for (uint32_t t = 0; t < mesh.triangle_count; t++)
+        {
+            draw_shaded_triangle(framebuffer, &instance_uniform, scratch.vertices, scratch.varyings.data(),
+                                 indices + t * 3);
+        }
+    }
+    return (uint32_t)instance_uniforms.size();
+}
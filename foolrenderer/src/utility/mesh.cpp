@@ -1,5 +1,8 @@
 #include "utility/mesh.h"
+#include <algorithm>
+#include <cmath>
 #include <cstring> // for memcpy
+#include "graphics/profiler.h"
 
 #define VERTEX_EQUAL(a, b) \
     ((a)->p == (b)->p && (a)->t == (b)->t && (a)->n == (b)->n)
@@ -31,6 +34,7 @@ Mesh::Mesh(std::string_view filename)
 
 void Mesh::load_model(std::string_view filename)
 {
+    PROFILE_ZONE("load mesh");
     // use std::unique_ptr for exception safe deletion
     auto fastObjDeleter = [](fastObjMesh *data)
     { if (data)fast_obj_destroy(data); };
@@ -46,6 +50,11 @@ void Mesh::load_model(std::string_view filename)
         {
             break;
         }
+        if (!set_position_streams())
+        {
+            break;
+        }
+        compute_bounds();
         if (!set_diffuse_texture_name(data.get()))
         {
             break;
@@ -72,10 +81,15 @@ void Mesh::load_model(std::string_view filename)
 void Mesh::clean_up()
 {
     positions.reset();
+    positions_x.reset();
+    positions_y.reset();
+    positions_z.reset();
     texcoords.reset();
     normals.reset();
     tangents.reset();
     indices.reset();
+    bounds_box = axis_aligned_box{VEC3_ZERO, VEC3_ZERO};
+    bounds_sphere = bounding_sphere{VEC3_ZERO, 0.0f};
     diffuse_texture_path.clear();
     vertex_count = 0;
     triangle_count = 0;
@@ -133,6 +147,24 @@ vec4 Mesh::get_mesh_tangent(uint32_t triangle_index, uint32_t vertex_index) cons
     }
 }
 
+bool Mesh::set_position_streams()
+{
+    positions_x.reset(new float[vertex_count]);
+    positions_y.reset(new float[vertex_count]);
+    positions_z.reset(new float[vertex_count]);
+    if (!positions_x || !positions_y || !positions_z)
+    {
+        return false;
+    }
+    for (uint32_t v = 0; v < vertex_count; v++)
+    {
+        positions_x[v] = positions[v].x;
+        positions_y[v] = positions[v].y;
+        positions_z[v] = positions[v].z;
+    }
+    return true;
+}
+
 bool Mesh::set_vertex_attributes(const fastObjMesh *data)
 {
     uint32_t index_count = 0;
@@ -396,3 +428,34 @@ bool Mesh::compute_tangents()
     }
     return true;
 }
+
+void Mesh::compute_triangle_bounds(uint32_t first_triangle, uint32_t count, axis_aligned_box &box,
+                                   bounding_sphere &sphere) const
+{
+    if (count == 0 || first_triangle >= triangle_count || count > triangle_count - first_triangle)
+    {
+        box = axis_aligned_box{VEC3_ZERO, VEC3_ZERO};
+        sphere = bounding_sphere{VEC3_ZERO, 0.0f};
+        return;
+    }
+    const uint32_t *first = indices.get() + (size_t)first_triangle * 3;
+    const uint32_t *last = first + (size_t)count * 3;
+    vec3 min = positions[*first], max = positions[*first];
+    for (const uint32_t *index = first + 1; index < last; index++)
+    {
+        const vec3 &position = positions[*index];
+        min = vec3{std::min(min.x, position.x), std::min(min.y, position.y), std::min(min.z, position.z)};
+        max = vec3{std::max(max.x, position.x), std::max(max.y, position.y), std::max(max.z, position.z)};
+    }
+    box = axis_aligned_box{min, max};
+    vec3 center = (min + max) * 0.5f;
+    float square_radius = 0.0f;
+    for (const uint32_t *index = first; index < last; index++)
+    {
+        vec3 offset = positions[*index] - center;
+        square_radius = std::max(square_radius, offset.dot(offset));
+    }
+    sphere = bounding_sphere{center, sqrtf(square_radius)};
+}
+
+void Mesh::compute_bounds() { compute_triangle_bounds(0, triangle_count, bounds_box, bounds_sphere); }
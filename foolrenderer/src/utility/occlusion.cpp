@@ -0,0 +1,292 @@
+#include "utility/occlusion.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "rmath/rsimd.h"
+
+OcclusionBuffer::OcclusionBuffer()
+    : m_width(0), m_height(0), m_has_new_occluders(false), m_tested_count(0), m_culled_count(0)
+{}
+
+bool OcclusionBuffer::initialize(uint32_t width, uint32_t height)
+{
+    if (width == 0 || height == 0 || width % OCCLUSION_BUFFER_ALIGNMENT != 0)
+    {
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    depths.reset(new float[(size_t)width * height]);
+    row_depths.reset(new float[(size_t)width * height]);
+    clear();
+    return true;
+}
+
+void OcclusionBuffer::clear()
+{
+    if (depths)
+    {
+        std::fill(depths.get(), depths.get() + (size_t)m_width * m_height, 1.0f);
+    }
+    m_has_new_occluders = false;
+    m_tested_count = 0;
+    m_culled_count = 0;
+}
+
+// An edge function that is positive inside a counterclockwise triangle:
+// a * x + b * y + c.
+struct occluder_edge
+{
+    float a, b, c;
+
+    occluder_edge(const vec4 &from, const vec4 &to)
+    {
+        a = from.y - to.y;
+        b = to.x - from.x;
+        c = -(a * from.x + b * from.y);
+    }
+};
+
+// Writes the farthest depth of the triangle to the texels whose centers it
+// covers. The vertices are in buffer space.
+static void rasterize_occluder(float *depths, uint32_t width, uint32_t height, const vec4 &v0, const vec4 &v1,
+                               const vec4 &v2)
+{
+    // Front faces are counterclockwise, as in the rasterizer.
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (!(area > 0.0f))
+    {
+        return;
+    }
+    float min_x = std::min({v0.x, v1.x, v2.x}), max_x = std::max({v0.x, v1.x, v2.x});
+    float min_y = std::min({v0.y, v1.y, v2.y}), max_y = std::max({v0.y, v1.y, v2.y});
+    // The texels whose centers are inside the bounding box.
+    float last_x = (float)(width - 1), last_y = (float)(height - 1);
+    float left = ceilf(min_x - 0.5f), bottom = ceilf(min_y - 0.5f);
+    float right = floorf(max_x - 0.5f), top = floorf(max_y - 0.5f);
+    if (right < 0.0f || top < 0.0f || left > last_x || bottom > last_y || left > right || bottom > top)
+    {
+        return;
+    }
+    uint32_t x_min = (uint32_t)std::min(left, last_x);
+    uint32_t y_min = (uint32_t)std::min(bottom, last_y);
+    uint32_t x_max = (uint32_t)std::min(right, last_x);
+    uint32_t y_max = (uint32_t)std::min(top, last_y);
+    // Farthest, so that the texel depth is never nearer than the triangle.
+    float depth = std::max({v0.z, v1.z, v2.z});
+    occluder_edge edges[3] = {occluder_edge(v0, v1), occluder_edge(v1, v2), occluder_edge(v2, v0)};
+    // Whole groups of OCCLUSION_BUFFER_ALIGNMENT texels are tested, texels
+    // outside the bounding box fail the edge tests.
+    x_min &= ~(uint32_t)(OCCLUSION_BUFFER_ALIGNMENT - 1);
+
+    for (uint32_t y = y_min; y <= y_max; y++)
+    {
+        float *row = depths + (size_t)y * width;
+        float center_y = y + 0.5f;
+#ifdef RMATH_SIMD
+        simd4f triangle_depth = simd4f_set1(depth);
+        simd4f zero = simd4f_set1(0.0f);
+        simd4f a[3], row_values[3];
+        for (int e = 0; e < 3; e++)
+        {
+            a[e] = simd4f_set1(edges[e].a);
+            row_values[e] = simd4f_set1(edges[e].b * center_y + edges[e].c);
+        }
+        for (uint32_t x = x_min; x <= x_max; x += 4)
+        {
+            const float centers[4] = {x + 0.5f, x + 1.5f, x + 2.5f, x + 3.5f};
+            simd4f center_x = simd4f_load(centers);
+            // Set in the lanes outside any edge.
+            simd4f outside = simd4f_less(simd4f_add(simd4f_mul(a[0], center_x), row_values[0]), zero);
+            for (int e = 1; e < 3; e++)
+            {
+                simd4f value = simd4f_add(simd4f_mul(a[e], center_x), row_values[e]);
+                outside = simd4f_select(outside, outside, simd4f_less(value, zero));
+            }
+            simd4f stored = simd4f_load(row + x);
+            simd4f_store(row + x, simd4f_select(outside, stored, simd4f_min(stored, triangle_depth)));
+        }
+#else
+        for (uint32_t x = x_min; x <= x_max; x++)
+        {
+            float center_x = x + 0.5f;
+            bool is_inside = true;
+            for (int e = 0; e < 3; e++)
+            {
+                is_inside = is_inside && edges[e].a * center_x + edges[e].b * center_y + edges[e].c >= 0.0f;
+            }
+            if (is_inside)
+            {
+                row[x] = std::min(row[x], depth);
+            }
+        }
+#endif
+    }
+}
+
+// Sets each texel to the farthest depth of its 3x3 neighbourhood, in a
+// horizontal and a vertical pass. The neighbours beyond the edges of the
+// buffer are ignored, what is outside of the viewport is not visible anyway.
+static void erode_depths(float *depths, float *row_depths, uint32_t width, uint32_t height)
+{
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const float *source = depths + (size_t)y * width;
+        float *target = row_depths + (size_t)y * width;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            float farthest = source[x];
+            if (x > 0)
+            {
+                farthest = std::max(farthest, source[x - 1]);
+            }
+            if (x + 1 < width)
+            {
+                farthest = std::max(farthest, source[x + 1]);
+            }
+            target[x] = farthest;
+        }
+    }
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const float *center = row_depths + (size_t)y * width;
+        const float *below = y > 0 ? center - width : center;
+        const float *above = y + 1 < height ? center + width : center;
+        float *target = depths + (size_t)y * width;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            target[x] = std::max({below[x], center[x], above[x]});
+        }
+    }
+}
+
+void OcclusionBuffer::draw_occluder(const Mesh &mesh, const matrix4x4 &local2clip)
+{
+    if (!depths || mesh.triangle_count == 0)
+    {
+        return;
+    }
+    projected_vertices.resize(mesh.vertex_count);
+    for (uint32_t v = 0; v < mesh.vertex_count; v++)
+    {
+        vec4 clip = local2clip * mesh.positions[v].to4D(1.0f);
+        if (!(clip.w > 0.0f) || clip.z < -clip.w)
+        {
+            projected_vertices[v] = VEC4_ZERO;
+            continue;
+        }
+        float inverse_w = 1.0f / clip.w;
+        projected_vertices[v] = vec4{(clip.x * inverse_w + 1.0f) * 0.5f * m_width,
+                                     (clip.y * inverse_w + 1.0f) * 0.5f * m_height,
+                                     (clip.z * inverse_w + 1.0f) * 0.5f, 1.0f};
+    }
+    const uint32_t *indices = mesh.indices.get();
+    for (uint32_t t = 0; t < mesh.triangle_count; t++)
+    {
+        const vec4 &v0 = projected_vertices[indices[t * 3]];
+        const vec4 &v1 = projected_vertices[indices[t * 3 + 1]];
+        const vec4 &v2 = projected_vertices[indices[t * 3 + 2]];
+        if (v0.w == 0.0f || v1.w == 0.0f || v2.w == 0.0f)
+        {
+            continue;
+        }
+        rasterize_occluder(depths.get(), m_width, m_height, v0, v1, v2);
+    }
+    m_has_new_occluders = true;
+}
+
+bool OcclusionBuffer::load_depth(const Texture &depth_buffer)
+{
+    if (!depths || depth_buffer.m_format != texture_format::TEXTURE_FORMAT_DEPTH_FLOAT || depth_buffer.m_width == 0 ||
+        depth_buffer.m_height == 0)
+    {
+        return false;
+    }
+    const float *source = (const float *)depth_buffer.get_pixels();
+    for (uint32_t y = 0; y < m_height; y++)
+    {
+        // The pixels that overlap the texel, all of them.
+        uint32_t source_y_min = (uint32_t)((uint64_t)y * depth_buffer.m_height / m_height);
+        uint32_t source_y_max = (uint32_t)(((uint64_t)(y + 1) * depth_buffer.m_height + m_height - 1) / m_height);
+        for (uint32_t x = 0; x < m_width; x++)
+        {
+            uint32_t source_x_min = (uint32_t)((uint64_t)x * depth_buffer.m_width / m_width);
+            uint32_t source_x_max =
+                (uint32_t)(((uint64_t)(x + 1) * depth_buffer.m_width + m_width - 1) / m_width);
+            float farthest = 0.0f;
+            for (uint32_t sy = source_y_min; sy < source_y_max; sy++)
+            {
+                const float *row = source + (size_t)sy * depth_buffer.m_width;
+                for (uint32_t sx = source_x_min; sx < source_x_max; sx++)
+                {
+                    farthest = std::max(farthest, row[sx]);
+                }
+            }
+            depths[(size_t)y * m_width + x] = farthest;
+        }
+    }
+    m_has_new_occluders = false;
+    return true;
+}
+
+bool OcclusionBuffer::is_visible(const axis_aligned_box &box, const matrix4x4 &local2clip)
+{
+    m_tested_count++;
+    if (!depths)
+    {
+        return true;
+    }
+    if (m_has_new_occluders)
+    {
+        erode_depths(depths.get(), row_depths.get(), m_width, m_height);
+        m_has_new_occluders = false;
+    }
+    float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+    float nearest_depth = FLT_MAX;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        vec3 position{corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y,
+                      corner & 4 ? box.max.z : box.min.z};
+        vec4 clip = local2clip * position.to4D(1.0f);
+        if (!(clip.w > 0.0f) || clip.z < -clip.w)
+        {
+            return true;
+        }
+        float inverse_w = 1.0f / clip.w;
+        float x = (clip.x * inverse_w + 1.0f) * 0.5f * m_width;
+        float y = (clip.y * inverse_w + 1.0f) * 0.5f * m_height;
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+        nearest_depth = std::min(nearest_depth, (clip.z * inverse_w + 1.0f) * 0.5f);
+    }
+    float last_x = (float)(m_width - 1), last_y = (float)(m_height - 1);
+    float left = floorf(min_x), bottom = floorf(min_y), right = floorf(max_x), top = floorf(max_y);
+    if (right < 0.0f || top < 0.0f || left > last_x || bottom > last_y)
+    {
+        m_culled_count++;
+        return false;
+    }
+    uint32_t x_min = (uint32_t)std::max(left, 0.0f), x_max = (uint32_t)std::min(right, last_x);
+    uint32_t y_min = (uint32_t)std::max(bottom, 0.0f), y_max = (uint32_t)std::min(top, last_y);
+    for (uint32_t y = y_min; y <= y_max; y++)
+    {
+        const float *row = depths.get() + (size_t)y * m_width;
+        for (uint32_t x = x_min; x <= x_max; x++)
+        {
+            if (row[x] >= nearest_depth)
+            {
+                return true;
+            }
+        }
+    }
+    m_culled_count++;
+    return false;
+}
+
+bool OcclusionBuffer::is_visible(const bounding_sphere &sphere, const matrix4x4 &local2clip)
+{
+    vec3 extent{sphere.radius, sphere.radius, sphere.radius};
+    return is_visible(axis_aligned_box{sphere.center - extent, sphere.center + extent}, local2clip);
+}
@@ -0,0 +1,280 @@
+#include "utility/texture_cache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <system_error>
+#include "graphics/profiler.h"
+#include "graphics/texture_compression.h"
+#include "utility/image.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define TEXTURE_CONTAINER_MAGIC "FTEX"
+
+// The header is written and read with memcpy, so the container is only
+// portable between little endian machines, which are all we target.
+struct texture_container_header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_count;
+    uint32_t tiling;
+    uint32_t data_offset;
+    uint64_t data_size;
+    uint64_t source_size;
+    int64_t source_time;
+    uint8_t reserved[8];
+};
+
+static_assert(sizeof(texture_container_header) == TEXTURE_CONTAINER_HEADER_SIZE,
+              "Unexpected texture container header size.");
+
+// Checks the fields that do not depend on the file size.
+static bool check_header(const texture_container_header &header)
+{
+    if (memcmp(header.magic, TEXTURE_CONTAINER_MAGIC, 4) != 0 ||
+        header.version != TEXTURE_CONTAINER_VERSION ||
+        header.mip_count != 1 || header.tiling != 0 ||
+        header.data_offset < TEXTURE_CONTAINER_HEADER_SIZE ||
+        header.width == 0 || header.height == 0)
+    {
+        return false;
+    }
+    texture_format format = (texture_format)header.format;
+    size_t data_size = Texture::get_data_size(format, header.width, header.height);
+    return data_size != 0 && header.data_size == data_size;
+}
+
+bool save_texture_container(const Texture &texture, std::string_view filename,
+                            uint64_t source_size, int64_t source_time)
+{
+    size_t data_size = Texture::get_data_size(texture.m_format, texture.m_width, texture.m_height);
+    if (data_size == 0 || texture.get_pixels() == nullptr)
+    {
+        return false;
+    }
+
+    texture_container_header header{};
+    memcpy(header.magic, TEXTURE_CONTAINER_MAGIC, 4);
+    header.version = TEXTURE_CONTAINER_VERSION;
+    header.format = (uint32_t)texture.m_format;
+    header.width = texture.m_width;
+    header.height = texture.m_height;
+    header.mip_count = 1;
+    header.tiling = 0;
+    header.data_offset = TEXTURE_CONTAINER_HEADER_SIZE;
+    header.data_size = data_size;
+    header.source_size = source_size;
+    header.source_time = source_time;
+
+    std::ofstream stream(std::string(filename), std::ios::binary | std::ios::trunc);
+    if (!stream)
+    {
+        return false;
+    }
+    stream.write((const char *)&header, sizeof(header));
+    stream.write((const char *)texture.get_pixels(), (std::streamsize)data_size);
+    return (bool)stream;
+}
+
+#ifdef _WIN32
+
+// Maps the whole file with copy-on-write access. Returns the owner of the
+// mapping, or an empty pointer on failure.
+static std::shared_ptr<void> map_file(const std::string &filename, uint8_t *&data, uint64_t &size)
+{
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+    {
+        return nullptr;
+    }
+    void *view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == NULL)
+    {
+        return nullptr;
+    }
+    data = (uint8_t *)view;
+    size = (uint64_t)file_size.QuadPart;
+    return std::shared_ptr<void>(view, [](void *view) { UnmapViewOfFile(view); });
+}
+
+#else
+
+// Maps the whole file with copy-on-write access. Returns the owner of the
+// mapping, or an empty pointer on failure.
+static std::shared_ptr<void> map_file(const std::string &filename, uint8_t *&data, uint64_t &size)
+{
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return nullptr;
+    }
+    struct stat file_status;
+    if (fstat(file, &file_status) != 0 || file_status.st_size <= 0)
+    {
+        close(file);
+        return nullptr;
+    }
+    size_t length = (size_t)file_status.st_size;
+    void *view = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    // The mapping stays valid after the file is closed.
+    close(file);
+    if (view == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    data = (uint8_t *)view;
+    size = length;
+    return std::shared_ptr<void>(view, [length](void *view) { munmap(view, length); });
+}
+
+#endif
+
+std::unique_ptr<Texture> map_texture_container(std::string_view filename,
+                                               uint64_t source_size, int64_t source_time)
+{
+    if (filename.empty())
+    {
+        return nullptr;
+    }
+    uint8_t *data = nullptr;
+    uint64_t file_size = 0;
+    std::shared_ptr<void> mapping = map_file(std::string(filename), data, file_size);
+    if (!mapping || file_size < TEXTURE_CONTAINER_HEADER_SIZE)
+    {
+        return nullptr;
+    }
+
+    texture_container_header header;
+    memcpy(&header, data, sizeof(header));
+    if (!check_header(header) || header.data_offset + header.data_size > file_size)
+    {
+        return nullptr;
+    }
+    if (source_size != 0 && (header.source_size != source_size || header.source_time != source_time))
+    {
+        return nullptr;
+    }
+
+    return std::make_unique<Texture>((texture_format)header.format, header.width, header.height,
+                                     data + header.data_offset, std::move(mapping));
+}
+
+// Loads the image and compresses it to the format compression chooses for it,
+// returns the uncompressed texture if that fails.
+static std::unique_ptr<Texture> load_image_compressed(std::string_view filename, bool is_srgb_encoding,
+                                                      texture_cache_compression compression)
+{
+    auto texture = load_image(filename, is_srgb_encoding);
+    if (!texture || compression == texture_cache_compression::TEXTURE_CACHE_UNCOMPRESSED)
+    {
+        return texture;
+    }
+    texture_format format;
+    if (texture->m_format == texture_format::TEXTURE_FORMAT_R8)
+    {
+        format = texture_format::TEXTURE_FORMAT_BC4;
+    }
+    else if (compression == texture_cache_compression::TEXTURE_CACHE_NORMAL)
+    {
+        format = texture_format::TEXTURE_FORMAT_BC5;
+    }
+    else
+    {
+        format = is_srgb_encoding ? texture_format::TEXTURE_FORMAT_BC1_SRGB : texture_format::TEXTURE_FORMAT_BC1;
+    }
+    auto compressed = compress_texture(*texture, format);
+    return compressed ? std::move(compressed) : std::move(texture);
+}
+
+std::unique_ptr<Texture> load_image_cached(std::string_view filename, bool is_srgb_encoding,
+                                           std::string_view cache_directory, texture_cache_compression compression)
+{
+    PROFILE_ZONE("load_image_cached");
+    if (cache_directory.empty())
+    {
+        return load_image_compressed(filename, is_srgb_encoding, compression);
+    }
+
+    namespace fs = std::filesystem;
+    std::error_code error;
+    fs::path source_path(filename);
+    uint64_t source_size = fs::file_size(source_path, error);
+    if (error)
+    {
+        return nullptr;
+    }
+    int64_t source_time = (int64_t)fs::last_write_time(source_path, error).time_since_epoch().count();
+    if (error)
+    {
+        return nullptr;
+    }
+
+    // The container name keeps the image name readable and adds a hash of the
+    // full path, so images with the same name in different directories do not
+    // collide. sRGB and linear loads, and each compression, are cached
+    // separately because the format differs.
+    static const char *const compression_suffixes[] = {"", "-bc", "-bc-normal"};
+    fs::path absolute_path = fs::absolute(source_path, error);
+    size_t path_hash = std::hash<std::string>{}((error ? source_path : absolute_path).generic_string());
+    std::string container_name = source_path.stem().string() + "-" + std::to_string(path_hash) +
+                                 (is_srgb_encoding ? "-srgb" : "") + compression_suffixes[(int)compression] +
+                                 ".ftex";
+    fs::path container_path = fs::path(cache_directory) / container_name;
+
+    auto texture = map_texture_container(container_path.string(), source_size, source_time);
+    if (texture)
+    {
+        return texture;
+    }
+
+    texture = load_image_compressed(filename, is_srgb_encoding, compression);
+    if (!texture)
+    {
+        return nullptr;
+    }
+    // Write to a temporary file first, so an interrupted write never leaves a
+    // truncated container behind.
+    fs::create_directories(fs::path(cache_directory), error);
+    fs::path temporary_path = container_path;
+    temporary_path += ".tmp";
+    bool saved = save_texture_container(*texture, temporary_path.string(), source_size, source_time);
+    if (saved)
+    {
+        fs::rename(temporary_path, container_path, error);
+    }
+    if (!saved || error)
+    {
+        fs::remove(temporary_path, error);
+    }
+    return texture;
+}
+
+#undef TEXTURE_CONTAINER_MAGIC
@@ -1,6 +1,13 @@
 #include "utility/tgafunc_cpp.h"
-#include <fstream>
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TGA_USE_SSSE3
+#endif
 
 // ----------------------Utilities----------------------
 
@@ -157,7 +164,7 @@ bool set_pixel_format(tga::tga_pixel_format &format, const tga_header &header)
 }
 
 // Used for color mapped image decode.
-uint16_t pixel_to_map_index(uint8_t *pixel_ptr)
+uint16_t pixel_to_map_index(const uint8_t *pixel_ptr)
 {
     // Because only 8-bit index is supported now, so implemented in this way.
     return pixel_ptr[0];
@@ -177,160 +184,255 @@ bool try_get_color_from_map(uint8_t *dest, uint16_t index, const color_map *map)
     return true;
 }
 
-// Decode image data from file stream.
+// Places decoded pixels into the image data. Pixels arrive in file order, the
+// writer stores each file row directly at its final row and swaps the red and
+// blue components while storing, so no separate flip or swizzle pass over the
+// image is needed.
+struct pixel_writer
+{
+    uint8_t *data;
+    size_t row_size;
+    uint16_t width, height;
+    uint8_t pixel_size;
+    // Whether the first file row is the last image row.
+    bool reverse_rows;
+    bool swap_red_blue;
+
+    uint16_t row{0};
+    uint16_t column{0};
+    uint8_t *dest{nullptr};
+
+    pixel_writer(uint8_t *data, const tga::tga_info *info, bool reverse_rows, bool swap_red_blue)
+        : data(data), width(info->width), height(info->height),
+          pixel_size(pixel_format_to_pixel_size(info->pixel_format)), reverse_rows(reverse_rows)
+    {
+        row_size = (size_t)width * pixel_size;
+        // Only formats with separate 8-bit components can be swizzled.
+        this->swap_red_blue = swap_red_blue && pixel_size >= 3;
+        dest = row_pointer(0);
+    }
+
+    uint8_t *row_pointer(uint16_t file_row) const
+    {
+        return data + (reverse_rows ? height - 1 - file_row : file_row) * row_size;
+    }
+
+    inline void store(uint8_t *target, const uint8_t *pixel) const
+    {
+        if (swap_red_blue)
+        {
+            target[0] = pixel[2];
+            target[1] = pixel[1];
+            target[2] = pixel[0];
+            if (pixel_size == 4)
+            {
+                target[3] = pixel[3];
+            }
+        }
+        else
+        {
+            memcpy(target, pixel, pixel_size);
+        }
+    }
+
+    // Moves to the next row once the current one is full.
+    inline void advance(size_t pixel_count)
+    {
+        column += (uint16_t)pixel_count;
+        dest += pixel_count * pixel_size;
+        if (column == width)
+        {
+            column = 0;
+            row++;
+            if (row < height)
+            {
+                dest = row_pointer(row);
+            }
+        }
+    }
+
+    // Writes count copies of one pixel.
+    void fill(const uint8_t *pixel, size_t count)
+    {
+        uint8_t stored[4];
+        store(stored, pixel);
+        while (count > 0)
+        {
+            size_t span = std::min<size_t>(count, width - column);
+            uint8_t *target = dest;
+            for (size_t i = 0; i < span; i++, target += pixel_size)
+            {
+                memcpy(target, stored, pixel_size);
+            }
+            advance(span);
+            count -= span;
+        }
+    }
+
+    // Writes count consecutive pixels.
+    void copy(const uint8_t *pixels, size_t count)
+    {
+        while (count > 0)
+        {
+            size_t span = std::min<size_t>(count, width - column);
+            if (swap_red_blue)
+            {
+                uint8_t *target = dest;
+                for (size_t i = 0; i < span; i++, target += pixel_size, pixels += pixel_size)
+                {
+                    store(target, pixels);
+                }
+            }
+            else
+            {
+                memcpy(dest, pixels, span * pixel_size);
+                pixels += span * pixel_size;
+            }
+            advance(span);
+            count -= span;
+        }
+    }
+};
+
+// Decode image data from the file buffer.
 // Still a C style function
-tga::tga_error decode_data(uint8_t *data,
+tga::tga_error decode_data(pixel_writer &writer,
                            const tga::tga_info *info,
                            uint8_t pixel_size,
                            bool is_color_mapped,
                            const color_map *map,
-                           std::ifstream &stream)
+                           const uint8_t *src, const uint8_t *end)
 {
-    tga::tga_error error_code = tga::tga_error::TGA_NO_ERROR;
     size_t pixel_count = (size_t)info->width * info->height;
+    if ((size_t)(end - src) < pixel_count * pixel_size)
+    {
+        return tga::tga_error::TGA_ERROR_FILE_CANNOT_READ;
+    }
 
     if (is_color_mapped)
     {
+        uint8_t pixel[4];
         for (; pixel_count > 0; --pixel_count)
         {
-            if (stream.read((char *)data, pixel_size).gcount() != pixel_size)
-            {
-                error_code = tga::tga_error::TGA_ERROR_FILE_CANNOT_READ;
-                break;
-            }
             // In color mapped image, the pixel as the index value of the color
             // map. The actual pixel value is found from the color map.
-            uint16_t index = pixel_to_map_index(data);
-            if (!try_get_color_from_map(data, index, map))
+            uint16_t index = pixel_to_map_index(src);
+            if (!try_get_color_from_map(pixel, index, map))
             {
-                error_code = tga::tga_error::TGA_ERROR_COLOR_MAP_INDEX_FAILED;
-                break;
+                return tga::tga_error::TGA_ERROR_COLOR_MAP_INDEX_FAILED;
             }
-            data += map->bytes_per_entry;
+            writer.fill(pixel, 1);
+            src += pixel_size;
         }
     }
     else
     {
-        size_t data_size = pixel_count * pixel_size;
-        if (stream.read((char *)data, data_size).gcount() != data_size)
-        {
-            error_code = tga::tga_error::TGA_ERROR_FILE_CANNOT_READ;
-        }
+        writer.copy(src, pixel_count);
     }
-    return error_code;
+    return tga::tga_error::TGA_NO_ERROR;
 }
 
-// Decode image data with run-length encoding from file stream.
+// Decode image data with run-length encoding from the file buffer.
 // Still a C style function
-tga::tga_error decode_data_rle(uint8_t *data,
+tga::tga_error decode_data_rle(pixel_writer &writer,
                                const tga::tga_info *info,
                                uint8_t pixel_size,
                                bool is_color_mapped,
-                               const color_map *map, std::ifstream &stream)
+                               const color_map *map,
+                               const uint8_t *src, const uint8_t *end)
 {
-    tga::tga_error error_code = tga::tga_error::TGA_NO_ERROR;
     size_t pixel_count = (size_t)info->width * info->height;
-    bool is_run_length_packet = false;
-    uint8_t packet_count = 0;
-    std::vector<uint8_t> pixel_buffer(is_color_mapped ? map->bytes_per_entry : pixel_size);
-
-    // The actual pixel size of the image, In order not to be confused with the
-    // name of the parameter pixel_size, named data element.
-    uint8_t data_element_size = pixel_format_to_pixel_size(info->pixel_format);
+    uint8_t pixel[4];
 
-    for (; pixel_count > 0; --pixel_count)
+    while (pixel_count > 0)
     {
-        if (packet_count == 0)
+        if (src >= end)
         {
-            uint8_t repetition_count_field;
-            if (stream.read((char *)&repetition_count_field, 1).gcount() != 1)
+            return tga::tga_error::TGA_ERROR_FILE_CANNOT_READ;
+        }
+        uint8_t repetition_count_field = *src++;
+        bool is_run_length_packet = repetition_count_field & 0x80;
+        // A packet that runs past the end of the image is cut off.
+        size_t packet_count = std::min<size_t>((repetition_count_field & 0x7F) + 1, pixel_count);
+        size_t packet_size = is_run_length_packet ? pixel_size : packet_count * pixel_size;
+        if ((size_t)(end - src) < packet_size)
+        {
+            return tga::tga_error::TGA_ERROR_FILE_CANNOT_READ;
+        }
+
+        if (!is_color_mapped)
+        {
+            if (is_run_length_packet)
             {
-                error_code = tga::tga_error::TGA_ERROR_FILE_CANNOT_READ;
-                break;
+                writer.fill(src, packet_count);
             }
-            is_run_length_packet = repetition_count_field & 0x80;
-            packet_count = (repetition_count_field & 0x7F) + 1;
-            if (is_run_length_packet)
+            else
             {
-                if (stream.read((char *)pixel_buffer.data(), pixel_size).gcount() != pixel_size)
-                {
-                    error_code = tga::tga_error::TGA_ERROR_FILE_CANNOT_READ;
-                    break;
-                }
-                if (is_color_mapped)
-                {
-                    // In color mapped image, the pixel as the index value of
-                    // the color map. The actual pixel value is found from the
-                    // color map.
-                    uint16_t index = pixel_to_map_index(pixel_buffer.data());
-                    if (!try_get_color_from_map(pixel_buffer.data(), index, map))
-                    {
-                        error_code = tga::tga_error::TGA_ERROR_COLOR_MAP_INDEX_FAILED;
-                        break;
-                    }
-                }
+                writer.copy(src, packet_count);
             }
         }
-
-        if (is_run_length_packet)
+        else if (is_run_length_packet)
         {
-            memcpy(data, pixel_buffer.data(), data_element_size);
+            // In color mapped image, the pixel as the index value of the color
+            // map. The actual pixel value is found from the color map.
+            if (!try_get_color_from_map(pixel, pixel_to_map_index(src), map))
+            {
+                return tga::tga_error::TGA_ERROR_COLOR_MAP_INDEX_FAILED;
+            }
+            writer.fill(pixel, packet_count);
         }
         else
         {
-            if (stream.read((char *)data, pixel_size).gcount() != pixel_size)
-            {
-                error_code = tga::tga_error::TGA_ERROR_FILE_CANNOT_READ;
-                break;
-            }
-            if (is_color_mapped)
+            for (size_t i = 0; i < packet_count; i++)
             {
-                // Again, in color mapped image, the pixel as the index value of
-                // the color map. The actual pixel value is found from the color
-                // map.
-                uint16_t index = pixel_to_map_index(data);
-                if (!try_get_color_from_map(data, index, map))
+                if (!try_get_color_from_map(pixel, pixel_to_map_index(src + i * pixel_size), map))
                 {
-                    error_code = tga::tga_error::TGA_ERROR_COLOR_MAP_INDEX_FAILED;
-                    break;
+                    return tga::tga_error::TGA_ERROR_COLOR_MAP_INDEX_FAILED;
                 }
+                writer.fill(pixel, 1);
             }
         }
-
-        --packet_count;
-        data += data_element_size;
+        src += packet_size;
+        pixel_count -= packet_count;
     }
 
-    return error_code;
+    return tga::tga_error::TGA_NO_ERROR;
 }
 
-tga::tga_error save_image(const uint8_t *data, const tga::tga_info *info, std::ofstream &stream)
+// Fills the header of an image written by this library. The image origin is
+// the upper left corner unless bottom_left_origin is set.
+void fill_header(uint8_t header[HEADER_SIZE], const tga::tga_info *info, bool rle, bool bottom_left_origin)
 {
     int pixel_size = pixel_format_to_pixel_size(info->pixel_format);
-    uint8_t header[HEADER_SIZE];
     memset(header, 0, HEADER_SIZE);
     if (info->pixel_format == tga::tga_pixel_format::TGA_PIXEL_BW8 ||
         info->pixel_format == tga::tga_pixel_format::TGA_PIXEL_BW16)
     {
-        header[2] = (uint8_t)TGA_TYPE_GRAYSCALE;
+        header[2] = (uint8_t)(rle ? TGA_TYPE_RLE_GRAYSCALE : TGA_TYPE_GRAYSCALE);
     }
     else
     {
-        header[2] = (uint8_t)TGA_TYPE_TRUE_COLOR;
+        header[2] = (uint8_t)(rle ? TGA_TYPE_RLE_TRUE_COLOR : TGA_TYPE_TRUE_COLOR);
     }
     header[12] = info->width & 0xFF;
     header[13] = (info->width >> 8) & 0xFF;
     header[14] = info->height & 0xFF;
     header[15] = (info->height >> 8) & 0xFF;
     header[16] = pixel_size * 8;
-    if (info->pixel_format == tga::tga_pixel_format::TGA_PIXEL_ARGB32)
-    {
-        header[17] = 0x28;
-    }
-    else
+    // The low 4 bits are the number of alpha bits, bit 5 set means the first
+    // row is the top row.
+    header[17] = info->pixel_format == tga::tga_pixel_format::TGA_PIXEL_ARGB32 ? 0x08 : 0x00;
+    if (!bottom_left_origin)
     {
-        header[17] = 0x20;
+        header[17] |= 0x20;
     }
+}
+
+tga::tga_error save_image(const uint8_t *data, const tga::tga_info *info, std::ofstream &stream)
+{
+    int pixel_size = pixel_format_to_pixel_size(info->pixel_format);
+    uint8_t header[HEADER_SIZE];
+    fill_header(header, info, false, false);
 
     if (!stream.write((char *)header, HEADER_SIZE))
     {
@@ -346,6 +448,219 @@ tga::tga_error save_image(const uint8_t *data, const tga::tga_info *info, std::o
     return tga::tga_error::TGA_NO_ERROR;
 }
 
+// Run-length encodes one row. Packets never cross rows, as the TGA 2.0
+// specification recommends. Returns the end of the encoded data, dst must
+// have room for a row plus one packet header per pixel: a 1 pixel raw packet
+// followed by a run of 2 pixels takes 2 headers for 3 pixels, which for 1 byte
+// pixels is more than the row itself.
+uint8_t *encode_row_rle(const uint8_t *row, int width, int pixel_size, uint8_t *dst)
+{
+    int x = 0;
+    while (x < width)
+    {
+        const uint8_t *pixel = row + x * pixel_size;
+        // Length of the run of pixels equal to this one.
+        int run = 1;
+        while (x + run < width && run < 128 && memcmp(pixel, pixel + run * pixel_size, pixel_size) == 0)
+        {
+            run++;
+        }
+        if (run >= 2)
+        {
+            *dst++ = (uint8_t)(0x80 | (run - 1));
+            memcpy(dst, pixel, pixel_size);
+            dst += pixel_size;
+            x += run;
+            continue;
+        }
+        // Collect raw pixels until two equal neighbors start a run.
+        int count = 1;
+        while (x + count < width && count < 128 &&
+               (x + count + 1 >= width ||
+                memcmp(row + (x + count) * pixel_size, row + (x + count + 1) * pixel_size, pixel_size) != 0))
+        {
+            count++;
+        }
+        *dst++ = (uint8_t)(count - 1);
+        memcpy(dst, pixel, (size_t)count * pixel_size);
+        dst += (size_t)count * pixel_size;
+        x += count;
+    }
+    return dst;
+}
+
+#ifdef TGA_USE_SSSE3
+
+// Converts 4 RGBA pixels per iteration with byte shuffles. Returns the number
+// of pixels converted, the caller converts the rest.
+__attribute__((target("ssse3"))) int convert_rgba_row_ssse3(const uint8_t *src, uint8_t *dst, int pixel_count,
+                                                            bool alpha)
+{
+    int p = 0;
+    if (alpha)
+    {
+        const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        for (; p + 4 <= pixel_count; p += 4)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i *)(src + p * 4));
+            _mm_storeu_si128((__m128i *)(dst + p * 4), _mm_shuffle_epi8(pixels, shuffle));
+        }
+    }
+    else
+    {
+        // 16 bytes are stored for 12 bytes of output, the last 4 are
+        // overwritten by the next iteration, so stop one group early.
+        const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        for (; p + 8 <= pixel_count; p += 4)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i *)(src + p * 4));
+            _mm_storeu_si128((__m128i *)(dst + p * 3), _mm_shuffle_epi8(pixels, shuffle));
+        }
+    }
+    return p;
+}
+#endif
+
+// ----------------------tga row conversion----------------------
+namespace tga
+{
+
+    void convert_rgb_row(const uint8_t *src, int component_count, uint8_t *dst, tga_pixel_format format,
+                         int pixel_count)
+    {
+        int dst_component_count = format == tga_pixel_format::TGA_PIXEL_ARGB32 ? 4 : 3;
+        int p = 0;
+#ifdef TGA_USE_SSSE3
+        static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+        if (has_ssse3 && component_count == 4)
+        {
+            p = convert_rgba_row_ssse3(src, dst, pixel_count, dst_component_count == 4);
+        }
+#endif
+        src += (size_t)p * component_count;
+        dst += (size_t)p * dst_component_count;
+        for (; p < pixel_count; p++)
+        {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            if (dst_component_count == 4)
+            {
+                // The alpha channel is set to 0xFF if the source has none.
+                dst[3] = component_count == 4 ? src[3] : 0xFF;
+            }
+            src += component_count;
+            dst += dst_component_count;
+        }
+    }
+
+}
+
+// ----------------------tga::ImageWriter implementation----------------------
+namespace tga
+{
+
+    ImageWriter::ImageWriter(std::string_view filepath, int width, int height, tga_pixel_format format,
+                             bool rle, bool bottom_left_origin)
+        : filepath(filepath), img_info{(uint16_t)width, (uint16_t)height, format}, rle(rle)
+    {
+        if (!check_dimensions(width, height))
+        {
+            err = tga_error::TGA_ERROR_INVALID_IMAGE_DIMENSIONS;
+            return;
+        }
+        pixel_size = pixel_format_to_pixel_size(format);
+        if (pixel_size == -1)
+        {
+            err = tga_error::TGA_ERROR_UNSUPPORTED_PIXEL_FORMAT;
+            return;
+        }
+
+        stream.open(this->filepath, std::ios::binary);
+        if (!stream.good())
+        {
+            err = tga_error::TGA_ERROR_FILE_CANNOT_WRITE;
+            return;
+        }
+        uint8_t header[HEADER_SIZE];
+        fill_header(header, &img_info, rle, bottom_left_origin);
+        if (!stream.write((char *)header, HEADER_SIZE))
+        {
+            err = tga_error::TGA_ERROR_FILE_CANNOT_WRITE;
+            return;
+        }
+        size_t row_size = (size_t)width * pixel_size;
+        row_buffer.resize(row_size);
+        if (rle)
+        {
+            encode_buffer.resize(row_size + width);
+        }
+    }
+
+    ImageWriter::~ImageWriter()
+    {
+        finish();
+    }
+
+    bool ImageWriter::write_row(const uint8_t *row)
+    {
+        if (err != tga_error::TGA_NO_ERROR || rows_written >= img_info.height)
+        {
+            return false;
+        }
+        const uint8_t *data = row;
+        size_t size = (size_t)img_info.width * pixel_size;
+        if (rle)
+        {
+            uint8_t *end = encode_row_rle(row, img_info.width, pixel_size, encode_buffer.data());
+            data = encode_buffer.data();
+            size = end - data;
+        }
+        if (!stream.write((const char *)data, size))
+        {
+            err = tga_error::TGA_ERROR_FILE_CANNOT_WRITE;
+            return false;
+        }
+        rows_written++;
+        return true;
+    }
+
+    bool ImageWriter::write_rgb_row(const uint8_t *row, int component_count)
+    {
+        if (err != tga_error::TGA_NO_ERROR || pixel_size < 3)
+        {
+            return false;
+        }
+        convert_rgb_row(row, component_count, row_buffer.data(), img_info.pixel_format, img_info.width);
+        return write_row(row_buffer.data());
+    }
+
+    bool ImageWriter::finish()
+    {
+        if (!stream.is_open())
+        {
+            return err == tga_error::TGA_NO_ERROR;
+        }
+        stream.close();
+        if (err == tga_error::TGA_NO_ERROR && rows_written != img_info.height)
+        {
+            err = tga_error::TGA_ERROR_NO_DATA;
+        }
+        if (err != tga_error::TGA_NO_ERROR)
+        {
+            std::remove(filepath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    tga_error ImageWriter::last_error() const
+    {
+        return err;
+    }
+
+}
+
 // ----------------------tga::Image implementation----------------------
 namespace tga
 {
@@ -370,42 +685,57 @@ namespace tga
         err = tga_error::TGA_NO_ERROR;
     }
 
-    Image::Image(std::string_view filepath)
+    Image::Image(std::string_view filepath, const tga_load_options &options)
     {
-        load(filepath);
+        load(filepath, options);
     }
 
-    bool Image::load(std::string_view filepath)
+    bool Image::load(std::string_view filepath, const tga_load_options &options)
     {
-        std::ifstream inFile(filepath.data(), std::ios::binary);
+        // Read the whole file with one call and decode from memory.
+        std::ifstream inFile(filepath.data(), std::ios::binary | std::ios::ate);
         if (!inFile.good())
         {
             err = tga_error::TGA_ERROR_FILE_CANNOT_READ;
             return false;
         }
+        std::streamoff file_size = inFile.tellg();
+        if (file_size < HEADER_SIZE)
+        {
+            err = tga_error::TGA_ERROR_FILE_CANNOT_READ;
+            return false;
+        }
+        std::vector<uint8_t> file_data((size_t)file_size);
+        inFile.seekg(0);
+        if (!inFile.read((char *)file_data.data(), file_size))
+        {
+            err = tga_error::TGA_ERROR_FILE_CANNOT_READ;
+            return false;
+        }
+        const uint8_t *src = file_data.data();
+        const uint8_t *end = src + file_data.size();
 
         tga_header header;
 
         // -----------Start load header-----------
         {
-            inFile.read((char *)&header.id_length, 1);
-            inFile.read((char *)&header.map_type, 1);
-            inFile.read((char *)&header.image_type, 1);
-            inFile.read((char *)&header.map_first_entry, 2);
-            inFile.read((char *)&header.map_length, 2);
-            inFile.read((char *)&header.map_entry_size, 1);
-            inFile.read((char *)&header.image_x_origin, 2);
-            inFile.read((char *)&header.image_y_origin, 2);
-            inFile.read((char *)&header.image_width, 2);
-            inFile.read((char *)&header.image_height, 2);
-            inFile.read((char *)&header.pixel_depth, 1);
-            inFile.read((char *)&header.image_descriptor, 1);
-
-            if (inFile.rdstate())
-            {
-                err = tga_error::TGA_ERROR_FILE_CANNOT_READ;
-                return false;
-            }
+            // All fields are little endian.
+            auto read_u16 = [](const uint8_t *bytes)
+            { return (uint16_t)(bytes[0] | bytes[1] << 8); };
+            header.id_length = src[0];
+            header.map_type = src[1];
+            header.image_type = src[2];
+            header.map_first_entry = read_u16(src + 3);
+            header.map_length = read_u16(src + 5);
+            header.map_entry_size = src[7];
+            header.image_x_origin = read_u16(src + 8);
+            header.image_y_origin = read_u16(src + 10);
+            header.image_width = read_u16(src + 12);
+            header.image_height = read_u16(src + 14);
+            header.pixel_depth = src[16];
+            header.image_descriptor = src[17];
+            src += HEADER_SIZE;
+
             if (header.map_type > 1)
             {
                 err = tga_error::TGA_ERROR_UNSUPPORTED_COLOR_MAP_TYPE;
@@ -438,11 +768,12 @@ namespace tga
         // img_info.pixel_format is already set
 
         // No need to handle the content of the ID field, so skip directly.
-        if (!inFile.seekg(header.id_length, std::ios::cur))
+        if (end - src < header.id_length)
         {
             err = tga_error::TGA_ERROR_FILE_CANNOT_READ;
             return false;
         }
+        src += header.id_length;
 
         bool is_color_mapped = IS_COLOR_MAPPED(header);
         bool is_rle = IS_RLE(header);
@@ -452,44 +783,44 @@ namespace tga
         // -----------Handle color map field-----------
         {
             size_t map_size = header.map_length * BITS_TO_BYTES(header.map_entry_size);
+            if (header.map_type == 1 && (size_t)(end - src) < map_size)
+            {
+                err = tga_error::TGA_ERROR_FILE_CANNOT_READ;
+                return false;
+            }
             if (is_color_mapped)
             {
                 color_map.first_index = header.map_first_entry;
                 color_map.entry_count = header.map_length;
                 color_map.bytes_per_entry = BITS_TO_BYTES(header.map_entry_size);
-                color_map.pixels.resize(map_size);
-
-                if (inFile.read((char *)color_map.pixels.data(), map_size).gcount() != map_size)
-                {
-                    err = tga_error::TGA_ERROR_FILE_CANNOT_READ;
-                    return false;
-                }
+                color_map.pixels.assign(src, src + map_size);
             }
-            else if (header.map_type == 1)
+            // If the image is not color mapped but contains a color map, the
+            // color map data block is skipped.
+            if (header.map_type == 1)
             {
-                // The image is not color mapped at this time, but contains a color map.
-                // So skips the color map data block directly.
-                if (!inFile.seekg(map_size, std::ios::cur))
-                {
-                    err = tga_error::TGA_ERROR_FILE_CANNOT_READ;
-                    return false;
-                }
+                src += map_size;
             }
         }
 
         this->data.resize((size_t)header.image_width * header.image_height * pixel_format_to_pixel_size(img_info.pixel_format));
 
         // -----------Load image data-----------
+        // The rows are stored bottom-up unless the descriptor says otherwise.
+        // Without options the image keeps the origin in the upper left corner.
+        bool is_top_first = header.image_descriptor & 0x20;
+        pixel_writer writer(data.data(), &img_info, is_top_first == options.bottom_left_origin,
+                            options.swap_red_blue);
         uint8_t pixel_size = BITS_TO_BYTES(header.pixel_depth);
         if (is_rle)
         {
-            err = decode_data_rle(data.data(), &img_info, pixel_size, is_color_mapped,
-                                  &color_map, inFile);
+            err = decode_data_rle(writer, &img_info, pixel_size, is_color_mapped,
+                                  &color_map, src, end);
         }
         else
         {
-            err = decode_data(data.data(), &img_info, pixel_size, is_color_mapped,
-                              &color_map, inFile);
+            err = decode_data(writer, &img_info, pixel_size, is_color_mapped,
+                              &color_map, src, end);
         }
 
         if (err != tga_error::TGA_NO_ERROR)
@@ -497,17 +828,13 @@ namespace tga
             return false;
         }
 
-        // Flip the image if necessary, to keep the origin in upper left corner.
+        // Flip the image if necessary, to keep the origin on the left. Images
+        // stored right-to-left are rare, so this is not fused into decoding.
         bool b_flip_h = header.image_descriptor & 0x10;
-        bool b_flip_v = !(header.image_descriptor & 0x20);
         if (b_flip_h)
         {
             flip_h();
         }
-        if (b_flip_v)
-        {
-            flip_v();
-        }
 
         return true;
     }
@@ -652,3 +979,5 @@ namespace tga
         return data;
     }
 }
+
+#undef TGA_USE_SSSE3